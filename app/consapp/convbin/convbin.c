@@ -43,6 +43,8 @@
 *                           force option -scan
 *                           delete option -noscan
 *                           suppress warnings
+*           2026/10/19 1.21 support multiple input files converted by threads
+*                           add option -nt, -tscan
 *-----------------------------------------------------------------------------*/
 #define _POSIX_C_SOURCE 199506
 #include <stdio.h>
@@ -55,13 +57,14 @@
 #define PRGNAME   "CONVBIN"
 #define TRACEFILE "convbin.trace"
 #define NOUTFILE        9       /* number of output files */
+#define MAXFILE         1024    /* max number of input files */
 
 /* help text -----------------------------------------------------------------*/
 static const char *help[]={
 "",
 " Synopsis",
 "",
-" convbin [option ...] file", 
+" convbin [option ...] file [file ...]", 
 "",
 " Description",
 "",
@@ -90,7 +93,7 @@ static const char *help[]={
 "",
 " Options [default]",
 "",
-"     file         input receiver binary log file",
+"     file         input receiver binary log file(s)",
 "     -ts y/m/d h:m:s  start time [all]",
 "     -te y/m/d h:m:s  end time [all]",
 "     -tr y/m/d h:m:s  approximated time for RTCM",
@@ -147,6 +150,8 @@ static const char *help[]={
 "     -b cfile     output RINEX CNAV file",
 "     -i ifile     output RINEX INAV file",
 "     -s sfile     output SBAS message file",
+"     -tscan tscan obs-type scan window (s) (0:scan all input) [0]",
+"     -nt nthread  number of threads for multiple input files [1]",
 "     -trace level output trace level [off]",
 "",
 " If any output file specified, default output files (<file>.obs,",
@@ -173,6 +178,15 @@ static const char *help[]={
 "     *.obs,*.*o    RINEX OBS",
 "     *.rnx         RINEX OBS"
 "     *.nav,*.*n    RINEX NAV",
+"",
+" If multiple input files are specified, they are converted independently",
+" with the default output files or the output files by -c option and the",
+" formats of the files must be same. The conversions are executed in",
+" parallel by -nt option.",
+" With -tscan option, the obs-types are scanned only in the first tscan",
+" seconds of the observation data instead of scanning all of the input",
+" before the conversion. The obs-types appearing after the window are not",
+" output. The option is ignored with -halfc option.",
 };
 /* print help ----------------------------------------------------------------*/
 static void printhelp(void)
@@ -189,13 +203,52 @@ extern int showmsg(const char *format, ...)
     fprintf(stderr,*format?"\r":"\n");
     return 0;
 }
-/* convert main --------------------------------------------------------------*/
-static int convbin(int format, rnxopt_t *opt, const char *ifile, char **file,
-                   char *dir)
+/* get start time of input file -----------------------------------------------*/
+static int get_filetime(const char *file, gtime_t *time)
+{
+    FILE *fp;
+    struct stat st;
+    struct tm *tm;
+    uint32_t time_time;
+    uint8_t buff[64];
+    double ep[6];
+    char path[1024],*paths[1],path_tag[1024];
+
+    paths[0]=path;
+    
+    if (!expath(file,paths,1)) return 0;
+    
+    /* get start time of time-tag file */
+    sprintf(path_tag,"%.1019s.tag",path);
+    if ((fp=fopen(path_tag,"rb"))) {
+        if (fread(buff,64,1,fp)==1&&!strncmp((char *)buff,"TIMETAG",7)&&
+            fread(&time_time,4,1,fp)==1) {
+            time->time=time_time; 
+            time->sec=0.0;
+            fclose(fp);
+            return 1;
+        }
+        fclose(fp);
+    }
+    /* get modified time of input file */
+    if (!stat(path,&st)&&(tm=gmtime(&st.st_mtime))) {
+        ep[0]=tm->tm_year+1900;
+        ep[1]=tm->tm_mon+1;
+        ep[2]=tm->tm_mday;
+        ep[3]=tm->tm_hour;
+        ep[4]=tm->tm_min;
+        ep[5]=tm->tm_sec;
+        *time=utc2gpst(epoch2time(ep));
+        return 1;
+    }
+    return 0;
+}
+/* set output files ----------------------------------------------------------*/
+static void setoutfile(const rnxopt_t *opt, const char *ifile, char **file,
+                       const char *dir, char **ofile)
 {
     int i,def;
-    static char work[1024],ofile_[NOUTFILE][1024]={"","","","","","","","",""};
-    char ifile_[1024],*ofile[NOUTFILE],*p;
+    char work[1024],ifile_[1024],*p;
     char *extnav=(opt->rnxver<=299||opt->navsys==SYS_GPS)?"N":"P";
     char *extlog="sbs";
     
@@ -206,7 +259,7 @@ static int convbin(int format, rnxopt_t *opt, const char *ifile, char **file,
     def=!file[0]&&!file[1]&&!file[2]&&!file[3]&&!file[4]&&!file[5]&&!file[6]&&
         !file[7]&&!file[8];
     
-    for (i=0;i<NOUTFILE;i++) ofile[i]=ofile_[i];
+    for (i=0;i<NOUTFILE;i++) *ofile[i]='\0';
     
     if (file[0]) strcpy(ofile[0],file[0]);
     else if (*opt->staid) {
@@ -298,6 +351,10 @@ static int convbin(int format, rnxopt_t *opt, const char *ifile, char **file,
         else strcpy(work,ofile[i]);
         sprintf(ofile[i],"%s%c%s",dir,RTKLIB_FILEPATHSEP,work);
     }
+}
+/* show input and output files -----------------------------------------------*/
+static void showfile(int format, const char *ifile, char **ofile)
+{
     fprintf(stderr,"input file  : %s (%s)\n",ifile,formatstrs[format]);
     
     if (*ofile[0]) fprintf(stderr,"->rinex obs : %s\n",ofile[0]);
@@ -309,6 +366,22 @@ static int convbin(int format, rnxopt_t *opt, const char *ifile, char **file,
     if (*ofile[6]) fprintf(stderr,"->rinex cnav: %s\n",ofile[6]);
     if (*ofile[7]) fprintf(stderr,"->rinex inav: %s\n",ofile[7]);
     if (*ofile[8]) fprintf(stderr,"->sbas log  : %s\n",ofile[8]);
+}
+/* convert main --------------------------------------------------------------*/
+static int convbin(int format, rnxopt_t *opt, const char *ifile, char **file,
+                   char *dir)
+{
+    static char ofile_[NOUTFILE][1024];
+    char *ofile[NOUTFILE];
+    int i;
+    
+    for (i=0;i<NOUTFILE;i++) ofile[i]=ofile_[i];
+    
+    if (!opt->trtcm.time) {
+        get_filetime(ifile,&opt->trtcm);
+    }
+    setoutfile(opt,ifile,file,dir,ofile);
+    showfile(format,ifile,ofile);
     
     if (!convrnx(format,opt,ifile,ofile)) {
         fprintf(stderr,"\n");
@@ -317,6 +390,39 @@ static int convbin(int format, rnxopt_t *opt, const char *ifile, char **file,
     fprintf(stderr,"\n");
     return 1;
 }
+/* convert main for multiple input files -------------------------------------*/
+static int convbin_batch(int format, const rnxopt_t *opt, char **ifile, int n,
+                         char **file, char *dir, int nthread)
+{
+    rnxopt_t *opts;
+    char *buff,**ofile;
+    int i,j,stat;
+    
+    opts=(rnxopt_t *)malloc(sizeof(rnxopt_t)*n);
+    buff=(char *)malloc(1024*NOUTFILE*n);
+    ofile=(char **)malloc(sizeof(char *)*NOUTFILE*n);
+    if (!opts||!buff||!ofile) {
+        fprintf(stderr,"memory allocation error\n");
+        free(opts); free(buff); free(ofile);
+        return 0;
+    }
+    for (i=0;i<n;i++) {
+        opts[i]=*opt;
+        if (!opts[i].trtcm.time) {
+            get_filetime(ifile[i],&opts[i].trtcm);
+        }
+        for (j=0;j<NOUTFILE;j++) ofile[i*NOUTFILE+j]=buff+1024*(i*NOUTFILE+j);
+        setoutfile(opts+i,ifile[i],file,dir,ofile+i*NOUTFILE);
+        showfile(format,ifile[i],ofile+i*NOUTFILE);
+    }
+    stat=convrnx_batch(format,opts,ifile,ofile,n,nthread);
+    fprintf(stderr,"\n");
+    
+    if (stat>=0) fprintf(stderr,"converted %d/%d files\n",stat,n);
+    
+    free(opts); free(buff); free(ofile);
+    return stat==n;
+}
 /* set signal mask -----------------------------------------------------------*/
 static void setmask(const char *argv, rnxopt_t *opt, int mask)
 {
@@ -375,49 +481,9 @@ static void setglofcn(const char *argv, rnxopt_t *opt) {
     opt->glofcn[i] = fcn + 8;
   }
 }
-/* get start time of input file -----------------------------------------------*/
-static int get_filetime(const char *file, gtime_t *time)
-{
-    FILE *fp;
-    struct stat st;
-    struct tm *tm;
-    uint32_t time_time;
-    uint8_t buff[64];
-    double ep[6];
-    char path[1024],*paths[1],path_tag[1024];
-
-    paths[0]=path;
-    
-    if (!expath(file,paths,1)) return 0;
-    
-    /* get start time of time-tag file */
-    sprintf(path_tag,"%.1019s.tag",path);
-    if ((fp=fopen(path_tag,"rb"))) {
-        if (fread(buff,64,1,fp)==1&&!strncmp((char *)buff,"TIMETAG",7)&&
-            fread(&time_time,4,1,fp)==1) {
-            time->time=time_time; 
-            time->sec=0.0;
-            fclose(fp);
-            return 1;
-        }
-        fclose(fp);
-    }
-    /* get modified time of input file */
-    if (!stat(path,&st)&&(tm=gmtime(&st.st_mtime))) {
-        ep[0]=tm->tm_year+1900;
-        ep[1]=tm->tm_mon+1;
-        ep[2]=tm->tm_mday;
-        ep[3]=tm->tm_hour;
-        ep[4]=tm->tm_min;
-        ep[5]=tm->tm_sec;
-        *time=utc2gpst(epoch2time(ep));
-        return 1;
-    }
-    return 0;
-}
 /* parse command line options ------------------------------------------------*/
 static int cmdopts(int argc, char **argv, rnxopt_t *opt, char **ifile,
-                   char **ofile, char **dir, int *trace)
+                   int *n, char **ofile, char **dir, int *nthread, int *trace)
 {
     double eps[]={1980,1,1,0,0,0},epe[]={2037,12,31,0,0,0};
     double epr[]={2010,1,1,0,0,0},span=0.0;
@@ -583,6 +649,12 @@ static int cmdopts(int argc, char **argv, rnxopt_t *opt, char **ifile,
         else if (!strcmp(argv[i],"-b" )&&i+1<argc) ofile[6]=argv[++i];
         else if (!strcmp(argv[i],"-i" )&&i+1<argc) ofile[7]=argv[++i];
         else if (!strcmp(argv[i],"-s" )&&i+1<argc) ofile[8]=argv[++i];
+        else if (!strcmp(argv[i],"-tscan")&&i+1<argc) {
+            opt->tscan=atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i],"-nt")&&i+1<argc) {
+            *nthread=atoi(argv[++i]);
+        }
         else if (!strcmp(argv[i],"-trace" )&&i+1<argc) {
             *trace=atoi(argv[++i]);
         }
@@ -592,7 +664,7 @@ static int cmdopts(int argc, char **argv, rnxopt_t *opt, char **ifile,
         }
         else if (!strncmp(argv[i],"-",1)) printhelp();
         
-        else *ifile=argv[i];
+        else if (*n<MAXFILE) ifile[(*n)++]=argv[i];
     }
     if (span>0.0&&opt->ts.time) {
         opt->te=timeadd(opt->ts,span*3600.0-1e-3);
@@ -604,9 +676,8 @@ static int cmdopts(int argc, char **argv, rnxopt_t *opt, char **ifile,
     if (nf>=5) opt->freqtype|=FREQTYPE_L5;
     if (nf>=6) opt->freqtype|=FREQTYPE_ALL;
     
-    if (!opt->trtcm.time) {
-        get_filetime(*ifile,&opt->trtcm);
-    }
+    if (*n<=0) return -1;
+    
     if (*fmt) {
         if      (!strcmp(fmt,"rtcm2")) format=STRFMT_RTCM2;
         else if (!strcmp(fmt,"rtcm3")) format=STRFMT_RTCM3;
@@ -627,7 +698,7 @@ static int cmdopts(int argc, char **argv, rnxopt_t *opt, char **ifile,
     }
     else {
         paths[0]=path;
-        if (!expath(*ifile,paths,1)||!(p=strrchr(path,'.'))) return -1;
+        if (!expath(ifile[0],paths,1)||!(p=strrchr(path,'.'))) return -1;
         if      (!strcmp(p,".rtcm2"))  format=STRFMT_RTCM2;
         else if (!strcmp(p,".rtcm3"))  format=STRFMT_RTCM3;
         else if (!strcmp(p,".gps"  ))  format=STRFMT_OEM4;
@@ -657,13 +728,13 @@ static int cmdopts(int argc, char **argv, rnxopt_t *opt, char **ifile,
 int main(int argc, char **argv)
 {
     rnxopt_t opt={{0}};
-    int format,trace=0,stat;
-    char *ifile="",*ofile[NOUTFILE]={0},*dir="";
+    int i,format,n=0,nthread=1,trace=0,stat;
+    char *ifile[MAXFILE],*ofile[NOUTFILE]={0},*dir="";
     
     /* parse command line options */
-    format=cmdopts(argc,argv,&opt,&ifile,ofile,&dir,&trace);
+    format=cmdopts(argc,argv,&opt,ifile,&n,ofile,&dir,&nthread,&trace);
     
-    if (!*ifile) {
+    if (n<=0) {
         fprintf(stderr,"no input file\n");
         return EXIT_FAILURE;
     }
@@ -676,7 +747,17 @@ int main(int argc, char **argv)
         traceopen(TRACEFILE);
         tracelevel(trace);
     }
-    stat=convbin(format,&opt,ifile,ofile,dir);
+    if (n==1) {
+        stat=convbin(format,&opt,ifile[0],ofile,dir);
+    }
+    else {
+        for (i=0;i<NOUTFILE;i++) {
+            if (!ofile[i]) continue;
+            fprintf(stderr,"output file option with multiple input files\n");
+            return EXIT_FAILURE;
+        }
+        stat=convbin_batch(format,&opt,ifile,n,ofile,dir,nthread);
+    }
     
     traceclose();
     
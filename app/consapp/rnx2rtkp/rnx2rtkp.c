@@ -73,6 +73,8 @@ static const char *help[]={
 "           rover latitude/longitude/height for fixed or ppp-fixed mode",
 " -y level  output solution status (0:off,1:states,2:residuals) [0]",
 " -x level  debug trace level (0:off) [0]",
+" -cache dir binary cache directory of input data (see rnxcache) [off]",
+" -stream   stream obs data in forward processing with bounded memory [off]",
 " --version display release version",
 };
 /* show message --------------------------------------------------------------*/
@@ -180,6 +182,10 @@ int main(int argc, char **argv)
         }
         else if (!strcmp(argv[i],"-y")&&i+1<argc) solopt.sstat=atoi(argv[++i]);
         else if (!strcmp(argv[i],"-x")&&i+1<argc) solopt.trace=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-stream")) prcopt.streamobs=1;
+        else if (!strcmp(argv[i],"-cache")&&i+1<argc) {
+            strcpy(filopt.cache,argv[++i]);
+        }
         else if (!strcmp(argv[i], "--version")) {
             fprintf(stderr, "rnx2rtkp RTKLIB %s %s\n", VER_RTKLIB, PATCH_LEVEL);
             exit(0);
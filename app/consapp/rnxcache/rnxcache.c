@@ -0,0 +1,113 @@
+/*------------------------------------------------------------------------------
+* rnxcache.c : build binary cache of rinex obs/nav, sp3 and clock files
+*
+* version : $Revision:$ $Date:$
+* history : 2026/10/19 1.0 new
+*-----------------------------------------------------------------------------*/
+#include <stdarg.h>
+#include "rtklib.h"
+
+#define PROGNAME    "rnxcache"          /* program name */
+#define MAXFILE     16                  /* max number of input files */
+
+/* help text -----------------------------------------------------------------*/
+static const char *help[]={
+"",
+" usage: rnxcache [option]... file file [...]",
+"",
+" Read RINEX OBS/NAV/GNAV/HNAV/CLK, SP3 and SBAS message log files and save",
+" the decoded data to a binary cache. Later runs of rnx2rtkp with the option",
+" -cache (or the option file-cachedir) load the cached data instead of",
+" parsing the input files again, as long as they are called with the same",
+" input files, time span, time interval and RINEX options. The processing",
+" options (elevation mask, AR thresholds, ...) can be changed freely.",
+" The cache key is derived from the contents of the input files, so a cache",
+" entry becomes invalid automatically when an input file is modified.",
+"",
+" -?        print help",
+" -k file   input options from configuration file [off]",
+" -d dir    cache directory [file-cachedir in configuration file]",
+" -ts ds ts start day/time (ds=y/m/d ts=h:m:s) [obs start time]",
+" -te de te end day/time   (de=y/m/d te=h:m:s) [obs end time]",
+" -ti tint  time interval (sec) [all]",
+" -x level  debug trace level (0:off) [0]",
+" --version display release version",
+};
+/* show message --------------------------------------------------------------*/
+extern int showmsg(const char *format, ...)
+{
+    va_list arg;
+    va_start(arg,format); vfprintf(stderr,format,arg); va_end(arg);
+    fprintf(stderr,"\r");
+    return 0;
+}
+extern void settspan(gtime_t ts, gtime_t te) {}
+extern void settime(gtime_t time) {}
+
+/* print help ----------------------------------------------------------------*/
+static void printhelp(void)
+{
+    int i;
+    for (i=0;i<(int)(sizeof(help)/sizeof(*help));i++) fprintf(stderr,"%s\n",help[i]);
+    exit(0);
+}
+/* rnxcache main -------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    prcopt_t prcopt=prcopt_default;
+    solopt_t solopt=solopt_default;
+    filopt_t filopt={""};
+    gtime_t ts={0},te={0};
+    double tint=0.0,es[]={2000,1,1,0,0,0},ee[]={2000,12,31,23,59,59};
+    int i,n,trlevel=0,ret;
+    const char *infile[MAXFILE];
+
+    /* load options from configuration file */
+    for (i=1;i<argc;i++) {
+        if (!strcmp(argv[i],"-k")&&i+1<argc) {
+            resetsysopts();
+            if (!loadopts(argv[++i],sysopts)) return EXIT_FAILURE;
+            getsysopts(&prcopt,&solopt,&filopt);
+        }
+    }
+    for (i=1,n=0;i<argc;i++) {
+        if      (!strcmp(argv[i],"-d")&&i+1<argc) strcpy(filopt.cache,argv[++i]);
+        else if (!strcmp(argv[i],"-ts")&&i+2<argc) {
+            sscanf(argv[++i],"%lf/%lf/%lf",es,es+1,es+2);
+            sscanf(argv[++i],"%lf:%lf:%lf",es+3,es+4,es+5);
+            ts=epoch2time(es);
+        }
+        else if (!strcmp(argv[i],"-te")&&i+2<argc) {
+            sscanf(argv[++i],"%lf/%lf/%lf",ee,ee+1,ee+2);
+            sscanf(argv[++i],"%lf:%lf:%lf",ee+3,ee+4,ee+5);
+            te=epoch2time(ee);
+        }
+        else if (!strcmp(argv[i],"-ti")&&i+1<argc) tint=atof(argv[++i]);
+        else if (!strcmp(argv[i],"-k")&&i+1<argc) {++i; continue;}
+        else if (!strcmp(argv[i],"-x")&&i+1<argc) trlevel=atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--version")) {
+            fprintf(stderr, "rnxcache RTKLIB %s %s\n", VER_RTKLIB, PATCH_LEVEL);
+            exit(0);
+        }
+        else if (*argv[i]=='-') printhelp();
+        else if (n<MAXFILE) infile[n++]=argv[i];
+    }
+    if (n<=0) {
+        showmsg("error : no input file");
+        return EXIT_FAILURE;
+    }
+    if (!*filopt.cache) {
+        showmsg("error : no cache directory");
+        return EXIT_FAILURE;
+    }
+    if (trlevel>0) {
+        traceopen(*filopt.trace?filopt.trace:PROGNAME ".trace");
+        tracelevel(trlevel);
+    }
+    ret=postcache(ts,te,tint,&prcopt,&filopt,infile,n);
+
+    traceclose();
+
+    if (!ret) fprintf(stderr,"%40s\r","");
+    return ret?EXIT_FAILURE:0;
+}
@@ -35,6 +35,10 @@
 *           2016/09/19 1.20 support multiple remote console connections
 *                           add option -w
 *           2017/09/01 1.21 add command ssr
+*           2026/10/19 1.22 read status/satellite/observation from status
+*                           snapshot of rtk server
+*           2026/10/19 1.23 serve metrics in prometheus text format by
+*                           http request to metrics port
 *-----------------------------------------------------------------------------*/
 #define _POSIX_C_SOURCE 199506
 #include <stdlib.h>
@@ -66,6 +70,8 @@
 #define TRACEFILE   "rtkrcv_%Y%m%d%h%M.trace" /* debug trace file */
 #define LOGFILE     "rtkrcv_%Y%m%d%h%M.log"   /* Deamon log file */
 #define INTKEEPALIVE 1000               /* keep alive interval (ms) */
+#define METRCYCLE   10                  /* metrics port polling cycle (ms) */
+#define MAXMETRICS  32768               /* max length of metrics output */
 
 #define ESC_CLEAR   "\033[H\033[2J"     /* ansi/vt100 escape: erase screen */
 #define ESC_RESET   "\033[0m"           /* ansi/vt100: reset attribute */
@@ -84,6 +90,7 @@ typedef struct {                       /* console type */
 /* global variables ----------------------------------------------------------*/
 static rtksvr_t svr;                    /* rtk server struct */
 static stream_t moni;                   /* monitor stream */
+static stream_t metr;                   /* metrics stream */
 
 static int intflg       =0;             /* interrupt flag (2:shutdown) */
 
@@ -117,6 +124,8 @@ static int modflgr[256] ={0};           /* modified flags of receiver options */
 static int modflgs[256] ={0};           /* modified flags of system options */
 static int moniport     =0;             /* monitor port */
 static int keepalive    =0;             /* keep alive flag */
+static int metrport     =0;             /* metrics port */
+static int metrflg      =0;             /* metrics port running flag */
 static int start        =0;             /* auto start */
 static int fswapmargin  =30;            /* file swap margin (s) */
 static char sta_name[256]="";           /* station name */
@@ -133,6 +142,7 @@ static const char *usage[]={
     "  -nc        start RTK server on program startup with no console",
     "  -p port    port number for telnet console",
     "  -m port    port number for monitor stream",
+    "  -mp port   port number for metrics (http GET /metrics)",
     "  -d dev     terminal device for console",
     "  -o file    processing options file",
     "  -w pwd     login password for remote console (\"\": no password)",
@@ -265,6 +275,161 @@ static void chop(char *str)
     char *p;
     for (p=str+strlen(str)-1;p>=str&&!isgraph((int)*p);p--) *p='\0';
 }
+/* output metrics in prometheus text format ----------------------------------*/
+static int outmetrics(char *buff)
+{
+    static const char *qname[]={
+        "obs_rover","obs_base","sol","log_rover","log_base","log_corr"
+    };
+    static const char *sname[]={
+        "input_rover","input_base","input_corr","output_sol1","output_sol2",
+        "log_rover","log_base","log_corr"
+    };
+    static const char *lname[]={
+        "decode_rover","decode_base","decode_corr","position","output"
+    };
+    rtksvrstat_t *stat;
+    char *p=buff;
+    int i;
+    
+    p+=metout(p,PRGNAME);
+    
+    if (!(stat=(rtksvrstat_t *)malloc(sizeof(rtksvrstat_t)))) return (int)(p-buff);
+    if (!rtksvrgetstat(&svr,stat)) memset(stat,0,sizeof(rtksvrstat_t));
+    
+    p+=sprintf(p,"# HELP %s_state rtk server state (0:stop,1:run)\n",PRGNAME);
+    p+=sprintf(p,"# TYPE %s_state gauge\n",PRGNAME);
+    p+=sprintf(p,"%s_state %d\n",PRGNAME,stat->state);
+    p+=sprintf(p,"# HELP %s_solution_status solution quality (0:none,1:fix,"
+               "2:float,...)\n",PRGNAME);
+    p+=sprintf(p,"# TYPE %s_solution_status gauge\n",PRGNAME);
+    p+=sprintf(p,"%s_solution_status %d\n",PRGNAME,stat->sol.stat);
+    p+=sprintf(p,"# HELP %s_degradations degradations applied by deadline "
+               "(bits: 1:ar rerun,2:doppler slip,4:elmask,8:nfreq)\n",PRGNAME);
+    p+=sprintf(p,"# TYPE %s_degradations gauge\n",PRGNAME);
+    p+=sprintf(p,"%s_degradations %d\n",PRGNAME,stat->sol.degrade);
+    p+=sprintf(p,"# HELP %s_cputime_seconds cpu time of processing cycle\n",
+               PRGNAME);
+    p+=sprintf(p,"# TYPE %s_cputime_seconds gauge\n",PRGNAME);
+    p+=sprintf(p,"%s_cputime_seconds %.3f\n",PRGNAME,stat->cputime*1E-3);
+    p+=sprintf(p,"# HELP %s_obs_outage_total missing observation data count\n",
+               PRGNAME);
+    p+=sprintf(p,"# TYPE %s_obs_outage_total counter\n",PRGNAME);
+    p+=sprintf(p,"%s_obs_outage_total %d\n",PRGNAME,stat->prcout);
+    
+    p+=sprintf(p,"# HELP %s_queue_depth number of queued data\n",PRGNAME);
+    p+=sprintf(p,"# TYPE %s_queue_depth gauge\n",PRGNAME);
+    for (i=0;i<6;i++) {
+        p+=sprintf(p,"%s_queue_depth{queue=\"%s\"} %d\n",PRGNAME,qname[i],
+                   stat->nq[i]);
+    }
+    p+=sprintf(p,"# HELP %s_queue_depth_max max number of queued data\n",
+               PRGNAME);
+    p+=sprintf(p,"# TYPE %s_queue_depth_max gauge\n",PRGNAME);
+    for (i=0;i<6;i++) {
+        p+=sprintf(p,"%s_queue_depth_max{queue=\"%s\"} %d\n",PRGNAME,
+                   qname[i],stat->nqmax[i]);
+    }
+    p+=sprintf(p,"# HELP %s_stream_bytes_total stream input/output bytes\n",
+               PRGNAME);
+    p+=sprintf(p,"# TYPE %s_stream_bytes_total counter\n",PRGNAME);
+    for (i=0;i<MAXSTRRTK;i++) {
+        p+=sprintf(p,"%s_stream_bytes_total{stream=\"%s\",dir=\"in\"} %d\n",
+                   PRGNAME,sname[i],stat->inb[i]);
+        p+=sprintf(p,"%s_stream_bytes_total{stream=\"%s\",dir=\"out\"} %d\n",
+                   PRGNAME,sname[i],stat->outb[i]);
+    }
+    p+=sprintf(p,"# HELP %s_latency_seconds stage latency {avg,max}\n",PRGNAME);
+    p+=sprintf(p,"# TYPE %s_latency_seconds gauge\n",PRGNAME);
+    for (i=0;i<5;i++) {
+        p+=sprintf(p,"%s_latency_seconds{stage=\"%s\",stat=\"avg\"} %.3f\n",
+                   PRGNAME,lname[i],stat->lat[i].ave*1E-3);
+        p+=sprintf(p,"%s_latency_seconds{stage=\"%s\",stat=\"max\"} %.3f\n",
+                   PRGNAME,lname[i],stat->lat[i].max*1E-3);
+    }
+    p+=sprintf(p,"# HELP %s_dropped_total data dropped by queue overflow\n",
+               PRGNAME);
+    p+=sprintf(p,"# TYPE %s_dropped_total counter\n",PRGNAME);
+    for (i=0;i<5;i++) {
+        p+=sprintf(p,"%s_dropped_total{stage=\"%s\"} %u\n",PRGNAME,lname[i],
+                   stat->lat[i].ndrop);
+    }
+    free(stat);
+    return (int)(p-buff);
+}
+/* reply request to metrics port -----------------------------------------------
+* a http request "GET /metrics" is replied by the metrics in prometheus text
+* format. the client is disconnected after the reply. other data from clients
+* of the metrics port are ignored. the metrics port is separated from the
+* monitor port, so the replies are not mixed with solutions and keep alives.
+*-----------------------------------------------------------------------------*/
+static void replymetr(const char *req)
+{
+    char *buff,*body,head[256],path[256]="";
+    int n,m;
+    
+    if (strncmp(req,"GET ",4)||sscanf(req+4,"%255s",path)<1) return;
+    
+    trace(3,"replymetr: path=%s\n",path);
+    
+    if (!(buff=(char *)malloc(MAXMETRICS+256))) return;
+    body=buff+256;
+    
+    if (!strcmp(path,"/metrics")) {
+        n=outmetrics(body);
+        m=sprintf(head,"HTTP/1.0 200 OK\r\n"
+                  "Content-Type: text/plain; version=0.0.4\r\n"
+                  "Content-Length: %d\r\nConnection: close\r\n\r\n",n);
+    }
+    else {
+        n=0;
+        m=sprintf(head,"HTTP/1.0 404 Not Found\r\n"
+                  "Content-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    /* put header before body */
+    memcpy(body-m,head,m);
+    strreply(&metr,(uint8_t *)body-m,m+n);
+    free(buff);
+}
+/* thread of metrics port ----------------------------------------------------*/
+static void *metrthread(void *arg)
+{
+    uint8_t buff[1024];
+    int n;
+    
+    trace(3,"metrthread: start\n");
+    
+    while (metrflg) {
+        if ((n=strread(&metr,buff,sizeof(buff)-1))>0) {
+            buff[n]='\0';
+            replymetr((char *)buff);
+        }
+        sleepms(METRCYCLE);
+    }
+    trace(3,"metrthread: stop\n");
+    return NULL;
+}
+/* open/close metrics port ---------------------------------------------------*/
+static int openmetr(int port)
+{
+    pthread_t thread;
+    char path[64];
+    
+    trace(3,"openmetr: port=%d\n",port);
+    
+    sprintf(path,":%d",port);
+    if (!stropen(&metr,STR_TCPSVR,STR_MODE_RW,path)) return 0;
+    metrflg=1;
+    pthread_create(&thread,NULL,metrthread,NULL);
+    return 1;
+}
+static void closemetr(void)
+{
+    trace(3,"closemetr:\n");
+    metrflg=0;
+    sleepms(METRCYCLE*2);
+    strclose(&metr);
+}
 /* thread to send keep alive for monitor port --------------------------------*/
 static void *sendkeepalive(void *arg)
 {
@@ -641,60 +806,50 @@ static void prsolution(vt_t *vt, const sol_t *sol, const double *rb)
 /* print status --------------------------------------------------------------*/
 static void prstatus(vt_t *vt)
 {
-    rtk_t rtk;
+    rtksvrstat_t *stat;
+    prcopt_t *opt;
     const char *svrstate[]={"stop","run"},*type[]={"rover","base","corr"};
     const char *sol[]={"-","fix","float","SBAS","DGPS","single","PPP",""};
     const char *mode[]={
          "single","DGPS","kinematic","static","static-start","moving-base","fixed",
          "PPP-kinema","PPP-static"
     };
-    gtime_t eventime={0};
     const char *freq[]={"-","L1","L1+L2","L1+L2+E5b","L1+L2+E5b+L5","5","6","7"};
-    rtcm_t rtcm[3];
     pthread_t thread;
-    int i,j,n,cycle,state,rtkstat,nsat0,nsat1,prcout,rcvcount,tmcount,timevalid,nave;
-    int cputime,nb[3]={0},nmsg[3][10]={{0}};
+    int i,j,n,cycle,state;
     char tstr[40],tmstr[40],s[1024],*p;
     double runtime,rt[3]={0},dop[4]={0},rr[3],bl1=0.0,bl2=0.0;
     double azel[MAXSAT*2],pos[3],vel[3],*del;
     
     trace(4,"prstatus:\n");
     
+    if (!(stat=(rtksvrstat_t *)malloc(sizeof(rtksvrstat_t)))||
+        !(opt=(prcopt_t *)malloc(sizeof(prcopt_t)))) {
+        free(stat);
+        return;
+    }
+    /* status snapshot published by rtk server without server lock */
+    if (!rtksvrgetstat(&svr,stat)) {
+        memset(stat,0,sizeof(rtksvrstat_t));
+    }
     rtksvrlock(&svr);
-    rtk=svr.rtk;
+    *opt=svr.rtk.opt;
     thread=svr.thread;
     cycle=svr.cycle;
     state=svr.state;
-    rtkstat=svr.rtk.sol.stat;
-    nsat0=svr.obs[0][0].n;
-    nsat1=svr.obs[1][0].n;
-    rcvcount = svr.raw[0].obs.rcvcount;
-    tmcount = svr.raw[0].obs.tmcount;
-    cputime=svr.cputime;
-    prcout=svr.prcout;
-    nave=svr.nave;
-    for (i=0;i<3;i++) nb[i]=svr.nb[i];
-    for (i=0;i<3;i++) for (j=0;j<10;j++) {
-        nmsg[i][j]=svr.nmsg[i][j];
-    }
     if (svr.state) {
         runtime=(double)(tickget()-svr.tick)/1000.0;
         rt[0]=floor(runtime/3600.0); runtime-=rt[0]*3600.0;
         rt[1]=floor(runtime/60.0); rt[2]=runtime-rt[1]*60.0;
     }
-    for (i=0;i<3;i++) rtcm[i]=svr.rtcm[i];
-    if (svr.raw[0].obs.data != NULL) {
-        timevalid = svr.raw[0].obs.data[0].timevalid;
-        eventime = svr.raw[0].obs.data[0].eventime;
-    }
-    time2str(eventime,tmstr,9);
     rtksvrunlock(&svr);
+    time2str(stat->eventime,tmstr,9);
     
     for (i=n=0;i<MAXSAT;i++) {
-        if (rtk.opt.mode==PMODE_SINGLE&&!rtk.ssat[i].vs) continue;
-        if (rtk.opt.mode!=PMODE_SINGLE&&!rtk.ssat[i].vsat[0]) continue;
-        azel[  n*2]=rtk.ssat[i].azel[0];
-        azel[1+n*2]=rtk.ssat[i].azel[1];
+        if (opt->mode==PMODE_SINGLE&&!stat->ssat[i].vs) continue;
+        if (opt->mode!=PMODE_SINGLE&&!stat->ssat[i].vsat[0]) continue;
+        azel[  n*2]=stat->ssat[i].azel[0];
+        azel[1+n*2]=stat->ssat[i].azel[1];
         n++;
     }
     dops(n,azel,0.0,dop);
@@ -704,107 +859,113 @@ static void prstatus(vt_t *vt)
     vt_printf(vt,"%-28s: %d\n","rtk server thread",thread);
     vt_printf(vt,"%-28s: %s\n","rtk server state",svrstate[state]);
     vt_printf(vt,"%-28s: %d\n","processing cycle (ms)",cycle);
-    vt_printf(vt,"%-28s: %s\n","positioning mode",mode[rtk.opt.mode]);
-    vt_printf(vt,"%-28s: %s\n","frequencies",freq[rtk.opt.nf]);
+    vt_printf(vt,"%-28s: %s\n","positioning mode",mode[opt->mode]);
+    vt_printf(vt,"%-28s: %s\n","frequencies",freq[opt->nf]);
     vt_printf(vt,"%-28s: %02.0f:%02.0f:%04.1f\n","accumulated time to run",rt[0],rt[1],rt[2]);
-    vt_printf(vt,"%-28s: %d\n","cpu time for a cycle (ms)",cputime);
-    vt_printf(vt,"%-28s: %d\n","missing obs data count",prcout);
-    vt_printf(vt,"%-28s: %d,%d\n","bytes in input buffer",nb[0],nb[1]);
+    vt_printf(vt,"%-28s: %d\n","cpu time for a cycle (ms)",stat->cputime);
+    vt_printf(vt,"%-28s: %d\n","missing obs data count",stat->prcout);
+    vt_printf(vt,"%-28s: %d,%d\n","bytes in input buffer",stat->nb[0],stat->nb[1]);
     for (i=0;i<3;i++) {
         sprintf(s,"# of input data %s",type[i]);
         vt_printf(vt,"%-28s: obs(%d),nav(%d),gnav(%d),ion(%d),sbs(%d),pos(%d),dgps(%d),ssr(%d),err(%d)\n",
-                s,nmsg[i][0],nmsg[i][1],nmsg[i][6],nmsg[i][2],nmsg[i][3],
-                nmsg[i][4],nmsg[i][5],nmsg[i][7],nmsg[i][9]);
+                s,stat->nmsg[i][0],stat->nmsg[i][1],stat->nmsg[i][6],
+                stat->nmsg[i][2],stat->nmsg[i][3],stat->nmsg[i][4],
+                stat->nmsg[i][5],stat->nmsg[i][7],stat->nmsg[i][9]);
     }
     for (i=0;i<3;i++) {
         p=s; *p='\0';
         for (j=1;j<100;j++) {
-            if (rtcm[i].nmsg2[j]==0) continue;
-            p+=sprintf(p,"%s%d(%d)",p>s?",":"",j,rtcm[i].nmsg2[j]);
+            if (stat->nmsg2[i][j]==0) continue;
+            p+=sprintf(p,"%s%d(%d)",p>s?",":"",j,stat->nmsg2[i][j]);
         }
-        if (rtcm[i].nmsg2[0]>0) {
-            sprintf(p,"%sother2(%d)",p>s?",":"",rtcm[i].nmsg2[0]);
+        if (stat->nmsg2[i][0]>0) {
+            sprintf(p,"%sother2(%d)",p>s?",":"",stat->nmsg2[i][0]);
         }
         for (j=1;j<300;j++) {
-            if (rtcm[i].nmsg3[j]==0) continue;
-            p+=sprintf(p,"%s%d(%d)",p>s?",":"",j+1000,rtcm[i].nmsg3[j]);
+            if (stat->nmsg3[i][j]==0) continue;
+            p+=sprintf(p,"%s%d(%d)",p>s?",":"",j+1000,stat->nmsg3[i][j]);
         }
-        if (rtcm[i].nmsg3[0]>0) {
-            sprintf(p,"%sother3(%d)",p>s?",":"",rtcm[i].nmsg3[0]);
+        if (stat->nmsg3[i][0]>0) {
+            sprintf(p,"%sother3(%d)",p>s?",":"",stat->nmsg3[i][0]);
         }
         vt_printf(vt,"%-15s %-9s: %s\n","# of rtcm messages",type[i],s);
     }
-    vt_printf(vt,"%-28s: %s\n","solution status",sol[rtkstat]);
-    time2str(rtk.sol.time,tstr,9);
-    vt_printf(vt,"%-28s: %s\n","time of receiver clock rover",rtk.sol.time.time?tstr:"-");
-    vt_printf(vt,"%-28s: %.3f,%.3f,%.3f,%.3f\n","time sys offset (ns)",rtk.sol.dtr[1]*1e9,
-              rtk.sol.dtr[2]*1e9,rtk.sol.dtr[3]*1e9,rtk.sol.dtr[4]*1e9);
-    vt_printf(vt,"%-28s: %.3f\n","solution interval (s)",rtk.tt);
-    vt_printf(vt,"%-28s: %.3f\n","age of differential (s)",rtk.sol.age);
-    vt_printf(vt,"%-28s: %.3f\n","ratio for ar validation",rtk.sol.ratio);
-    vt_printf(vt,"%-28s: %d\n","# of satellites rover",nsat0);
-    vt_printf(vt,"%-28s: %d\n","# of satellites base",nsat1);
-    vt_printf(vt,"%-28s: %d\n","# of valid satellites",rtk.sol.ns);
+    vt_printf(vt,"%-28s: %s\n","solution status",sol[stat->sol.stat]);
+    time2str(stat->sol.time,tstr,9);
+    vt_printf(vt,"%-28s: %s\n","time of receiver clock rover",stat->sol.time.time?tstr:"-");
+    vt_printf(vt,"%-28s: %.3f,%.3f,%.3f,%.3f\n","time sys offset (ns)",stat->sol.dtr[1]*1e9,
+              stat->sol.dtr[2]*1e9,stat->sol.dtr[3]*1e9,stat->sol.dtr[4]*1e9);
+    vt_printf(vt,"%-28s: %.3f\n","solution interval (s)",stat->tt);
+    vt_printf(vt,"%-28s: %.3f\n","age of differential (s)",stat->sol.age);
+    vt_printf(vt,"%-28s: %.3f\n","ratio for ar validation",stat->sol.ratio);
+    vt_printf(vt,"%-28s: %d\n","# of satellites rover",stat->nobs[0]);
+    vt_printf(vt,"%-28s: %d\n","# of satellites base",stat->nobs[1]);
+    vt_printf(vt,"%-28s: %d\n","# of valid satellites",stat->sol.ns);
     vt_printf(vt,"%-28s: %.1f,%.1f,%.1f,%.1f\n","GDOP/PDOP/HDOP/VDOP",dop[0],dop[1],dop[2],dop[3]);
-    vt_printf(vt,"%-28s: %d\n","# of real estimated states",rtk.na);
-    vt_printf(vt,"%-28s: %d\n","# of all estimated states",rtk.nx);
+    vt_printf(vt,"%-28s: %d\n","# of real estimated states",stat->na);
+    vt_printf(vt,"%-28s: %d\n","# of all estimated states",stat->nx);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","pos xyz single (m) rover",
-            rtk.sol.rr[0],rtk.sol.rr[1],rtk.sol.rr[2]);
-    if (norm(rtk.sol.rr,3)>0.0) ecef2pos(rtk.sol.rr,pos); else pos[0]=pos[1]=pos[2]=0.0;
+            stat->sol.rr[0],stat->sol.rr[1],stat->sol.rr[2]);
+    if (norm(stat->sol.rr,3)>0.0) ecef2pos(stat->sol.rr,pos); else pos[0]=pos[1]=pos[2]=0.0;
     vt_printf(vt,"%-28s: %.8f,%.8f,%.3f\n","pos llh single (deg,m) rover",
             pos[0]*R2D,pos[1]*R2D,pos[2]);
-    ecef2enu(pos,rtk.sol.rr+3,vel);
+    ecef2enu(pos,stat->sol.rr+3,vel);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","vel enu (m/s) rover",vel[0],vel[1],vel[2]);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","pos xyz float (m) rover",
-            rtk.x?rtk.x[0]:0,rtk.x?rtk.x[1]:0,rtk.x?rtk.x[2]:0);
+            stat->x[0],stat->x[1],stat->x[2]);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","pos xyz float std (m) rover",
-            rtk.P?SQRT(rtk.P[0]):0,rtk.P?SQRT(rtk.P[1+1*rtk.nx]):0,rtk.P?SQRT(rtk.P[2+2*rtk.nx]):0);
+            stat->x[3],stat->x[4],stat->x[5]);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","pos xyz fixed (m) rover",
-            rtk.xa?rtk.xa[0]:0,rtk.xa?rtk.xa[1]:0,rtk.xa?rtk.xa[2]:0);
+            stat->xa[0],stat->xa[1],stat->xa[2]);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","pos xyz fixed std (m) rover",
-            rtk.Pa?SQRT(rtk.Pa[0]):0,rtk.Pa?SQRT(rtk.Pa[1+1*rtk.na]):0,rtk.Pa?SQRT(rtk.Pa[2+2*rtk.na]):0);
+            stat->xa[3],stat->xa[4],stat->xa[5]);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","pos xyz (m) base",
-            rtk.rb[0],rtk.rb[1],rtk.rb[2]);
-    if (norm(rtk.rb,3)>0.0) ecef2pos(rtk.rb,pos); else pos[0]=pos[1]=pos[2]=0.0;
+            stat->rb[0],stat->rb[1],stat->rb[2]);
+    if (norm(stat->rb,3)>0.0) ecef2pos(stat->rb,pos); else pos[0]=pos[1]=pos[2]=0.0;
     vt_printf(vt,"%-28s: %.8f,%.8f,%.3f\n","pos llh (deg,m) base",
             pos[0]*R2D,pos[1]*R2D,pos[2]);
-    vt_printf(vt,"%-28s: %d\n","# of average single pos base",nave);
-    vt_printf(vt,"%-28s: %s\n","ant type rover",rtk.opt.pcvr[0].type);
-    del=rtk.opt.antdel[0];
+    vt_printf(vt,"%-28s: %d\n","# of average single pos base",stat->nave);
+    vt_printf(vt,"%-28s: %s\n","ant type rover",opt->pcvr[0].type);
+    del=opt->antdel[0];
     vt_printf(vt,"%-28s: %.3f %.3f %.3f\n","ant delta rover",del[0],del[1],del[2]);
-    vt_printf(vt,"%-28s: %s\n","ant type base" ,rtk.opt.pcvr[1].type);
-    del=rtk.opt.antdel[1];
+    vt_printf(vt,"%-28s: %s\n","ant type base" ,opt->pcvr[1].type);
+    del=opt->antdel[1];
     vt_printf(vt,"%-28s: %.3f %.3f %.3f\n","ant delta base",del[0],del[1],del[2]);
-    ecef2enu(pos,rtk.rb+3,vel);
+    ecef2enu(pos,stat->rb+3,vel);
     vt_printf(vt,"%-28s: %.3f,%.3f,%.3f\n","vel enu (m/s) base",
             vel[0],vel[1],vel[2]);
-    if (rtk.opt.mode>0&&rtk.x&&norm(rtk.x,3)>0.0) {
-        for (i=0;i<3;i++) rr[i]=rtk.x[i]-rtk.rb[i];
+    if (opt->mode>0&&norm(stat->x,3)>0.0) {
+        for (i=0;i<3;i++) rr[i]=stat->x[i]-stat->rb[i];
         bl1=norm(rr,3);
     }
-    if (rtk.opt.mode>0&&rtk.xa&&norm(rtk.xa,3)>0.0) {
-        for (i=0;i<3;i++) rr[i]=rtk.xa[i]-rtk.rb[i];
+    if (opt->mode>0&&norm(stat->xa,3)>0.0) {
+        for (i=0;i<3;i++) rr[i]=stat->xa[i]-stat->rb[i];
         bl2=norm(rr,3);
     }
     vt_printf(vt,"%-28s: %.3f\n","baseline length float (m)",bl1);
     vt_printf(vt,"%-28s: %.3f\n","baseline length fixed (m)",bl2);
-    vt_printf(vt,"%-28s: %s\n","last time mark",tmcount ? tmstr : "-");
-    vt_printf(vt,"%-28s: %d\n","receiver time mark count",rcvcount);
-    vt_printf(vt,"%-28s: %d\n","rtklib time mark count",tmcount);
+    vt_printf(vt,"%-28s: %s\n","last time mark",stat->tmcount ? tmstr : "-");
+    vt_printf(vt,"%-28s: %d\n","receiver time mark count",stat->rcvcount);
+    vt_printf(vt,"%-28s: %d\n","rtklib time mark count",stat->tmcount);
+    free(opt);
+    free(stat);
 }
 /* print satellite -----------------------------------------------------------*/
 static void prsatellite(vt_t *vt, int nf)
 {
-    rtk_t rtk;
+    rtksvrstat_t *stat;
+    ssat_t *ssat;
     double az,el;
     char id[8];
     int i,j,fix,frq[]={1,2,5,7,8,6};
     
     trace(4,"prsatellite:\n");
     
-    rtksvrlock(&svr);
-    rtk=svr.rtk;
-    rtksvrunlock(&svr);
+    if (!(stat=(rtksvrstat_t *)malloc(sizeof(rtksvrstat_t)))) return;
+    if (!rtksvrgetstat(&svr,stat)) {
+        memset(stat,0,sizeof(rtksvrstat_t));
+    }
+    ssat=stat->ssat;
     if (nf<=0||nf>NFREQ) nf=NFREQ;
     vt_printf(vt,"\n%s%3s %2s %5s %4s",ESC_BOLD,"SAT","C1","Az","El");
     for (j=0;j<nf;j++) vt_printf(vt," L%d"    ,frq[j]);
@@ -817,42 +978,46 @@ static void prsatellite(vt_t *vt, int nf)
     vt_printf(vt,"%s\n",ESC_RESET);
     
     for (i=0;i<MAXSAT;i++) {
-        if (rtk.ssat[i].azel[1]<=0.0) continue;
+        if (ssat[i].azel[1]<=0.0) continue;
         satno2id(i+1,id);
-        vt_printf(vt,"%3s %2s",id,rtk.ssat[i].vs?"OK":"-");
-        az=rtk.ssat[i].azel[0]*R2D; if (az<0.0) az+=360.0;
-        el=rtk.ssat[i].azel[1]*R2D;
+        vt_printf(vt,"%3s %2s",id,ssat[i].vs?"OK":"-");
+        az=ssat[i].azel[0]*R2D; if (az<0.0) az+=360.0;
+        el=ssat[i].azel[1]*R2D;
         vt_printf(vt," %5.1f %4.1f",az,el);
-        for (j=0;j<nf;j++) vt_printf(vt," %2s",rtk.ssat[i].vsat[j]?"OK":"-");
+        for (j=0;j<nf;j++) vt_printf(vt," %2s",ssat[i].vsat[j]?"OK":"-");
         for (j=0;j<nf;j++) {
-            fix=rtk.ssat[i].fix[j];
+            fix=ssat[i].fix[j];
             vt_printf(vt," %5s",fix==1?"FLOAT":(fix==2?"FIX":(fix==3?"HOLD":"-")));
         }
-        for (j=0;j<nf;j++) vt_printf(vt,"%7.3f",rtk.ssat[i].resp[j]);
-        for (j=0;j<nf;j++) vt_printf(vt,"%8.4f",rtk.ssat[i].resc[j]);
-        for (j=0;j<nf;j++) vt_printf(vt," %4d",rtk.ssat[i].slipc[j]);
-        for (j=0;j<nf;j++) vt_printf(vt," %6d",rtk.ssat[i].lock [j]);
-        for (j=0;j<nf;j++) vt_printf(vt," %3d",rtk.ssat[i].rejc [j]);
+        for (j=0;j<nf;j++) vt_printf(vt,"%7.3f",ssat[i].resp[j]);
+        for (j=0;j<nf;j++) vt_printf(vt,"%8.4f",ssat[i].resc[j]);
+        for (j=0;j<nf;j++) vt_printf(vt," %4d",ssat[i].slipc[j]);
+        for (j=0;j<nf;j++) vt_printf(vt," %6d",ssat[i].lock [j]);
+        for (j=0;j<nf;j++) vt_printf(vt," %3d",ssat[i].rejc [j]);
         vt_printf(vt,"\n");
     }
+    free(stat);
 }
 /* print observation data ----------------------------------------------------*/
 static void probserv(vt_t *vt, int nf)
 {
+    rtksvrstat_t *stat;
     obsd_t obs[MAXOBS*2];
     char tstr[40],id[8];
     int i,j,n=0,frq[]={1,2,5,7,8,6,9};
     
     trace(4,"probserv:\n");
     
-    rtksvrlock(&svr);
-    for (i=0;i<svr.obs[0][0].n&&n<MAXOBS*2;i++) {
-        obs[n++]=svr.obs[0][0].data[i];
-    }
-    for (i=0;i<svr.obs[1][0].n&&n<MAXOBS*2;i++) {
-        obs[n++]=svr.obs[1][0].data[i];
+    if (!(stat=(rtksvrstat_t *)malloc(sizeof(rtksvrstat_t)))) return;
+    if (rtksvrgetstat(&svr,stat)) {
+        for (i=0;i<stat->nobs[0]&&n<MAXOBS*2;i++) {
+            obs[n++]=stat->obs[0][i];
+        }
+        for (i=0;i<stat->nobs[1]&&n<MAXOBS*2;i++) {
+            obs[n++]=stat->obs[1][i];
+        }
     }
-    rtksvrunlock(&svr);
+    free(stat);
     
     if (nf<=0||nf>NFREQ) nf=NFREQ;
     vt_printf(vt,"\n%s%-22s %3s %s",ESC_BOLD,"      TIME(GPST)","SAT","R");
@@ -1579,6 +1744,9 @@ static void deamonise(void)
 *     -nc        start RTK server on program startup with no console
 *     -p port    port number for telnet console
 *     -m port    port number for monitor stream
+*     -mp port   port number for metrics. a http request GET /metrics to the
+*                port is replied by the metrics of processing stages, queues
+*                and streams in prometheus text format.
 *     -d dev     terminal device for console
 *     -o file    processing options file
 *     -w pwd     login password for remote console ("": no password)
@@ -1676,6 +1844,7 @@ int main(int argc, char **argv)
         else if (!strcmp(argv[i],"-nc")) start|=2; /* no console */
         else if (!strcmp(argv[i],"-p")&&i+1<argc) port=atoi(argv[++i]);
         else if (!strcmp(argv[i],"-m")&&i+1<argc) moniport=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-mp")&&i+1<argc) metrport=atoi(argv[++i]);
         else if (!strcmp(argv[i],"-d")&&i+1<argc) dev=argv[++i];
         else if (!strcmp(argv[i],"-o")&&i+1<argc) strcpy(file,argv[++i]);
         else if (!strcmp(argv[i],"-w")&&i+1<argc) strcpy(passwd,argv[++i]);
@@ -1697,6 +1866,10 @@ int main(int argc, char **argv)
     /* initialize rtk server and monitor port */
     rtksvrinit(&svr);
     strinit(&moni);
+    strinit(&metr);
+    
+    /* enable metrics of processing stages for metrics port */
+    if (metrport>0) metenable(1);
     
     /* load options file */
     if (!*file) sprintf(file,"%s/%s",OPTSDIR,OPTSFILE);
@@ -1720,11 +1893,17 @@ int main(int argc, char **argv)
     if (moniport>0&&!openmoni(moniport)) {
         fprintf(stderr,"monitor port open error: %d\n",moniport);
     }
+    /* open metrics port */
+    if (metrport>0&&!openmetr(metrport)) {
+        fprintf(stderr,"metrics port open error: %d\n",metrport);
+        metrport=0;
+    }
     if (port) {
         /* open socket for remote console */
         if ((sock=open_sock(port))<=0) {
             fprintf(stderr,"console open error port=%d\n",port);
             if (moniport>0) closemoni();
+            if (metrport>0) closemetr();
             if (outstat>0) rtkclosestat();
             traceclose();
             return EXIT_FAILURE;
@@ -1737,6 +1916,7 @@ int main(int argc, char **argv)
         if (!(con[0]=con_open(0,dev))) {
             fprintf(stderr,"console open error dev=%s\n",dev);
             if (moniport>0) closemoni();
+            if (metrport>0) closemetr();
             if (outstat>0) rtkclosestat();
             traceclose();
             return EXIT_FAILURE;
@@ -1761,6 +1941,7 @@ int main(int argc, char **argv)
         con_close(con[i]);
     }
     if (moniport>0) closemoni();
+    if (metrport>0) closemetr();
     if (outstat>0) rtkclosestat();
     
     /* save navigation data */
@@ -0,0 +1,448 @@
+/*------------------------------------------------------------------------------
+* bincache.c : binary cache of observation and navigation data
+*
+* the cache keeps the decoded content of rinex obs/nav, sp3, rinex clock and
+* sbas message files so that repeated post-processing runs with different
+* processing options can skip the text parsers.
+*
+* cache file layout (all values in host byte order):
+*
+*     header   : magic "RTKCACHE", format version, cache type, record
+*                sizes and build constants used as layout check
+*     sections : {id,record size,number of records} followed by the raw
+*                records padded to 8 bytes
+*
+* every section starts at an 8-byte aligned offset and stores records with the
+* in-memory layout of the library, so that a cache file can be memory mapped
+* and used in place. a cache written by a library built with different
+* NFREQ, NEXOBS or MAXSAT is rejected by the layout check.
+*
+* version : $Revision:$ $Date:$
+* history : 2026/10/19 1.0 new
+*-----------------------------------------------------------------------------*/
+#include "rtklib.h"
+
+#define CACHE_MAGIC "RTKCACHE"          /* cache file magic */
+#define CACHE_VER   1                   /* cache format version */
+#define CACHE_EXT   ".rtkc"             /* cache file extension */
+#define NSIZE       12                  /* number of layout check values */
+
+#define SEC_OBS     1                   /* section: observation data */
+#define SEC_EPH     2                   /* section: broadcast ephemeris */
+#define SEC_GEPH    3                   /* section: glonass ephemeris */
+#define SEC_SEPH    4                   /* section: sbas ephemeris */
+#define SEC_NAVP    5                   /* section: iono/utc/fcn parameters */
+#define SEC_STA     6                   /* section: station parameters */
+#define SEC_PEPH    7                   /* section: precise ephemeris */
+#define SEC_PCLK    8                   /* section: precise clock */
+#define SEC_SBS     9                   /* section: sbas messages */
+
+#define FNV_OFFSET  14695981039346656037ULL /* fnv-1a 64 offset basis */
+#define FNV_PRIME   1099511628211ULL    /* fnv-1a 64 prime */
+
+typedef struct {        /* cache file header type */
+    char magic[8];      /* magic ("RTKCACHE") */
+    uint32_t ver;       /* format version */
+    uint32_t type;      /* cache type (0:obs/nav/sta,1:peph/pclk/sbs) */
+    uint32_t size[NSIZE]; /* record sizes and constants for layout check */
+    int32_t nepoch;     /* number of observation epochs */
+    int32_t nsec;       /* number of sections */
+} cachehdr_t;
+
+typedef struct {        /* cache section header type */
+    uint32_t id;        /* section id (SEC_???) */
+    uint32_t size;      /* record size (bytes) */
+    uint64_t n;         /* number of records */
+} cachesec_t;
+
+typedef struct {        /* navigation parameters type */
+    double utc_gps[8],utc_glo[8],utc_gal[8],utc_qzs[8],utc_cmp[8];
+    double utc_irn[9],utc_sbs[4];
+    double ion_gps[8],ion_gal[4],ion_qzs[8],ion_cmp[8],ion_irn[8];
+    int glo_fcn[32];
+} navprm_t;
+
+/* layout check values -------------------------------------------------------*/
+static void layout(uint32_t *size)
+{
+    size[ 0]=sizeof(obsd_t);
+    size[ 1]=sizeof(eph_t);
+    size[ 2]=sizeof(geph_t);
+    size[ 3]=sizeof(seph_t);
+    size[ 4]=sizeof(peph_t);
+    size[ 5]=sizeof(pclk_t);
+    size[ 6]=sizeof(sta_t);
+    size[ 7]=sizeof(sbsmsg_t);
+    size[ 8]=sizeof(navprm_t);
+    size[ 9]=NFREQ;
+    size[10]=NEXOBS;
+    size[11]=MAXSAT;
+}
+/* fnv-1a 64 hash ------------------------------------------------------------*/
+static uint64_t hash(uint64_t h, const void *data, size_t n)
+{
+    const uint8_t *p=(const uint8_t *)data;
+    size_t i;
+
+    for (i=0;i<n;i++) {
+        h^=p[i];
+        h*=FNV_PRIME;
+    }
+    return h;
+}
+/* hash file contents --------------------------------------------------------*/
+static uint64_t hashfile(uint64_t h, const char *file)
+{
+    FILE *fp;
+    uint8_t buff[65536];
+    size_t n;
+
+    h=hash(h,file,strlen(file)+1);
+
+    if (!(fp=fopen(file,"rb"))) return h;
+
+    while ((n=fread(buff,1,sizeof(buff),fp))>0) {
+        h=hash(h,buff,n);
+    }
+    fclose(fp);
+    return h;
+}
+/* write section -------------------------------------------------------------*/
+static int writesec(FILE *fp, uint32_t id, const void *data, uint32_t size,
+                    int n)
+{
+    static const uint8_t pad[8]={0};
+    cachesec_t sec;
+    size_t len;
+
+    sec.id=id;
+    sec.size=size;
+    sec.n=n>0?(uint64_t)n:0;
+    len=(size_t)sec.n*size;
+
+    if (fwrite(&sec,sizeof(sec),1,fp)!=1) return 0;
+    if (len>0&&fwrite(data,len,1,fp)!=1) return 0;
+    if (len%8&&fwrite(pad,8-len%8,1,fp)!=1) return 0;
+    return 1;
+}
+/* read section --------------------------------------------------------------*/
+static void *readsec(FILE *fp, uint32_t id, uint32_t size, int *n)
+{
+    cachesec_t sec;
+    uint8_t pad[8];
+    size_t len;
+    void *data=NULL;
+
+    *n=0;
+    if (fread(&sec,sizeof(sec),1,fp)!=1||sec.id!=id||sec.size!=size||
+        sec.n>(uint64_t)0x7FFFFFFF) {
+        trace(2,"cache section error: id=%u\n",id);
+        *n=-1;
+        return NULL;
+    }
+    if ((len=(size_t)sec.n*size)<=0) return NULL;
+
+    if (!(data=malloc(len))||fread(data,len,1,fp)!=1||
+        (len%8&&fread(pad,8-len%8,1,fp)!=1)) {
+        trace(1,"cache read error: id=%u n=%d\n",id,(int)sec.n);
+        free(data);
+        *n=-1;
+        return NULL;
+    }
+    *n=(int)sec.n;
+    return data;
+}
+/* open cache file for reading and check header ------------------------------*/
+static FILE *opencache(const char *file, uint32_t type, int *nepoch)
+{
+    FILE *fp;
+    cachehdr_t hdr;
+    uint32_t size[NSIZE];
+
+    if (!(fp=fopen(file,"rb"))) return NULL;
+
+    layout(size);
+
+    if (fread(&hdr,sizeof(hdr),1,fp)!=1||
+        memcmp(hdr.magic,CACHE_MAGIC,8)||hdr.ver!=CACHE_VER||
+        hdr.type!=type||memcmp(hdr.size,size,sizeof(size))) {
+        trace(2,"cache header mismatch: %s\n",file);
+        fclose(fp);
+        return NULL;
+    }
+    if (nepoch) *nepoch=hdr.nepoch;
+    return fp;
+}
+/* create cache file ---------------------------------------------------------*/
+static FILE *createcache(const char *file, uint32_t type, int nepoch,
+                         int nsec)
+{
+    FILE *fp;
+    cachehdr_t hdr={{0}};
+
+    createdir(file);
+
+    if (!(fp=fopen(file,"wb"))) {
+        trace(2,"cache file open error: %s\n",file);
+        return NULL;
+    }
+    memcpy(hdr.magic,CACHE_MAGIC,8);
+    hdr.ver=CACHE_VER;
+    hdr.type=type;
+    layout(hdr.size);
+    hdr.nepoch=nepoch;
+    hdr.nsec=nsec;
+
+    if (fwrite(&hdr,sizeof(hdr),1,fp)!=1) {
+        fclose(fp);
+        remove(file);
+        return NULL;
+    }
+    return fp;
+}
+/* close cache file and move it to the final path ----------------------------*/
+static int closecache(FILE *fp, const char *tmpfile, const char *file, int stat)
+{
+    if (fclose(fp)||!stat) {
+        remove(tmpfile);
+        return 0;
+    }
+#ifdef WIN32
+    remove(file);
+#endif
+    if (rename(tmpfile,file)) {
+        trace(2,"cache file rename error: %s\n",file);
+        remove(tmpfile);
+        return 0;
+    }
+    return 1;
+}
+/* generate cache file path ----------------------------------------------------
+* generate cache file path keyed by input file contents and read options
+* args   : char   *dir      I   cache directory
+*          int    type      I   cache type (0:obs/nav/sta,1:peph/pclk/sbs)
+*          char   **infile  I   input files
+*          int    *index    I   input file index (NULL: 0,1,2,...)
+*          int    n         I   number of input files
+*          gtime_t ts,te    I   time start/end (ts.time==0: no limit)
+*          double ti        I   time interval (s) (0:all)
+*          char   *opt      I   read options
+*          char   *path     O   cache file path
+* return : status (1:ok,0:no cache directory)
+* notes  : the key covers the paths and contents of all input files (after
+*          wild-card expansion), the file grouping index, the time span and
+*          the read options. processing options which are not used while
+*          reading the input files do not change the key.
+*-----------------------------------------------------------------------------*/
+extern int cachepath(const char *dir, int type, const char **infile,
+                     const int *index, int n, gtime_t ts, gtime_t te,
+                     double ti, const char *opt, char *path)
+{
+    uint64_t h=FNV_OFFSET;
+    uint32_t size[NSIZE];
+    char *files[MAXEXFILE]={0};
+    int i,j,m,idx;
+
+    trace(3,"cachepath: dir=%s type=%d n=%d\n",dir,type,n);
+
+    if (!*dir) return 0;
+
+    for (i=0;i<MAXEXFILE;i++) {
+        if (!(files[i]=(char *)malloc(1024))) {
+            for (i--;i>=0;i--) free(files[i]);
+            return 0;
+        }
+    }
+    layout(size);
+    h=hash(h,&type,sizeof(type));
+    h=hash(h,size,sizeof(size));
+    h=hash(h,&ts.time,sizeof(ts.time));
+    h=hash(h,&te.time,sizeof(te.time));
+    h=hash(h,&ti,sizeof(ti));
+    h=hash(h,opt,strlen(opt)+1);
+
+    for (i=0;i<n;i++) {
+        idx=index?index[i]:i;
+        h=hash(h,&idx,sizeof(idx));
+        m=expath(infile[i],files,MAXEXFILE);
+        for (j=0;j<m;j++) h=hashfile(h,files[j]);
+    }
+    for (i=0;i<MAXEXFILE;i++) free(files[i]);
+
+    sprintf(path,"%s%c%016llx%s",dir,RTKLIB_FILEPATHSEP,(unsigned long long)h,
+            CACHE_EXT);
+    return 1;
+}
+/* save observation and navigation data to cache -------------------------------
+* save observation, broadcast navigation and station data to binary cache
+* args   : char   *file     I   cache file path
+*          obs_t  *obs      I   observation data (sorted)
+*          nav_t  *nav      I   navigation data (unique)
+*          sta_t  *sta      I   station parameters (NULL: no data)
+*          int    nsta      I   number of station parameters
+*          int    nepoch    I   number of observation epochs
+* return : status (1:ok,0:error)
+* notes  : the cache is written to a temporary file which is renamed to the
+*          final path on success. concurrent readers never see partial files.
+*-----------------------------------------------------------------------------*/
+extern int savecacheobs(const char *file, const obs_t *obs, const nav_t *nav,
+                        const sta_t *sta, int nsta, int nepoch)
+{
+    FILE *fp;
+    navprm_t prm;
+    char tmpfile[1024];
+    int stat;
+
+    trace(3,"savecacheobs: file=%s nobs=%d nepoch=%d\n",file,obs->n,nepoch);
+
+    memcpy(prm.utc_gps,nav->utc_gps,sizeof(prm.utc_gps));
+    memcpy(prm.utc_glo,nav->utc_glo,sizeof(prm.utc_glo));
+    memcpy(prm.utc_gal,nav->utc_gal,sizeof(prm.utc_gal));
+    memcpy(prm.utc_qzs,nav->utc_qzs,sizeof(prm.utc_qzs));
+    memcpy(prm.utc_cmp,nav->utc_cmp,sizeof(prm.utc_cmp));
+    memcpy(prm.utc_irn,nav->utc_irn,sizeof(prm.utc_irn));
+    memcpy(prm.utc_sbs,nav->utc_sbs,sizeof(prm.utc_sbs));
+    memcpy(prm.ion_gps,nav->ion_gps,sizeof(prm.ion_gps));
+    memcpy(prm.ion_gal,nav->ion_gal,sizeof(prm.ion_gal));
+    memcpy(prm.ion_qzs,nav->ion_qzs,sizeof(prm.ion_qzs));
+    memcpy(prm.ion_cmp,nav->ion_cmp,sizeof(prm.ion_cmp));
+    memcpy(prm.ion_irn,nav->ion_irn,sizeof(prm.ion_irn));
+    memcpy(prm.glo_fcn,nav->glo_fcn,sizeof(prm.glo_fcn));
+
+    sprintf(tmpfile,"%.1000s.tmp",file);
+
+    if (!(fp=createcache(tmpfile,0,nepoch,6))) return 0;
+
+    stat=writesec(fp,SEC_OBS ,obs->data,sizeof(obsd_t),obs->n)&&
+         writesec(fp,SEC_EPH ,nav->eph ,sizeof(eph_t ),nav->n )&&
+         writesec(fp,SEC_GEPH,nav->geph,sizeof(geph_t),nav->ng)&&
+         writesec(fp,SEC_SEPH,nav->seph,sizeof(seph_t),nav->ns)&&
+         writesec(fp,SEC_NAVP,&prm     ,sizeof(prm   ),1      )&&
+         writesec(fp,SEC_STA ,sta      ,sizeof(sta_t ),sta?nsta:0);
+
+    return closecache(fp,tmpfile,file,stat);
+}
+/* load observation and navigation data from cache -----------------------------
+* load observation, broadcast navigation and station data from binary cache
+* args   : char   *file     I   cache file path
+*          obs_t  *obs      O   observation data
+*          nav_t  *nav      IO  navigation data
+*          sta_t  *sta      O   station parameters (NULL: no output)
+*          int    nsta      I   number of station parameters
+* return : number of observation epochs (0:no valid cache)
+* notes  : obs->data, nav->eph, nav->geph and nav->seph are allocated and
+*          should be freed by the caller as for readrnxt()
+*-----------------------------------------------------------------------------*/
+extern int loadcacheobs(const char *file, obs_t *obs, nav_t *nav, sta_t *sta,
+                        int nsta)
+{
+    FILE *fp;
+    obsd_t *data;
+    eph_t *eph;
+    geph_t *geph;
+    seph_t *seph;
+    navprm_t *prm;
+    sta_t *stas;
+    int i,n[6],nepoch=0;
+
+    trace(3,"loadcacheobs: file=%s\n",file);
+
+    if (!(fp=opencache(file,0,&nepoch))) return 0;
+
+    data=(obsd_t   *)readsec(fp,SEC_OBS ,sizeof(obsd_t  ),n  );
+    eph =(eph_t    *)readsec(fp,SEC_EPH ,sizeof(eph_t   ),n+1);
+    geph=(geph_t   *)readsec(fp,SEC_GEPH,sizeof(geph_t  ),n+2);
+    seph=(seph_t   *)readsec(fp,SEC_SEPH,sizeof(seph_t  ),n+3);
+    prm =(navprm_t *)readsec(fp,SEC_NAVP,sizeof(navprm_t),n+4);
+    stas=(sta_t    *)readsec(fp,SEC_STA ,sizeof(sta_t   ),n+5);
+    fclose(fp);
+
+    if (n[0]<=0||n[1]<0||n[2]<0||n[3]<0||n[4]!=1||n[5]<0||nepoch<=0) {
+        trace(2,"cache data error: %s\n",file);
+        free(data); free(eph); free(geph); free(seph); free(prm); free(stas);
+        return 0;
+    }
+    obs->data=data; obs->n=obs->nmax=n[0];
+    nav->eph =eph ; nav->n =nav->nmax =n[1];
+    nav->geph=geph; nav->ng=nav->ngmax=n[2];
+    nav->seph=seph; nav->ns=nav->nsmax=n[3];
+
+    memcpy(nav->utc_gps,prm->utc_gps,sizeof(prm->utc_gps));
+    memcpy(nav->utc_glo,prm->utc_glo,sizeof(prm->utc_glo));
+    memcpy(nav->utc_gal,prm->utc_gal,sizeof(prm->utc_gal));
+    memcpy(nav->utc_qzs,prm->utc_qzs,sizeof(prm->utc_qzs));
+    memcpy(nav->utc_cmp,prm->utc_cmp,sizeof(prm->utc_cmp));
+    memcpy(nav->utc_irn,prm->utc_irn,sizeof(prm->utc_irn));
+    memcpy(nav->utc_sbs,prm->utc_sbs,sizeof(prm->utc_sbs));
+    memcpy(nav->ion_gps,prm->ion_gps,sizeof(prm->ion_gps));
+    memcpy(nav->ion_gal,prm->ion_gal,sizeof(prm->ion_gal));
+    memcpy(nav->ion_qzs,prm->ion_qzs,sizeof(prm->ion_qzs));
+    memcpy(nav->ion_cmp,prm->ion_cmp,sizeof(prm->ion_cmp));
+    memcpy(nav->ion_irn,prm->ion_irn,sizeof(prm->ion_irn));
+    memcpy(nav->glo_fcn,prm->glo_fcn,sizeof(prm->glo_fcn));
+
+    for (i=0;sta&&i<nsta&&i<n[5];i++) sta[i]=stas[i];
+
+    free(prm);
+    free(stas);
+    return nepoch;
+}
+/* save precise ephemeris/clock and sbas messages to cache ---------------------
+* save precise ephemeris, precise clock and sbas messages to binary cache
+* args   : char   *file     I   cache file path
+*          nav_t  *nav      I   navigation data (peph and pclk)
+*          sbs_t  *sbs      I   sbas messages
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+extern int savecachepeph(const char *file, const nav_t *nav, const sbs_t *sbs)
+{
+    FILE *fp;
+    char tmpfile[1024];
+    int stat;
+
+    trace(3,"savecachepeph: file=%s ne=%d nc=%d\n",file,nav->ne,nav->nc);
+
+    sprintf(tmpfile,"%.1000s.tmp",file);
+
+    if (!(fp=createcache(tmpfile,1,0,3))) return 0;
+
+    stat=writesec(fp,SEC_PEPH,nav->peph,sizeof(peph_t  ),nav->ne)&&
+         writesec(fp,SEC_PCLK,nav->pclk,sizeof(pclk_t  ),nav->nc)&&
+         writesec(fp,SEC_SBS ,sbs->msgs,sizeof(sbsmsg_t),sbs->n );
+
+    return closecache(fp,tmpfile,file,stat);
+}
+/* load precise ephemeris/clock and sbas messages from cache -------------------
+* load precise ephemeris, precise clock and sbas messages from binary cache
+* args   : char   *file     I   cache file path
+*          nav_t  *nav      IO  navigation data (peph and pclk)
+*          sbs_t  *sbs      O   sbas messages
+* return : status (1:ok,0:no valid cache)
+*-----------------------------------------------------------------------------*/
+extern int loadcachepeph(const char *file, nav_t *nav, sbs_t *sbs)
+{
+    FILE *fp;
+    peph_t *peph;
+    pclk_t *pclk;
+    sbsmsg_t *msgs;
+    int n[3];
+
+    trace(3,"loadcachepeph: file=%s\n",file);
+
+    if (!(fp=opencache(file,1,NULL))) return 0;
+
+    peph=(peph_t   *)readsec(fp,SEC_PEPH,sizeof(peph_t  ),n  );
+    pclk=(pclk_t   *)readsec(fp,SEC_PCLK,sizeof(pclk_t  ),n+1);
+    msgs=(sbsmsg_t *)readsec(fp,SEC_SBS ,sizeof(sbsmsg_t),n+2);
+    fclose(fp);
+
+    if (n[0]<0||n[1]<0||n[2]<0) {
+        trace(2,"cache data error: %s\n",file);
+        free(peph); free(pclk); free(msgs);
+        return 0;
+    }
+    nav->peph=peph; nav->ne=nav->nemax=n[0];
+    nav->pclk=pclk; nav->nc=nav->ncmax=n[1];
+    sbs->msgs=msgs; sbs->n =sbs->nmax =n[2];
+    return 1;
+}
@@ -18,6 +18,7 @@
 *           2010/05/10  1.4  support api readsolt() change
 *           2010/08/14  1.5  fix bug on readsolt() (2.4.0_p3)
 *           2017/06/10  1.6  support wild-card in input file
+*           2026/10/19  1.7  get geoid heights of track by geoidh_batch()
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -35,9 +36,20 @@ static const char *mark="http://maps.google.com/mapfiles/kml/pal2/icon18.png";
 static void outtrack(FILE *f, const solbuf_t *solbuf, const char *color,
                      int outalt, int outtime)
 {
-    double pos[3];
+    double *pos,*hgeo;
     int i;
     
+    if (!(pos=(double *)malloc(sizeof(double)*(solbuf->n*3+1)))||
+        !(hgeo=(double *)malloc(sizeof(double)*(solbuf->n+1)))) {
+        free(pos);
+        return;
+    }
+    for (i=0;i<solbuf->n;i++) {
+        ecef2pos(solbuf->data[i].rr,pos+i*3);
+    }
+    if (outalt==2) { /* geoid heights of all track points */
+        geoidh_batch(pos,solbuf->n,hgeo);
+    }
     fprintf(f,"<Placemark>\n");
     fprintf(f,"<name>Rover Track</name>\n");
     fprintf(f,"<Style>\n");
@@ -49,14 +61,16 @@ static void outtrack(FILE *f, const solbuf_t *solbuf, const char *color,
     if (outalt) fprintf(f,"<altitudeMode>absolute</altitudeMode>\n");
     fprintf(f,"<coordinates>\n");
     for (i=0;i<solbuf->n;i++) {
-        ecef2pos(solbuf->data[i].rr,pos);
-        if      (outalt==0) pos[2]=0.0;
-        else if (outalt==2) pos[2]-=geoidh(pos);
-        fprintf(f,"%13.9f,%12.9f,%5.3f\n",pos[1]*R2D,pos[0]*R2D,pos[2]);
+        if      (outalt==0) pos[2+i*3]=0.0;
+        else if (outalt==2) pos[2+i*3]-=hgeo[i];
+        fprintf(f,"%13.9f,%12.9f,%5.3f\n",pos[1+i*3]*R2D,pos[i*3]*R2D,
+                pos[2+i*3]);
     }
     fprintf(f,"</coordinates>\n");
     fprintf(f,"</LineString>\n");
     fprintf(f,"</Placemark>\n");
+    free(pos);
+    free(hgeo);
 }
 /* output point --------------------------------------------------------------*/
 static void outpoint(FILE *fp, gtime_t time, const double *pos,
@@ -43,11 +43,14 @@
 *                           fix bug on screening time in screent_ttol()
 *                           fix bug on screening QZS L1S messages as SBAS
 *                           use integer types in stdint.h
+*           2026/10/19 1.16 add obs-type scan window (tscan) in rnxopt_t
+*                           add api convrnx_batch()
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
 #define NOUTFILE        9       /* number of output files */
 #define TSTARTMARGIN    60.0    /* time margin for file name replacement */
+#define MAXBATCHTHREAD  64      /* max number of batch conversion threads */
 
 #define EVENT_STARTMOVE 2       /* rinex event start moving antenna */
 #define EVENT_NEWSITE   3       /* rinex event new site occupation */
@@ -69,6 +72,18 @@ typedef struct halfc_tag {      /* half-cycle ambiguity list type */
     struct halfc_tag *next;     /* next list */
 } halfc_t;
 
+typedef struct {                /* batch conversion type */
+    int format;                 /* stream format (STRFMT_???) */
+    rnxopt_t *opt;              /* RINEX options for each file */
+    char **files;               /* input files */
+    char **ofile;               /* output files (NOUTFILE for each file) */
+    int n;                      /* number of input files */
+    int next;                   /* index of next file to convert */
+    int nok;                    /* number of converted files */
+    int abort;                  /* abort flag */
+    rtklib_lock_t lock;         /* lock flag */
+} batch_t;
+
 typedef struct {                /* stream file type */
     int format;                 /* stream format (STRFMT_???) */
     int staid;                  /* station ID */
@@ -754,12 +769,13 @@ static int scan_file(char **files, int nf, rnxopt_t *opt, strfile_t *str,
     seph_t seph0={0};
     uint8_t codes[RNX_NUMSYS][33]={{0}};
     uint8_t types[RNX_NUMSYS][33]={{0}};
+    gtime_t t0={0};
     char msg[128];
-    int i,j,k,l,m,c=0,type,sys,prn,abort=0,n[RNX_NUMSYS]={0};
+    int i,j,k,l,m,c=0,type,sys,prn,abort=0,done=0,n[RNX_NUMSYS]={0};
     
-    trace(3,"scan_file: nf=%d\n",nf);
+    trace(3,"scan_file: nf=%d tscan=%.0f\n",nf,opt->tscan);
     
-    for (m=0;m<nf&&!abort;m++) {
+    for (m=0;m<nf&&!abort&&!done;m++) {
         
         if (!open_strfile(str,files[m])) {
             continue;
@@ -770,6 +786,15 @@ static int scan_file(char **files, int nf, rnxopt_t *opt, strfile_t *str,
             mask[m]=1; /* update file mask */
             
             if (type==1) { /* observation data */
+                
+                /* end of scan window */
+                if (opt->tscan>0.0&&!opt->halfcyc) {
+                    if (!t0.time) t0=str->time;
+                    else if (timediff(str->time,t0)>opt->tscan) {
+                        done=1;
+                        break;
+                    }
+                }
                 for (i=0;i<str->obs->n;i++) {
                     sys=satsys(str->obs->data[i].sat,NULL);
                     if (!(sys&opt->navsys)) continue;
@@ -824,6 +849,9 @@ static int scan_file(char **files, int nf, rnxopt_t *opt, strfile_t *str,
         trace(2,"aborted in scan\n");
         return 0;
     }
+    /* files after scan window are screened by time in conversion */
+    for (;m<nf;m++) mask[m]=1;
+    
     for (i=0;i<RNX_NUMSYS;i++) for (j=0;j<n[i];j++) {
         trace(2,"scan_file: sys=%d code=%s type=%d\n",i,code2obs(codes[i][j]),
               types[i][j]);
@@ -844,6 +872,8 @@ static int scan_file(char **files, int nf, rnxopt_t *opt, strfile_t *str,
     if (opt->phshift) {
         setopt_phshift(opt);
     }
+    /* set obs code maps for RINEX obs output */
+    setrnxobsmap(opt);
     /* set GLONASS FCN and clear ephemeris */
     for (i=0;i<str->nav->n;i++) {
         str->nav->eph[i]=eph0;
@@ -875,7 +905,19 @@ static void write_header(FILE **ofp, int idx, const rnxopt_t *opt,
         case 7: outrnxinavh(ofp[7],opt,nav); break;
     }
 }
-/* open output files ---------------------------------------------------------*/
+/* output file path ----------------------------------------------------------*/
+static void outpath(const char *ofile, const char *file, char *path)
+{
+    strcpy(path,ofile);
+    
+    /* check overwrite input file and modify output file */
+    if (!strcmp(path,file)) strcat(path,"_");
+}
+/* open output files -----------------------------------------------------------
+* notes  : with the obs-type scan window (opt->tscan>0), the bodies are written
+*          to temporary files and the headers are output in closefile() since
+*          the header length may change by the info decoded after the window
+*-----------------------------------------------------------------------------*/
 static int openfile(FILE **ofp, char *files[], const char *file,
                     const rnxopt_t *opt, const nav_t *nav)
 {
@@ -888,27 +930,39 @@ static int openfile(FILE **ofp, char *files[], const char *file,
         
         if (!*files[i]) continue;
         
-        strcpy(path,files[i]);
-        
-        /* check overwrite input file and modify output file */
-        if (!strcmp(path,file)) strcat(path,"_");
+        outpath(files[i],file,path);
         
         /* create directory if not exist */
         createdir(path);
         
-        if (!(ofp[i]=fopen(path,"w"))) {
+        if (!(ofp[i]=opt->tscan>0.0&&i<8?tmpfile():fopen(path,"w"))) {
             showmsg("file open error: %s",path);
             for (i--;i>=0;i--) if (ofp[i]) fclose(ofp[i]);
             return 0;
         }
         /* write RINEX header */
-        write_header(ofp,i,opt,nav);
+        if (opt->tscan<=0.0) write_header(ofp,i,opt,nav);
     }
     return 1;
 }
+/* copy body of temporary file to output file --------------------------------*/
+static int copybody(FILE *fp, FILE *tmp)
+{
+    char buff[65536];
+    size_t n;
+    
+    rewind(tmp);
+    while ((n=fread(buff,1,sizeof(buff),tmp))>0) {
+        if (fwrite(buff,1,n,fp)<n) return 0;
+    }
+    return !ferror(tmp);
+}
 /* close output files --------------------------------------------------------*/
-static void closefile(FILE **ofp, const rnxopt_t *opt, nav_t *nav)
+static void closefile(FILE **ofp, char *files[], const char *file,
+                      const rnxopt_t *opt, nav_t *nav)
 {
+    FILE *fp[NOUTFILE]={NULL};
+    char path[1024];
     int i;
     
     trace(3,"closefile:\n");
@@ -917,10 +971,26 @@ static void closefile(FILE **ofp, const rnxopt_t *opt, nav_t *nav)
         
         if (!ofp[i]) continue;
         
-        /* rewrite RINEX header */
-        rewind(ofp[i]);
-        write_header(ofp,i,opt,nav);
+        if (opt->tscan<=0.0||i>=8) {
+            
+            /* rewrite RINEX header */
+            rewind(ofp[i]);
+            write_header(ofp,i,opt,nav);
+            
+            fclose(ofp[i]);
+            continue;
+        }
+        /* output RINEX header and body */
+        outpath(files[i],file,path);
         
+        if (!(fp[i]=fopen(path,"w"))) {
+            showmsg("file open error: %s",path);
+        }
+        else {
+            write_header(fp,i,opt,nav);
+            if (!copybody(fp[i],ofp[i])) showmsg("file write error: %s",path);
+            fclose(fp[i]);
+        }
         fclose(ofp[i]);
     }
 }
@@ -1375,7 +1445,7 @@ static int convrnx_s(int sess, int format, rnxopt_t *opt, const char *file,
         close_strfile(str);
     }
     /* close output files */
-    closefile(ofp,opt,str->nav);
+    closefile(ofp,paths,path,opt,str->nav);
     
     /* remove empty output files */
     for (i=0;i<NOUTFILE;i++) {
@@ -1473,3 +1543,90 @@ extern int convrnx(int format, rnxopt_t *opt, const char *file, char **ofile)
     
     return stat;
 }
+/* batch conversion worker thread --------------------------------------------*/
+#ifdef WIN32
+static DWORD WINAPI batchthread(void *arg)
+#else
+static void *batchthread(void *arg)
+#endif
+{
+    batch_t *batch=(batch_t *)arg;
+    int i,stat;
+    
+    for (;;) {
+        rtklib_lock(&batch->lock);
+        i=batch->abort?batch->n:batch->next++;
+        rtklib_unlock(&batch->lock);
+        
+        if (i>=batch->n) break;
+        
+        stat=convrnx(batch->format,batch->opt+i,batch->files[i],
+                     batch->ofile+i*NOUTFILE);
+        
+        rtklib_lock(&batch->lock);
+        if (stat>0) batch->nok++;
+        else if (stat<0) batch->abort=1;
+        rtklib_unlock(&batch->lock);
+    }
+    return 0;
+}
+/* RINEX converter for batch of files ------------------------------------------
+* convert independent receiver log files to RINEX files by worker threads
+* args   : int    format I      receiver raw format (STRFMT_???)
+*          rnxopt_t *opt IO     RINEX options for each file (opt[0..n-1])
+*          char   **files I     RTCM, receiver raw or RINEX files
+*                               (wild-cards (*) are expanded in each file)
+*          char   **ofile IO    output files for each file
+*                               ofile[i*9+j] output file j of files[i]
+*                               (see convrnx() for j)
+*          int    n      I      number of files
+*          int    nthread I     number of worker threads (<=1: no thread)
+* return : number of converted files (-1: abort)
+* notes  : each files[i] is converted by convrnx() with opt[i] independently,
+*          so the output files of different files[i] should not be same
+*          the conversions share showmsg() and trace output
+*-----------------------------------------------------------------------------*/
+extern int convrnx_batch(int format, rnxopt_t *opt, char **files,
+                         char **ofile, int n, int nthread)
+{
+    rtklib_thread_t thread[MAXBATCHTHREAD];
+    batch_t batch={0};
+    int i,nt=0;
+    
+    trace(3,"convrnx_batch: format=%d n=%d nthread=%d\n",format,n,nthread);
+    
+    batch.format=format;
+    batch.opt=opt;
+    batch.files=files;
+    batch.ofile=ofile;
+    batch.n=n;
+    rtklib_initlock(&batch.lock);
+    
+    if (nthread>MAXBATCHTHREAD) nthread=MAXBATCHTHREAD;
+    if (nthread>n) nthread=n;
+    
+    /* create worker threads */
+    for (i=0;i<nthread&&nthread>1;i++) {
+#ifdef WIN32
+        if (!(thread[nt]=CreateThread(NULL,0,batchthread,&batch,0,NULL))) {
+#else
+        if (pthread_create(thread+nt,NULL,batchthread,&batch)) {
+#endif
+            trace(2,"convrnx_batch: thread create error\n");
+            break;
+        }
+        nt++;
+    }
+    /* convert files in current thread if no worker thread */
+    if (nt<=0) batchthread(&batch);
+    
+    for (i=0;i<nt;i++) {
+#ifdef WIN32
+        WaitForSingleObject(thread[i],INFINITE);
+        CloseHandle(thread[i]);
+#else
+        pthread_join(thread[i],NULL);
+#endif
+    }
+    return batch.abort?-1:batch.nok;
+}
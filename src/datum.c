@@ -5,6 +5,7 @@
 *
 * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
 * history : 2007/02/08 1.0 new
+*           2026/10/19 1.1 move parameter table to library context
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -15,9 +16,6 @@ typedef struct {                    /* datum trans parameter type */
     float db,dl;                    /* difference of latitude/longitude (sec) */
 } tprm_t;
 
-static tprm_t *prm=NULL;            /* datum trans parameter table */
-static int n=0;                     /* datum trans parameter table size */
-
 /* compare datum trans parameters --------------------------------------------*/
 static int cmpprm(const void *p1, const void *p2)
 {
@@ -25,7 +23,7 @@ static int cmpprm(const void *p1, const void *p2)
     return q1->code-q2->code;
 }
 /* search datum trans parameter ----------------------------------------------*/
-static int searchprm(double lat, double lon)
+static int searchprm(const tprm_t *prm, int n, double lat, double lon)
 {
     int i,j,k,n1,m1,n2,m2,code;
     
@@ -46,13 +44,15 @@ static int searchprm(double lat, double lon)
 /* tokyo datum to jgd2000 lat/lon corrections --------------------------------*/
 static int dlatdlon(const double *post, double *dpos)
 {
+    const rtkctx_t *ctx=getrtkctx();
+    const tprm_t *prm=(const tprm_t *)ctx->datum;
     double lat=post[0]*R2D*60.0,lon=post[1]*R2D*60.0; /* arcmin */
     double dlat=0.5,dlon=0.75,db[2][2],dl[2][2],a,b,c,d;
     int i,j,k;
     
-    if (n==0) return -1;
+    if (ctx->ndatum==0) return -1;
     for (i=0;i<2;i++) for (j=0;j<2;j++) {
-        if ((k=searchprm(lat+i*dlat,lon+j*dlon))<0) return -1;
+        if ((k=searchprm(prm,ctx->ndatum,lat+i*dlat,lon+j*dlon))<0) return -1;
         db[i][j]=prm[k].db; dl[i][j]=prm[k].dl;
     }
     a=lat/dlat-(int)(lat/dlat); c=1.0-a;
@@ -66,13 +66,17 @@ static int dlatdlon(const double *post, double *dpos)
 * args   : char  *file      I   datum trans parameter file path
 * return : status (0:ok,0>:error)
 * notes  : parameters file shall comply with GSI TKY2JGD.par
+*          the table is loaded to the library context of the calling thread
 *-----------------------------------------------------------------------------*/
 extern int loaddatump(const char *file)
 {
+    rtkctx_t *ctx=getrtkctx();
+    tprm_t *prm;
     FILE *fp;
     char buff[256];
+    int n=0;
     
-    if (n>0) return 0; /* already loaded */
+    if (ctx->ndatum>0) return 0; /* already loaded */
     
     if (!(fp=fopen(file,"r"))) {
         fprintf(stderr,"%s : datum prm file open error : %s\n",__FILE__,file);
@@ -88,6 +92,8 @@ extern int loaddatump(const char *file)
     }
     fclose(fp);
     qsort(prm,n,sizeof(tprm_t),cmpprm); /* sort parameter table */
+    ctx->datum=prm;
+    ctx->ndatum=n;
     return 0;
 }
 /* tokyo datum to JGD2000 datum ------------------------------------------------
@@ -70,6 +70,9 @@
 *                           fix bug on clock reference time in satpos_ssr()
 *                           fix bug on wrong value with ura=15 in var_ura()
 *                           use integer types in stdint.h
+*           2026/10/19 1.15 add astronomical context to api satposs()
+*                           move ephemeris selections to library context
+*                           select ephemeris in satellite index of nav
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -105,11 +108,6 @@
 
 #define MAX_ITER_KEPLER 30        /* max number of iteration of Kepler */
 
-/* ephemeris selections ------------------------------------------------------*/
-static int eph_sel[]={ /* GPS,GLO,GAL,QZS,BDS,IRN,SBS */
-    0,0,0,0,0,0,0
-};
-
 /* variance by ura ephemeris -------------------------------------------------*/
 static double var_uraeph(int sys, int ura)
 {
@@ -428,11 +426,26 @@ extern void seph2pos(gtime_t time, const seph_t *seph, double *rs, double *dts,
 
     *var=var_uraeph(SYS_SBS,seph->sva);
 }
+/* range of ephemerides of satellite ------------------------------------------
+* ephemerides of satellite in satellite index of navigation data (see uniqnav())
+* or all ephemerides without valid index
+*-----------------------------------------------------------------------------*/
+static void satrange(const nav_t *nav, int type, const void *data, int n,
+                     int sat, int *i0, int *i1)
+{
+    *i0=0; *i1=n;
+
+    if (!data||nav->idxdata[type]!=data||nav->idxn[type]!=n) return;
+    if (sat<1||sat>MAXSAT) return;
+    *i0=nav->idxsat[type][sat-1];
+    *i1=nav->idxsat[type][sat];
+}
 /* select ephemeris --------------------------------------------------------*/
 static eph_t *seleph(gtime_t time, int sat, int iode, const nav_t *nav)
 {
+    const int *eph_sel=getrtkctx()->eph_sel;
     double t,tmax,tmin;
-    int i,j=-1,sys,sel=0;
+    int i,j=-1,i0,i1,sys,sel=0;
 
     char tstr[40];
     trace(4,"seleph  : time=%s sat=%2d iode=%d\n",time2str(time,tstr,3),sat,iode);
@@ -448,7 +461,9 @@ static eph_t *seleph(gtime_t time, int sat, int iode, const nav_t *nav)
     }
     tmin=tmax+1.0;
 
-    for (i=0;i<nav->n;i++) {
+    satrange(nav,0,nav->eph,nav->n,sat,&i0,&i1);
+
+    for (i=i0;i<i1;i++) {
         if (nav->eph[i].sat!=sat) continue;
         if (iode>=0&&nav->eph[i].iode!=iode) continue;
         if (sys==SYS_GAL) {
@@ -477,12 +492,14 @@ static eph_t *seleph(gtime_t time, int sat, int iode, const nav_t *nav)
 static geph_t *selgeph(gtime_t time, int sat, int iode, const nav_t *nav)
 {
     double t,tmax=MAXDTOE_GLO,tmin=tmax+1.0;
-    int i,j=-1;
+    int i,j=-1,i0,i1;
 
     char tstr[40];
     trace(4,"selgeph : time=%s sat=%2d iode=%2d\n",time2str(time,tstr,3),sat,iode);
 
-    for (i=0;i<nav->ng;i++) {
+    satrange(nav,1,nav->geph,nav->ng,sat,&i0,&i1);
+
+    for (i=i0;i<i1;i++) {
         if (nav->geph[i].sat!=sat) continue;
         if (iode>=0&&nav->geph[i].iode!=iode) continue;
         if ((t=fabs(timediff(nav->geph[i].toe,time)))>tmax) continue;
@@ -501,12 +518,14 @@ static geph_t *selgeph(gtime_t time, int sat, int iode, const nav_t *nav)
 static seph_t *selseph(gtime_t time, int sat, const nav_t *nav)
 {
     double t,tmax=MAXDTOE_SBS,tmin=tmax+1.0;
-    int i,j=-1;
+    int i,j=-1,i0,i1;
 
     char tstr[40];
     trace(4,"selseph : time=%s sat=%2d\n",time2str(time,tstr,3),sat);
 
-    for (i=0;i<nav->ns;i++) {
+    satrange(nav,2,nav->seph,nav->ns,sat,&i0,&i1);
+
+    for (i=i0;i<i1;i++) {
         if (nav->seph[i].sat!=sat) continue;
         if ((t=fabs(timediff(nav->seph[i].t0,time)))>tmax) continue;
         if (t<=tmin) {j=i; tmin=t;} /* toe closest to time */
@@ -625,7 +644,8 @@ static int satpos_sbas(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
 }
 /* satellite position and clock with ssr correction --------------------------*/
 static int satpos_ssr(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
-                      int opt, double *rs, double *dts, double *var, int *svh)
+                      int opt, const astro_t *astro, double *rs, double *dts,
+                      double *var, int *svh)
 {
     const ssr_t *ssr;
     eph_t *eph;
@@ -706,7 +726,7 @@ static int satpos_ssr(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
 
     /* satellite antenna offset correction */
     if (opt) {
-        satantoff(time,rs,sat,nav,dant);
+        satantoff(time,rs,sat,nav,astro,dant);
     }
     for (i=0;i<3;i++) {
         rs[i]+=-(er[i]*deph[0]+ea[i]*deph[1]+ec[i]*deph[2])+dant[i];
@@ -722,6 +742,27 @@ static int satpos_ssr(gtime_t time, gtime_t teph, int sat, const nav_t *nav,
 
     return 1;
 }
+/* satellite position and clock with astronomical context -------------------*/
+static int satpos_astro(gtime_t time, gtime_t teph, int sat, int ephopt,
+                        const nav_t *nav, const astro_t *astro, double *rs,
+                        double *dts, double *var, int *svh)
+{
+    char tstr[40];
+    trace(4,"satpos  : time=%s sat=%2d ephopt=%d\n",time2str(time,tstr,3),sat,ephopt);
+
+    *svh=0;
+
+    switch (ephopt) {
+        case EPHOPT_BRDC  : return ephpos     (time,teph,sat,nav,-1,rs,dts,var,svh);
+        case EPHOPT_SBAS  : return satpos_sbas(time,teph,sat,nav,   rs,dts,var,svh);
+        case EPHOPT_SSRAPC: return satpos_ssr (time,teph,sat,nav, 0,astro,rs,dts,var,svh);
+        case EPHOPT_SSRCOM: return satpos_ssr (time,teph,sat,nav, 1,astro,rs,dts,var,svh);
+        case EPHOPT_PREC  :
+            if (!peph2pos(time,sat,nav,1,astro,rs,dts,var)) break; else return 1;
+    }
+    *svh=-1;
+    return 0;
+}
 /* satellite position and clock ------------------------------------------------
 * compute satellite position, velocity and clock
 * args   : gtime_t time     I   time (gpst)
@@ -742,21 +783,7 @@ extern int satpos(gtime_t time, gtime_t teph, int sat, int ephopt,
                   const nav_t *nav, double *rs, double *dts, double *var,
                   int *svh)
 {
-    char tstr[40];
-    trace(4,"satpos  : time=%s sat=%2d ephopt=%d\n",time2str(time,tstr,3),sat,ephopt);
-
-    *svh=0;
-
-    switch (ephopt) {
-        case EPHOPT_BRDC  : return ephpos     (time,teph,sat,nav,-1,rs,dts,var,svh);
-        case EPHOPT_SBAS  : return satpos_sbas(time,teph,sat,nav,   rs,dts,var,svh);
-        case EPHOPT_SSRAPC: return satpos_ssr (time,teph,sat,nav, 0,rs,dts,var,svh);
-        case EPHOPT_SSRCOM: return satpos_ssr (time,teph,sat,nav, 1,rs,dts,var,svh);
-        case EPHOPT_PREC  :
-            if (!peph2pos(time,sat,nav,1,rs,dts,var)) break; else return 1;
-    }
-    *svh=-1;
-    return 0;
+    return satpos_astro(time,teph,sat,ephopt,nav,NULL,rs,dts,var,svh);
 }
 /* satellite positions and clocks ----------------------------------------------
 * compute satellite positions, velocities and clocks
@@ -765,6 +792,8 @@ extern int satpos(gtime_t time, gtime_t teph, int sat, int ephopt,
 *          int    n         I   number of observation data
 *          nav_t  *nav      I   navigation data
 *          int    ephopt    I   ephemeris option (EPHOPT_???)
+*          astro_t *astro   I   astronomical context of the epoch
+*                               (NULL: computed for teph if needed)
 *          double *rs       O   satellite positions and velocities (ecef)
 *          double *dts      O   satellite clocks
 *          double *var      O   sat position and clock error variances (m^2)
@@ -783,15 +812,24 @@ extern int satpos(gtime_t time, gtime_t teph, int sat, int ephopt,
 *          signal transmission time
 *-----------------------------------------------------------------------------*/
 extern void satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav,
-                    int ephopt, double *rs, double *dts, double *var, int *svh)
+                    int ephopt, const astro_t *astro, double *rs, double *dts,
+                    double *var, int *svh)
 {
     gtime_t time[2*MAXOBS]={{0}};
-    double dt,pr;
+    astro_t astro_;
+    double dt,pr,erpv[5]={0};
     int i,j;
 
     char tstr[40];
     trace(3,"satposs : teph=%s n=%d ephopt=%d\n",time2str(teph,tstr,3),n,ephopt);
 
+    /* astronomical context for satellite antenna offset */
+    if (!astro&&(ephopt==EPHOPT_PREC||ephopt==EPHOPT_SSRCOM)) {
+        geterp(&nav->erp,teph,erpv);
+        setastro(gpst2utc(teph),erpv,&astro_);
+        astro=&astro_;
+    }
+
     for (i=0;i<n&&i<2*MAXOBS;i++) {
         for (j=0;j<6;j++) rs [j+i*6]=0.0;
         for (j=0;j<2;j++) dts[j+i*2]=0.0;
@@ -815,8 +853,8 @@ extern void satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav,
         time[i]=timeadd(time[i],-dt);
 
         /* satellite position and clock at transmission time */
-        if (!satpos(time[i],teph,obs[i].sat,ephopt,nav,rs+i*6,dts+i*2,var+i,
-                    svh+i)) {
+        if (!satpos_astro(time[i],teph,obs[i].sat,ephopt,nav,astro,rs+i*6,
+                          dts+i*2,var+i,svh+i)) {
             trace(3,"no ephemeris %s sat=%2d\n",time2str(time[i],tstr,3),obs[i].sat);
             continue;
         }
@@ -847,9 +885,12 @@ extern void satposs(gtime_t teph, const obsd_t *obs, int n, const nav_t *nav,
 *  2.4.3 b34 but not functional?  GAL     : 0:I/NAV,1:F/NAV (default: I/NAV)
 *                                 others : undefined
 * return : none
+* notes  : the selection is set to the library context of the calling thread
 *-----------------------------------------------------------------------------*/
 extern void setseleph(int sys, int sel)
 {
+    int *eph_sel=getrtkctx()->eph_sel;
+
     switch (sys) {
         case SYS_GPS: eph_sel[0]=sel; break;
         case SYS_GLO: eph_sel[1]=sel; break;
@@ -868,6 +909,8 @@ extern void setseleph(int sys, int sel)
 *-----------------------------------------------------------------------------*/
 extern int getseleph(int sys)
 {
+    const int *eph_sel=getrtkctx()->eph_sel;
+
     switch (sys) {
         case SYS_GPS: return eph_sel[0];
         case SYS_GLO: return eph_sel[1];
@@ -13,13 +13,35 @@
 *           2009/12/05 1.2  added api:
 *                               opengeoid(),closegeoid()
 *           2020/11/30 1.3  use integer types in stdint.h
+*           2026/10/19 1.4  move geoid model file to library context
+*                           memory-map geoid model files instead of reading
+*                            grid values by fseek()/fread()
+*                           parse gsi geoid grid once at opengeoid()
+*                           added api geoidh_batch()
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define GSI_NLON    1201            /* gsi geoid 2000 grid size (lon) */
+#define GSI_NLAT    1801            /* gsi geoid 2000 grid size (lat) */
+
+typedef struct {                    /* geoid model data type */
+    int model;                      /* geoid model */
+    const uint8_t *data;            /* mapped grid file (NULL: not mapped) */
+    size_t size;                    /* mapped grid file size (bytes) */
+    double *grid;                   /* parsed gsi geoid grid (lon x lat) */
+#ifdef WIN32
+    HANDLE hfile,hmap;              /* file and file mapping handle */
+#endif
+} geoid_t;
 
 static const double range[4];       /* embedded geoid area range {W,E,S,N} (deg) */
 static const float geoid[361][181]; /* embedded geoid heights (m) (lon x lat) */
-static FILE *fp_geoid=NULL;         /* geoid file pointer */
-static int model_geoid=GEOID_EMBEDDED; /* geoid model */
 
 /* bilinear interpolation ----------------------------------------------------*/
 static double interpb(const double *y, double a, double b)
@@ -47,46 +69,49 @@ static double geoidh_emb(const double *pos)
     y[3]=geoid[i2][j2];
     return interpb(y,a,b);
 }
-/* get 2 byte signed integer from file ---------------------------------------*/
-static int16_t fget2b(FILE *fp, int32_t off)
+/* get 2 byte signed integer from mapped file --------------------------------*/
+static int16_t get2b(const geoid_t *g, size_t off)
 {
-    uint8_t v[2]={0x00};
-    if (fseek(fp,off,SEEK_SET)==EOF||fread(v,2,1,fp)<1) {
-        trace(2,"geoid data file range error: off=%ld\n",off);
+    if (off+2>g->size) {
+        trace(2,"geoid data file range error: off=%ld\n",(long)off);
+        return 0;
     }
-    return ((int16_t)v[0]<<8)+v[1]; /* big-endian */
+    return (int16_t)((g->data[off]<<8)+g->data[off+1]); /* big-endian */
 }
 /* egm96 15x15" model --------------------------------------------------------*/
-static double geoidh_egm96(const double *pos)
+static double geoidh_egm96(const geoid_t *g, const double *pos)
 {
     const double lon0=0.0,lat0=90.0,dlon=15.0/60.0,dlat=-15.0/60.0;
     const int nlon=1440,nlat=721;
     double a,b,y[4];
     int i1,i2,j1,j2;
     
-    if (!fp_geoid) return 0.0;
+    if (!g||!g->data) return 0.0;
     
     a=(pos[1]-lon0)/dlon;
     b=(pos[0]-lat0)/dlat;
     i1=(int)a; a-=i1; i2=i1<nlon-1?i1+1:0;
     j1=(int)b; b-=j1; j2=j1<nlat-1?j1+1:j1;
-    y[0]=fget2b(fp_geoid,2L*(i1+j1*nlon))*0.01;
-    y[1]=fget2b(fp_geoid,2L*(i2+j1*nlon))*0.01;
-    y[2]=fget2b(fp_geoid,2L*(i1+j2*nlon))*0.01;
-    y[3]=fget2b(fp_geoid,2L*(i2+j2*nlon))*0.01;
+    y[0]=get2b(g,2*((size_t)i1+(size_t)j1*nlon))*0.01;
+    y[1]=get2b(g,2*((size_t)i2+(size_t)j1*nlon))*0.01;
+    y[2]=get2b(g,2*((size_t)i1+(size_t)j2*nlon))*0.01;
+    y[3]=get2b(g,2*((size_t)i2+(size_t)j2*nlon))*0.01;
     return interpb(y,a,b);
 }
-/* get 4byte float from file -------------------------------------------------*/
-static float fget4f(FILE *fp, int off)
+/* get 4 byte float from mapped file -----------------------------------------*/
+static float get4f(const geoid_t *g, size_t off)
 {
-    float v=0.0;
-    if (fseek(fp,(long)off,SEEK_SET)==EOF||fread(&v,4,1,fp)<1) {
-        trace(2,"geoid data file range error: off=%ld\n",off);
+    float v=0.0f;
+    
+    if (off+4>g->size) {
+        trace(2,"geoid data file range error: off=%ld\n",(long)off);
+        return 0.0f;
     }
+    memcpy(&v,g->data+off,4);
     return v; /* small-endian */
 }
 /* egm2008 model -------------------------------------------------------------*/
-static double geoidh_egm08(const double *pos, int model)
+static double geoidh_egm08(const geoid_t *g, const double *pos, int model)
 {
     const double lon0=0.0,lat0=90.0;
     double dlon,dlat;
@@ -94,7 +119,7 @@ static double geoidh_egm08(const double *pos, int model)
     int i1,i2,j1,j2;
     int nlon,nlat;
     
-    if (!fp_geoid) return 0.0;
+    if (!g||!g->data) return 0.0;
     
     if (model==GEOID_EGM2008_M25) { /* 2.5 x 2.5" grid */
         dlon= 2.5/60.0;
@@ -120,47 +145,62 @@ static double geoidh_egm08(const double *pos, int model)
     /* (2) Und_min2.5x2.5_egm2008_isw=82_WGS84_TideFree_SE.gz */
 #if 0
     /* not zero-inserted */
-    y[0]=fget4f(fp_geoid,4L*(i1+j1*(nlon)));
-    y[1]=fget4f(fp_geoid,4L*(i2+j1*(nlon)));
-    y[2]=fget4f(fp_geoid,4L*(i1+j2*(nlon)));
-    y[3]=fget4f(fp_geoid,4L*(i2+j2*(nlon)));
+    y[0]=get4f(g,4*((size_t)i1+(size_t)j1*(nlon)));
+    y[1]=get4f(g,4*((size_t)i2+(size_t)j1*(nlon)));
+    y[2]=get4f(g,4*((size_t)i1+(size_t)j2*(nlon)));
+    y[3]=get4f(g,4*((size_t)i2+(size_t)j2*(nlon)));
 #else
     /* zero-inserted version (2009/12/10) */
-    y[0]=fget4f(fp_geoid,4L*(i1+j1*(nlon+2)+1));
-    y[1]=fget4f(fp_geoid,4L*(i2+j1*(nlon+2)+1));
-    y[2]=fget4f(fp_geoid,4L*(i1+j2*(nlon+2)+1));
-    y[3]=fget4f(fp_geoid,4L*(i2+j2*(nlon+2)+1));
+    y[0]=get4f(g,4*((size_t)i1+(size_t)j1*(nlon+2)+1));
+    y[1]=get4f(g,4*((size_t)i2+(size_t)j1*(nlon+2)+1));
+    y[2]=get4f(g,4*((size_t)i1+(size_t)j2*(nlon+2)+1));
+    y[3]=get4f(g,4*((size_t)i2+(size_t)j2*(nlon+2)+1));
 #endif
     return interpb(y,a,b);
 }
-/* get gsi geoid data --------------------------------------------------------*/
-static double fgetgsi(FILE *fp, int nlon, int nlat, int i, int j)
+/* parse gsi geoid data ------------------------------------------------------*/
+static double parsegsi(const geoid_t *g, int nlon, int nlat, int i, int j)
 {
     const int nf=28,wf=9,nl=nf*wf+2,nr=(nlon-1)/nf+1;
+    size_t off=nl+(size_t)j*nr*nl+i/nf*nl+i%nf*wf;
     double v;
-    int off=nl+j*nr*nl+i/nf*nl+i%nf*wf;
     char buff[16]="";
     
-    if (fseek(fp,(long)off,SEEK_SET)==EOF||fread(buff,wf,1,fp)<1) {
+    if (off+wf>g->size) {
         trace(2,"out of range for gsi geoid: i=%d j=%d\n",i,j);
         return 0.0;
     }
+    memcpy(buff,g->data+off,wf);
     if (sscanf(buff,"%lf",&v)<1) {
         trace(2,"gsi geoid data format error: i=%d j=%d buff=%s\n",i,j,buff);
         return 0.0;
     }
     return v;
 }
+/* convert gsi geoid ascii grid to binary grid -------------------------------*/
+static int loadgsi(geoid_t *g)
+{
+    int i,j;
+    
+    if (!(g->grid=(double *)malloc(sizeof(double)*GSI_NLON*GSI_NLAT))) {
+        trace(1,"gsi geoid grid malloc error\n");
+        return 0;
+    }
+    for (j=0;j<GSI_NLAT;j++) for (i=0;i<GSI_NLON;i++) {
+        g->grid[i+j*GSI_NLON]=parsegsi(g,GSI_NLON,GSI_NLAT,i,j);
+    }
+    return 1;
+}
 /* gsi geoid 2000 1.0x1.5" model ---------------------------------------------*/
-static double geoidh_gsi(const double *pos)
+static double geoidh_gsi(const geoid_t *g, const double *pos)
 {
     const double lon0=120.0,lon1=150.0,lat0=20.0,lat1=50.0;
     const double dlon=1.5/60.0,dlat=1.0/60.0;
-    const int nlon=1201,nlat=1801;
+    const int nlon=GSI_NLON,nlat=GSI_NLAT;
     double a,b,y[4];
     int i1,i2,j1,j2;
     
-    if (!fp_geoid||pos[1]<lon0||lon1<pos[1]||pos[0]<lat0||lat1<pos[0]) {
+    if (!g||!g->grid||pos[1]<lon0||lon1<pos[1]||pos[0]<lat0||lat1<pos[0]) {
         trace(2,"out of range for gsi geoid: lat=%.3f lon=%.3f\n",pos[0],pos[1]);
         return 0.0;
     }
@@ -168,16 +208,69 @@ static double geoidh_gsi(const double *pos)
     b=(pos[0]-lat0)/dlat;
     i1=(int)a; a-=i1; i2=i1<nlon-1?i1+1:i1;
     j1=(int)b; b-=j1; j2=j1<nlat-1?j1+1:j1;
-    y[0]=fgetgsi(fp_geoid,nlon,nlat,i1,j1);
-    y[1]=fgetgsi(fp_geoid,nlon,nlat,i2,j1);
-    y[2]=fgetgsi(fp_geoid,nlon,nlat,i1,j2);
-    y[3]=fgetgsi(fp_geoid,nlon,nlat,i2,j2);
+    y[0]=g->grid[i1+j1*nlon];
+    y[1]=g->grid[i2+j1*nlon];
+    y[2]=g->grid[i1+j2*nlon];
+    y[3]=g->grid[i2+j2*nlon];
     if (y[0]==999.0||y[1]==999.0||y[2]==999.0||y[3]==999.0) {
         trace(2,"geoidh_gsi: data outage (lat=%.3f lon=%.3f)\n",pos[0],pos[1]);
         return 0.0;
     }
     return interpb(y,a,b);
 }
+/* map geoid model file to memory --------------------------------------------*/
+static int mapgeoid(geoid_t *g, const char *file)
+{
+#ifdef WIN32
+    LARGE_INTEGER size;
+    
+    g->hfile=CreateFile(file,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL,NULL);
+    if (g->hfile==INVALID_HANDLE_VALUE) return 0;
+    
+    if (!GetFileSizeEx(g->hfile,&size)||size.QuadPart<=0||
+        !(g->hmap=CreateFileMapping(g->hfile,NULL,PAGE_READONLY,0,0,NULL))) {
+        CloseHandle(g->hfile);
+        return 0;
+    }
+    if (!(g->data=(const uint8_t *)MapViewOfFile(g->hmap,FILE_MAP_READ,0,0,0))) {
+        CloseHandle(g->hmap);
+        CloseHandle(g->hfile);
+        return 0;
+    }
+    g->size=(size_t)size.QuadPart;
+#else
+    struct stat st;
+    void *p;
+    int fd;
+    
+    if ((fd=open(file,O_RDONLY))<0) return 0;
+    
+    if (fstat(fd,&st)<0||st.st_size<=0||
+        (p=mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,fd,0))==MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+    close(fd); /* mapping remains valid after closing fd */
+    g->data=(const uint8_t *)p;
+    g->size=(size_t)st.st_size;
+#endif
+    return 1;
+}
+/* unmap geoid model file ----------------------------------------------------*/
+static void unmapgeoid(geoid_t *g)
+{
+    if (!g->data) return;
+#ifdef WIN32
+    UnmapViewOfFile(g->data);
+    CloseHandle(g->hmap);
+    CloseHandle(g->hfile);
+#else
+    munmap((void *)g->data,g->size);
+#endif
+    g->data=NULL;
+    g->size=0;
+}
 /* open geoid model file -------------------------------------------------------
 * open geoid model file
 * args   : int    model     I   geoid model type
@@ -194,9 +287,17 @@ static double geoidh_gsi(const double *pos)
 *          Und_min1x1_egm2008_isw=82_WGS84_TideFree_SE    : EGM2008 1.0x1.0"
 *          gsigeome_ver4 : GSI geoid 2000 1.0x1.5" (japanese area)
 *          (byte-order of binary files must be compatible to cpu)
+*          the geoid model is set to the library context of the calling thread
+*          binary grid files are mapped to memory read-only. the gsi ascii grid
+*          is converted to a binary grid at opening. after opening, geoidh()
+*          and geoidh_batch() can be called by multiple threads sharing the
+*          context without locking
 *-----------------------------------------------------------------------------*/
 extern int opengeoid(int model, const char *file)
 {
+    rtkctx_t *ctx=getrtkctx();
+    geoid_t *g;
+
     trace(3,"opengeoid: model=%d file=%s\n",model,file);
     
     closegeoid();
@@ -208,11 +309,27 @@ extern int opengeoid(int model, const char *file)
         trace(2,"invalid geoid model: model=%d file=%s\n",model,file);
         return 0;
     }
-    if (!(fp_geoid=fopen(file,"rb"))) {
+    if (!(g=(geoid_t *)calloc(1,sizeof(geoid_t)))) {
+        return 0;
+    }
+    g->model=model;
+
+    if (!mapgeoid(g,file)) {
         trace(2,"geoid model file open error: model=%d file=%s\n",model,file);
+        free(g);
         return 0;
     }
-    model_geoid=model;
+    if (model==GEOID_GSI2000_M15) { /* ascii grid to binary grid */
+        if (!loadgsi(g)) {
+            unmapgeoid(g);
+            free(g);
+            return 0;
+        }
+        unmapgeoid(g);
+    }
+    ctx->geoid=g;
+    ctx->model_geoid=model;
+    add_ctxclose(closegeoid);
     return 1;
 }
 /* close geoid model file ------------------------------------------------------
@@ -222,21 +339,21 @@ extern int opengeoid(int model, const char *file)
 *-----------------------------------------------------------------------------*/
 extern void closegeoid(void)
 {
+    rtkctx_t *ctx=getrtkctx();
+    geoid_t *g=(geoid_t *)ctx->geoid;
+
     trace(3,"closegoid:\n");
     
-    if (fp_geoid) fclose(fp_geoid);
-    fp_geoid=NULL;
-    model_geoid=GEOID_EMBEDDED;
+    if (g) {
+        unmapgeoid(g);
+        free(g->grid);
+        free(g);
+    }
+    ctx->geoid=NULL;
+    ctx->model_geoid=GEOID_EMBEDDED;
 }
-/* geoid height ----------------------------------------------------------------
-* get geoid height from geoid model
-* args   : double *pos      I   geodetic position {lat,lon} (rad)
-* return : geoid height (m) (0.0:error)
-* notes  : to use external geoid model, call function opengeoid() to open
-*          geoid model before calling the function. If the external geoid model
-*          is not open, the function uses embedded geoid model.
-*-----------------------------------------------------------------------------*/
-extern double geoidh(const double *pos)
+/* geoid height by model -----------------------------------------------------*/
+static double geoidh_model(const geoid_t *g, int model, const double *pos)
 {
     double posd[2],h;
     
@@ -246,12 +363,12 @@ extern double geoidh(const double *pos)
         trace(2,"out of range for geoid model: lat=%.3f lon=%.3f\n",posd[0],posd[1]);
         return 0.0;
     }
-    switch (model_geoid) {
+    switch (model) {
         case GEOID_EMBEDDED   : h=geoidh_emb  (posd); break;
-        case GEOID_EGM96_M150 : h=geoidh_egm96(posd); break;
-        case GEOID_EGM2008_M25: h=geoidh_egm08(posd,model_geoid); break;
-        case GEOID_EGM2008_M10: h=geoidh_egm08(posd,model_geoid); break;
-        case GEOID_GSI2000_M15: h=geoidh_gsi  (posd); break;
+        case GEOID_EGM96_M150 : h=geoidh_egm96(g,posd); break;
+        case GEOID_EGM2008_M25: h=geoidh_egm08(g,posd,model); break;
+        case GEOID_EGM2008_M10: h=geoidh_egm08(g,posd,model); break;
+        case GEOID_GSI2000_M15: h=geoidh_gsi  (g,posd); break;
         default: return 0.0;
     }
     if (fabs(h)>200.0) {
@@ -260,6 +377,40 @@ extern double geoidh(const double *pos)
     }
     return h;
 }
+/* geoid height ----------------------------------------------------------------
+* get geoid height from geoid model
+* args   : double *pos      I   geodetic position {lat,lon} (rad)
+* return : geoid height (m) (0.0:error)
+* notes  : to use external geoid model, call function opengeoid() to open
+*          geoid model before calling the function. If the external geoid model
+*          is not open, the function uses embedded geoid model.
+*-----------------------------------------------------------------------------*/
+extern double geoidh(const double *pos)
+{
+    const rtkctx_t *ctx=getrtkctx();
+    
+    return geoidh_model((const geoid_t *)ctx->geoid,ctx->model_geoid,pos);
+}
+/* geoid heights ---------------------------------------------------------------
+* get geoid heights of multiple positions from geoid model
+* args   : double *pos      I   geodetic positions {lat,lon,h} (rad,m)
+*                               pos[(0:2)+i*3]: position i
+*          int    n         I   number of positions
+*          double *h        O   geoid heights (m) (0.0:error)
+* return : none
+* notes  : same as geoidh() for each position. the geoid model of the library
+*          context is resolved once for all positions
+*-----------------------------------------------------------------------------*/
+extern void geoidh_batch(const double *pos, int n, double *h)
+{
+    const rtkctx_t *ctx=getrtkctx();
+    const geoid_t *g=(const geoid_t *)ctx->geoid;
+    int i,model=ctx->model_geoid;
+    
+    for (i=0;i<n;i++) {
+        h[i]=geoidh_model(g,model,pos+i*3);
+    }
+}
 /*------------------------------------------------------------------------------
 * embedded geoid model
 * notes  : geoid heights are derived from EGM96 (1 x 1 deg grid)
@@ -15,6 +15,9 @@
 *           2013/03/05 1.1 change api readtec()
 *                          fix problem in case of lat>85deg or lat<-85deg
 *           2014/02/22 1.2 fix problem on compiled as C++
+*           2026/10/19 1.3 search tec grid epochs by interval of maps
+*                          sort tec grid data by insertion in combtec()
+*                          add api iontec_batch()
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -22,6 +25,7 @@
 #define VAR_NOTEC   SQR(30.0)   /* variance of no tec */
 #define MIN_EL      0.0         /* min elevation angle (rad) */
 #define MIN_HGT     -1000.0     /* min user height (m) */
+#define MAXLAYER    8           /* max number of layers to share pierce points */
 
 /* get index -----------------------------------------------------------------*/
 static int getindex(double value, const double *range)
@@ -249,14 +253,14 @@ static void combtec(nav_t *nav)
     
     trace(3,"combtec : nav->nt=%d\n",nav->nt);
     
-    for (i=0;i<nav->nt-1;i++) {
-        for (j=i+1;j<nav->nt;j++) {
-            if (timediff(nav->tec[j].time,nav->tec[i].time)<0.0) {
-                tmp=nav->tec[i];
-                nav->tec[i]=nav->tec[j];
-                nav->tec[j]=tmp;
-            }
+    /* stable insertion sort (linear for maps read in time order) */
+    for (i=1;i<nav->nt;i++) {
+        if (timediff(nav->tec[i].time,nav->tec[i-1].time)>=0.0) continue;
+        tmp=nav->tec[i];
+        for (j=i;j>0&&timediff(nav->tec[j-1].time,tmp.time)>0.0;j--) {
+            nav->tec[j]=nav->tec[j-1];
         }
+        nav->tec[j]=tmp;
     }
     for (i=0;i<nav->nt;i++) {
         if (i>0&&timediff(nav->tec[i].time,nav->tec[n-1].time)==0.0) {
@@ -416,6 +420,28 @@ static int iondelay(gtime_t time, const tec_t *tec, const double *pos,
     
     return 1;
 }
+/* search tec grid epoch -----------------------------------------------------*/
+static int tecindex(const nav_t *nav, gtime_t time)
+{
+    double tt,a;
+    int i,j,k;
+    
+    /* estimate index by mean interval of maps */
+    if (nav->nt>=2&&(tt=timediff(nav->tec[nav->nt-1].time,nav->tec[0].time))>0.0) {
+        a=timediff(time,nav->tec[0].time)/tt*(nav->nt-1);
+        if (0.0<=a&&a<nav->nt-1) {
+            i=(int)a+1;
+            if (timediff(nav->tec[i].time,time)>0.0&&
+                timediff(nav->tec[i-1].time,time)<=0.0) return i;
+        }
+    }
+    /* binary search of first map after time */
+    for (i=0,j=nav->nt;i<j;) {
+        k=(i+j)/2;
+        if (timediff(nav->tec[k].time,time)>0.0) j=k; else i=k+1;
+    }
+    return i;
+}
 /* ionosphere model by tec grid data -------------------------------------------
 * compute ionospheric delay by tec grid data
 * args   : gtime_t time     I   time (gpst)
@@ -446,9 +472,8 @@ extern int iontec(gtime_t time, const nav_t *nav, const double *pos,
         *var=VAR_NOTEC;
         return 1;
     }
-    for (i=0;i<nav->nt;i++) {
-        if (timediff(nav->tec[i].time,time)>0.0) break;
-    }
+    i=tecindex(nav,time);
+    
     if (i==0||i>=nav->nt) {
         trace(2,"%s: tec grid out of period\n",time2str(time,tstr,0));
         return 0;
@@ -482,3 +507,126 @@ extern int iontec(gtime_t time, const nav_t *nav, const double *pos,
     trace(3,"iontec  : delay=%5.2f std=%5.2f\n",*delay,sqrt(*var));
     return 1;
 }
+/* ionosphere model by tec grid data for multiple satellites ------------------
+* compute ionospheric delays by tec grid data for satellites of a receiver
+* args   : gtime_t time     I   time (gpst)
+*          nav_t  *nav      I   navigation data
+*          double *pos      I   receiver position {lat,lon,h} (rad,m)
+*          double *azel     I   azimuth/elevation angles {az,el,...} (rad)
+*          int    n         I   number of satellites
+*          int    opt       I   model option (see iontec())
+*          double *delay    O   ionospheric delays (L1) (m) (n x 1)
+*          double *var      O   ionospheric dealy (L1) variances (m^2) (n x 1)
+*          int    *stat     O   status (1:ok,0:error) (n x 1)
+* return : number of satellites with status ok
+* notes  : same as iontec() for each satellite. the tec grid epochs are
+*          searched once and the pierce points are shared by the both maps
+*          bracketing the time if they have same layer heights.
+*-----------------------------------------------------------------------------*/
+extern int iontec_batch(gtime_t time, const nav_t *nav, const double *pos,
+                        const double *azel, int n, int opt, double *delay,
+                        double *var, int *stat)
+{
+    const double fact=40.30E16/FREQL1/FREQL1; /* tecu->L1 iono (m) */
+    const tec_t *tec[2];
+    double tt,a,rot[2],fs,rp,hion,posp[3]={0},vtec,rms,dels[2],vars[2];
+    double fsl[MAXLAYER],hl[MAXLAYER],ppl[MAXLAYER*2];
+    int i,j,k,m,nl,st[2],nok=0;
+    
+    char tstr[40];
+    trace(3,"iontec_batch: time=%s pos=%.1f %.1f n=%d\n",time2str(time,tstr,0),
+          pos[0]*R2D,pos[1]*R2D,n);
+    
+    for (i=0;i<n;i++) {
+        delay[i]=0.0;
+        var[i]=VAR_NOTEC;
+        stat[i]=azel[1+i*2]<MIN_EL||pos[2]<MIN_HGT;
+        nok+=stat[i];
+    }
+    if (nok>=n) return nok;
+    
+    k=tecindex(nav,time);
+    
+    if (k==0||k>=nav->nt) {
+        trace(2,"%s: tec grid out of period\n",time2str(time,tstr,0));
+        return nok;
+    }
+    if ((tt=timediff(nav->tec[k].time,nav->tec[k-1].time))==0.0) {
+        trace(2,"tec grid time interval error\n");
+        return nok;
+    }
+    tec[0]=nav->tec+k-1;
+    tec[1]=nav->tec+k;
+    for (m=0;m<2;m++) {
+        rot[m]=2.0*PI*timediff(time,tec[m]->time)/86400.0;
+    }
+    a=timediff(time,tec[0]->time)/tt;
+    
+    for (i=0;i<n;i++) {
+        if (stat[i]) continue;
+        
+        for (m=nl=0;m<2;m++) {
+            dels[m]=vars[m]=0.0;
+            st[m]=1;
+            
+            for (j=0;j<tec[m]->ndata[2];j++) { /* for a layer */
+                
+                hion=tec[m]->hgts[0]+tec[m]->hgts[2]*j;
+                
+                if (m==1&&j<nl&&hl[j]==hion&&tec[1]->rb==tec[0]->rb) {
+                    
+                    /* pierce point shared with previous map */
+                    fs=fsl[j];
+                    posp[0]=ppl[j*2]; posp[1]=ppl[1+j*2];
+                }
+                else {
+                    /* ionospheric pierce point position */
+                    fs=ionppp(pos,azel+i*2,tec[m]->rb,hion,posp);
+                    
+                    if (opt&2) {
+                        /* modified single layer mapping function (M-SLM) */
+                        rp=tec[m]->rb/(tec[m]->rb+hion)*
+                           sin(0.9782*(PI/2.0-azel[1+i*2]));
+                        fs=1.0/sqrt(1.0-rp*rp);
+                    }
+                    if (m==0&&j<MAXLAYER) {
+                        fsl[j]=fs; hl[j]=hion;
+                        ppl[j*2]=posp[0]; ppl[1+j*2]=posp[1];
+                        nl=j+1;
+                    }
+                }
+                /* earth rotation correction (sun-fixed coordinate) */
+                if (opt&1) posp[1]+=rot[m];
+                
+                /* interpolate tec grid data */
+                if (!interptec(tec[m],j,posp,&vtec,&rms)) {
+                    st[m]=0;
+                    break;
+                }
+                dels[m]+=fact*fs*vtec;
+                vars[m]+=fact*fact*fs*fs*rms*rms;
+            }
+        }
+        if (!st[0]&&!st[1]) {
+            trace(2,"%s: tec grid out of area pos=%6.2f %7.2f azel=%6.1f %5.1f\n",
+                  time2str(time,tstr,0),pos[0]*R2D,pos[1]*R2D,azel[i*2]*R2D,
+                  azel[1+i*2]*R2D);
+            continue;
+        }
+        if (st[0]&&st[1]) { /* linear interpolation by time */
+            delay[i]=dels[0]*(1.0-a)+dels[1]*a;
+            var[i]  =vars[0]*(1.0-a)+vars[1]*a;
+        }
+        else if (st[0]) { /* nearest-neighbour extrapolation by time */
+            delay[i]=dels[0];
+            var[i]  =vars[0];
+        }
+        else {
+            delay[i]=dels[1];
+            var[i]  =vars[1];
+        }
+        stat[i]=1;
+        nok++;
+    }
+    return nok;
+}
@@ -13,6 +13,8 @@
 * version : $Revision: 1.1 $ $Date: 2008/07/17 21:48:06 $
 * history : 2007/01/13 1.0 new
 *           2015/05/31 1.1 add api lambda_reduction(), lambda_search()
+*           2026/10/19 1.2 add api lambda_ws()
+*                          allocate scratch matrices in workspace
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -24,11 +26,18 @@
 #define ROUND(x)    (floor((x)+0.5))
 #define SWAP(x,y)   do {double tmp_; tmp_=x; x=y; y=tmp_;} while (0)
 
+/* size of workspace (doubles) -----------------------------------------------*/
+static size_t wssize(int n, int m)
+{
+    return (size_t)n*(6*n+m+8);
+}
+
 /* LD factorization (Q=L'*diag(D)*L) -----------------------------------------*/
-static int LD(int n, const double *Q, double *L, double *D)
+static int LD(int n, const double *Q, double *L, double *D, wspace_t *ws)
 {
+    size_t mark=wsmark(ws);
     int i,j,k,info=0;
-    double a,*A=mat(n,n);
+    double a,*A=wsmat(ws,n,n);
     
     memcpy(A,Q,sizeof(double)*n*n);
     for (i=n-1;i>=0;i--) {
@@ -38,7 +47,7 @@ static int LD(int n, const double *Q, double *L, double *D)
         for (j=0;j<=i-1;j++) for (k=0;k<=j;k++) A[j+k*n]-=L[i+k*n]*L[i+j*n];
         for (j=0;j<=i;j++) L[i+j*n]/=L[i+i*n];
     }
-    free(A);
+    wsrelease(ws,mark);
     if (info) fprintf(stderr,"%s : LD factorization error\n",__FILE__);
     return info;
 }
@@ -95,11 +104,13 @@ static void reduction(int n, double *L, double *D, double *Z)
            zn     O  fixed solutions
            s      O  sum of residuals for fixed solutions                    */
 static int search(int n, int m, const double *L, const double *D,
-                  const double *zs, double *zn, double *s)
+                  const double *zs, double *zn, double *s, wspace_t *ws)
 {
+    size_t mark=wsmark(ws);
     int i,j,k,c,nn=0,imax=0;
     double newdist,maxdist=1E99,y;
-    double *S=zeros(n,n),*dist=mat(n,1),*zb=mat(n,1),*z=mat(n,1),*step=mat(n,1);
+    double *S=wszeros(ws,n,n),*dist=wsmat(ws,n,1),*zb=wsmat(ws,n,1);
+    double *z=wsmat(ws,n,1),*step=wsmat(ws,n,1);
     
     k=n-1; dist[k]=0.0;
     zb[k]=zs[k];
@@ -157,7 +168,7 @@ static int search(int n, int m, const double *L, const double *D,
             for (k=0;k<n;k++) SWAP(zn[k+i*n],zn[k+j*n]);
         }
     }
-    free(S); free(dist); free(zb); free(z); free(step);
+    wsrelease(ws,mark);
     
     if (c>=LOOPMAX) {
         fprintf(stderr,"%s : search loop count overflow\n",__FILE__);
@@ -180,14 +191,36 @@ static int search(int n, int m, const double *L, const double *D,
 extern int lambda(int n, int m, const double *a, const double *Q, double *F,
                   double *s)
 {
+    wspace_t ws;
     int info;
+    
+    if (n<=0||m<=0) return -1;
+    if (!wsinit(&ws,wssize(n,m))) return -1;
+    info=lambda_ws(n,m,a,Q,F,s,&ws);
+    wsfree(&ws);
+    return info;
+}
+/* lambda/mlambda integer least-square estimation in workspace -----------------
+* integer least-square estimation with scratch matrices in workspace
+* args   : int    n,m,*a,*Q,*F,*s  same as lambda()
+*          wspace_t *ws  IO workspace
+* return : status (0:ok,other:error)
+*-----------------------------------------------------------------------------*/
+extern int lambda_ws(int n, int m, const double *a, const double *Q, double *F,
+                     double *s, wspace_t *ws)
+{
+    size_t mark;
+    int i,info;
     double *L,*D,*Z,*z,*E;
     
     if (n<=0||m<=0) return -1;
-    L=zeros(n,n); D=mat(n,1); Z=eye(n); z=mat(n,1); E=mat(n,m);
+    mark=wsmark(ws);
+    L=wszeros(ws,n,n); D=wsmat(ws,n,1); Z=wszeros(ws,n,n); z=wsmat(ws,n,1);
+    E=wsmat(ws,n,m);
+    for (i=0;i<n;i++) Z[i+i*n]=1.0;
     
     /* LD (lower diagonal) factorization (Q=L'*diag(D)*L) */
-    if (!(info=LD(n,Q,L,D))) {
+    if (!(info=LD(n,Q,L,D,ws))) {
         
         /* lambda reduction (z=Z'*a, Qz=Z'*Q*Z=L'*diag(D)*L) */
         reduction(n,L,D,Z);
@@ -196,12 +229,12 @@ extern int lambda(int n, int m, const double *a, const double *Q, double *F,
         /* mlambda search 
             z = transformed double-diff phase biases
             L,D = transformed covariance matrix */
-        if (!(info=search(n,m,L,D,z,E,s))) {  /* returns 0 if no error */
+        if (!(info=search(n,m,L,D,z,E,s,ws))) {  /* returns 0 if no error */
             
-            info=solve("T",Z,E,n,m,F); /* F=Z'\E */
+            info=solve_ws("T",Z,E,n,m,F,ws); /* F=Z'\E */
         }
     }
-    free(L); free(D); free(Z); free(z); free(E);
+    wsrelease(ws,mark);
     return info;
 }
 /* lambda reduction ------------------------------------------------------------
@@ -213,25 +246,27 @@ extern int lambda(int n, int m, const double *a, const double *Q, double *F,
 *-----------------------------------------------------------------------------*/
 extern int lambda_reduction(int n, const double *Q, double *Z)
 {
+    wspace_t ws;
     double *L,*D;
     int i,j,info;
     
     if (n<=0) return -1;
+    if (!wsinit(&ws,wssize(n,0))) return -1;
     
-    L=zeros(n,n); D=mat(n,1);
+    L=wszeros(&ws,n,n); D=wsmat(&ws,n,1);
     
     for (i=0;i<n;i++) for (j=0;j<n;j++) {
         Z[i+j*n]=i==j?1.0:0.0;
     }
     /* LD factorization */
-    if ((info=LD(n,Q,L,D))) {
-        free(L); free(D);
+    if ((info=LD(n,Q,L,D,&ws))) {
+        wsfree(&ws);
         return info;
     }
     /* lambda reduction */
     reduction(n,L,D,Z);
      
-    free(L); free(D);
+    wsfree(&ws);
     return 0;
 }
 /* mlambda search --------------------------------------------------------------
@@ -247,21 +282,23 @@ extern int lambda_reduction(int n, const double *Q, double *Z)
 extern int lambda_search(int n, int m, const double *a, const double *Q,
                          double *F, double *s)
 {
+    wspace_t ws;
     double *L,*D;
     int info;
     
     if (n<=0||m<=0) return -1;
+    if (!wsinit(&ws,wssize(n,m))) return -1;
     
-    L=zeros(n,n); D=mat(n,1);
+    L=wszeros(&ws,n,n); D=wsmat(&ws,n,1);
     
     /* LD factorization */
-    if ((info=LD(n,Q,L,D))) {
-        free(L); free(D);
+    if ((info=LD(n,Q,L,D,&ws))) {
+        wsfree(&ws);
         return info;
     }
     /* mlambda search */
-    info=search(n,m,L,D,a,F,s);
+    info=search(n,m,L,D,a,F,s,&ws);
     
-    free(L); free(D);
+    wsfree(&ws);
     return info;
 }
@@ -0,0 +1,199 @@
+/*------------------------------------------------------------------------------
+* metrics.c : processing stage metrics functions
+*
+* the processing stages (decode, satellite positions, residuals, filter,
+* ambiguity resolution, output, ...) are measured as spans by a monotonic
+* clock. the durations of the spans are accumulated to log2 histograms of
+* microseconds per stage, from which the percentiles are estimated.
+*
+* the metrics are disabled by default. metbegin() returns 0 and metend()
+* does nothing until the metrics are enabled by metenable(), so that the
+* instrumented functions cost only a flag check if the metrics are not used.
+*
+* options : -DWIN32    use WIN32 API
+*
+* version : $Revision:$ $Date:$
+* history : 2026/10/19 1.0 new
+*-----------------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199506
+#include "rtklib.h"
+
+/* names of metrics spans ----------------------------------------------------*/
+static const char *metname[MAXMETSPAN]={
+    "decode","satpos","residual","filter","ar","output","rtkpos"
+};
+static metspan_t metspan[MAXMETSPAN]; /* metrics span histograms */
+static int metena=0;                  /* metrics enabled flag */
+static int metinit=0;                 /* metrics lock initialized flag */
+static rtklib_lock_t metlock;         /* lock of metrics */
+
+/* monotonic clock -------------------------------------------------------------
+* get monotonic clock
+* args   : none
+* return : monotonic clock (ns)
+*-----------------------------------------------------------------------------*/
+extern uint64_t metclock(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER f,c;
+    
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (uint64_t)((double)c.QuadPart/f.QuadPart*1E9);
+#else
+    struct timespec tp={0};
+    
+    clock_gettime(CLOCK_MONOTONIC,&tp);
+    return (uint64_t)tp.tv_sec*1000000000u+(uint64_t)tp.tv_nsec;
+#endif
+}
+/* enable/disable metrics ------------------------------------------------------
+* enable or disable metrics
+* args   : int    ena       I   enable flag (0:disable,1:enable)
+* return : none
+* notes  : call it before any instrumented thread is started. the histograms
+*          are kept when the metrics are disabled.
+*-----------------------------------------------------------------------------*/
+extern void metenable(int ena)
+{
+    if (!metinit) {
+        rtklib_initlock(&metlock);
+        metinit=1;
+    }
+    metena=ena;
+}
+/* begin span ------------------------------------------------------------------
+* begin span of processing stage
+* args   : none
+* return : start time of span (ns) (0: metrics disabled)
+*-----------------------------------------------------------------------------*/
+extern uint64_t metbegin(void)
+{
+    return metena?metclock():0;
+}
+/* end span --------------------------------------------------------------------
+* end span of processing stage and add duration to histogram of stage
+* args   : int    span      I   metrics span (MET_???)
+*          uint64_t t0      I   start time of span by metbegin()
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void metend(int span, uint64_t t0)
+{
+    metspan_t *s;
+    double t;
+    int k;
+    
+    if (!metena||!t0||span<0||span>=MAXMETSPAN) return;
+    
+    t=(metclock()-t0)*1E-3;
+    for (k=0;k<MET_NBIN-1&&t>=(double)(1u<<k);k++) ;
+    
+    rtklib_lock(&metlock);
+    s=metspan+span;
+    s->n++;
+    s->sum+=t;
+    if (t>s->max) s->max=t;
+    s->bin[k]++;
+    rtklib_unlock(&metlock);
+}
+/* get span histogram ----------------------------------------------------------
+* get copy of histogram of processing stage
+* args   : int    span      I   metrics span (MET_???)
+*          metspan_t *s     O   span histogram
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+extern int metget(int span, metspan_t *s)
+{
+    if (span<0||span>=MAXMETSPAN) return 0;
+    
+    if (metinit) rtklib_lock(&metlock);
+    *s=metspan[span];
+    if (metinit) rtklib_unlock(&metlock);
+    return 1;
+}
+/* reset histograms ------------------------------------------------------------
+* reset histograms of all processing stages
+* args   : none
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void metreset(void)
+{
+    if (metinit) rtklib_lock(&metlock);
+    memset(metspan,0,sizeof(metspan));
+    if (metinit) rtklib_unlock(&metlock);
+}
+/* percentile of span ----------------------------------------------------------
+* estimate percentile of span duration from histogram
+* args   : metspan_t *s     I   span histogram
+*          double p         I   percentile (0-1)
+* return : percentile of duration (us) (0: no data)
+* notes  : the value is linearly interpolated in the bin {2^(k-1),2^k} (us)
+*          and limited to the max duration
+*-----------------------------------------------------------------------------*/
+extern double metpct(const metspan_t *s, double p)
+{
+    double c=0.0,r,lo,hi,t;
+    int k;
+    
+    if (s->n<=0) return 0.0;
+    r=p*s->n;
+    
+    for (k=0;k<MET_NBIN;k++) {
+        if (s->bin[k]<=0||c+s->bin[k]<r) {
+            c+=s->bin[k];
+            continue;
+        }
+        lo=k>0?(double)(1u<<(k-1)):0.0;
+        hi=(double)(1u<<k);
+        t=lo+(hi-lo)*(r-c)/s->bin[k];
+        return t<s->max?t:s->max;
+    }
+    return s->max;
+}
+/* name of span ----------------------------------------------------------------
+* get name of processing stage
+* args   : int    span      I   metrics span (MET_???)
+* return : name of span ("": invalid span)
+*-----------------------------------------------------------------------------*/
+extern const char *metspanname(int span)
+{
+    return span>=0&&span<MAXMETSPAN?metname[span]:"";
+}
+/* output metrics --------------------------------------------------------------
+* output span histograms of processing stages in prometheus text format
+* args   : char   *buff     O   output buffer
+*          const char *prefix I metric name prefix (eg. "rtkrcv")
+* return : number of output bytes
+* notes  : buffer size should be 4096 bytes or more. the durations are output
+*          in seconds as summaries {prefix}_stage_seconds and gauges
+*          {prefix}_stage_seconds_max with label stage.
+*-----------------------------------------------------------------------------*/
+extern int metout(char *buff, const char *prefix)
+{
+    metspan_t s;
+    char *p=buff;
+    int i;
+    
+    p+=sprintf(p,"# HELP %s_stage_seconds processing stage duration\n",prefix);
+    p+=sprintf(p,"# TYPE %s_stage_seconds summary\n",prefix);
+    for (i=0;i<MAXMETSPAN;i++) {
+        metget(i,&s);
+        p+=sprintf(p,"%s_stage_seconds{stage=\"%s\",quantile=\"0.5\"} %.6f\n",
+                   prefix,metname[i],metpct(&s,0.5)*1E-6);
+        p+=sprintf(p,"%s_stage_seconds{stage=\"%s\",quantile=\"0.99\"} %.6f\n",
+                   prefix,metname[i],metpct(&s,0.99)*1E-6);
+        p+=sprintf(p,"%s_stage_seconds_sum{stage=\"%s\"} %.6f\n",prefix,
+                   metname[i],s.sum*1E-6);
+        p+=sprintf(p,"%s_stage_seconds_count{stage=\"%s\"} %u\n",prefix,
+                   metname[i],s.n);
+    }
+    p+=sprintf(p,"# HELP %s_stage_seconds_max max processing stage duration\n",
+               prefix);
+    p+=sprintf(p,"# TYPE %s_stage_seconds_max gauge\n",prefix);
+    for (i=0;i<MAXMETSPAN;i++) {
+        metget(i,&s);
+        p+=sprintf(p,"%s_stage_seconds_max{stage=\"%s\"} %.6f\n",prefix,
+                   metname[i],s.max*1E-6);
+    }
+    return (int)(p-buff);
+}
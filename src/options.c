@@ -27,6 +27,8 @@
 *           2020/11/30  1.12 change options pos1-frequency, pos1-ionoopt,
 *                             pos1-tropopt, pos1-sateph, pos1-navsys,
 *                             pos2-gloarmode,
+*           2026/10/19  1.13 add misc-streamobs,misc-pephcheb,misc-tideint
+*                           add pos2-budget
 *-----------------------------------------------------------------------------*/
 #define _POSIX_C_SOURCE 199506
 #include "rtklib.h"
@@ -117,6 +119,7 @@ EXPORT opt_t sysopts[]={
     {"pos2-rejionno",   1,  (void *)&prcopt_.maxinno[0], "m"    },
     {"pos2-rejcode",    1,  (void *)&prcopt_.maxinno[1], "m"    },
     {"pos2-niter",      0,  (void *)&prcopt_.niter,      ""     },
+    {"pos2-budget",     0,  (void *)&prcopt_.budget,     "ms"   },
     {"pos2-baselen",    1,  (void *)&prcopt_.baseline[0],"m"    },
     {"pos2-basesig",    1,  (void *)&prcopt_.baseline[1],"m"    },
     
@@ -183,6 +186,9 @@ EXPORT opt_t sysopts[]={
     {"misc-rnxopt1",    2,  (void *)prcopt_.rnxopt[0],   ""     },
     {"misc-rnxopt2",    2,  (void *)prcopt_.rnxopt[1],   ""     },
     {"misc-pppopt",     2,  (void *)prcopt_.pppopt,      ""     },
+    {"misc-streamobs",  3,  (void *)&prcopt_.streamobs,  SWTOPT },
+    {"misc-pephcheb",   3,  (void *)&prcopt_.pephcheb,   SWTOPT },
+    {"misc-tideint",    1,  (void *)&prcopt_.tideint,    "s"    },
     
     {"file-satantfile", 2,  (void *)&filopt_.satantp,    ""     },
     {"file-rcvantfile", 2,  (void *)&filopt_.rcvantp,    ""     },
@@ -196,6 +202,7 @@ EXPORT opt_t sysopts[]={
     {"file-geexefile",  2,  (void *)&filopt_.geexe,      ""     },
     {"file-solstatfile",2,  (void *)&filopt_.solstat,    ""     },
     {"file-tracefile",  2,  (void *)&filopt_.trace,      ""     },
+    {"file-cachedir",   2,  (void *)&filopt_.cache,      ""     },
     
     {"",0,NULL,""} /* terminator */
 };
@@ -529,6 +536,7 @@ extern void resetsysopts(void)
     filopt_.blq    [0]='\0';
     filopt_.solstat[0]='\0';
     filopt_.trace  [0]='\0';
+    filopt_.cache  [0]='\0';
     elmask_=15.0;
     elmaskar_=0.0;
     elmaskhold_=0.0;
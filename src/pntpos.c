@@ -23,6 +23,12 @@
 *                           use E1-E5b for Galileo dual-freq iono-correction
 *                           use API sat2freq() to get carrier frequency
 *                           add output of velocity estimation error in estvel()
+*           2026/10/19 1.8  compute saastamoinen site terms once per iteration
+*                            in rescode()
+*                           compute ionex tec model for all satellites by
+*                            iontec_batch() in rescode()
+*                           add metrics span of satellite positions
+*                           add api pntpos_ws()
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -288,8 +294,12 @@ static int rescode(int iter, const obsd_t *obs, int n, const double *rs,
                    double *azel, int *vsat, double *resp, int *ns)
 {
     gtime_t time;
-    double r,freq,dion=0.0,dtrp=0.0,vmeas,vion=0.0,vtrp=0.0,rr[3],pos[3],dtr,e[3],P;
-    int i,j,nv=0,sat,sys,mask[NX-3]={0};
+    tropsite_t site={{0}};
+    double r,freq,dion=0.0,dtrp=0.0,vmeas,vion=0.0,vtrp=0.0,rr[3],pos[3],dtr,*e,P;
+    double rg[MAXOBS],es[MAXOBS*3],azs[MAXOBS*2],trp[MAXOBS];
+    double ion[MAXOBS],vions[MAXOBS];
+    int i,j,nv=0,sat,sys,mask[NX-3]={0},nt=n<MAXOBS?n:MAXOBS,saas,tec;
+    int tecs[MAXOBS];
 
     for (i=0;i<3;i++) rr[i]=x[i];
     dtr=x[3];
@@ -297,6 +307,23 @@ static int rescode(int iter, const obsd_t *obs, int n, const double *rs,
     ecef2pos(rr,pos);
     trace(3,"rescode: rr=%.3f %.3f %.3f\n",rr[0], rr[1], rr[2]);
     
+    /* geometric distances and azimuth/elevation angles of all satellites */
+    for (i=0;i<nt;i++) {
+        azs[i*2]=azs[1+i*2]=0.0;
+        if ((rg[i]=geodist(rs+i*6,rr,es+i*3))<=0.0) continue;
+        satazel(pos,es+i*3,azs+i*2);
+    }
+    /* saastamoinen tropospheric delays of all satellites */
+    saas=iter>0&&(opt->tropopt==TROPOPT_SAAS||opt->tropopt==TROPOPT_EST||
+                  opt->tropopt==TROPOPT_ESTG);
+    if (saas) {
+        settropsite(obs[0].time,pos,REL_HUMI,&site);
+        tropmodel_batch(&site,azs,nt,trp);
+    }
+    /* ionex tec model of all satellites */
+    if ((tec=iter>0&&opt->ionoopt==IONOOPT_TEC)) {
+        iontec_batch(obs[0].time,nav,pos,azs,nt,1,ion,vions,tecs);
+    }
     for (i=*ns=0;i<n&&i<MAXOBS;i++) {
         vsat[i]=0; azel[i*2]=azel[1+i*2]=resp[i]=0.0;
         time=obs[i].time;
@@ -314,15 +341,22 @@ static int rescode(int iter, const obsd_t *obs, int n, const double *rs,
         if (satexclude(sat,vare[i],svh[i],opt)) continue;
         
         /* geometric distance and elevation mask*/
-        if ((r=geodist(rs+i*6,rr,e))<=0.0) continue;
-        if (satazel(pos,e,azel+i*2)<opt->elmin) continue;
+        if ((r=rg[i])<=0.0) continue;
+        e=es+i*3;
+        azel[i*2]=azs[i*2]; azel[1+i*2]=azs[1+i*2];
+        if (azel[1+i*2]<opt->elmin) continue;
         
         if (iter>0) {
             /* test SNR mask */
             if (!snrmask(obs+i,azel+i*2,opt)) continue;
         
             /* ionospheric correction */
-            if (!ionocorr(time,nav,sat,pos,azel+i*2,opt->ionoopt,&dion,&vion)) {
+            if (tec&&tecs[i]) {
+                dion=ion[i];
+                vion=vions[i];
+            }
+            else if (!ionocorr(time,nav,sat,pos,azel+i*2,opt->ionoopt,&dion,
+                               &vion)) {
                 continue;
             }
             if ((freq=sat2freq(sat,obs[i].code[0],nav))==0.0) continue;
@@ -331,7 +365,12 @@ static int rescode(int iter, const obsd_t *obs, int n, const double *rs,
             vion*=SQR(SQR(FREQL1/freq));
         
             /* tropospheric correction */
-            if (!tropcorr(time,nav,pos,azel+i*2,opt->tropopt,&dtrp,&vtrp)) {
+            if (saas) {
+                dtrp=trp[i];
+                vtrp=SQR(ERR_SAAS/(sin(azel[1+i*2])+0.1));
+            }
+            else if (!tropcorr(time,nav,pos,azel+i*2,opt->tropopt,&dtrp,
+                               &vtrp)) {
                 continue;
             }
         }
@@ -408,17 +447,18 @@ static int valsol(const double *azel, const int *vsat, int n,
     return 1;
 }
 /* estimate receiver position ------------------------------------------------*/
-static int estpos(const obsd_t *obs, int n, const double *rs, const double *dts,
-                  const double *vare, const int *svh, const nav_t *nav,
-                  const prcopt_t *opt, const ssat_t *ssat, sol_t *sol, double *azel,
-                  int *vsat, double *resp, char *msg)
+static int estpos(wspace_t *ws, const obsd_t *obs, int n, const double *rs,
+                  const double *dts, const double *vare, const int *svh,
+                  const nav_t *nav, const prcopt_t *opt, const ssat_t *ssat,
+                  sol_t *sol, double *azel, int *vsat, double *resp, char *msg)
 {
+    size_t mark=wsmark(ws);
     double x[NX]={0},dx[NX],Q[NX*NX],*v,*H,*var,sig;
     int i,j,k,info,stat,nv,ns;
     
     trace(3,"estpos  : n=%d\n",n);
     
-    v=mat(n+NX-3,1); H=mat(NX,n+NX-3); var=mat(n+NX-3,1);
+    v=wsmat(ws,n+NX-3,1); H=wsmat(ws,NX,n+NX-3); var=wsmat(ws,n+NX-3,1);
     
     for (i=0;i<3;i++) x[i]=sol->rr[i];
 
@@ -439,7 +479,7 @@ static int estpos(const obsd_t *obs, int n, const double *rs, const double *dts,
             for (k=0;k<NX;k++) H[k+j*NX]/=sig;
         }
         /* least square estimation */
-        if ((info=lsq(H,v,NX,nv,dx,Q))) {
+        if ((info=lsq_ws(H,v,NX,nv,dx,Q,ws))) {
             sprintf(msg,"lsq error info=%d",info);
             break;
         }
@@ -469,21 +509,22 @@ static int estpos(const obsd_t *obs, int n, const double *rs, const double *dts,
             if ((stat=valsol(azel,vsat,n,opt,v,nv,NX,msg))) {
                 sol->stat=opt->sateph==EPHOPT_SBAS?SOLQ_SBAS:SOLQ_SINGLE;
             }
-            free(v); free(H); free(var);
+            wsrelease(ws,mark);
             return stat;
         }
     }
     if (i>=MAXITR) sprintf(msg,"iteration divergent i=%d",i);
     
-    free(v); free(H); free(var);
+    wsrelease(ws,mark);
     return 0;
 }
 /* RAIM FDE (failure detection and exclusion) -------------------------------*/
-static int raim_fde(const obsd_t *obs, int n, const double *rs,
+static int raim_fde(wspace_t *ws, const obsd_t *obs, int n, const double *rs,
                     const double *dts, const double *vare, const int *svh,
                     const nav_t *nav, const prcopt_t *opt, const ssat_t *ssat, 
                     sol_t *sol, double *azel, int *vsat, double *resp, char *msg)
 {
+    size_t mark;
     obsd_t *obs_e;
     sol_t sol_e={{0}};
     char tstr[40],name[8],msg_e[128];
@@ -493,8 +534,10 @@ static int raim_fde(const obsd_t *obs, int n, const double *rs,
     trace(3,"raim_fde: %s n=%2d\n",time2str(obs[0].time,tstr,0),n);
     
     if (!(obs_e=(obsd_t *)malloc(sizeof(obsd_t)*n))) return 0;
-    rs_e = mat(6,n); dts_e = mat(2,n); vare_e=mat(1,n); azel_e=zeros(2,n);
-    svh_e=imat(1,n); vsat_e=imat(1,n); resp_e=mat(1,n); 
+    mark=wsmark(ws);
+    rs_e=wsmat(ws,6,n); dts_e=wsmat(ws,2,n); vare_e=wsmat(ws,1,n);
+    azel_e=wszeros(ws,2,n); svh_e=wsimat(ws,1,n); vsat_e=wsimat(ws,1,n);
+    resp_e=wsmat(ws,1,n);
     
     for (i=0;i<n;i++) {
         
@@ -508,8 +551,8 @@ static int raim_fde(const obsd_t *obs, int n, const double *rs,
             svh_e[k++]=svh[j];
         }
         /* estimate receiver position without a satellite */
-        if (!estpos(obs_e,n-1,rs_e,dts_e,vare_e,svh_e,nav,opt,ssat,&sol_e,azel_e,
-                    vsat_e,resp_e,msg_e)) {
+        if (!estpos(ws,obs_e,n-1,rs_e,dts_e,vare_e,svh_e,nav,opt,ssat,&sol_e,
+                    azel_e,vsat_e,resp_e,msg_e)) {
             trace(3,"raim_fde: exsat=%2d (%s)\n",obs[i].sat,msg);
             continue;
         }
@@ -551,8 +594,7 @@ static int raim_fde(const obsd_t *obs, int n, const double *rs,
     }
 #endif
     free(obs_e);
-    free(rs_e ); free(dts_e ); free(vare_e); free(azel_e);
-    free(svh_e); free(vsat_e); free(resp_e);
+    wsrelease(ws,mark);
     return stat;
 }
 /* range rate residuals ------------------------------------------------------*/
@@ -605,15 +647,16 @@ static int resdop(const obsd_t *obs, int n, const double *rs, const double *dts,
     return nv;
 }
 /* estimate receiver velocity ------------------------------------------------*/
-static void estvel(const obsd_t *obs, int n, const double *rs, const double *dts,
-                   const nav_t *nav, const prcopt_t *opt, sol_t *sol,
-                   const double *azel, const int *vsat)
+static void estvel(wspace_t *ws, const obsd_t *obs, int n, const double *rs,
+                   const double *dts, const nav_t *nav, const prcopt_t *opt,
+                   sol_t *sol, const double *azel, const int *vsat)
 {
+    size_t mark=wsmark(ws);
     double x[4]={0},dx[4],Q[16],*v,*H;
     double err=opt->err[4]; /* Doppler error (Hz) */
     int i,j,nv;
     
-    v=mat(n,1); H=mat(4,n);
+    v=wsmat(ws,n,1); H=wsmat(ws,4,n);
     
     for (i=0;i<MAXITR;i++) {
         
@@ -622,7 +665,7 @@ static void estvel(const obsd_t *obs, int n, const double *rs, const double *dts
             break;
         }
         /* least square estimation */
-        if (lsq(H,v,4,nv,dx,Q)) break;
+        if (lsq_ws(H,v,4,nv,dx,Q,ws)) break;
         
         for (j=0;j<4;j++) x[j]+=dx[j];
         
@@ -638,7 +681,7 @@ static void estvel(const obsd_t *obs, int n, const double *rs, const double *dts
             break;
         }
     }
-    free(v); free(H);
+    wsrelease(ws,mark);
 }
 /* single-point positioning ----------------------------------------------------
 * compute receiver position, velocity, clock bias by single-point positioning
@@ -656,9 +699,34 @@ static void estvel(const obsd_t *obs, int n, const double *rs, const double *dts
 extern int pntpos(const obsd_t *obs, int n, const nav_t *nav,
                   const prcopt_t *opt, sol_t *sol, double *azel, ssat_t *ssat,
                   char *msg)
+{
+    wspace_t ws;
+    int stat;
+    
+    if (!wsinit(&ws,(size_t)(n>0?n:0)*(NX+20)+NX*(NX+4))) {
+        strcpy(msg,"workspace allocation error");
+        sol->stat=SOLQ_NONE;
+        return 0;
+    }
+    stat=pntpos_ws(obs,n,nav,opt,sol,azel,ssat,msg,&ws);
+    wsfree(&ws);
+    return stat;
+}
+/* single-point positioning in workspace ---------------------------------------
+* compute receiver position, velocity, clock bias by single-point positioning
+* with scratch matrices in workspace
+* args   : obsd_t *obs,n,*nav,*opt,*sol,*azel,*ssat,*msg  same as pntpos()
+*          wspace_t *ws     IO  workspace
+* return : status(1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+extern int pntpos_ws(const obsd_t *obs, int n, const nav_t *nav,
+                     const prcopt_t *opt, sol_t *sol, double *azel,
+                     ssat_t *ssat, char *msg, wspace_t *ws)
 {
     prcopt_t opt_=*opt;
+    size_t mark;
     double *rs,*dts,*var,*azel_,*resp;
+    uint64_t t0;
     int i,stat,vsat[MAXOBS]={0},svh[MAXOBS];
     
     char tstr[40];
@@ -674,7 +742,9 @@ extern int pntpos(const obsd_t *obs, int n, const nav_t *nav,
     msg[0]='\0';
     sol->eventime = obs[0].eventime;
     
-    rs=mat(6,n); dts=mat(2,n); var=mat(1,n); azel_=zeros(2,n); resp=mat(1,n);
+    mark=wsmark(ws);
+    rs=wsmat(ws,6,n); dts=wsmat(ws,2,n); var=wsmat(ws,1,n);
+    azel_=wszeros(ws,2,n); resp=wsmat(ws,1,n);
     
     if (ssat) {
         for (i=0;i<MAXSAT;i++) {
@@ -690,18 +760,21 @@ extern int pntpos(const obsd_t *obs, int n, const nav_t *nav,
         opt_.tropopt=TROPOPT_SAAS;
     }
     /* satellite positions, velocities and clocks */
-    satposs(sol->time,obs,n,nav,opt_.sateph,rs,dts,var,svh);
+    t0=metbegin();
+    satposs(sol->time,obs,n,nav,opt_.sateph,NULL,rs,dts,var,svh);
+    metend(MET_SATPOS,t0);
     
     /* estimate receiver position and time with pseudorange */
-    stat=estpos(obs,n,rs,dts,var,svh,nav,&opt_,ssat,sol,azel_,vsat,resp,msg);
+    stat=estpos(ws,obs,n,rs,dts,var,svh,nav,&opt_,ssat,sol,azel_,vsat,resp,msg);
     
     /* RAIM FDE */
     if (!stat&&n>=6&&opt->posopt[4]) {
-        stat=raim_fde(obs,n,rs,dts,var,svh,nav,&opt_,ssat,sol,azel_,vsat,resp,msg);
+        stat=raim_fde(ws,obs,n,rs,dts,var,svh,nav,&opt_,ssat,sol,azel_,vsat,
+                      resp,msg);
     }
     /* estimate receiver velocity with Doppler */
     if (stat) {
-        estvel(obs,n,rs,dts,nav,&opt_,sol,azel_,vsat);
+        estvel(ws,obs,n,rs,dts,nav,&opt_,sol,azel_,vsat);
     }
     if (azel) {
         for (i=0;i<n*2;i++) azel[i]=azel_[i];
@@ -720,6 +793,6 @@ extern int pntpos(const obsd_t *obs, int n, const nav_t *nav,
             ssat[obs[i].sat-1].resp[0]=resp[i];
         }
     }
-    free(rs); free(dts); free(var); free(azel_); free(resp);
+    wsrelease(ws,mark);
     return stat;
 }
@@ -43,6 +43,13 @@
 *                            fix bug on select best solution in static mode
 *                            delete function to use L2 instead of L5 PCV
 *                            writing solution file in binary mode
+*           2026/10/19  1.25 support binary cache of input data
+*                            support streaming of obs data in forward mode
+*                            seek sbas corrections by snapshots of correction
+*                            state in backward mode
+*                            seek sbas corrections incrementally by fine
+*                            snapshots in backward mode
+*                            share tide cache by all passes of session
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -52,6 +59,8 @@
 #define MAXPRCDAYS  100          /* max days of continuous processing */
 #define MAXINFILE   1000         /* max number of input files */
 #define MAXINVALIDTM 100         /* max number of invalid time marks */
+#define SBSSNAPINT  300.0        /* time interval of sbas snapshots (s) */
+#define SBSSNAPSUB  10.0         /* time interval of fine sbas snapshots (s) */
 
 /* constants/global variables ------------------------------------------------*/
 
@@ -65,7 +74,7 @@ static int nepoch=0;            /* number of observation epochs */
 static int nitm  =0;            /* number of invalid time marks */
 static int iobsu =0;            /* current rover observation data index */
 static int iobsr =0;            /* current reference observation data index */
-static int isbs  =0;            /* current sbas message index */
+static int isbs  =0;            /* current sbas message index (-1:unknown) */
 static int iitm  =0;            /* current invalid time mark index */
 static int reverse=0;           /* analysis direction (0:forward,1:backward) */
 static int aborts=0;            /* abort status */
@@ -82,6 +91,11 @@ static char rtcm_path[1024]=""; /* rtcm data path */
 static gtime_t invalidtm[MAXINVALIDTM]={{0}};/* invalid time marks */
 static rtcm_t rtcm;             /* rtcm control struct */
 static FILE *fp_rtcm=NULL;      /* rtcm data file pointer */
+static rnxobs_t rnxobs[2];      /* rover/base obs streams (streaming mode) */
+static obsd_t *obsbuf[3]={0};   /* read-ahead epochs {rover,base,next base} */
+static int nobsbuf[3]={0};      /* number of obs data in read-ahead epochs */
+static int streaming=0;         /* streaming mode of obs data (0:off,1:on) */
+static void *tidec=NULL;        /* tidal displacement cache of session */
 
 /* show message and check break ----------------------------------------------*/
 static int checkbrk(const char *format, ...)
@@ -156,11 +170,17 @@ static void outheader(FILE *fp, const char **file, int n, const prcopt_t *popt,
         for (i=0;i<n;i++) {
             fprintf(fp,"%s inp file  : %s\n",COMMENTH,file[i]);
         }
-        for (i=0;i<obss.n;i++)    if (obss.data[i].rcv==1) break;
-        for (j=obss.n-1;j>=0;j--) if (obss.data[j].rcv==1) break;
-        if (j<i) {fprintf(fp,"\n%s no rover obs data\n",COMMENTH); return;}
-        ts=obss.data[i].time;
-        te=obss.data[j].time;
+        if (streaming) { /* obs end unknown until the end of processing */
+            if (nobsbuf[0]<=0) {fprintf(fp,"\n%s no rover obs data\n",COMMENTH); return;}
+            ts=te=obsbuf[0][0].time;
+        }
+        else {
+            for (i=0;i<obss.n;i++)    if (obss.data[i].rcv==1) break;
+            for (j=obss.n-1;j>=0;j--) if (obss.data[j].rcv==1) break;
+            if (j<i) {fprintf(fp,"\n%s no rover obs data\n",COMMENTH); return;}
+            ts=obss.data[i].time;
+            te=obss.data[j].time;
+        }
         t1=time2gpst(ts,&w1);
         t2=time2gpst(te,&w2);
         if (sopt->times>=1) {
@@ -174,7 +194,9 @@ static void outheader(FILE *fp, const char **file, int n, const prcopt_t *popt,
         time2str(ts,s2,1);
         time2str(te,s3,1);
         fprintf(fp,"%s obs start : %s %s (week%04d %8.1fs)\n",COMMENTH,s2,s1[sopt->times],w1,t1);
-        fprintf(fp,"%s obs end   : %s %s (week%04d %8.1fs)\n",COMMENTH,s3,s1[sopt->times],w2,t2);
+        if (!streaming) {
+            fprintf(fp,"%s obs end   : %s %s (week%04d %8.1fs)\n",COMMENTH,s3,s1[sopt->times],w2,t2);
+        }
     }
     if (sopt->outopt) {
         outprcopt(fp,popt);
@@ -251,11 +273,79 @@ static void update_rtcm_ssr(gtime_t time)
         }
     }
 }
+/* update sbas and rtcm ssr corrections in forward direction -----------------*/
+static void updatecorrf(gtime_t time)
+{
+    /* Update sbas corrections */
+    while (isbs<sbss.n) {
+        gtime_t tmsg=gpst2time(sbss.msgs[isbs].week,sbss.msgs[isbs].tow);
+
+        if (getbitu(sbss.msgs[isbs].msg,8,6)!=9) { /* Except for geo nav */
+            sbsupdatecorr(sbss.msgs+isbs,&navs);
+        }
+        if (timediff(tmsg,time)>-1.0-DTTOL) break;
+        isbs++;
+    }
+    /* Update rtcm ssr corrections */
+    if (*rtcm_file) {
+        update_rtcm_ssr(time);
+    }
+}
+/* advance base epoch of obs streams -----------------------------------------*/
+static void nextbase(void)
+{
+    obsd_t *p=obsbuf[1];
+
+    obsbuf[1]=obsbuf[2]; nobsbuf[1]=nobsbuf[2];
+    obsbuf[2]=p;
+    nobsbuf[2]=nobsbuf[1]>0?input_rnxobs(rnxobs+1,obsbuf[2],MAXOBS):0;
+}
+/* Input obs data from rinex obs streams (forward only) ----------------------*/
+static int inputobs_s(obsd_t *obs, int solq, const prcopt_t *popt)
+{
+    gtime_t time;
+    char tstr[40];
+    int i,n=nobsbuf[0];
+
+    if (n<=0) return -1;
+
+    time=obsbuf[0][0].time;
+    settime(time);
+    if (checkbrk("processing : %s Q=%d",time2str(time,tstr,0),solq)) {
+        aborts=1;
+        showmsg("aborted");
+        return -1;
+    }
+    for (i=0;i<n;i++) obs[i]=obsbuf[0][i];
+
+    /* Read ahead next rover epoch */
+    nobsbuf[0]=input_rnxobs(rnxobs,obsbuf[0],MAXOBS);
+
+    if (popt->intpref) {
+        /* For interpolation, find first base epoch after rover epoch */
+        while (nobsbuf[1]>0&&timediff(obsbuf[1][0].time,time)<=-DTTOL) {
+            nextbase();
+        }
+    } else {
+        /* If not interpolating, find the closest base epoch */
+        while (nobsbuf[2]>0&&fabs(timediff(obsbuf[2][0].time,time))<=
+                             fabs(timediff(obsbuf[1][0].time,time))) {
+            nextbase();
+        }
+    }
+    for (i=0;i<nobsbuf[1]&&n<MAXOBS*2;i++) obs[n++]=obsbuf[1][i];
+
+    /* Update sbas and rtcm ssr corrections */
+    updatecorrf(obs[0].time);
+    return n;
+}
 /* Input obs data, navigation messages and sbas correction -------------------*/
 static int inputobs(obsd_t *obs, int solq, const prcopt_t *popt)
 {
     trace(3,"\ninfunc  : dir=%d iobsu=%d iobsr=%d isbs=%d\n",reverse,iobsu,iobsr,isbs);
 
+    if (streaming) return inputobs_s(obs,solq,popt);
+
     if (0<=iobsu&&iobsu<obss.n) {
         gtime_t time = obss.data[iobsu].time;
         settime(time);
@@ -300,20 +390,8 @@ static int inputobs(obsd_t *obs, int solq, const prcopt_t *popt)
         }
         iobsu+=nu;
 
-        /* Update sbas corrections */
-        while (isbs<sbss.n) {
-            gtime_t time=gpst2time(sbss.msgs[isbs].week,sbss.msgs[isbs].tow);
-
-            if (getbitu(sbss.msgs[isbs].msg,8,6)!=9) { /* Except for geo nav */
-                sbsupdatecorr(sbss.msgs+isbs,&navs);
-            }
-            if (timediff(time,obs[0].time)>-1.0-DTTOL) break;
-            isbs++;
-        }
-        /* Update rtcm ssr corrections */
-        if (*rtcm_file) {
-            update_rtcm_ssr(obs[0].time);
-        }
+        /* Update sbas and rtcm ssr corrections */
+        updatecorrf(obs[0].time);
     } else {
         /* Input backward data */
         int nu=nextobsb(&obss,&iobsu,1);
@@ -346,15 +424,9 @@ static int inputobs(obsd_t *obs, int solq, const prcopt_t *popt)
         }
         iobsu-=nu;
 
-        /* Update sbas corrections */
-        while (isbs>=0) {
-            gtime_t time=gpst2time(sbss.msgs[isbs].week,sbss.msgs[isbs].tow);
-
-            if (getbitu(sbss.msgs[isbs].msg,8,6)!=9) { /* Except for geo nav */
-                sbsupdatecorr(sbss.msgs+isbs,&navs);
-            }
-            if (timediff(time,obs[0].time)<1.0+DTTOL) break;
-            isbs--;
+        /* Seek sbas corrections to the same state as in forward direction */
+        if (sbss.n>0) {
+            isbs=sbsseekcorr(&sbss,timeadd(obs[0].time,-1.0+DTTOL),isbs,&navs);
         }
     }
     return n;
@@ -667,10 +739,12 @@ static void combres(FILE *fp, FILE *fptm, const prcopt_t *popt, const solopt_t *
 }
 /* read prec ephemeris, sbas data, tec grid and open rtcm --------------------*/
 static void readpreceph(const char **infile, int n, const prcopt_t *prcopt,
-                        nav_t *nav, sbs_t *sbs)
+                        const filopt_t *fopt, nav_t *nav, sbs_t *sbs)
 {
-    int i;
-    const char *ext;
+    gtime_t t0={0};
+    int i,m;
+    const char *ext,*files[MAXINFILE];
+    char path[1024],opt[32];
 
     trace(2,"readpreceph: n=%d\n",n);
 
@@ -678,21 +752,43 @@ static void readpreceph(const char **infile, int n, const prcopt_t *prcopt,
     nav->nc=nav->ncmax=0;
     sbs->n =sbs->nmax =0;
 
-    /* read precise ephemeris files */
-    for (i=0;i<n;i++) {
+    for (i=m=0;i<n&&m<MAXINFILE;i++) {
         if (strstr(infile[i],"%r")||strstr(infile[i],"%b")) continue;
-        readsp3(infile[i],nav,0);
+        files[m++]=infile[i];
     }
-    /* read precise clock files */
-    for (i=0;i<n;i++) {
-        if (strstr(infile[i],"%r")||strstr(infile[i],"%b")) continue;
-        readrnxc(infile[i],nav);
+    /* load precise ephemeris, clock and sbas data from binary cache */
+    sprintf(opt,"sbassatsel=%d",prcopt->sbassatsel);
+    if (!cachepath(fopt->cache,1,files,NULL,m,t0,t0,0.0,opt,path)) {
+        *path='\0';
     }
-    /* read sbas message files */
-    for (i=0;i<n;i++) {
-        if (strstr(infile[i],"%r")||strstr(infile[i],"%b")) continue;
-        sbsreadmsg(infile[i],prcopt->sbassatsel,sbs);
+    if (*path&&loadcachepeph(path,nav,sbs)) {
+        trace(2,"peph cache loaded: %s\n",path);
+    }
+    else {
+        /* read precise ephemeris files */
+        for (i=0;i<m;i++) {
+            readsp3(files[i],nav,0);
+        }
+        /* read precise clock files */
+        for (i=0;i<m;i++) {
+            readrnxc(files[i],nav);
+        }
+        /* read sbas message files */
+        for (i=0;i<m;i++) {
+            sbsreadmsg(files[i],prcopt->sbassatsel,sbs);
+        }
+        /* save to binary cache */
+        if (*path&&!savecachepeph(path,nav,sbs)) {
+            trace(2,"peph cache save error: %s\n",path);
+        }
     }
+    /* make sbas correction state snapshots for backward processing */
+    if (sbs->n>0&&prcopt->mode!=PMODE_SINGLE&&
+        prcopt->soltype!=SOLTYPE_FORWARD) {
+        sbsmakesnap(sbs,SBSSNAPINT,SBSSNAPSUB);
+    }
+    /* set per-satellite precise ephemeris and chebyshev orbit segments */
+    setpephs(nav,prcopt->pephcheb?3:1);
 
     /* set rtcm file and initialize rtcm struct */
     rtcm_file[0]=rtcm_path[0]='\0'; fp_rtcm=NULL;
@@ -714,8 +810,10 @@ static void freepreceph(nav_t *nav, sbs_t *sbs)
     trace(3,"freepreceph:\n");
 
     free(nav->peph); nav->peph=NULL; nav->ne=nav->nemax=0;
+    freepephs(nav);
     free(nav->pclk); nav->pclk=NULL; nav->nc=nav->ncmax=0;
     free(sbs->msgs); sbs->msgs=NULL; sbs->n =sbs->nmax =0;
+    sbsfreesnap(sbs);
     for (i=0;i<nav->nt;i++) {
         free(nav->tec[i].data);
         free(nav->tec[i].rms );
@@ -725,12 +823,28 @@ static void freepreceph(nav_t *nav, sbs_t *sbs)
     if (fp_rtcm) fclose(fp_rtcm);
     free_rtcm(&rtcm);
 }
+/* set time span for progress display ----------------------------------------*/
+static void settspanobs(gtime_t ts, gtime_t te, const obs_t *obs)
+{
+    int i,j;
+
+    if (ts.time!=0&&te.time!=0) return;
+
+    for (i=0;   i<obs->n;i++) if (obs->data[i].rcv==1) break;
+    for (j=obs->n-1;j>=0;j--) if (obs->data[j].rcv==1) break;
+    if (i<j) {
+        if (ts.time==0) ts=obs->data[i].time;
+        if (te.time==0) te=obs->data[j].time;
+        settspan(ts,te);
+    }
+}
 /* read obs and nav data -----------------------------------------------------*/
 static int readobsnav(gtime_t ts, gtime_t te, double ti, const char **infile,
                       const int *index, int n, const prcopt_t *prcopt,
-                      obs_t *obs, nav_t *nav, sta_t *sta)
+                      const filopt_t *fopt, obs_t *obs, nav_t *nav, sta_t *sta)
 {
-    int i,j,ind=0,nobs=0,rcv=1;
+    int i,ind=0,nobs=0,rcv=1;
+    char path[1024],opt[520];
 
     char tstr[40];
     trace(3,"readobsnav: ts=%s n=%d\n",time2str(ts,tstr,0),n);
@@ -742,6 +856,16 @@ static int readobsnav(gtime_t ts, gtime_t te, double ti, const char **infile,
     nav->seph=NULL; nav->ns=nav->nsmax=0;
     nepoch=0;
 
+    /* load obs and nav data from binary cache */
+    sprintf(opt,"%s|%s",prcopt->rnxopt[0],prcopt->rnxopt[1]);
+    if (!cachepath(fopt->cache,0,infile,index,n,ts,te,ti,opt,path)) {
+        *path='\0';
+    }
+    if (*path&&(nepoch=loadcacheobs(path,obs,nav,sta,2))>0) {
+        trace(2,"obs/nav cache loaded: %s\n",path);
+        settspanobs(ts,te,obs);
+        return 1;
+    }
     for (i=0;i<n;i++) {
         if (checkbrk("")) return 0;
 
@@ -773,23 +897,105 @@ static int readobsnav(gtime_t ts, gtime_t te, double ti, const char **infile,
     /* delete duplicated ephemeris */
     uniqnav(nav);
 
-    /* set time span for progress display */
-    if (ts.time==0||te.time==0) {
-        for (i=0;   i<obs->n;i++) if (obs->data[i].rcv==1) break;
-        for (j=obs->n-1;j>=0;j--) if (obs->data[j].rcv==1) break;
-        if (i<j) {
-            if (ts.time==0) ts=obs->data[i].time;
-            if (te.time==0) te=obs->data[j].time;
-            settspan(ts,te);
+    /* save to binary cache */
+    if (*path&&!savecacheobs(path,obs,nav,sta,2,nepoch)) {
+        trace(2,"obs/nav cache save error: %s\n",path);
+    }
+    settspanobs(ts,te,obs);
+    return 1;
+}
+/* open obs streams and read nav data ----------------------------------------*/
+static int openobsnav(gtime_t ts, gtime_t te, double ti, const char **infile,
+                      const int *index, int n, const prcopt_t *prcopt,
+                      nav_t *nav, sta_t *sta)
+{
+    int i,stat,ind=0,nobs=0,rcv=1;
+
+    trace(3,"openobsnav: n=%d\n",n);
+
+    nav->eph =NULL; nav->n =nav->nmax =0;
+    nav->geph=NULL; nav->ng=nav->ngmax=0;
+    nav->seph=NULL; nav->ns=nav->nsmax=0;
+    nepoch=0;
+
+    streaming=1;
+    for (i=0;i<2;i++) {
+        if (!init_rnxobs(rnxobs+i,i+1,ts,te,ti,prcopt->rnxopt[i])) {
+            checkbrk("error : insufficient memory");
+            return 0;
+        }
+    }
+    for (i=0;i<3;i++) {
+        nobsbuf[i]=0;
+        if (!(obsbuf[i]=(obsd_t *)malloc(sizeof(obsd_t)*MAXOBS))) {
+            checkbrk("error : insufficient memory");
+            return 0;
+        }
+    }
+    for (i=0;i<n;i++) {
+        if (checkbrk("")) return 0;
+
+        if (index[i]!=ind) {
+            if (nobs>0) rcv++;
+            ind=index[i]; nobs=0;
         }
+        /* queue rinex obs files and read nav files */
+        if ((stat=add_rnxobs(rcv<=2?rnxobs+rcv-1:NULL,infile[i],nav,
+                             rcv<=2?sta+rcv-1:NULL))<0) {
+            checkbrk("error : insufficient memory");
+            trace(1,"insufficient memory\n");
+            return 0;
+        }
+        nobs+=stat;
+    }
+    if (nav->n<=0&&nav->ng<=0&&nav->ns<=0) {
+        checkbrk("error : no nav data");
+        trace(1,"\n");
+        return 0;
+    }
+    /* delete duplicated ephemeris */
+    uniqnav(nav);
+
+    /* read first rover and base epochs */
+    if ((nobsbuf[0]=input_rnxobs(rnxobs,obsbuf[0],MAXOBS))<=0) {
+        checkbrk("error : no obs data");
+        trace(1,"\n");
+        return 0;
+    }
+    if ((nobsbuf[1]=input_rnxobs(rnxobs+1,obsbuf[1],MAXOBS))>0) {
+        nobsbuf[2]=input_rnxobs(rnxobs+1,obsbuf[2],MAXOBS);
+    }
+    return 1;
+}
+/* check if obs data can be streamed -----------------------------------------*/
+static int canstream(const prcopt_t *popt, const char **infile, int n)
+{
+    int i;
+
+    if (!popt->streamobs) return 0;
+
+    /* backward and combined solutions need all obs data */
+    if (popt->mode!=PMODE_SINGLE&&popt->soltype!=SOLTYPE_FORWARD) return 0;
+
+    for (i=0;i<n;i++) {
+        if (!*infile[i]) return 0; /* stdin */
     }
     return 1;
 }
 /* free obs and nav data -----------------------------------------------------*/
 static void freeobsnav(obs_t *obs, nav_t *nav)
 {
+    int i;
+
     trace(3,"freeobsnav:\n");
 
+    if (streaming) {
+        for (i=0;i<2;i++) free_rnxobs(rnxobs+i);
+        for (i=0;i<3;i++) {
+            free(obsbuf[i]); obsbuf[i]=NULL; nobsbuf[i]=0;
+        }
+        streaming=0;
+    }
     free(obs->data); obs->data=NULL; obs->n =obs->nmax =0;
     free(nav->eph ); nav->eph =NULL; nav->n =nav->nmax =0;
     free(nav->geph); nav->geph=NULL; nav->ng=nav->ngmax=0;
@@ -799,7 +1005,8 @@ static void freeobsnav(obs_t *obs, nav_t *nav)
 static int avepos(double *ra, int rcv, const obs_t *obs, const nav_t *nav,
                   const prcopt_t *opt)
 {
-    obsd_t data[MAXOBS];
+    obsd_t data[MAXOBS],*p=NULL;
+    rnxobs_t rnx,*strm=rnxobs+(rcv==1?0:1);
     gtime_t ts={0};
     sol_t sol={{0}};
     int i,j,n=0,m,iobs;
@@ -809,10 +1016,25 @@ static int avepos(double *ra, int rcv, const obs_t *obs, const nav_t *nav,
 
     for (i=0;i<3;i++) ra[i]=0.0;
 
-    for (iobs=0;(m=nextobsf(obs,&iobs,rcv))>0;iobs+=m) {
-
+    /* second pass on a copy of the obs stream in streaming mode */
+    if (streaming) {
+        if (!init_rnxobs(&rnx,rcv,strm->ts,strm->te,strm->tint,strm->opt)||
+            !(p=(obsd_t *)malloc(sizeof(obsd_t)*MAXOBS))) {
+            free_rnxobs(&rnx);
+            return 0;
+        }
+        for (i=0;i<strm->nf;i++) add_rnxobs(&rnx,strm->files[i],NULL,NULL);
+    }
+    for (iobs=0;;iobs+=m) {
+        if (streaming) {
+            if ((m=input_rnxobs(&rnx,p,MAXOBS))<=0) break;
+        }
+        else {
+            if ((m=nextobsf(obs,&iobs,rcv))<=0) break;
+            p=obs->data+iobs;
+        }
         for (i=j=0;i<m&&i<MAXOBS;i++) {
-            data[j]=obs->data[iobs+i];
+            data[j]=p[i];
             if ((satsys(data[j].sat,NULL)&opt->navsys)&&
                 opt->exsats[data[j].sat-1]!=1) j++;
         }
@@ -823,6 +1045,10 @@ static int avepos(double *ra, int rcv, const obs_t *obs, const nav_t *nav,
         for (i=0;i<3;i++) ra[i]+=sol.rr[i];
         n++;
     }
+    if (streaming) {
+        free_rnxobs(&rnx);
+        free(p);
+    }
     if (n<=0) {
         trace(1,"no average of base station position\n");
         return 0;
@@ -935,6 +1161,12 @@ static int openses(const prcopt_t *popt, const solopt_t *sopt,
     }
     return 1;
 }
+/* initialize rtk control sharing tidal displacement cache -----------------*/
+static void initrtk(rtk_t *rtk, const prcopt_t *popt)
+{
+    rtkinit(rtk,popt);
+    rtk->tide=reftidecache(&tidec);
+}
 /* close processing session ---------------------------------------------------*/
 static void closeses(nav_t *nav, pcvs_t *pcvs, pcvs_t *pcvr)
 {
@@ -947,8 +1179,9 @@ static void closeses(nav_t *nav, pcvs_t *pcvs, pcvs_t *pcvr)
     /* close geoid data */
     closegeoid();
 
-    /* free erp data */
+    /* free erp data and tidal displacement cache */
     free(nav->erp.data); nav->erp.data=NULL; nav->erp.n=nav->erp.nmax=0;
+    cleartidecache(&tidec);
 
     /* close solution statistics and debug trace */
     rtkclosestat();
@@ -1097,8 +1330,10 @@ static int execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
             trace(2,"no erp data %s\n",path);
         }
     }
-    /* read obs and nav data */
-    if (!readobsnav(ts,te,ti,infile,index,n,&popt_,&obss,&navs,stas)) {
+    /* read obs and nav data or open obs streams */
+    if (canstream(&popt_,infile,n)?
+        !openobsnav(ts,te,ti,infile,index,n,&popt_,&navs,stas):
+        !readobsnav(ts,te,ti,infile,index,n,&popt_,fopt,&obss,&navs,stas)) {
         /* free obs and nav data */
         freeobsnav(&obss, &navs);
         free(rtk_ptr);
@@ -1124,8 +1359,8 @@ static int execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
     }
     /* set antenna parameters */
     if (popt_.mode!=PMODE_SINGLE) {
-        setpcv(obss.n>0?obss.data[0].time:timeget(),&popt_,&navs,&pcvss,&pcvsr,
-               stas);
+        setpcv(streaming?obsbuf[0][0].time:(obss.n>0?obss.data[0].time:timeget()),
+               &popt_,&navs,&pcvss,&pcvsr,stas);
     }
     /* read ocean tide loading parameters */
     if (popt_.mode>PMODE_SINGLE&&*fopt->blq) {
@@ -1176,7 +1411,7 @@ static int execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
         if (fp) {
             FILE *fptm=openfile(outfiletm);
             if (fptm) {
-                rtkinit(rtk_ptr,&popt_);
+                initrtk(rtk_ptr,&popt_);
                 procpos(fp,fptm,&popt_,sopt,rtk_ptr,SOLMODE_SINGLE_DIR);
                 rtkfree(rtk_ptr);
                 fclose(fptm);
@@ -1189,8 +1424,8 @@ static int execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
         if (fp) {
             FILE *fptm=openfile(outfiletm);
             if (fptm) {
-                reverse=1; iobsu=iobsr=obss.n-1; isbs=sbss.n-1;
-                rtkinit(rtk_ptr,&popt_);
+                reverse=1; iobsu=iobsr=obss.n-1; isbs=-1;
+                initrtk(rtk_ptr,&popt_);
                 procpos(fp,fptm,&popt_,sopt,rtk_ptr,SOLMODE_SINGLE_DIR);
                 rtkfree(rtk_ptr);
                 fclose(fptm);
@@ -1206,13 +1441,13 @@ static int execses(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
 
         if (solf&&solb) {
             isolf=isolb=0;
-            rtkinit(rtk_ptr,&popt_);
+            initrtk(rtk_ptr,&popt_);
             procpos(NULL,NULL,&popt_,sopt,rtk_ptr,SOLMODE_COMBINED); /* forward */
-            reverse=1; iobsu=iobsr=obss.n-1; isbs=sbss.n-1;
+            reverse=1; iobsu=iobsr=obss.n-1; isbs=-1;
             if (popt_.soltype!=SOLTYPE_COMBINED_NORESET) {
                 /* Reset */
                 rtkfree(rtk_ptr);
-                rtkinit(rtk_ptr,&popt_);
+                initrtk(rtk_ptr,&popt_);
             }
             procpos(NULL,NULL,&popt_,sopt,rtk_ptr,SOLMODE_COMBINED); /* backward */
             rtkfree(rtk_ptr);
@@ -1307,7 +1542,7 @@ static int execses_b(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
     trace(3,"execses_b: n=%d outfile=%s\n",n,outfile);
 
     /* read prec ephemeris and sbas data */
-    readpreceph(infile,n,popt,&navs,&sbss);
+    readpreceph(infile,n,popt,fopt,&navs,&sbss);
 
     for (i=0;i<n;i++) if (strstr(infile[i],"%b")) break;
 
@@ -1352,6 +1587,58 @@ static int execses_b(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
 
     return stat;
 }
+/* build binary cache of input data --------------------------------------------
+* read input files and save the observation/navigation data and the precise
+* ephemeris/clock/sbas data to the binary cache for later processing runs
+* args   : gtime_t ts       I   processing start time (ts.time==0: no limit)
+*          gtime_t te       I   processing end time   (te.time==0: no limit)
+*          double ti        I   processing interval  (s) (0:all)
+*          prcopt_t *popt   I   processing options
+*          filopt_t *fopt   I   file options (fopt->cache: cache directory)
+*          char   **infile  I   input files
+*          int    n         I   number of input files
+* return : status (0:ok,0>:error)
+* notes  : postpos() loads the cache only if it is called with the same input
+*          files, time span, interval and rinex options. multiple sessions
+*          (tu>0) and rover/base keywords are not expanded.
+*-----------------------------------------------------------------------------*/
+extern int postcache(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
+                     const filopt_t *fopt, const char **infile, int n)
+{
+    int i,stat=0,index[MAXINFILE]={0};
+    char *ifile[MAXINFILE];
+
+    trace(3,"postcache: n=%d dir=%s\n",n,fopt->cache);
+
+    if (!*fopt->cache) {
+        showmsg("error : no cache directory");
+        return -1;
+    }
+    if (n>MAXINFILE) n=MAXINFILE;
+
+    for (i=0;i<n;i++) {
+        if (!(ifile[i]=(char *)malloc(1024))) {
+            for (i--;i>=0;i--) free(ifile[i]);
+            return -1;
+        }
+        if (ts.time) reppath(infile[i],ifile[i],ts,"","");
+        else strcpy(ifile[i],infile[i]);
+        index[i]=i;
+    }
+    /* read prec ephemeris and sbas data and save to cache */
+    readpreceph((const char **)ifile,n,popt,fopt,&navs,&sbss);
+
+    /* read obs and nav data and save to cache */
+    if (!readobsnav(ts,te,ti,(const char **)ifile,index,n,popt,fopt,&obss,
+                    &navs,stas)) {
+        stat=-1;
+    }
+    freeobsnav(&obss,&navs);
+    freepreceph(&navs,&sbss);
+
+    for (i=0;i<n;i++) free(ifile[i]);
+    return stat;
+}
 /* post-processing positioning -------------------------------------------------
 * post-processing positioning
 * args   : gtime_t ts       I   processing start time (ts.time==0: no limit)
@@ -59,6 +59,21 @@
 *           2018/10/10 1.13 support api change of satexclude()
 *           2020/11/30 1.14 use sat2freq() to get carrier frequency
 *                           use E1-E5b for Galileo iono-free LC
+*           2026/10/19 1.15 compute sun/moon position once per epoch by
+*                            setastro() and pass it to satposs(), tidedisp(),
+*                            testeclipse() and model_phw()
+*                           compute troposphere site terms once per receiver
+*                            and epoch in ppp_res()
+*                           compute ionex tec model for all satellites by
+*                            iontec_batch() in ppp_res()
+*                           allocate scratch matrices in workspace of rtk
+*                            control struct
+*                           update only position/velocity/acceleration rows
+*                            and columns in udpos_ppp()
+*                           update active state index of rtk control struct
+*                           use pvatrans() for state transition in udpos_ppp()
+*                           use filter_ws() with workspace of rtk control struct
+*                            and active state index
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -198,17 +213,17 @@ extern int pppoutstat(rtk_t *rtk, char *buff)
     return (int)(p-buff);
 }
 /* exclude meas of eclipsing satellite (block IIA) ---------------------------*/
-static void testeclipse(const obsd_t *obs, int n, const nav_t *nav, double *rs)
+static void testeclipse(const obsd_t *obs, int n, const nav_t *nav,
+                        const astro_t *astro, double *rs)
 {
-    double rsun[3],esun[3],r,ang,erpv[5]={0},cosa;
+    double esun[3],r,ang,cosa;
     int i,j;
     const char *type;
 
     trace(3,"testeclipse:\n");
 
     /* unit vector of sun direction (ecef) */
-    sunmoonpos(gpst2utc(obs[0].time),erpv,rsun,NULL,NULL);
-    normv3(rsun,esun);
+    normv3(astro->rsun,esun);
 
     for (i=0;i<n;i++) {
         type=nav->pcvs[obs[i].sat-1].type;
@@ -247,15 +262,14 @@ extern int yaw_angle(int sat, const char *type, int opt, double beta, double mu,
     return 1;
 }
 /* satellite attitude model --------------------------------------------------*/
-static int sat_yaw(gtime_t time, int sat, const char *type, int opt,
+static int sat_yaw(const astro_t *astro, int sat, const char *type, int opt,
                    const double *rs, double *exs, double *eys)
 {
-    double rsun[3],ri[6],es[3],esun[3],n[3],p[3],en[3],ep[3],ex[3],E,beta,mu;
-    double yaw,cosy,siny,erpv[5]={0};
+    const double *rsun=astro->rsun;
+    double ri[6],es[3],esun[3],n[3],p[3],en[3],ep[3],ex[3],E,beta,mu;
+    double yaw,cosy,siny;
     int i;
 
-    sunmoonpos(gpst2utc(time),erpv,rsun,NULL,NULL);
-
     /* beta and orbit angle */
     matcpy(ri,rs,6,1);
     ri[3]-=OMGE*ri[1];
@@ -284,7 +298,7 @@ static int sat_yaw(gtime_t time, int sat, const char *type, int opt,
     return 1;
 }
 /* phase windup model --------------------------------------------------------*/
-static int model_phw(gtime_t time, int sat, const char *type, int opt,
+static int model_phw(const astro_t *astro, int sat, const char *type, int opt,
                      const double *rs, const double *rr, double *phw)
 {
     double exs[3],eys[3],ek[3],exr[3],eyr[3],eks[3],ekr[3],E[9];
@@ -294,7 +308,7 @@ static int model_phw(gtime_t time, int sat, const char *type, int opt,
     if (opt<=0) return 1; /* no phase windup */
 
     /* satellite yaw attitude model */
-    if (!sat_yaw(time,sat,type,opt,rs,exs,eys)) return 0;
+    if (!sat_yaw(astro,sat,type,opt,rs,exs,eys)) return 0;
 
     /* unit vector satellite to receiver */
     for (i=0;i<3;i++) r[i]=rr[i]-rs[i];
@@ -376,6 +390,7 @@ static inline void initx(rtk_t *rtk, double xi, double var, int i)
     for (j=0;j<rtk->nx;j++) rtk->P[i+j*rtk->nx]=0.0;
     for (j=0;j<rtk->nx;j++) rtk->P[j+i*rtk->nx]=0.0;
     rtk->P[i+i*rtk->nx]=var;
+    rtkactstate(rtk,i);
 }
 /* geometry-free phase measurement -------------------------------------------*/
 static double gfmeas(const obsd_t *obs, const nav_t *nav)
@@ -519,7 +534,8 @@ static void detslp_mw(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
 /* temporal update of position -----------------------------------------------*/
 static void udpos_ppp(rtk_t *rtk)
 {
-    double *F,*P,*FP,*x,*xp,pos[3],Q[9]={0},Qv[9],var=0.0;
+    double *P=rtk->P,tt=rtk->tt,pos[3],Q[9]={0},Qv[9],var=0.0,ta=0.0;
+    size_t mark;
     int i,j,*ix,nx;
 
     trace(3,"udpos_ppp:\n");
@@ -564,49 +580,29 @@ static void udpos_ppp(rtk_t *rtk)
         return;
     }
     /* generate valid state index */
-    ix=imat(rtk->nx,1);
+    mark=wsmark(&rtk->ws);
+    ix=wsimat(&rtk->ws,rtk->nx,1);
     for (i=nx=0;i<rtk->nx;i++) {
         if  (i<9||(rtk->x[i]!=0.0&&rtk->P[i+i*rtk->nx]>0.0)) ix[nx++]=i;
     }
-    /* state transition of position/velocity/acceleration */
-    F=eye(nx); P=mat(nx,nx); FP=mat(nx,nx); x=mat(nx,1); xp=mat(nx,1);
-
-    for (i=0;i<6;i++) {
-        F[i+(i+3)*nx]=rtk->tt;
-    }
     /* include accel terms if filter is converged */
     if (var<rtk->opt.thresar[1]) {
-        for (i=0;i<3;i++) {
-            F[i+(i+6)*nx]=SQR(rtk->tt)/2.0;
-        }
+        ta=SQR(tt)/2.0;
     }
     else trace(3,"pos var too high for accel term: %.4f,%.4f\n", var,rtk->opt.thresar[1]);
-    for (i=0;i<nx;i++) {
-        x[i]=rtk->x[ix[i]];
-        for (j=0;j<nx;j++) {
-            P[i+j*nx]=rtk->P[ix[i]+ix[j]*rtk->nx];
-        }
-    }
-    /* x=F*x, P=F*P*F+Q */
-    matmul("NN",nx,1,nx,F,x,xp);
-    matmul("NN",nx,nx,nx,F,P,FP);
-    matmul("NT",nx,nx,nx,FP,F,P);
 
-    for (i=0;i<nx;i++) {
-        rtk->x[ix[i]]=xp[i];
-        for (j=0;j<nx;j++) {
-            rtk->P[ix[i]+ix[j]*rtk->nx]=P[i+j*nx];
-        }
-    }
+    /* state transition of position/velocity/acceleration x=F*x, P=F*P*F' */
+    pvatrans(rtk->x,P,rtk->nx,ix,nx,tt,ta);
+    for (i=0;i<6;i++) rtkactstate(rtk,i);
     /* process noise added to only acceleration */
-    Q[0]=Q[4]=SQR(rtk->opt.prn[3])*fabs(rtk->tt);
-    Q[8]=SQR(rtk->opt.prn[4])*fabs(rtk->tt);
+    Q[0]=Q[4]=SQR(rtk->opt.prn[3])*fabs(tt);
+    Q[8]=SQR(rtk->opt.prn[4])*fabs(tt);
     ecef2pos(rtk->x,pos);
     covecef(pos,Q,Qv);
     for (i=0;i<3;i++) for (j=0;j<3;j++) {
         rtk->P[i+6+(j+6)*rtk->nx]+=Qv[i+j*3];
     }
-    free(ix); free(F); free(P); free(FP); free(x); free(xp);
+    wsrelease(&rtk->ws,mark);
 }
 /* temporal update of clock --------------------------------------------------*/
 static void udclk_ppp(rtk_t *rtk)
@@ -673,6 +669,7 @@ static void udiono_ppp(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
         j=II(i+1,&rtk->opt);
         if (rtk->x[j]!=0.0&&(int)rtk->ssat[i].outc[0]>gap_resion) {
             rtk->x[j]=0.0;
+            rtkactstate(rtk,j);
         }
     }
     for (i=0;i<n;i++) {
@@ -850,18 +847,11 @@ static void satantpcv(const double *rs, const double *rr, const pcv_t *pcv,
     antmodel_s(pcv,nadir,dant);
 }
 /* precise tropospheric model ------------------------------------------------*/
-static double trop_model_prec(gtime_t time, const double *pos,
+static double trop_model_prec(double zhd, const double *mapf,
                               const double *azel, const double *x, double *dtdx,
                               double *var)
 {
-    const double zazel[]={0.0,PI/2.0};
-    double zhd,m_h,m_w,cotz,grad_n,grad_e;
-
-    /* zenith hydrostatic delay */
-    zhd=tropmodel(time,pos,zazel,0.0);
-
-    /* mapping function */
-    m_h=tropmapf(time,pos,azel,&m_w);
+    double m_h=mapf[0],m_w=mapf[1],cotz,grad_n,grad_e;
 
     if (azel[1]>0.0) {
 
@@ -879,13 +869,14 @@ static double trop_model_prec(gtime_t time, const double *pos,
 }
 /* tropospheric model ---------------------------------------------------------*/
 static int model_trop(gtime_t time, const double *pos, const double *azel,
-                      const prcopt_t *opt, const double *x, double *dtdx,
-                      const nav_t *nav, double *dtrp, double *var)
+                      const prcopt_t *opt, const double *x,
+                      const tropsite_t *site, double trps, const double *mapf,
+                      double *dtdx, const nav_t *nav, double *dtrp, double *var)
 {
     double trp[3]={0};
 
     if (opt->tropopt==TROPOPT_SAAS) {
-        *dtrp=tropmodel(time,pos,azel,REL_HUMI);
+        *dtrp=trps;
         *var=SQR(ERR_SAAS);
         return 1;
     }
@@ -895,7 +886,7 @@ static int model_trop(gtime_t time, const double *pos, const double *azel,
     }
     if (opt->tropopt==TROPOPT_EST||opt->tropopt==TROPOPT_ESTG) {
         matcpy(trp,x+IT(opt),opt->tropopt==TROPOPT_EST?1:3,1);
-        *dtrp=trop_model_prec(time,pos,azel,trp,dtdx,var);
+        *dtrp=trop_model_prec(site->zhd,mapf,azel,trp,dtdx,var);
         return 1;
     }
     return 0;
@@ -931,18 +922,21 @@ static int model_iono(gtime_t time, const double *pos, const double *azel,
 /* phase and code residuals --------------------------------------------------*/
 static int ppp_res(int post, const obsd_t *obs, int n, const double *rs,
                    const double *dts, const double *var_rs, const int *svh,
-                   const double *dr, int *exc, const nav_t *nav,
-                   const double *x, rtk_t *rtk, double *v, double *H, double *R,
-                   double *azel)
+                   const double *dr, const astro_t *astro, int *exc,
+                   const nav_t *nav, const double *x, rtk_t *rtk, double *v,
+                   double *H, double *R, double *azel)
 {
     prcopt_t *opt=&rtk->opt;
-    double y,r,cdtr,bias,rr[3],pos[3],e[3],dtdx[3],L[NFREQ],P[NFREQ],Lc,Pc;
+    double y,r,cdtr,bias,rr[3],pos[3],*e,dtdx[3],L[NFREQ],P[NFREQ],Lc,Pc;
+    double rg[MAXOBS],es[MAXOBS*3],trps[MAXOBS]={0},mapfs[MAXOBS*2]={0};
+    double tecd[MAXOBS],tecv[MAXOBS];
     double var[MAXOBS*2*NFREQ],dtrp=0.0,dion=0.0,vart=0.0,vari=0.0,dcb,freq;
     double dantr[NFREQ]={0},dants[NFREQ]={0};
     double ve[MAXOBS*2*NFREQ]={0},vmax=0;
     char str[40];
     int ne=0,obsi[MAXOBS*2*NFREQ]={0},frqi[MAXOBS*2*NFREQ],maxobs,maxfrq,rej;
-    int i,j,k,sat,sys,nv=0,nx=rtk->nx,stat=1,frq,code;
+    int i,j,k,sat,sys,nv=0,nx=rtk->nx,stat=1,frq,code,nt=n<MAXOBS?n:MAXOBS;
+    int tecs[MAXOBS];
 
     time2str(obs[0].time,str,2);
 
@@ -951,11 +945,28 @@ static int ppp_res(int post, const obsd_t *obs, int n, const double *rs,
     for (i=0;i<3;i++) rr[i]=x[i]+dr[i];
     ecef2pos(rr,pos);
 
-    for (i=0;i<n&&i<MAXOBS;i++) {
+    /* geometric distances and azimuth/elevation angles of all satellites */
+    for (i=0;i<nt;i++) {
+        if ((rg[i]=geodist(rs+i*6,rr,es+i*3))<=0.0) continue;
+        satazel(pos,es+i*3,azel+i*2);
+    }
+    /* troposphere models of all satellites by site terms of receiver */
+    settropsite(obs[0].time,pos,REL_HUMI,rtk->trps);
+    if (opt->tropopt==TROPOPT_SAAS) {
+        tropmodel_batch(rtk->trps,azel,nt,trps);
+    }
+    else if (opt->tropopt==TROPOPT_EST||opt->tropopt==TROPOPT_ESTG) {
+        tropmapf_batch(rtk->trps,azel,nt,mapfs);
+    }
+    /* ionex tec model of all satellites */
+    if (opt->ionoopt==IONOOPT_TEC) {
+        iontec_batch(obs[0].time,nav,pos,azel,nt,1,tecd,tecv,tecs);
+    }
+    for (i=0;i<nt;i++) {
         sat=obs[i].sat;
+        r=rg[i]; e=es+i*3;
 
-        if ((r=geodist(rs+i*6,rr,e))<=0.0||
-            satazel(pos,e,azel+i*2)<opt->elmin) {
+        if (r<=0.0||azel[1+i*2]<opt->elmin) {
             exc[i]=1;
             continue;
         }
@@ -965,8 +976,17 @@ static int ppp_res(int post, const obsd_t *obs, int n, const double *rs,
             continue;
         }
         /* tropospheric and ionospheric model */
-        if (!model_trop(obs[i].time,pos,azel+i*2,opt,x,dtdx,nav,&dtrp,&vart)||
-            !model_iono(obs[i].time,pos,azel+i*2,opt,sat,x,nav,&dion,&vari)) {
+        if (!model_trop(obs[i].time,pos,azel+i*2,opt,x,rtk->trps,trps[i],
+                        mapfs+i*2,dtdx,nav,&dtrp,&vart)) {
+            continue;
+        }
+        if (opt->ionoopt==IONOOPT_TEC) {
+            if (!tecs[i]) continue;
+            dion=tecd[i];
+            vari=tecv[i];
+        }
+        else if (!model_iono(obs[i].time,pos,azel+i*2,opt,sat,x,nav,&dion,
+                             &vari)) {
             continue;
         }
         /* satellite and receiver antenna model */
@@ -974,7 +994,7 @@ static int ppp_res(int post, const obsd_t *obs, int n, const double *rs,
         antmodel(opt->pcvr,opt->antdel[0],azel+i*2,opt->posopt[1],dantr);
 
         /* phase windup model */
-        if (!model_phw(rtk->sol.time,sat,nav->pcvs[sat-1].type,
+        if (!model_phw(astro,sat,nav->pcvs[sat-1].type,
                        opt->posopt[2]?2:0,rs+i*6,rr,&rtk->ssat[sat-1].phw)) {
             continue;
         }
@@ -1182,14 +1202,17 @@ static int test_hold_amb(rtk_t *rtk)
 extern void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
 {
     const prcopt_t *opt=&rtk->opt;
-    double *rs,*dts,*var,*v,*H,*R,*azel,*xp,*Pp,dr[3]={0},std[3];
+    astro_t astro;
+    double *rs,*dts,*var,*v,*H,*R,*azel,*xp,*Pp,dr[3]={0},std[3],erpv[5]={0};
     char str[40];
+    size_t mark=wsmark(&rtk->ws);
     int i,j,nv,info,svh[MAXOBS],exc[MAXOBS]={0},stat=SOLQ_SINGLE;
 
     time2str(obs[0].time,str,2);
     trace(3,"pppos   : time=%s nx=%d n=%d\n",str,rtk->nx,n);
 
-    rs=mat(6,n); dts=mat(2,n); var=mat(1,n); azel=zeros(2,n);
+    rs=wsmat(&rtk->ws,6,n); dts=wsmat(&rtk->ws,2,n); var=wsmat(&rtk->ws,1,n);
+    azel=wszeros(&rtk->ws,2,n);
 
     for (i=0;i<MAXSAT;i++) for (j=0;j<opt->nf;j++) rtk->ssat[i].fix[j]=0;
     for (i=0;i<n&&i<MAXOBS;i++) for (j=0;j<opt->nf;j++) {
@@ -1200,21 +1223,31 @@ extern void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
     /* temporal update of ekf states */
     udstate_ppp(rtk,obs,n,nav);
 
+    /* sun, moon and earth orientation of the epoch */
+    geterp(&nav->erp,obs[0].time,erpv);
+    setastro(gpst2utc(obs[0].time),erpv,&astro);
+
     /* satellite positions and clocks */
-    satposs(obs[0].time,obs,n,nav,rtk->opt.sateph,rs,dts,var,svh);
+    satposs(obs[0].time,obs,n,nav,rtk->opt.sateph,&astro,rs,dts,var,svh);
 
     /* exclude measurements of eclipsing satellite (block IIA) */
     if (rtk->opt.posopt[3]) {
-        testeclipse(obs,n,nav,rs);
+        testeclipse(obs,n,nav,&astro,rs);
     }
     /* earth tides correction */
-    if (opt->tidecorr) {
+    if (opt->tidecorr&&opt->tideint>0.0) {
+        tidedisp_cache(&rtk->tide,gpst2utc(obs[0].time),rtk->x,
+                       opt->tidecorr==1?1:7,&nav->erp,opt->odisp[0],
+                       opt->tideint,dr);
+    }
+    else if (opt->tidecorr) {
         tidedisp(gpst2utc(obs[0].time),rtk->x,opt->tidecorr==1?1:7,&nav->erp,
-                 opt->odisp[0],dr);
+                 &astro,opt->odisp[0],dr);
     }
     nv=n*rtk->opt.nf*2+MAXSAT+3;
-    xp=mat(rtk->nx,1); Pp=zeros(rtk->nx,rtk->nx);
-    v=mat(nv,1); H=mat(rtk->nx,nv); R=mat(nv,nv);
+    xp=wsmat(&rtk->ws,rtk->nx,1); Pp=wsmat(&rtk->ws,rtk->nx,rtk->nx);
+    v=wsmat(&rtk->ws,nv,1); H=wsmat(&rtk->ws,rtk->nx,nv);
+    R=wsmat(&rtk->ws,nv,nv);
 
     for (i=0;i<MAX_ITER;i++) {
 
@@ -1222,17 +1255,18 @@ extern void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
         matcpy(Pp,rtk->P,rtk->nx,rtk->nx);
 
         /* prefit residuals */
-        if (!(nv=ppp_res(0,obs,n,rs,dts,var,svh,dr,exc,nav,xp,rtk,v,H,R,azel))) {
+        if (!(nv=ppp_res(0,obs,n,rs,dts,var,svh,dr,&astro,exc,nav,xp,rtk,v,H,R,azel))) {
             trace(2,"%s ppp (%d) no valid obs data\n",str,i+1);
             break;
         }
         /* measurement update of ekf states */
-        if ((info=filter(xp,Pp,H,v,R,rtk->nx,nv))) {
+        if ((info=filter_ws(xp,Pp,H,v,R,rtk->nx,nv,rtk->ixs,rtk->nxs,
+                            &rtk->ws))) {
             trace(2,"%s ppp (%d) filter error info=%d\n",str,i+1,info);
             break;
         }
         /* postfit residuals */
-        if (ppp_res(i+1,obs,n,rs,dts,var,svh,dr,exc,nav,xp,rtk,NULL,NULL,NULL,azel)) {
+        if (ppp_res(i+1,obs,n,rs,dts,var,svh,dr,&astro,exc,nav,xp,rtk,NULL,NULL,NULL,azel)) {
             matcpy(rtk->x,xp,rtk->nx,1);
             matcpy(rtk->P,Pp,rtk->nx,rtk->nx);
             stat=SOLQ_PPP;
@@ -1245,7 +1279,7 @@ extern void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
     if (stat==SOLQ_PPP) {
 
         if (ppp_ar(rtk,obs,n,exc,nav,azel,xp,Pp)&&
-            ppp_res(9,obs,n,rs,dts,var,svh,dr,exc,nav,xp,rtk,NULL,NULL,NULL,azel)) {
+            ppp_res(9,obs,n,rs,dts,var,svh,dr,&astro,exc,nav,xp,rtk,NULL,NULL,NULL,azel)) {
 
             matcpy(rtk->xa,xp,rtk->nx,1);
             matcpy(rtk->Pa,Pp,rtk->nx,rtk->nx);
@@ -1266,6 +1300,5 @@ extern void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
             rtk->nfix=0;
         }
     }
-    free(rs); free(dts); free(var); free(azel);
-    free(xp); free(Pp); free(v); free(H); free(R);
+    wsrelease(&rtk->ws,mark);
 }
@@ -48,6 +48,11 @@
 *                           LC defined GPS/QZS L1-L2, GLO G1-G2, GAL E1-E5b,
 *                            BDS B1I-B2I and IRN L5-S for API satantoff()
 *                           fix bug on reading SP3 file extension
+*           2026/10/19 1.18 add api setpephs(),freepephs()
+*                           cache interpolation window in peph2pos()
+*                           support chebyshev orbit segments by setpephs()
+*                           add astronomical context to api peph2pos(),
+*                            satantoff()
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -57,8 +62,18 @@
 #define MAXDTE      900.0           /* max time difference to ephem time (s) */
 #define EXTERR_CLK  1E-3            /* extrapolation error for clock (m/s) */
 #define EXTERR_EPH  5E-7            /* extrapolation error for ephem (m/s^2) */
+#define MAXERR_CHEB 1E-4            /* max error of chebyshev orbit (m) */
 #define MAX_BIAS_SYS 4              /* # of constellations supported */
 
+typedef struct {                    /* interpolation window type */
+    gtime_t time;                   /* time */
+    int n;                          /* number of epochs of ephemeris store */
+    int index,i0;                   /* index of epoch and first node */
+    gtime_t tn[NMAX+1];             /* epoch times of nodes */
+    double t[NMAX+1];               /* time of nodes from time (s) */
+    double sinl[NMAX+1],cosl[NMAX+1]; /* earth rotation terms of nodes */
+} pephwin_t;
+
 /* table to translate code to code bias table index  */
 static int8_t code_bias_ix[MAX_BIAS_SYS][MAXCODE];
 /* initialize code bias lookup table -------------------------------------------
@@ -553,6 +568,171 @@ static double interppol(const double *x, double *y, int n)
     }
     return y[0];
 }
+/* interpolation window of per-satellite precise ephemeris -------------------*/
+static const pephwin_t *pephwin(gtime_t time, const pephs_t *p)
+{
+    static THREADLOCAL pephwin_t win[2];
+    static THREADLOCAL int next=0;
+    pephwin_t *w;
+    int i,j,k;
+
+    /* reuse window of same time and same node epochs (for all satellites) */
+    for (i=0;i<2;i++) {
+        if (win[i].n!=p->n||win[i].time.time!=time.time||
+            win[i].time.sec!=time.sec) continue;
+        for (j=0;j<=NMAX;j++) {
+            if (win[i].tn[j].time!=p->time[win[i].i0+j].time||
+                win[i].tn[j].sec!=p->time[win[i].i0+j].sec) break;
+        }
+        if (j>NMAX) return win+i;
+    }
+    w=win+next; next^=1;
+
+    /* binary search */
+    for (i=0,j=p->n-1;i<j;) {
+        k=(i+j)/2;
+        if (timediff(p->time[k],time)<0.0) i=k+1; else j=k;
+    }
+    w->index=i<=0?0:i-1;
+
+    /* nodes and earth rotation terms for polynomial interpolation */
+    i=w->index-(NMAX+1)/2;
+    if (i<0) i=0; else if (i+NMAX>=p->n) i=p->n-NMAX-1;
+    w->i0=i;
+
+    for (j=0;j<=NMAX;j++) {
+        w->tn[j]=p->time[i+j];
+        w->t[j]=timediff(p->time[i+j],time);
+        w->sinl[j]=sin(OMGE*w->t[j]);
+        w->cosl[j]=cos(OMGE*w->t[j]);
+    }
+    w->n=p->n;
+    w->time=time;
+    return w;
+}
+/* satellite orbit by polynomial interpolation of per-satellite ephemeris ---*/
+static int pephorb(const pephwin_t *w, const double *pos, double *rs)
+{
+    double p[3][NMAX+1];
+    int i,j;
+
+    for (j=0;j<=NMAX;j++) {
+        if (norm(pos+(w->i0+j)*4,3)<=0.0) return 0;
+    }
+    for (j=0;j<=NMAX;j++) {
+        const double *q=pos+(w->i0+j)*4;
+        p[0][j]=w->cosl[j]*q[0]-w->sinl[j]*q[1];
+        p[1][j]=w->sinl[j]*q[0]+w->cosl[j]*q[1];
+        p[2][j]=q[2];
+    }
+    for (i=0;i<3;i++) {
+        rs[i]=interppol(w->t,p[i],NMAX+1);
+    }
+    return 1;
+}
+/* evaluate chebyshev series by clenshaw recurrence -------------------------*/
+static void chebval(const double *c, double x, double *rs)
+{
+    double b0,b1,b2,x2=2.0*x;
+    int i,j;
+
+    for (i=0;i<3;i++,c+=NCHEB+1) {
+        for (j=NCHEB,b1=b2=0.0;j>=1;j--) {
+            b0=x2*b1-b2+c[j];
+            b2=b1; b1=b0;
+        }
+        rs[i]=x*b1-b2+c[0];
+    }
+}
+/* satellite orbit by chebyshev segment --------------------------------------*/
+static int pephcheb(gtime_t time, const pephs_t *ps, int k, int index,
+                    double *rs)
+{
+    double x;
+    int iseg=k*(ps->n-1)+index;
+
+    if (index>=ps->n-1||!ps->cval[iseg]) return 0;
+
+    /* normalized time in segment */
+    x=2.0*timediff(time,ps->time[index])/
+      timediff(ps->time[index+1],ps->time[index])-1.0;
+    if (x<-1.0||x>1.0) return 0;
+
+    chebval(ps->cheb+(size_t)iseg*3*(NCHEB+1),x,rs);
+    return 1;
+}
+/* satellite position by per-satellite precise ephemeris ---------------------*/
+static int pephpos_s(gtime_t time, int sat, const pephs_t *ps, double *rs,
+                     double *dts, double *vare, double *varc)
+{
+    const pephwin_t *w;
+    const double *pos;
+    const float *sd;
+    double t[2],c[2],std=0.0,s[3];
+    int i,k,index;
+
+    char tstr[40];
+    trace(4,"pephpos_s: time=%s sat=%2d\n",time2str(time,tstr,3),sat);
+
+    rs[0]=rs[1]=rs[2]=dts[0]=0.0;
+
+    if (ps->n<NMAX+1||
+        timediff(time,ps->time[0])<-MAXDTE||
+        timediff(time,ps->time[ps->n-1])>MAXDTE) {
+        trace(3,"no prec ephem %s sat=%2d\n",time2str(time,tstr,0),sat);
+        return 0;
+    }
+    w=pephwin(time,ps);
+    index=w->index;
+
+    if ((k=ps->idx[sat-1])<0) {
+        trace(3,"prec ephem outage %s sat=%2d\n",time2str(time,tstr,0),sat);
+        return 0;
+    }
+    pos=ps->pos+(size_t)k*ps->n*4;
+    sd =ps->std+(size_t)k*ps->n*4;
+
+    /* chebyshev segment or polynomial interpolation for orbit */
+    if (!(ps->cheb&&pephcheb(time,ps,k,index,rs))&&!pephorb(w,pos,rs)) {
+        trace(3,"prec ephem outage %s sat=%2d\n",time2str(time,tstr,0),sat);
+        return 0;
+    }
+    if (vare) {
+        for (i=0;i<3;i++) s[i]=sd[index*4+i];
+        std=norm(s,3);
+
+        /* extrapolation error for orbit */
+        if      (w->t[0   ]>0.0) std+=EXTERR_EPH*SQR(w->t[0   ])/2.0;
+        else if (w->t[NMAX]<0.0) std+=EXTERR_EPH*SQR(w->t[NMAX])/2.0;
+        *vare=SQR(std);
+    }
+    /* linear interpolation for clock */
+    t[0]=timediff(time,ps->time[index  ]);
+    t[1]=timediff(time,ps->time[index+1]);
+    c[0]=pos[index*4+3];
+    c[1]=pos[(index+1)*4+3];
+
+    if (t[0]<=0.0) {
+        if ((dts[0]=c[0])!=0.0) {
+            std=sd[index*4+3]*CLIGHT-EXTERR_CLK*t[0];
+        }
+    }
+    else if (t[1]>=0.0) {
+        if ((dts[0]=c[1])!=0.0) {
+            std=sd[(index+1)*4+3]*CLIGHT+EXTERR_CLK*t[1];
+        }
+    }
+    else if (c[0]!=0.0&&c[1]!=0.0) {
+        dts[0]=(c[1]*t[0]-c[0]*t[1])/(t[0]-t[1]);
+        i=t[0]<-t[1]?0:1;
+        std=sd[(index+i)*4+3]+EXTERR_CLK*fabs(t[i]);
+    }
+    else {
+        dts[0]=0.0;
+    }
+    if (varc) *varc=SQR(std);
+    return 1;
+}
 /* satellite position by precise ephemeris -----------------------------------*/
 static int pephpos(gtime_t time, int sat, const nav_t *nav, double *rs,
                    double *dts, double *vare, double *varc)
@@ -563,6 +743,9 @@ static int pephpos(gtime_t time, int sat, const nav_t *nav, double *rs,
     char tstr[40];
     trace(4,"pephpos : time=%s sat=%2d\n",time2str(time,tstr,3),sat);
 
+    if (nav->pephs) {
+        return pephpos_s(time,sat,nav->pephs,rs,dts,vare,varc);
+    }
     rs[0]=rs[1]=rs[2]=dts[0]=0.0;
 
     if (nav->ne<NMAX+1||
@@ -686,6 +869,167 @@ static int pephclk(gtime_t time, int sat, const nav_t *nav, double *dts,
     if (varc) *varc=SQR(std);
     return 1;
 }
+/* fit chebyshev orbit segments -----------------------------------------------
+* fit the orbit by polynomial interpolation in each segment between ephemeris
+* epochs with chebyshev polynomials of degree NCHEB. the fitted orbits are
+* checked against the interpolated ones at 2*(NCHEB+1) points in the segment
+* and the segment with the difference over MAXERR_CHEB is not used
+*-----------------------------------------------------------------------------*/
+static int fitpephs(pephs_t *ps)
+{
+    const pephwin_t *w;
+    gtime_t time;
+    double *f,*c,x,dt,r0[3],r1[3],err,maxerr=0.0;
+    int i,j,k,m,nseg=ps->n-1,nerr=0;
+
+    trace(3,"fitpephs: n=%d nsat=%d\n",ps->n,ps->nsat);
+
+    if (nseg<=0||ps->n<NMAX+1) return 0;
+
+    if (!(ps->cheb=(double *)malloc(sizeof(double)*ps->nsat*nseg*3*(NCHEB+1)))||
+        !(ps->cval=(uint8_t *)calloc(ps->nsat*nseg,1))||
+        !(f=(double *)malloc(sizeof(double)*ps->nsat*(NCHEB+1)*3))) {
+        free(ps->cheb); free(ps->cval); ps->cheb=NULL; ps->cval=NULL;
+        return 0;
+    }
+    for (i=0;i<nseg;i++) {
+        dt=timediff(ps->time[i+1],ps->time[i]);
+
+        /* interpolated orbits at chebyshev nodes */
+        for (k=0;k<ps->nsat;k++) ps->cval[k*nseg+i]=dt>0.0;
+        for (m=0;m<=NCHEB&&dt>0.0;m++) {
+            x=cos(PI*(m+0.5)/(NCHEB+1));
+            time=timeadd(ps->time[i],(x+1.0)/2.0*dt);
+            w=pephwin(time,ps);
+            for (k=0;k<ps->nsat;k++) {
+                if (w->index!=i||
+                    !pephorb(w,ps->pos+(size_t)k*ps->n*4,f+(k*(NCHEB+1)+m)*3)) {
+                    ps->cval[k*nseg+i]=0;
+                }
+            }
+        }
+        /* chebyshev coefficients */
+        for (k=0;k<ps->nsat;k++) {
+            if (!ps->cval[k*nseg+i]) continue;
+            c=ps->cheb+((size_t)k*nseg+i)*3*(NCHEB+1);
+            for (j=0;j<=NCHEB;j++) for (m=0;m<3;m++) {
+                c[m*(NCHEB+1)+j]=0.0;
+            }
+            for (m=0;m<=NCHEB;m++) for (j=0;j<=NCHEB;j++) {
+                x=cos(PI*j*(m+0.5)/(NCHEB+1))*2.0/(NCHEB+1);
+                c[            j]+=f[(k*(NCHEB+1)+m)*3  ]*x;
+                c[  (NCHEB+1)+j]+=f[(k*(NCHEB+1)+m)*3+1]*x;
+                c[2*(NCHEB+1)+j]+=f[(k*(NCHEB+1)+m)*3+2]*x;
+            }
+            for (m=0;m<3;m++) c[m*(NCHEB+1)]/=2.0;
+        }
+        /* check fitted orbits */
+        for (m=0;m<2*(NCHEB+1)&&dt>0.0;m++) {
+            x=-1.0+(m+0.5)/(NCHEB+1);
+            time=timeadd(ps->time[i],(x+1.0)/2.0*dt);
+            w=pephwin(time,ps);
+            for (k=0;k<ps->nsat;k++) {
+                if (!ps->cval[k*nseg+i]) continue;
+                if (!pephorb(w,ps->pos+(size_t)k*ps->n*4,r0)) continue;
+                chebval(ps->cheb+((size_t)k*nseg+i)*3*(NCHEB+1),x,r1);
+                err=sqrt(SQR(r1[0]-r0[0])+SQR(r1[1]-r0[1])+SQR(r1[2]-r0[2]));
+                if (err>maxerr) maxerr=err;
+                if (err>MAXERR_CHEB) {
+                    ps->cval[k*nseg+i]=0;
+                    nerr++;
+                }
+            }
+        }
+    }
+    free(f);
+    trace(3,"fitpephs: max error=%.3E m over limit=%d\n",maxerr,nerr);
+    return 1;
+}
+/* set per-satellite precise ephemeris -----------------------------------------
+* set per-satellite precise ephemeris store from precise ephemeris
+* args   : nav_t  *nav        IO  navigation data
+*          int    opt         I   options (1: free nav->peph after set +
+*                                 2: fit chebyshev orbit segments)
+* return : status (1:ok,0:error)
+* notes  : the store holds positions/clocks and their std-devs of satellites
+*          with any precise ephemeris in time-contiguous arrays for each
+*          satellite. velocities and covariances in nav->peph are not stored.
+*          if nav->pephs is set, peph2pos() uses the store instead of
+*          nav->peph. call the function again after updating nav->peph
+*          with opt=2, the orbit between ephemeris epochs is fitted by
+*          chebyshev polynomials (see fitpephs())
+*-----------------------------------------------------------------------------*/
+extern int setpephs(nav_t *nav, int opt)
+{
+    pephs_t *p;
+    double *pos;
+    float *std;
+    int i,j,k,sat;
+
+    trace(3,"setpephs: ne=%d opt=%d\n",nav->ne,opt);
+
+    freepephs(nav);
+
+    if (nav->ne<=0) return 0;
+
+    if (!(p=(pephs_t *)calloc(1,sizeof(pephs_t)))) return 0;
+
+    for (sat=0;sat<MAXSAT;sat++) {
+        p->idx[sat]=-1;
+        for (i=0;i<nav->ne;i++) {
+            if (norm(nav->peph[i].pos[sat],4)>0.0) break;
+        }
+        if (i<nav->ne) p->idx[sat]=p->nsat++;
+    }
+    p->n=nav->ne;
+    if (!(p->time=(gtime_t *)malloc(sizeof(gtime_t)*p->n))||
+        !(p->pos=(double *)malloc(sizeof(double)*p->nsat*p->n*4+1))||
+        !(p->std=(float  *)malloc(sizeof(float )*p->nsat*p->n*4+1))) {
+        trace(1,"setpephs: memory allocation error ne=%d nsat=%d\n",p->n,
+              p->nsat);
+        free(p->time); free(p->pos); free(p->std); free(p);
+        return 0;
+    }
+    for (i=0;i<p->n;i++) p->time[i]=nav->peph[i].time;
+
+    for (sat=0;sat<MAXSAT;sat++) {
+        if ((k=p->idx[sat])<0) continue;
+        pos=p->pos+(size_t)k*p->n*4;
+        std=p->std+(size_t)k*p->n*4;
+        for (i=0;i<p->n;i++) for (j=0;j<4;j++) {
+            pos[i*4+j]=nav->peph[i].pos[sat][j];
+            std[i*4+j]=nav->peph[i].std[sat][j];
+        }
+    }
+    nav->pephs=p;
+
+    if ((opt&2)&&!fitpephs(p)) {
+        trace(2,"setpephs: chebyshev fit error\n");
+    }
+
+    trace(3,"setpephs: n=%d nsat=%d\n",p->n,p->nsat);
+
+    if (opt&1) {
+        free(nav->peph); nav->peph=NULL; nav->ne=nav->nemax=0;
+    }
+    return 1;
+}
+/* free per-satellite precise ephemeris ----------------------------------------
+* free per-satellite precise ephemeris store
+* args   : nav_t  *nav        IO  navigation data
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void freepephs(nav_t *nav)
+{
+    if (!nav->pephs) return;
+    free(nav->pephs->time);
+    free(nav->pephs->pos);
+    free(nav->pephs->std);
+    free(nav->pephs->cheb);
+    free(nav->pephs->cval);
+    free(nav->pephs);
+    nav->pephs=NULL;
+}
 /* satellite antenna phase center offset ---------------------------------------
 * compute satellite antenna phase center offset in ecef
 * args   : gtime_t time       I   time (gpst)
@@ -693,6 +1037,8 @@ static int pephclk(gtime_t time, int sat, const nav_t *nav, double *dts,
 *                                 {x,y,z,vx,vy,vz} (m|m/s)
 *          int    sat         I   satellite number
 *          nav_t  *nav        I   navigation data
+*          astro_t *astro     I   astronomical context of the epoch
+*                                 (NULL: sun position computed for time)
 *          double *dant       O   satellite antenna phase center offset (ecef)
 *                                 {dx,dy,dz} (m) (iono-free LC value)
 * return : none
@@ -704,7 +1050,7 @@ static int pephclk(gtime_t time, int sat, const nav_t *nav, double *dts,
 *            NavIC    : L5-S
 *-----------------------------------------------------------------------------*/
 extern void satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
-                      double *dant)
+                      const astro_t *astro, double *dant)
 {
     const pcv_t *pcv=nav->pcvs+sat-1;
     double ex[3],ey[3],ez[3],es[3],r[3],rsun[3],gmst,erpv[5]={0},freq[2];
@@ -717,7 +1063,12 @@ extern void satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
     dant[0]=dant[1]=dant[2]=0.0;
 
     /* sun position in ecef */
-    sunmoonpos(gpst2utc(time),erpv,rsun,NULL,&gmst);
+    if (astro) {
+        for (i=0;i<3;i++) rsun[i]=astro->rsun[i];
+    }
+    else {
+        sunmoonpos(gpst2utc(time),erpv,rsun,NULL,&gmst);
+    }
 
     /* unit vectors of satellite fixed coordinates */
     for (i=0;i<3;i++) r[i]=-rs[i];
@@ -769,6 +1120,8 @@ extern void satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
 *          nav_t  *nav        I   navigation data
 *          int    opt         I   sat position option
 *                                 (0: center of mass, 1: antenna phase center)
+*          astro_t *astro     I   astronomical context of the epoch
+*                                 (NULL: computed by satantoff())
 *          double *rs         O   sat position and velocity (ecef)
 *                                 {x,y,z,vx,vy,vz} (m|m/s)
 *          double *dts        O   sat clock {bias,drift} (s|s/s)
@@ -781,7 +1134,7 @@ extern void satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
 *          if precise clocks are not set, clocks in sp3 are used instead
 *-----------------------------------------------------------------------------*/
 extern int peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
-                    double *rs, double *dts, double *var)
+                    const astro_t *astro, double *rs, double *dts, double *var)
 {
     gtime_t time_tt;
     double rss[3],rst[3],dtss[1],dtst[1],dant[3]={0},vare=0.0,varc=0.0,tt=1E-3;
@@ -802,7 +1155,7 @@ extern int peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
 
     /* satellite antenna offset correction */
     if (opt) {
-        satantoff(time,rss,sat,nav,dant);
+        satantoff(time,rss,sat,nav,astro,dant);
     }
     for (i=0;i<3;i++) {
         rs[i  ]=rss[i]+dant[i];
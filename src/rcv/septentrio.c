@@ -40,6 +40,7 @@
 *           2024/01/12  1.11 update with new code from Tomoji TAKASU
 *           2024/06/16  1.12 restructed code, tested with Mosaic and PolarRx receivers
 *           2024/06/26  1.13 implemented reading new Meas3 records
+*           2026/10/19  1.14 update SBAS IGP index by IGP mask
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -3547,6 +3548,9 @@ static int decode_sbsigpmask(raw_t *raw) /* TODO: verify this function */
     else if (band <= 10) {b = igpband2[band-9]; m = 5;}
     else return 0;
 
+    /* remove igps of previous mask from igp index */
+    sbsupdateigp(&raw->nav, band, 0);
+
     raw->nav.sbsion[band].iodi = U1(p+9);
     raw->nav.sbsion[band].nigp = U1(p+10);
 
@@ -3561,6 +3565,9 @@ static int decode_sbsigpmask(raw_t *raw) /* TODO: verify this function */
         }
     }
 
+    /* add igps of new mask to igp index */
+    sbsupdateigp(&raw->nav, band, 1);
+
     trace(5, "decode_sbsigpmask: band=%d nigp=%d\n", band, n);
 
     return 3;
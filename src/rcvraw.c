@@ -1321,7 +1321,7 @@ extern int init_raw(raw_t *raw, int format)
             raw->lockt[i][j]=0.0;
             raw->halfc[i][j]=0;
         }
-        raw->icpp[i]=raw->off[i]=raw->prCA[i]=raw->dpCA[i]=0.0;
+        raw->icpp[i]=raw->off[i]=raw->prCA[i]=raw->dpCA[i]=raw->adrs[i]=0.0;
     }
     for (i=0;i<MAXOBS;i++) raw->freqn[i]=0;
     raw->icpc=0.0;
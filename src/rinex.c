@@ -116,6 +116,9 @@
 *                           use API code2idx() to get frequency index
 *                           use integer types in stdint.h
 *                           suppress warnings
+*           2026/10/19 1.31 add api init_rnxobs(),free_rnxobs(),add_rnxobs(),
+*                           input_rnxobs()
+*           2026/10/19 1.32 delete duplicated ephemerides on reading RINEX nav
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -1455,7 +1458,7 @@ static int readrnxnavb(FILE *fp, const char *opt, double ver, int sys,
     return -1;
 }
 /* add ephemeris to navigation data ------------------------------------------*/
-static int add_eph(nav_t *nav, const eph_t *eph)
+static int add_eph(nav_t *nav, const eph_t *eph, navhash_t *hash)
 {
     eph_t *nav_eph;
 
@@ -1468,10 +1471,13 @@ static int add_eph(nav_t *nav, const eph_t *eph)
         }
         nav->eph=nav_eph;
     }
-    nav->eph[nav->n++]=*eph;
+    nav->eph[nav->n]=*eph;
+    
+    /* check duplicated ephemeris */
+    if (add_navhash(hash,nav,0)) nav->n++;
     return 1;
 }
-static int add_geph(nav_t *nav, const geph_t *geph)
+static int add_geph(nav_t *nav, const geph_t *geph, navhash_t *hash)
 {
     geph_t *nav_geph;
 
@@ -1484,10 +1490,13 @@ static int add_geph(nav_t *nav, const geph_t *geph)
         }
         nav->geph=nav_geph;
     }
-    nav->geph[nav->ng++]=*geph;
+    nav->geph[nav->ng]=*geph;
+    
+    /* check duplicated ephemeris */
+    if (add_navhash(hash,nav,1)) nav->ng++;
     return 1;
 }
-static int add_seph(nav_t *nav, const seph_t *seph)
+static int add_seph(nav_t *nav, const seph_t *seph, navhash_t *hash)
 {
     seph_t *nav_seph;
 
@@ -1500,7 +1509,10 @@ static int add_seph(nav_t *nav, const seph_t *seph)
         }
         nav->seph=nav_seph;
     }
-    nav->seph[nav->ns++]=*seph;
+    nav->seph[nav->ns]=*seph;
+    
+    /* check duplicated ephemeris */
+    if (add_navhash(hash,nav,2)) nav->ns++;
     return 1;
 }
 /* read RINEX navigation data ------------------------------------------------*/
@@ -1510,11 +1522,12 @@ static int readrnxnav(FILE *fp, const char *opt, double ver, int sys,
     eph_t eph;
     geph_t geph;
     seph_t seph;
+    navhash_t hash;
     int stat,type;
 
     trace(3,"readrnxnav: ver=%.2f sys=%d\n",ver,sys);
 
-    if (!nav) return 0;
+    if (!nav||!init_navhash(&hash,nav)) return 0;
 
     /* read RINEX navigation data body */
     while ((stat=readrnxnavb(fp,opt,ver,sys,&type,&eph,&geph,&seph))>=0) {
@@ -1522,13 +1535,17 @@ static int readrnxnav(FILE *fp, const char *opt, double ver, int sys,
         /* add ephemeris to navigation data */
         if (stat) {
             switch (type) {
-                case 1 : stat=add_geph(nav,&geph); break;
-                case 2 : stat=add_seph(nav,&seph); break;
-                default: stat=add_eph (nav,&eph ); break;
+                case 1 : stat=add_geph(nav,&geph,&hash); break;
+                case 2 : stat=add_seph(nav,&seph,&hash); break;
+                default: stat=add_eph (nav,&eph ,&hash); break;
+            }
+            if (!stat) {
+                free_navhash(&hash);
+                return 0;
             }
-            if (!stat) return 0;
         }
     }
+    free_navhash(&hash);
     return nav->n>0||nav->ng>0||nav->ns>0;
 }
 /* read RINEX clock ----------------------------------------------------------*/
@@ -1703,7 +1720,7 @@ extern int rnxcomment(rnxopt_t *opt, const char *format, ...) {
 * notes  : read data are appended to obs and nav struct
 *          before calling the function, obs and nav should be initialized.
 *          observation data and navigation data are not sorted.
-*          navigation data may be duplicated.
+*          duplicated navigation data in nav are not added.
 *          call sortobs() or uniqnav() to sort data or delete duplicated eph.
 *
 *          RINEX options (separated by spaces) :
@@ -2021,6 +2038,329 @@ extern int input_rnxctr(rnxctr_t *rnx, FILE *fp)
     return 2;
 }
 /*------------------------------------------------------------------------------
+* RINEX observation stream functions
+*-----------------------------------------------------------------------------*/
+
+/* initialize RINEX observation stream -----------------------------------------
+* initialize RINEX observation stream to input observation data epoch by epoch
+* args   : rnxobs_t *rnx   IO  RINEX observation stream
+*          int    rcv      I   receiver number for obs data
+*          gtime_t ts      I   observation time start (ts.time==0: no limit)
+*          gtime_t te      I   observation time end   (te.time==0: no limit)
+*          double tint     I   observation time interval (s) (0:all)
+*          char   *opt     I   RINEX options (see readrnxt())
+* return : status (1:ok,0:memory allocation error)
+*-----------------------------------------------------------------------------*/
+extern int init_rnxobs(rnxobs_t *rnx, int rcv, gtime_t ts, gtime_t te,
+                       double tint, const char *opt)
+{
+    gtime_t time0={0};
+
+    trace(3,"init_rnxobs: rcv=%d\n",rcv);
+
+    rnx->rcv=rcv;
+    rnx->files=NULL;
+    rnx->nf=rnx->nfmax=rnx->ifile=0;
+    rnx->fp=NULL;
+    rnx->data=rnx->obs.data=NULL;
+    rnx->obs.n=rnx->obs.nmax=0;
+
+    if (!(rnx->data    =(obsd_t *)malloc(sizeof(obsd_t)*MAXOBS))||
+        !(rnx->obs.data=(obsd_t *)malloc(sizeof(obsd_t)*MAXOBS))) {
+        free_rnxobs(rnx);
+        return 0;
+    }
+    rnx->obs.nmax=MAXOBS;
+    rnx->ts=ts;
+    rnx->te=te;
+    rnx->tint=tint;
+    rnx->time1=time0;
+    rnx->dtime1=0.0;
+    rnx->n1=rnx->nobs=0;
+    sprintf(rnx->opt,"%.255s",opt);
+    return 1;
+}
+/* close current file of RINEX observation stream ----------------------------*/
+static void closeobsfile(rnxobs_t *rnx)
+{
+    if (!rnx->fp) return;
+    fclose(rnx->fp);
+    rnx->fp=NULL;
+    if (rnx->cstat) remove(rnx->tmpfile);
+}
+/* free RINEX observation stream -----------------------------------------------
+* close input file and free buffers of RINEX observation stream
+* args   : rnxobs_t *rnx   IO  RINEX observation stream
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void free_rnxobs(rnxobs_t *rnx)
+{
+    int i;
+
+    trace(3,"free_rnxobs: rcv=%d\n",rnx->rcv);
+
+    closeobsfile(rnx);
+    for (i=0;i<rnx->nf;i++) free(rnx->files[i]);
+    free(rnx->files); rnx->files=NULL; rnx->nf=rnx->nfmax=rnx->ifile=0;
+    free(rnx->data); rnx->data=NULL;
+    free(rnx->obs.data); rnx->obs.data=NULL; rnx->obs.n=rnx->obs.nmax=0;
+}
+/* queue obs file to RINEX observation stream --------------------------------*/
+static int queueobsfile(rnxobs_t *rnx, const char *file)
+{
+    char **files;
+
+    if (rnx->nf>=rnx->nfmax) {
+        rnx->nfmax=rnx->nfmax<=0?16:rnx->nfmax*2;
+        if (!(files=(char **)realloc(rnx->files,sizeof(char *)*rnx->nfmax))) {
+            return 0;
+        }
+        rnx->files=files;
+    }
+    if (!(rnx->files[rnx->nf]=(char *)malloc(strlen(file)+1))) return 0;
+    strcpy(rnx->files[rnx->nf++],file);
+    return 1;
+}
+/* add RINEX files to RINEX observation stream ---------------------------------
+* add RINEX files to RINEX observation stream. OBS files are queued to the
+* stream and read by input_rnxobs() later, NAV files are read at once.
+* args   : rnxobs_t *rnx   IO  RINEX observation stream (NULL: skip OBS files)
+*          char   *file    I   file (wild-card * expanded)
+*          nav_t  *nav     IO  navigation data    (NULL: no input)
+*          sta_t  *sta     IO  station parameters (NULL: no input)
+* return : number of OBS files in file (-1: error)
+* notes  : station parameters are read from the RINEX OBS file headers as
+*          readrnxt() does. stdin is not supported as input.
+*-----------------------------------------------------------------------------*/
+extern int add_rnxobs(rnxobs_t *rnx, const char *file, nav_t *nav, sta_t *sta)
+{
+    FILE *fp;
+    double ver;
+    int i,n,sys,tsys,cstat,nobs=0;
+    const char *p,*opt=rnx?rnx->opt:"";
+    char type=' ',tmpfile[1024],*files[MAXEXFILE]={0};
+    char tobs[RNX_NUMSYS][MAXOBSTYPE][4];
+
+    trace(3,"add_rnxobs: file=%s\n",file);
+
+    for (i=0;i<MAXEXFILE;i++) {
+        if (!(files[i]=(char *)malloc(1024))) {
+            for (i--;i>=0;i--) free(files[i]);
+            return -1;
+        }
+    }
+    /* expand wild-card */
+    n=expath(file,files,MAXEXFILE);
+
+    for (i=0;i<n&&nobs>=0;i++) {
+        if (sta) init_sta(sta);
+
+        if ((cstat=rtk_uncompress(files[i],tmpfile))<0) {
+            trace(2,"rinex file uncompact error: %s\n",files[i]);
+            continue;
+        }
+        if (!(fp=fopen(cstat?tmpfile:files[i],"r"))) {
+            trace(2,"rinex file open error: %s\n",cstat?tmpfile:files[i]);
+            continue;
+        }
+        memset(tobs,0,sizeof(tobs));
+
+        if (readrnxh(fp,&ver,&type,&sys,&tsys,tobs,nav,sta,0)) {
+            switch (type) {
+                case 'O': nobs=rnx&&!queueobsfile(rnx,files[i])?-1:nobs+1;
+                          break;
+                case 'N': readrnxnav(fp,opt,ver,sys    ,nav); break;
+                case 'G': readrnxnav(fp,opt,ver,SYS_GLO,nav); break;
+                case 'H': readrnxnav(fp,opt,ver,SYS_SBS,nav); break;
+                case 'J': readrnxnav(fp,opt,ver,SYS_QZS,nav); break;
+                case 'L': readrnxnav(fp,opt,ver,SYS_GAL,nav); break;
+                default: trace(2,"unsupported rinex type ver=%.2f type=%c\n",
+                               ver,type);
+            }
+        }
+        fclose(fp);
+        if (cstat) remove(tmpfile);
+    }
+    /* if station name empty, set 4-char name from file head */
+    if (type=='O'&&sta) {
+        if (!(p=strrchr(file,RTKLIB_FILEPATHSEP))) p=file-1;
+        if (!*sta->name) setstr(sta->name,p+1,4);
+    }
+    for (i=0;i<MAXEXFILE;i++) free(files[i]);
+
+    return nobs;
+}
+/* open next file of RINEX observation stream --------------------------------*/
+static int openobsfile(rnxobs_t *rnx)
+{
+    gtime_t time0={0};
+    double ver;
+    int sys;
+    char type=' ',*file;
+
+    closeobsfile(rnx);
+
+    while (rnx->ifile<rnx->nf) {
+        file=rnx->files[rnx->ifile++];
+
+        trace(3,"openobsfile: file=%s\n",file);
+
+        if ((rnx->cstat=rtk_uncompress(file,rnx->tmpfile))<0) {
+            trace(2,"rinex file uncompact error: %s\n",file);
+            continue;
+        }
+        if (!(rnx->fp=fopen(rnx->cstat?rnx->tmpfile:file,"r"))) {
+            trace(2,"rinex file open error: %s\n",rnx->cstat?rnx->tmpfile:file);
+            continue;
+        }
+        init_sta(&rnx->sta);
+        memset(rnx->tobs,0,sizeof(rnx->tobs));
+        rnx->tsys=TSYS_GPS;
+
+        if (readrnxh(rnx->fp,&ver,&type,&sys,&rnx->tsys,rnx->tobs,NULL,
+                     &rnx->sta,0)&&type=='O') {
+            rnx->ver=ver;
+            memset(rnx->slips,0,sizeof(rnx->slips));
+            rnx->time1=time0;
+            rnx->dtime1=0.0;
+            rnx->n1=0;
+            return 1;
+        }
+        closeobsfile(rnx);
+    }
+    return 0;
+}
+/* read an epoch of RINEX observation stream ---------------------------------
+* same screening and event/slip handling as readrnxobs(). events delayed to
+* the previous epoch are set to the pending epoch in rnx->obs.
+* return : number of obs data in rnx->data (0: skipped, -1: end of file)
+*-----------------------------------------------------------------------------*/
+static int readobsepoch(rnxobs_t *rnx)
+{
+    gtime_t eventime={0},time0={0};
+    obsd_t *data=rnx->data;
+    int i,n,flag=0;
+
+    if ((n=readrnxobsb(rnx->fp,rnx->opt,rnx->ver,&rnx->tsys,rnx->tobs,&flag,
+                       data,&rnx->sta))<0) {
+        return -1;
+    }
+    if (flag==5) {
+        eventime=data[0].eventime;
+        n=readrnxobsb(rnx->fp,rnx->opt,rnx->ver,&rnx->tsys,rnx->tobs,&flag,
+                      data,&rnx->sta);
+        if (fabs(timediff(data[0].time,rnx->time1)-rnx->dtime1)>=DTTOL) {
+            n=readrnxobsb(rnx->fp,rnx->opt,rnx->ver,&rnx->tsys,rnx->tobs,
+                          &flag,data,&rnx->sta);
+        }
+    }
+    if (eventime.time==0||rnx->nobs-rnx->n1<=0||
+        timediff(eventime,rnx->time1)>=0) {
+        for (i=0;i<n;i++) data[i].eventime=eventime;
+    }
+    else {
+        /* add event to previous epoch if delayed */
+        for (i=0;i<rnx->n1&&i<rnx->obs.n;i++) {
+            rnx->obs.data[rnx->obs.n-i-1].eventime=eventime;
+        }
+        for (i=0;i<n;i++) data[i].eventime=time0;
+    }
+    for (i=0;i<n;i++) {
+
+        /* UTC -> GPST */
+        if (rnx->tsys==TSYS_UTC) data[i].time=utc2gpst(data[i].time);
+
+        /* save cycle slip */
+        saveslips(rnx->slips,data+i);
+    }
+    /* screen data by time */
+    if (n>0&&!screent(data[0].time,rnx->ts,rnx->te,rnx->tint)) return 0;
+
+    for (i=0;i<n;i++) {
+
+        /* restore cycle slip */
+        restslips(rnx->slips,data+i);
+
+        data[i].rcv=(uint8_t)rnx->rcv;
+    }
+    rnx->n1=n;
+    rnx->dtime1=timediff(data[0].time,rnx->time1);
+    rnx->time1=data[0].time;
+    return n<0?0:n;
+}
+/* compare obs data of an epoch ----------------------------------------------*/
+static int cmpepoch(const void *p1, const void *p2)
+{
+    obsd_t *q1=(obsd_t *)p1,*q2=(obsd_t *)p2;
+    double tt=timediff(q1->time,q2->time);
+    if (q1->sat!=q2->sat) return (int)q1->sat-(int)q2->sat;
+    return tt<0.0?-1:(tt>0.0?1:0);
+}
+/* output pending epoch of RINEX observation stream --------------------------*/
+static int outobsepoch(rnxobs_t *rnx, obsd_t *data, int nmax)
+{
+    obs_t *obs=&rnx->obs;
+    int i,n;
+
+    if (obs->n<=0) return 0;
+
+    /* sort by satellite and delete duplicated data as sortobs() */
+    qsort(obs->data,obs->n,sizeof(obsd_t),cmpepoch);
+
+    for (i=n=0;i<obs->n&&n<nmax;i++) {
+        if (n>0&&obs->data[i].sat==data[n-1].sat&&
+            timediff(obs->data[i].time,data[n-1].time)==0.0) continue;
+        data[n++]=obs->data[i];
+    }
+    obs->n=0;
+    return n;
+}
+/* input RINEX observation stream ----------------------------------------------
+* input observation data of next epoch from RINEX observation stream
+* args   : rnxobs_t *rnx   IO  RINEX observation stream
+*          obsd_t *data    O   observation data of an epoch (sorted by sat)
+*          int    nmax     I   max number of observation data
+* return : number of observation data (0: end of data)
+* notes  : the stream keeps one epoch read ahead to attach delayed event
+*          marks. obs data within DTTOL are merged to one epoch as sortobs().
+*          epochs going backward in time (e.g. overlapping files) are
+*          discarded since the stream can not sort them.
+*-----------------------------------------------------------------------------*/
+extern int input_rnxobs(rnxobs_t *rnx, obsd_t *data, int nmax)
+{
+    obs_t *obs=&rnx->obs;
+    double tt;
+    int i,n,nout;
+
+    trace(4,"input_rnxobs: rcv=%d\n",rnx->rcv);
+
+    for (;;) {
+        if (!rnx->fp&&!openobsfile(rnx)) {
+            return outobsepoch(rnx,data,nmax); /* end of data */
+        }
+        if ((n=readobsepoch(rnx))<0) {
+            closeobsfile(rnx);
+            continue;
+        }
+        if (n==0) continue;
+
+        tt=obs->n>0?timediff(rnx->data[0].time,obs->data[0].time):0.0;
+
+        if (tt<-DTTOL) {
+            trace(2,"rinex obs epoch out of order: rcv=%d\n",rnx->rcv);
+            continue;
+        }
+        nout=tt>DTTOL?outobsepoch(rnx,data,nmax):0;
+
+        for (i=0;i<n&&obs->n<obs->nmax;i++) {
+            obs->data[obs->n++]=rnx->data[i];
+        }
+        rnx->nobs+=n;
+
+        if (nout>0) return nout;
+    }
+}
+/*------------------------------------------------------------------------------
 * output RINEX functions
 *-----------------------------------------------------------------------------*/
 
@@ -2288,23 +2628,6 @@ extern int outrnxobsh(FILE *fp, const rnxopt_t *opt, const nav_t *nav)
     }
     return fprintf(fp,"%-60.60s%-20s\n","","END OF HEADER")!=EOF;
 }
-/* output observation data field ---------------------------------------------*/
-static void outrnxobsf(FILE *fp, double obs, int lli, int std)
-{
-    if (obs==0.0) {
-        fprintf(fp,"              ");
-    }
-    else {
-        fprintf(fp,"%14.3f",fmod(obs,1e9));
-    }
-    if (lli<0||!(lli&(LLI_SLIP|LLI_HALFC|LLI_BOCTRK))) {
-        fprintf(fp," ");
-    }
-    else {
-        fprintf(fp,"%1.1d",lli&(LLI_SLIP|LLI_HALFC|LLI_BOCTRK));
-    }
-    if (std<=0) fprintf(fp," "); else fprintf(fp,"%1.1x", std > 9 ? 9 : std);
-}
 /* search observation data index -------------------------------------------*/
 static int obsindex(int rnxver, int sys, const uint8_t *code, const char *tobs,
                     const char *mask)
@@ -2395,6 +2718,85 @@ static void outrinexevent(FILE *fp, const rnxopt_t *opt, const obsd_t *obs,
     }
     if (n) fprintf(fp,"%-60.60s%-20s\n"," Time mark is not valid","COMMENT");
 }
+/* output observation data field to buffer -----------------------------------*/
+static char *outrnxobsf(char *p, double obs, int lli, int std)
+{
+    uint64_t q;
+    double v,a,x,f;
+    char *q0=p+10;
+    int i;
+
+    if (obs==0.0) {
+        memset(p,' ',14); p+=14;
+    }
+    else {
+        v=fmod(obs,1e9);
+        a=fabs(v);
+        x=floor(a*1000.0);
+        f=a*1000.0-x;
+        q=(uint64_t)x+(f>0.5?1:0);
+
+        /* use printf near rounding boundary, for -0.000 and overflow */
+        if (!(a<1E9)||fabs(f-0.5)<1E-3||q==0||q>=999999999999ULL) {
+            p+=sprintf(p,"%14.3f",v);
+        }
+        else {
+            for (i=13;i>10;i--,q/=10) p[i]=(char)('0'+q%10);
+            p[10]='.';
+            do {
+                *--q0=(char)('0'+q%10);
+            } while (q/=10);
+            if (v<0.0) *--q0='-';
+            while (q0>p) *--q0=' ';
+            p+=14;
+        }
+    }
+    lli=lli<0?0:lli&(LLI_SLIP|LLI_HALFC|LLI_BOCTRK);
+    *p++=lli?(char)('0'+lli):' ';
+    *p++=std<=0?' ':(char)('0'+(std>9?9:std));
+    return p;
+}
+/* search observation data index by obs code map -----------------------------*/
+static int obsmapindex(const uint32_t *map, const uint8_t *code)
+{
+    int i,c;
+
+    for (i=0;i<NFREQ+NEXOBS;i++) {
+        if ((c=code[i])==CODE_NONE||c>MAXCODE) continue;
+        if ((map[c>>5]>>(c&31))&1) return i;
+    }
+    return -1;
+}
+/* set obs code maps of RINEX options ------------------------------------------
+* set obs code maps of RINEX options to find obs data of obs types without
+* searching obs type strings for every signal
+* args   : rnxopt_t *opt    IO  RINEX options
+* return : none
+* notes  : call after opt->rnxver, opt->tobs, opt->nobs and opt->mask are set.
+*          without the maps outrnxobsb() searches obs types as before.
+*-----------------------------------------------------------------------------*/
+extern void setrnxobsmap(rnxopt_t *opt)
+{
+    uint8_t code[NFREQ+NEXOBS]={0};
+    int i,j,m,c;
+
+    trace(3,"setrnxobsmap: rnxver=%d\n",opt->rnxver);
+
+    memset(opt->obsmap,0,sizeof(opt->obsmap));
+
+    for (i=0;i<RNX_NUMSYS;i++) {
+        m=(opt->rnxver<=299)?RNX_SYS_GPS:i;
+
+        for (j=0;j<opt->nobs[m]&&j<MAXOBSTYPE;j++) for (c=1;c<=MAXCODE;c++) {
+            code[0]=(uint8_t)c;
+            if (obsindex(opt->rnxver,navsys[i],code,opt->tobs[m][j],
+                         opt->mask[i])==0) {
+                opt->obsmap[i][j][c>>5]|=1u<<(c&31);
+            }
+        }
+    }
+    opt->obsmapset=1;
+}
 /* output RINEX observation data body ------------------------------------------
 * output RINEX observation data body
 * args   : FILE   *fp       I   output file pointer
@@ -2403,14 +2805,16 @@ static void outrinexevent(FILE *fp, const rnxopt_t *opt, const obsd_t *obs,
 *          int    n         I   number of observation data
 *          int    flag      I   epoch flag (0:ok,1:power failure,>1:event flag)
 * return : status (1:ok, 0:output error)
+* notes  : an epoch is formatted to a buffer and output by one fwrite().
+*          obs code maps are used if set by setrnxobsmap().
 *-----------------------------------------------------------------------------*/
 extern int outrnxobsb(FILE *fp, const rnxopt_t *opt, const obsd_t *obs, int n,
                       int flag)
 {
     const char *mask;
     double epdiff,ep[6],dL;
-    char sats[MAXOBS][4]={""};
-    int i,j,k,m,ns,sys,ind[MAXOBS],s[MAXOBS]={0};
+    char sats[MAXOBS][4]={""},*buff,*p;
+    int i,j,k,m,ns,sys,nmax=0,stat,ind[MAXOBS],s[MAXOBS]={0};
 
     trace(3,"outrnxobsb: n=%d\n",n);
 
@@ -2430,10 +2834,17 @@ extern int outrnxobsb(FILE *fp, const rnxopt_t *opt, const obsd_t *obs, int n,
             case SYS_IRN: s[ns]=RNX_SYS_IRN; break;
             default: continue;
         }
-        if (!opt->nobs[(opt->rnxver<=299)?RNX_SYS_GPS:s[ns]]) continue;
+        m=(opt->rnxver<=299)?RNX_SYS_GPS:s[ns];
+        if (!opt->nobs[m]) continue;
+        if (opt->nobs[m]>nmax) nmax=opt->nobs[m];
         ind[ns++]=i;
     }
     if (ns<=0) return 1;
+
+    /* epoch buffer (max 17 bytes per field) */
+    if (!(buff=(char *)malloc(128+ns*(40+nmax*18)))) return 0;
+    p=buff;
+
     /* if epoch of event less than epoch of observation, then first output
     time mark, else first output observation record */
     epdiff = timediff(obs[0].time,obs[0].eventime);
@@ -2441,16 +2852,16 @@ extern int outrnxobsb(FILE *fp, const rnxopt_t *opt, const obsd_t *obs, int n,
         outrinexevent(fp, opt, obs, epdiff);
     }
     if (opt->rnxver<=299) { /* ver.2 */
-        fprintf(fp," %02d %02.0f %02.0f %02.0f %02.0f %010.7f  %d%3d",
-                (int)ep[0]%100,ep[1],ep[2],ep[3],ep[4],ep[5],0,ns);
+        p+=sprintf(p," %02d %02.0f %02.0f %02.0f %02.0f %010.7f  %d%3d",
+                   (int)ep[0]%100,ep[1],ep[2],ep[3],ep[4],ep[5],0,ns);
         for (i=0;i<ns;i++) {
-            if (i>0&&i%12==0) fprintf(fp,"\n%32s","");
-            fprintf(fp,"%-3s",sats[i]);
+            if (i>0&&i%12==0) p+=sprintf(p,"\n%32s","");
+            p+=sprintf(p,"%-3s",sats[i]);
         }
     }
     else { /* ver.3 */
-        fprintf(fp,"> %04.0f %2.0f %2.0f %2.0f %2.0f%11.7f  %d%3d\n",
-                ep[0],ep[1],ep[2],ep[3],ep[4],ep[5],0,ns);
+        p+=sprintf(p,"> %04.0f %2.0f %2.0f %2.0f %2.0f%11.7f  %d%3d\n",
+                   ep[0],ep[1],ep[2],ep[3],ep[4],ep[5],0,ns);
     }
     for (i=0;i<ns;i++) {
         sys=satsys(obs[ind[i]].sat,NULL);
@@ -2460,19 +2871,20 @@ extern int outrnxobsb(FILE *fp, const rnxopt_t *opt, const obsd_t *obs, int n,
             mask=opt->mask[s[i]];
         }
         else { /* ver.3 */
-            fprintf(fp,"%-3s",sats[i]);
+            p+=sprintf(p,"%-3s",sats[i]);
             m=s[i];
             mask=opt->mask[m];
         }
         for (j=0;j<opt->nobs[m];j++) {
 
             if (opt->rnxver<=299) { /* ver.2 */
-                if (j%5==0) fprintf(fp,"\n");
+                if (j%5==0) *p++='\n';
             }
             /* search obs data index */
-            if ((k=obsindex(opt->rnxver,sys,obs[ind[i]].code,opt->tobs[m][j],
-                            mask))<0) {
-                outrnxobsf(fp,0.0,-1,-1);
+            k=opt->obsmapset?obsmapindex(opt->obsmap[s[i]][j],obs[ind[i]].code):
+                obsindex(opt->rnxver,sys,obs[ind[i]].code,opt->tobs[m][j],mask);
+            if (k<0) {
+                p=outrnxobsf(p,0.0,-1,-1);
                 continue;
             }
             /* phase shift (cyc) */
@@ -2481,10 +2893,10 @@ extern int outrnxobsb(FILE *fp, const rnxopt_t *opt, const obsd_t *obs, int n,
             /* output field */
             switch (opt->tobs[m][j][0]) {
                 case 'C':
-                case 'P': outrnxobsf(fp,obs[ind[i]].P[k],-1,obs[ind[i]].Pstd[k]); break;
-                case 'L': outrnxobsf(fp,obs[ind[i]].L[k]+dL,obs[ind[i]].LLI[k],obs[ind[i]].Lstd[k]); break;
-                case 'D': outrnxobsf(fp,obs[ind[i]].D[k],-1,-1); break;
-                case 'S': outrnxobsf(fp,obs[ind[i]].SNR[k]*SNR_UNIT,-1,-1); break;
+                case 'P': p=outrnxobsf(p,obs[ind[i]].P[k],-1,obs[ind[i]].Pstd[k]); break;
+                case 'L': p=outrnxobsf(p,obs[ind[i]].L[k]+dL,obs[ind[i]].LLI[k],obs[ind[i]].Lstd[k]); break;
+                case 'D': p=outrnxobsf(p,obs[ind[i]].D[k],-1,-1); break;
+                case 'S': p=outrnxobsf(p,obs[ind[i]].SNR[k]*SNR_UNIT,-1,-1); break;
             }
         }
 
@@ -2500,15 +2912,17 @@ extern int outrnxobsb(FILE *fp, const rnxopt_t *opt, const obsd_t *obs, int n,
         }
 #endif
 
-        if (opt->rnxver>=300&&fprintf(fp,"\n")==EOF) return 0;
+        if (opt->rnxver>=300) *p++='\n';
     }
+    if (opt->rnxver<=299) *p++='\n';
+
+    stat=fwrite(buff,1,p-buff,fp)==(size_t)(p-buff);
+    free(buff);
 
     if (flag == 5 && epdiff < 0) {
         outrinexevent(fp, opt, obs, epdiff);
     }
-    if (opt->rnxver>=300) return 1;
-
-    return fprintf(fp,"\n")!=EOF;
+    return stat;
 }
 /* output data field in RINEX navigation data --------------------------------*/
 static void outnavf_n(FILE *fp, double value, int n)
@@ -142,11 +142,30 @@
 *                           update obs code strings and priority table
 *                           use integer types in stdint.h
 *                           suppress warnings
+*           2026/10/19 1.46 add API init_navhash(),free_navhash(),add_navhash()
+*                           delete duplicated ephemerides by hash index and
+*                            sort them by satellite and toe in uniqnav()
+*                           add API setastro()
+*                           delete static cache in eci2ecef() (thread-safe)
+*                           add API init_rtkctx(),free_rtkctx(),getrtkctx(),
+*                            setrtkctx(),add_ctxclose()
+*                           move time offset, leap seconds and code
+*                            priorities to library context
+*                           add API settropsite(),tropmodel_batch(),
+*                            tropmapf_batch()
+*                           add API wsinit(),wsfree(),wsmat(),wsimat(),
+*                            wszeros(),wsmark(),wsrelease()
+*                           add API pvatrans()
+*                           index ephemerides by satellite in uniqnav()
+*                           move API rtkactstate() from rtkpos.c
+*                           add API matinv_ws(),solve_ws(),lsq_ws(),filter_ws()
+*                           add index of active states to filter_ws()
 *-----------------------------------------------------------------------------*/
 #define _POSIX_C_SOURCE 199506
 #include <stdarg.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stddef.h>
 #ifndef WIN32
 #include <dirent.h>
 #include <time.h>
@@ -162,33 +181,13 @@
 #define POLYCRC24Q  0x1864CFBu  /* CRC24Q polynomial */
 
 #define SQR(x)      ((x)*(x))
+#define MAX(x,y)    ((x)>(y)?(x):(y))
 #define MAX_VAR_EPH SQR(300.0)  /* max variance eph to reject satellite (m^2) */
 
 static const double gpst0[]={1980,1, 6,0,0,0}; /* gps time reference */
 static const double gst0 []={1999,8,22,0,0,0}; /* galileo system time reference */
 static const double bdt0 []={2006,1, 1,0,0,0}; /* beidou time reference */
 
-static double leaps[MAXLEAPS+1][7]={ /* leap seconds (y,m,d,h,m,s,utc-gpst) */
-    {2017,1,1,0,0,0,-18},
-    {2015,7,1,0,0,0,-17},
-    {2012,7,1,0,0,0,-16},
-    {2009,1,1,0,0,0,-15},
-    {2006,1,1,0,0,0,-14},
-    {1999,1,1,0,0,0,-13},
-    {1997,7,1,0,0,0,-12},
-    {1996,1,1,0,0,0,-11},
-    {1994,7,1,0,0,0,-10},
-    {1993,7,1,0,0,0, -9},
-    {1992,7,1,0,0,0, -8},
-    {1991,1,1,0,0,0, -7},
-    {1990,1,1,0,0,0, -6},
-    {1988,1,1,0,0,0, -5},
-    {1985,7,1,0,0,0, -4},
-    {1983,7,1,0,0,0, -3},
-    {1982,7,1,0,0,0, -2},
-    {1981,7,1,0,0,0, -1},
-    {0}
-};
 const double chisqr[100]={      /* chi-sqr(n) (alpha=0.001) */
     10.8,13.8,16.3,18.5,20.5,22.5,24.3,26.1,27.9,29.6,
     31.3,32.9,34.5,36.1,37.7,39.3,40.8,42.3,43.8,45.3,
@@ -266,16 +265,46 @@ static char *obscodes[MAXCODE + 1]={       /* observation code strings */
     "6E","7D","7P","7Z","8D", "8P","4A","4B","4X","6D", /* 60-69 */
     "6P"
 };
-static char codepris[7][MAXFREQ][16]={  /* code priority for each freq-index */
-    /* L1/E1/B1 L2/E5b/B2b L5/E5a/B2a E6/LEX/B3 E5(a+b)         */
-    {"CPYWMNSLX","CPYWMNDLSX","IQX"    ,""       ,""       ,""}, /* GPS */
-    {"CPABX"   ,"CPABX"     ,"IQX"     ,""       ,""       ,""}, /* GLO */
-    {"CABXZ"   ,"XIQ"       ,"XIQ"     ,"ABCXZ"  ,"IQX"    ,""}, /* GAL */
-    {"CLSXZBE" ,"LSX"       ,"IQXDPZ"  ,"LSXEZ"  ,""       ,""}, /* QZS */
-    {"C"       ,"IQX"       ,""        ,""       ,""       ,""}, /* SBS */
-    {"IQXDPSLZAN","IQXDPZ"  ,"DPX"     ,"IQXDPZA" ,"DPX"    ,""}, /* BDS */
-    {"ABCX"    ,"ABCX"      ,"DPX"     ,""       ,""       ,""}  /* IRN */
+static rtkctx_t rtkctx_def={ /* default library context */
+    0.0,                        /* time offset of timeget() (s) */
+    {                           /* leap seconds (y,m,d,h,m,s,utc-gpst) */
+        {2017,1,1,0,0,0,-18},
+        {2015,7,1,0,0,0,-17},
+        {2012,7,1,0,0,0,-16},
+        {2009,1,1,0,0,0,-15},
+        {2006,1,1,0,0,0,-14},
+        {1999,1,1,0,0,0,-13},
+        {1997,7,1,0,0,0,-12},
+        {1996,1,1,0,0,0,-11},
+        {1994,7,1,0,0,0,-10},
+        {1993,7,1,0,0,0, -9},
+        {1992,7,1,0,0,0, -8},
+        {1991,1,1,0,0,0, -7},
+        {1990,1,1,0,0,0, -6},
+        {1988,1,1,0,0,0, -5},
+        {1985,7,1,0,0,0, -4},
+        {1983,7,1,0,0,0, -3},
+        {1982,7,1,0,0,0, -2},
+        {1981,7,1,0,0,0, -1},
+        {0}
+    },
+    {                           /* code priority for each freq-index */
+        /* L1/E1/B1 L2/E5b/B2b L5/E5a/B2a E6/LEX/B3 E5(a+b)         */
+        {"CPYWMNSLX","CPYWMNDLSX","IQX"    ,""       ,""       ,""}, /* GPS */
+        {"CPABX"   ,"CPABX"     ,"IQX"     ,""       ,""       ,""}, /* GLO */
+        {"CABXZ"   ,"XIQ"       ,"XIQ"     ,"ABCXZ"  ,"IQX"    ,""}, /* GAL */
+        {"CLSXZBE" ,"LSX"       ,"IQXDPZ"  ,"LSXEZ"  ,""       ,""}, /* QZS */
+        {"C"       ,"IQX"       ,""        ,""       ,""       ,""}, /* SBS */
+        {"IQXDPSLZAN","IQXDPZ"  ,"DPX"     ,"IQXDPZA" ,"DPX"    ,""}, /* BDS */
+        {"ABCX"    ,"ABCX"      ,"DPX"     ,""       ,""       ,""}  /* IRN */
+    },
+    {0,0,0,0,0,0,0},            /* ephemeris selections */
+    0,NULL,"",{0},              /* rtk status output */
+    GEOID_EMBEDDED,NULL,        /* geoid model and data */
+    NULL,0,                     /* datum trans parameters */
+    {NULL},0                    /* close functions of resources */
 };
+static THREADLOCAL rtkctx_t *rtkctx_cur=NULL; /* context bound to thread */
 static fatalfunc_t *fatalfunc=NULL; /* fatal callback function */
 
 /* crc tables generated by util/gencrc ---------------------------------------*/
@@ -788,6 +817,8 @@ extern double sat2freq(int sat, uint8_t code, const nav_t *nav)
 *-----------------------------------------------------------------------------*/
 extern void setcodepri(int sys, int idx, const char *pri)
 {
+    char (*codepris)[MAXFREQ][16]=getrtkctx()->codepris;
+
     trace(3,"setcodepri:sys=%d idx=%d pri=%s\n",sys,idx,pri);
 
     if (idx<0||idx>=MAXFREQ) return;
@@ -808,7 +839,7 @@ extern void setcodepri(int sys, int idx, const char *pri)
 *-----------------------------------------------------------------------------*/
 extern int getcodepri(int sys, uint8_t code, const char *opt)
 {
-    const char *p,*optstr;
+    const char *p,*optstr,*pri;
     char *obs,str[8]="";
     int i,j;
 
@@ -831,7 +862,8 @@ extern int getcodepri(int sys, uint8_t code, const char *opt)
         return str[1]==obs[1]?15:0;
     }
     /* search code priority */
-    return (p=strchr(codepris[i][j],obs[1]))?14-(int)(p-codepris[i][j]):0;
+    pri=getrtkctx()->codepris[i][j];
+    return (p=strchr(pri,obs[1]))?14-(int)(p-pri):0;
 }
 /* extract unsigned/signed bits ------------------------------------------------
 * extract unsigned/signed bits from byte data
@@ -1025,6 +1057,150 @@ extern double *eye(int n)
     if ((p=zeros(n,n))) for (i=0;i<n;i++) p[i+i*n]=1.0;
     return p;
 }
+/* new workspace block -------------------------------------------------------*/
+static wsblk_t *newwsblk(wspace_t *ws, size_t size)
+{
+    wsblk_t *b;
+    
+    if (!(b=(wsblk_t *)malloc(sizeof(wsblk_t)))||
+        !(b->data=(double *)malloc(sizeof(double)*size))) {
+        fatalerr("workspace memory allocation error: size=%lu\n",
+                 (unsigned long)size);
+        free(b);
+        return NULL;
+    }
+    b->size=size;
+    b->next=NULL;
+    ws->nalloc++;
+    return b;
+}
+/* initialize workspace --------------------------------------------------------
+* initialize workspace arena of scratch matrices
+* args   : wspace_t *ws     O   workspace
+*          size_t size      I   size of first block (doubles)
+* return : status (1:ok,0:memory allocation error)
+* notes  : the matrices are allocated in stack order by wsmat(),wsimat() and
+*          wszeros() and released by wsrelease() to the mark by wsmark().
+*          if a block is short, a new block is added and kept until wsfree(),
+*          so no heap allocation occurs after the max size is reached.
+*-----------------------------------------------------------------------------*/
+extern int wsinit(wspace_t *ws, size_t size)
+{
+    ws->top=ws->cur=NULL;
+    ws->used=0;
+    ws->size=size>0?size:1;
+    ws->nalloc=0;
+    
+    if (!(ws->top=ws->cur=newwsblk(ws,ws->size))) return 0;
+    return 1;
+}
+/* free workspace --------------------------------------------------------------
+* free memory of workspace arena
+* args   : wspace_t *ws     IO  workspace
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void wsfree(wspace_t *ws)
+{
+    wsblk_t *b,*next;
+    
+    for (b=ws->top;b;b=next) {
+        next=b->next;
+        free(b->data); free(b);
+    }
+    ws->top=ws->cur=NULL;
+    ws->used=0;
+}
+/* allocate from workspace ---------------------------------------------------*/
+static double *wsalloc(wspace_t *ws, size_t size)
+{
+    wsblk_t *b;
+    double *p;
+    
+    if (!ws->cur) {
+        if (!ws->top&&!(ws->top=newwsblk(ws,MAX(ws->size,size)))) return NULL;
+        ws->cur=ws->top;
+        ws->used=0;
+    }
+    if (ws->cur->size-ws->used<size) {
+        
+        /* insert new block if next block is short */
+        if (!ws->cur->next||ws->cur->next->size<size) {
+            if (!(b=newwsblk(ws,MAX(ws->size,size)))) return NULL;
+            b->next=ws->cur->next;
+            ws->cur->next=b;
+        }
+        ws->cur=ws->cur->next;
+        ws->used=0;
+    }
+    p=ws->cur->data+ws->used;
+    ws->used+=size;
+    return p;
+}
+/* new matrix in workspace -----------------------------------------------------
+* allocate matrix in workspace arena
+* args   : wspace_t *ws     IO  workspace
+*          int    n,m       I   number of rows and columns of matrix
+* return : matrix pointer (if n<=0 or m<=0, return NULL)
+* notes  : the matrix is valid until wsrelease() to the mark before it
+*-----------------------------------------------------------------------------*/
+extern double *wsmat(wspace_t *ws, int n, int m)
+{
+    if (n<=0||m<=0) return NULL;
+    return wsalloc(ws,(size_t)n*m);
+}
+/* new integer matrix in workspace ---------------------------------------------
+* allocate integer matrix in workspace arena
+* args   : wspace_t *ws     IO  workspace
+*          int    n,m       I   number of rows and columns of matrix
+* return : matrix pointer (if n<=0 or m<=0, return NULL)
+*-----------------------------------------------------------------------------*/
+extern int *wsimat(wspace_t *ws, int n, int m)
+{
+    size_t size=sizeof(int)*n*m;
+    
+    if (n<=0||m<=0) return NULL;
+    return (int *)wsalloc(ws,(size+sizeof(double)-1)/sizeof(double));
+}
+/* zero matrix in workspace ----------------------------------------------------
+* allocate zero matrix in workspace arena
+* args   : wspace_t *ws     IO  workspace
+*          int    n,m       I   number of rows and columns of matrix
+* return : matrix pointer (if n<=0 or m<=0, return NULL)
+*-----------------------------------------------------------------------------*/
+extern double *wszeros(wspace_t *ws, int n, int m)
+{
+    double *p;
+    
+    if ((p=wsmat(ws,n,m))) memset(p,0,sizeof(double)*n*m);
+    return p;
+}
+/* mark workspace --------------------------------------------------------------
+* get current position of workspace arena
+* args   : wspace_t *ws     I   workspace
+* return : mark of workspace
+*-----------------------------------------------------------------------------*/
+extern size_t wsmark(const wspace_t *ws)
+{
+    const wsblk_t *b;
+    size_t mark=0;
+    
+    for (b=ws->top;b&&b!=ws->cur;b=b->next) mark+=b->size;
+    return mark+(ws->cur?ws->used:0);
+}
+/* release workspace -----------------------------------------------------------
+* release matrices allocated in workspace arena after mark
+* args   : wspace_t *ws     IO  workspace
+*          size_t mark      I   mark of workspace by wsmark()
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void wsrelease(wspace_t *ws, size_t mark)
+{
+    wsblk_t *b;
+    
+    for (b=ws->top;b&&b->next&&mark>b->size;b=b->next) mark-=b->size;
+    ws->cur=b;
+    ws->used=b?mark:0;
+}
 
 /* dot product -----------------------------------------------------------------
  * inner product of vectors of size 2
@@ -1150,6 +1326,23 @@ extern void matmulm(const char *tr, int n, int k, int m,
     dgemm_((char *)tr,(char *)tr+1,&n,&k,&m,&alpha,(double *)A,&lda,(double *)B,
            &ldb,&beta,C,&n);
 }
+/* inverse of matrix with scratch memory ------------------------------------*/
+static int matinv_(double *A, int n, int *ipiv, double *work)
+{
+    int info,lwork=n*16;
+
+    dgetrf_(&n,&n,A,&n,ipiv,&info);
+    if (!info) dgetri_(&n,A,&n,ipiv,work,&lwork,&info);
+    return info;
+}
+/* inverse of 4x4 matrix without heap memory ---------------------------------*/
+static int matinv4(double *A)
+{
+    double work[64];
+    int ipiv[4];
+
+    return matinv_(A,4,ipiv,work);
+}
 /* inverse of matrix -----------------------------------------------------------
 * inverse of matrix (A=A^-1)
 * args   : double *A        IO  matrix (n x n)
@@ -1158,15 +1351,29 @@ extern void matmulm(const char *tr, int n, int k, int m,
 *-----------------------------------------------------------------------------*/
 extern int matinv(double *A, int n)
 {
-    double *work;
-    int info,lwork=n*16,*ipiv=imat(n,1);
+    double *work=mat(n*16,1);
+    int info,*ipiv=imat(n,1);
 
-    work=mat(lwork,1);
-    dgetrf_(&n,&n,A,&n,ipiv,&info);
-    if (!info) dgetri_(&n,A,&n,ipiv,work,&lwork,&info);
+    info=matinv_(A,n,ipiv,work);
     free(ipiv); free(work);
     return info;
 }
+/* inverse of matrix in workspace ---------------------------------------------
+* inverse of matrix (A=A^-1) with scratch memory in workspace
+* args   : double *A        IO  matrix (n x n)
+*          int    n         I   size of matrix A
+*          wspace_t *ws     IO  workspace
+* return : status (0:ok,0>:error)
+*-----------------------------------------------------------------------------*/
+extern int matinv_ws(double *A, int n, wspace_t *ws)
+{
+    size_t mark=wsmark(ws);
+    int info;
+
+    info=matinv_(A,n,wsimat(ws,n,1),wsmat(ws,n*16,1));
+    wsrelease(ws,mark);
+    return info;
+}
 /* solve linear equation -------------------------------------------------------
 * solve linear equation (X=A\Y or X=A'\Y)
 * args   : char   *tr       I   transpose flag ("N":normal,"T":transpose)
@@ -1178,19 +1385,47 @@ extern int matinv(double *A, int n)
 * notes  : matrix stored by column-major order (fortran convention)
 *          X can be same as Y
 *-----------------------------------------------------------------------------*/
-extern int solve(const char *tr, const double *A, const double *Y, int n,
-                 int m, double *X)
+static int solve_(const char *tr, const double *A, const double *Y, int n,
+                  int m, double *X, double *B, int *ipiv)
 {
-    double *B=mat(n,n);
-    int info,*ipiv=imat(n,1);
+    int info;
 
     matcpy(B,A,n,n);
     matcpy(X,Y,n,m);
     dgetrf_(&n,&n,B,&n,ipiv,&info);
     if (!info) dgetrs_((char *)tr,&n,&m,B,&n,ipiv,X,&n,&info);
+    return info;
+}
+extern int solve(const char *tr, const double *A, const double *Y, int n,
+                 int m, double *X)
+{
+    double *B=mat(n,n);
+    int info,*ipiv=imat(n,1);
+
+    info=solve_(tr,A,Y,n,m,X,B,ipiv);
     free(ipiv); free(B);
     return info;
 }
+/* solve linear equation in workspace ------------------------------------------
+* solve linear equation (X=A\Y or X=A'\Y) with scratch memory in workspace
+* args   : char   *tr       I   transpose flag ("N":normal,"T":transpose)
+*          double *A        I   input matrix A (n x n)
+*          double *Y        I   input matrix Y (n x m)
+*          int    n,m       I   size of matrix A,Y
+*          double *X        O   X=A\Y or X=A'\Y (n x m)
+*          wspace_t *ws     IO  workspace
+* return : status (0:ok,0>:error)
+*-----------------------------------------------------------------------------*/
+extern int solve_ws(const char *tr, const double *A, const double *Y, int n,
+                    int m, double *X, wspace_t *ws)
+{
+    size_t mark=wsmark(ws);
+    int info;
+
+    info=solve_(tr,A,Y,n,m,X,wsmat(ws,n,n),wsimat(ws,n,1));
+    wsrelease(ws,mark);
+    return info;
+}
 
 #else /* without LAPACK/BLAS or MKL */
 
@@ -1328,15 +1563,15 @@ extern void matmulm(const char *tr, int n, int k, int m,
     }
 }
 /* LU decomposition ----------------------------------------------------------*/
-static int ludcmp(double *A, int n, int *indx, double *d)
+static int ludcmp(double *A, int n, int *indx, double *d, double *vv)
 {
-    double big,s,tmp,*vv=mat(n,1);
+    double big,s,tmp;
     int i,imax=0,j,k;
 
     *d=1.0;
     for (i=0;i<n;i++) {
         big=0.0; for (j=0;j<n;j++) if ((tmp=fabs(A[i+j*n]))>big) big=tmp;
-        if (big>0.0) vv[i]=1.0/big; else {free(vv); return -1;}
+        if (big>0.0) vv[i]=1.0/big; else return -1;
     }
     for (j=0;j<n;j++) {
         for (i=0;i<j;i++) {
@@ -1354,12 +1589,11 @@ static int ludcmp(double *A, int n, int *indx, double *d)
             *d=-(*d); vv[imax]=vv[j];
         }
         indx[j]=imax;
-        if (A[j+j*n]==0.0) {free(vv); return -1;}
+        if (A[j+j*n]==0.0) return -1;
         if (j!=n-1) {
             tmp=1.0/A[j+j*n]; for (i=j+1;i<n;i++) A[i+j*n]*=tmp;
         }
     }
-    free(vv);
     return 0;
 }
 /* LU back-substitution ------------------------------------------------------*/
@@ -1377,22 +1611,49 @@ static void lubksb(const double *A, int n, const int *indx, double *b)
         s=b[i]; for (j=i+1;j<n;j++) s-=A[i+j*n]*b[j]; b[i]=s/A[i+i*n];
     }
 }
-/* inverse of matrix ---------------------------------------------------------*/
-extern int matinv(double *A, int n)
+/* inverse of matrix with scratch memory ------------------------------------*/
+static int matinv_(double *A, int n, int *indx, double *B, double *vv)
 {
-    double d,*B;
-    int i,j,*indx;
+    double d;
+    int i,j;
 
-    indx=imat(n,1); B=mat(n,n); matcpy(B,A,n,n);
-    if (ludcmp(B,n,indx,&d)) {free(indx); free(B); return -1;}
+    matcpy(B,A,n,n);
+    if (ludcmp(B,n,indx,&d,vv)) return -1;
     for (j=0;j<n;j++) {
         for (i=0;i<n;i++) A[i+j*n]=0.0;
         A[j+j*n]=1.0;
         lubksb(B,n,indx,A+j*n);
     }
-    free(indx); free(B);
     return 0;
 }
+/* inverse of 4x4 matrix without heap memory ---------------------------------*/
+static int matinv4(double *A)
+{
+    double B[16],vv[4];
+    int indx[4];
+
+    return matinv_(A,4,indx,B,vv);
+}
+/* inverse of matrix ---------------------------------------------------------*/
+extern int matinv(double *A, int n)
+{
+    double *B=mat(n,n),*vv=mat(n,1);
+    int info,*indx=imat(n,1);
+
+    info=matinv_(A,n,indx,B,vv);
+    free(indx); free(B); free(vv);
+    return info;
+}
+/* inverse of matrix in workspace --------------------------------------------*/
+extern int matinv_ws(double *A, int n, wspace_t *ws)
+{
+    size_t mark=wsmark(ws);
+    int info;
+
+    info=matinv_(A,n,wsimat(ws,n,1),wsmat(ws,n,n),wsmat(ws,n,1));
+    wsrelease(ws,mark);
+    return info;
+}
 /* solve linear equation -----------------------------------------------------*/
 extern int solve(const char *tr, const double *A, const double *Y, int n,
                  int m, double *X)
@@ -1405,6 +1666,19 @@ extern int solve(const char *tr, const double *A, const double *Y, int n,
     free(B);
     return info;
 }
+/* solve linear equation in workspace ----------------------------------------*/
+extern int solve_ws(const char *tr, const double *A, const double *Y, int n,
+                    int m, double *X, wspace_t *ws)
+{
+    size_t mark=wsmark(ws);
+    double *B=wsmat(ws,n,n);
+    int info;
+
+    matcpy(B,A,n,n);
+    if (!(info=matinv_ws(B,n,ws))) matmul(tr[0]=='N'?"NN":"TN",n,m,n,B,Y,X);
+    wsrelease(ws,mark);
+    return info;
+}
 #endif
 
 /* end of matrix routines ----------------------------------------------------*/
@@ -1434,6 +1708,28 @@ extern int lsq(const double *A, const double *y, int n, int m, double *x,
     free(Ay);
     return info;
 }
+/* least square estimation in workspace ----------------------------------------
+* least square estimation with scratch memory in workspace
+* args   : double *A,*y,n,m,*x,*Q  same as lsq()
+*          wspace_t *ws     IO  workspace
+* return : status (0:ok,0>:error)
+*-----------------------------------------------------------------------------*/
+extern int lsq_ws(const double *A, const double *y, int n, int m, double *x,
+                  double *Q, wspace_t *ws)
+{
+    size_t mark;
+    double *Ay;
+    int info;
+
+    if (m<n) return -1;
+    mark=wsmark(ws);
+    Ay=wsmat(ws,n,1);
+    matmul("NN",n,1,m,A,y,Ay); /* Ay=A*y */
+    matmul("NT",n,n,m,A,A,Q);  /* Q=A*A' */
+    if (!(info=matinv_ws(Q,n,ws))) matmul("NN",n,1,n,Q,Ay,x); /* x=Q^-1*Ay */
+    wsrelease(ws,mark);
+    return info;
+}
 /* kalman filter ---------------------------------------------------------------
 * kalman filter state update as follows:
 *
@@ -1453,33 +1749,74 @@ extern int lsq(const double *A, const double *y, int n, int m, double *x,
 *-----------------------------------------------------------------------------*/
 static int filter_(const double *x, const double *P, const double *H,
                    const double *v, const double *R, int n, int m,
-                   double *xp, double *Pp)
+                   double *xp, double *Pp, wspace_t *ws)
 {
-    double *F=mat(n,m),*Q=mat(m,m),*K=mat(n,m),*I=eye(n);
-    int info;
+    double *F=wsmat(ws,n,m),*Q=wsmat(ws,m,m),*K=wsmat(ws,n,m);
+    double *I=wszeros(ws,n,n);
+    int i,info;
 
+    for (i=0;i<n;i++) I[i+i*n]=1.0;
     matcpy(Q,R,m,m);
     matcpy(xp,x,n,1);
     matmul("NN",n,m,n,P,H,F);       /* Q=H'*P*H+R */
     matmulp("TN",m,m,n,H,F,Q);
-    if (!(info=matinv(Q,m))) {
+    if (!(info=matinv_ws(Q,m,ws))) {
         matmul("NN",n,m,m,F,Q,K);   /* K=P*H*Q^-1 */
         matmulp("NN",n,1,m,K,v,xp);  /* xp=x+K*v */
         matmulm("NT",n,n,m,K,H,I);  /* Pp=(I-K*H')*P */
         matmul("NN",n,n,n,I,P,Pp);
     }
-    free(F); free(Q); free(K); free(I);
     return info;
 }
 extern int filter(double *x, double *P, const double *H, const double *v,
                   const double *R, int n, int m)
 {
+    wspace_t ws;
+    int i,k,info;
+
+    /* workspace for non-zero states */
+    for (i=k=0;i<n;i++) if (x[i]!=0.0&&P[i+i*n]>0.0) k++;
+    if (!wsinit(&ws,(size_t)k*(3*k+3*m+2)+(size_t)m*(2*m+2)+n)) return -1;
+    info=filter_ws(x,P,H,v,R,n,m,NULL,0,&ws);
+    wsfree(&ws);
+    return info;
+}
+/* kalman filter in workspace --------------------------------------------------
+* kalman filter state update with scratch memory in workspace
+* args   : double *x,*P,*H,*v,*R,n,m  same as filter()
+*          int    *ixs      I   indexes of active states (nxs x 1)
+*                               (NULL: search non-zero states in x)
+*          int    nxs       I   number of active states
+*          wspace_t *ws     IO  workspace
+* return : status (0:ok,<0:error)
+* notes  : no heap memory is allocated once the workspace has grown to the
+*          size of the compressed matrices of the non-zero states
+*          with ixs, only the listed states are examined and updated, so the
+*          cost of the index does not depend on n. ixs must include all
+*          non-zero states in x (ex. rtk->ixs by rtkactstate())
+*-----------------------------------------------------------------------------*/
+extern int filter_ws(double *x, double *P, const double *H, const double *v,
+                     const double *R, int n, int m, const int *ixs, int nxs,
+                     wspace_t *ws)
+{
+    size_t mark=wsmark(ws);
     double *x_,*xp_,*P_,*Pp_,*H_;
     int i,j,k,info,*ix;
 
     /* create list of non-zero states */
-    ix=imat(n,1); for (i=k=0;i<n;i++) if (x[i]!=0.0&&P[i+i*n]>0.0) ix[k++]=i;
-    x_=mat(k,1); xp_=mat(k,1); P_=mat(k,k); Pp_=mat(k,k); H_=mat(k,m);
+    if (ixs) {
+        ix=wsimat(ws,nxs,1);
+        for (i=k=0;i<nxs;i++) {
+            j=ixs[i];
+            if (x[j]!=0.0&&P[j+j*n]>0.0) ix[k++]=j;
+        }
+    }
+    else {
+        ix=wsimat(ws,n,1);
+        for (i=k=0;i<n;i++) if (x[i]!=0.0&&P[i+i*n]>0.0) ix[k++]=i;
+    }
+    x_=wsmat(ws,k,1); xp_=wsmat(ws,k,1); P_=wsmat(ws,k,k); Pp_=wsmat(ws,k,k);
+    H_=wsmat(ws,k,m);
     /* compress array by removing zero elements to save computation time */
     for (i=0;i<k;i++) {
         x_[i]=x[ix[i]];
@@ -1487,13 +1824,13 @@ extern int filter(double *x, double *P, const double *H, const double *v,
         for (j=0;j<m;j++) H_[i+j*k]=H[ix[i]+j*n];
     }
     /* do kalman filter state update on compressed arrays */
-    info=filter_(x_,P_,H_,v,R,k,m,xp_,Pp_);
+    info=filter_(x_,P_,H_,v,R,k,m,xp_,Pp_,ws);
     /* copy values from compressed arrays back to full arrays */
     for (i=0;i<k;i++) {
         x[ix[i]]=xp_[i];
         for (j=0;j<k;j++) P[ix[i]+ix[j]*n]=Pp_[i+j*k];
     }
-    free(ix); free(x_); free(xp_); free(P_); free(Pp_); free(H_);
+    wsrelease(ws,mark);
     return info;
 }
 /* smoother --------------------------------------------------------------------
@@ -1531,6 +1868,80 @@ extern int smoother(const double *xf, const double *Qf, const double *xb,
     free(invQf); free(invQb); free(xx);
     return info;
 }
+/* state transition of position/velocity/acceleration --------------------------
+* state transition x=F*x, P=F*P*F' in place, where F=I except F(i,i+3)=tt
+* (i=0-5) and F(i,i+6)=ta (i=0-2)
+* args   : double *x        IO  states (n x 1)
+*          double *P        IO  covariance matrix of states (n x n)
+*          int    n         I   number of states
+*          int    *ix       I   indexes of active states including 0-8 (nix x 1)
+*          int    nix       I   number of active states
+*          double tt        I   time interval (s)
+*          double ta        I   coefficient of acceleration (0.0: no accel)
+* return : none
+* notes  : only rows and columns 0-5 of active states are updated in ascending
+*          order, so row/column i refers to rows/columns i+3,i+6 not yet
+*          updated. it costs O(6*nix) instead of O(nix^3) of dense products.
+*          matrix stored by column-major order (fortran convention)
+*-----------------------------------------------------------------------------*/
+extern void pvatrans(double *x, double *P, int n, const int *ix, int nix,
+                     double tt, double ta)
+{
+    int i,j,k;
+
+    for (i=0;i<6;i++) {
+        x[i]+=tt*x[i+3];
+        if (i<3&&ta!=0.0) x[i]+=ta*x[i+6];
+    }
+    for (i=0;i<6;i++) for (k=0;k<nix;k++) { /* F*P */
+        j=ix[k];
+        P[i+j*n]+=tt*P[i+3+j*n];
+        if (i<3&&ta!=0.0) P[i+j*n]+=ta*P[i+6+j*n];
+    }
+    for (j=0;j<6;j++) for (k=0;k<nix;k++) { /* (F*P)*F' */
+        i=ix[k];
+        P[i+j*n]+=tt*P[i+(j+3)*n];
+        if (j<3&&ta!=0.0) P[i+j*n]+=ta*P[i+(j+6)*n];
+    }
+}
+/* update active state index ---------------------------------------------------
+* update index of active states after the state is set or reset
+* args   : rtk_t    *rtk    IO  rtk control/result struct
+*          int      i       I   state index
+* return : none
+* notes  : the active states are the states with non-zero values. the indices
+*          are kept in ascending order in rtk->ixs and the position of a state
+*          in rtk->ixs is in rtk->pxs. the index is updated only when a state
+*          is set or reset, not on every filter update. call it after a state
+*          is changed from/to zero outside of the kalman filter.
+*-----------------------------------------------------------------------------*/
+extern void rtkactstate(rtk_t *rtk, int i)
+{
+    int j,act;
+
+    if (!rtk->ixs||i<0||i>=rtk->nx) return;
+
+    act=rtk->x[i]!=0.0;
+    if (act==(rtk->pxs[i]>=0)) return;
+
+    if (act) { /* insert state */
+        for (j=rtk->nxs;j>0&&rtk->ixs[j-1]>i;j--) {
+            rtk->ixs[j]=rtk->ixs[j-1];
+            rtk->pxs[rtk->ixs[j]]=j;
+        }
+        rtk->ixs[j]=i;
+        rtk->pxs[i]=j;
+        rtk->nxs++;
+    }
+    else { /* remove state */
+        for (j=rtk->pxs[i];j<rtk->nxs-1;j++) {
+            rtk->ixs[j]=rtk->ixs[j+1];
+            rtk->pxs[rtk->ixs[j]]=j;
+        }
+        rtk->pxs[i]=-1;
+        rtk->nxs--;
+    }
+}
 /* print matrix ----------------------------------------------------------------
 * print matrix to stdout
 * args   : double *A        I   matrix A (n x m)
@@ -1765,9 +2176,9 @@ extern double timediff(gtime_t t1, gtime_t t2)
 * get current time in utc
 * args   : none
 * return : current time in utc
+* notes  : the time offset set by timeset() is taken from the library context
+*          of the calling thread
 *-----------------------------------------------------------------------------*/
-static double timeoffset_=0.0;        /* time offset (s) */
-
 extern gtime_t timeget(void)
 {
     gtime_t time;
@@ -1792,7 +2203,7 @@ extern gtime_t timeget(void)
 #ifdef CPUTIME_IN_GPST /* cputime operated in gpst */
     time=gpst2utc(time);
 #endif
-    return timeadd(time,timeoffset_);
+    return timeadd(time,getrtkctx()->timeoffset);
 }
 /* set current time in utc -----------------------------------------------------
 * set current time in utc
@@ -1800,11 +2211,11 @@ extern gtime_t timeget(void)
 * return : none
 * notes  : just set time offset between cpu time and current time
 *          the time offset is reflected to only timeget()
-*          not reentrant
+*          the time offset is kept in the library context of the calling thread
 *-----------------------------------------------------------------------------*/
 extern void timeset(gtime_t t)
 {
-    timeoffset_+=timediff(t,timeget());
+    getrtkctx()->timeoffset+=timediff(t,timeget());
 }
 /* reset current time ----------------------------------------------------------
 * reset current time
@@ -1813,10 +2224,10 @@ extern void timeset(gtime_t t)
 *-----------------------------------------------------------------------------*/
 extern void timereset(void)
 {
-    timeoffset_=0.0;
+    getrtkctx()->timeoffset=0.0;
 }
 /* read leap seconds table by text -------------------------------------------*/
-static int read_leaps_text(FILE *fp)
+static int read_leaps_text(FILE *fp, double (*leaps)[7])
 {
     char buff[256],*p;
     int i,n=0,ep[6],ls;
@@ -1833,7 +2244,7 @@ static int read_leaps_text(FILE *fp)
     return n;
 }
 /* read leap seconds table by usno -------------------------------------------*/
-static int read_leaps_usno(FILE *fp)
+static int read_leaps_usno(FILE *fp, double (*leaps)[7])
 {
     static const char *months[]={
         "JAN","FEB","MAR","APR","MAY","JUN","JUL","AUG","SEP","OCT","NOV","DEC"
@@ -1870,16 +2281,18 @@ static int read_leaps_usno(FILE *fp)
 *              year month day hour min sec UTC-GPST(s)
 *          (2) The date and time indicate the start UTC time for the UTC-GPST
 *          (3) The date and time should be descending order.
+*          the table is read to the library context of the calling thread
 *-----------------------------------------------------------------------------*/
 extern int read_leaps(const char *file)
 {
+    double (*leaps)[7]=getrtkctx()->leaps;
     FILE *fp;
     int i,n;
 
     if (!(fp=fopen(file,"r"))) return 0;
 
     /* read leap seconds table by text or usno */
-    if (!(n=read_leaps_text(fp))&&!(n=read_leaps_usno(fp))) {
+    if (!(n=read_leaps_text(fp,leaps))&&!(n=read_leaps_usno(fp,leaps))) {
         fclose(fp);
         return 0;
     }
@@ -1887,6 +2300,100 @@ extern int read_leaps(const char *file)
     fclose(fp);
     return 1;
 }
+/* initialize library context -------------------------------------------------
+* initialize library context
+* args   : rtkctx_t *ctx    O   library context
+* return : none
+* notes  : the leap seconds table, the code priorities and the ephemeris
+*          selections are copied from the default context. the time offset,
+*          the rtk status file, the geoid file and the datum parameters are
+*          not shared and have to be set with the context bound by setrtkctx()
+*-----------------------------------------------------------------------------*/
+extern void init_rtkctx(rtkctx_t *ctx)
+{
+    gtime_t time0={0};
+
+    trace(3,"init_rtkctx:\n");
+
+    memcpy(ctx->leaps,rtkctx_def.leaps,sizeof(ctx->leaps));
+    memcpy(ctx->codepris,rtkctx_def.codepris,sizeof(ctx->codepris));
+    memcpy(ctx->eph_sel,rtkctx_def.eph_sel,sizeof(ctx->eph_sel));
+    ctx->timeoffset=0.0;
+    ctx->statlevel=0;
+    ctx->fp_stat=NULL;
+    ctx->file_stat[0]='\0';
+    ctx->time_stat=time0;
+    ctx->model_geoid=GEOID_EMBEDDED;
+    ctx->geoid=NULL;
+    ctx->datum=NULL;
+    ctx->ndatum=0;
+    ctx->nclose=0;
+}
+/* free library context -------------------------------------------------------
+* close files and free memory held by library context
+* args   : rtkctx_t *ctx    IO  library context
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void free_rtkctx(rtkctx_t *ctx)
+{
+    rtkctx_t *ctx_cur=rtkctx_cur;
+    int i;
+
+    trace(3,"free_rtkctx:\n");
+
+    /* close files in the context */
+    rtkctx_cur=ctx;
+    for (i=ctx->nclose-1;i>=0;i--) ctx->closefunc[i]();
+    ctx->nclose=0;
+    rtkctx_cur=ctx_cur;
+
+    free(ctx->datum);
+    ctx->datum=NULL;
+    ctx->ndatum=0;
+}
+/* add close function of library context --------------------------------------
+* add close function called by free_rtkctx() to current library context
+* args   : void (*func)(void) I close function of resource held by context
+* return : none
+* notes  : the function is called with the context bound as current context.
+*          the functions are called in reverse order of addition.
+*-----------------------------------------------------------------------------*/
+extern void add_ctxclose(void (*func)(void))
+{
+    rtkctx_t *ctx=getrtkctx();
+    int i;
+
+    for (i=0;i<ctx->nclose;i++) if (ctx->closefunc[i]==func) return;
+    if (ctx->nclose>=MAXCTXCLOSE) {
+        trace(1,"add_ctxclose: close function overflow\n");
+        return;
+    }
+    ctx->closefunc[ctx->nclose++]=func;
+}
+/* get library context ---------------------------------------------------------
+* get library context of the calling thread
+* args   : none
+* return : library context bound by setrtkctx() or default context
+*-----------------------------------------------------------------------------*/
+extern rtkctx_t *getrtkctx(void)
+{
+    return rtkctx_cur?rtkctx_cur:&rtkctx_def;
+}
+/* set library context ---------------------------------------------------------
+* bind library context to the calling thread
+* args   : rtkctx_t *ctx    I   library context (NULL: default context)
+* return : none
+* notes  : the time offset, leap seconds, code priorities, ephemeris
+*          selections, rtk status output, geoid and datum parameters are
+*          taken from the context bound to the thread. independent rtk engines
+*          running in different threads with their own contexts do not
+*          interfere with each other. threads without a context share the
+*          default context (backward compatible with previous versions)
+*-----------------------------------------------------------------------------*/
+extern void setrtkctx(rtkctx_t *ctx)
+{
+    rtkctx_cur=ctx;
+}
 /* gpstime to utc --------------------------------------------------------------
 * convert gpstime to utc considering leap seconds
 * args   : gtime_t t        I   time expressed in gpstime
@@ -1895,6 +2402,7 @@ extern int read_leaps(const char *file)
 *-----------------------------------------------------------------------------*/
 extern gtime_t gpst2utc(gtime_t t)
 {
+    double (*leaps)[7]=getrtkctx()->leaps;
     gtime_t tu;
     int i;
 
@@ -1912,6 +2420,7 @@ extern gtime_t gpst2utc(gtime_t t)
 *-----------------------------------------------------------------------------*/
 extern gtime_t utc2gpst(gtime_t t)
 {
+    double (*leaps)[7]=getrtkctx()->leaps;
     int i;
 
     for (i=0;leaps[i][0]>0;i++) {
@@ -2374,30 +2883,21 @@ static void nut_iau1980(double t, const double *f, double *dpsi, double *deps)
 *                               (NULL: no output)
 * return : none
 * note   : see ref [3] chap 5
-*          not thread-safe
+*          no internal cache. use setastro() to compute the matrix once for
+*          an epoch and share it among satellites and threads
 *-----------------------------------------------------------------------------*/
 extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
 {
     const double ep2000[]={2000,1,1,12,0,0};
-    static gtime_t tutc_;
-    static double U_[9],gmst_;
     gtime_t tgps;
-    double eps,ze,th,z,t,t2,t3,dpsi,deps,gast,f[5];
+    double eps,ze,th,z,t,t2,t3,dpsi,deps,gast,gmst_,f[5];
     double R1[9],R2[9],R3[9],R[9],W[9],N[9],P[9],NP[9];
-    int i;
 
     char tstr[40];
     trace(4,"eci2ecef: tutc=%s\n",time2str(tutc,tstr,3));
 
-    if (fabs(timediff(tutc,tutc_))<0.01) { /* read cache */
-        for (i=0;i<9;i++) U[i]=U_[i];
-        if (gmst) *gmst=gmst_;
-        return;
-    }
-    tutc_=tutc;
-
     /* terrestrial time */
-    tgps=utc2gpst(tutc_);
+    tgps=utc2gpst(tutc);
     t=(timediff(tgps,epoch2time(ep2000))+19.0+32.184)/86400.0/36525.0;
     t2=t*t; t3=t2*t;
 
@@ -2420,7 +2920,7 @@ extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
     matmul("NN",3,3,3,R ,R3,N); /* N=Rx(-eps)*Rz(-dspi)*Rx(eps) */
     
     /* greenwich aparent sidereal time (rad) */
-    gmst_=utc2gmst(tutc_,erpv[2]);
+    gmst_=utc2gmst(tutc,erpv[2]);
     gast=gmst_+dpsi*cos(eps);
     gast+=(0.00264*sin(f[4])+0.000063*sin(2.0*f[4]))*AS2R;
 
@@ -2429,9 +2929,8 @@ extern void eci2ecef(gtime_t tutc, const double *erpv, double *U, double *gmst)
     matmul("NN",3,3,3,R1,R2,W );
     matmul("NN",3,3,3,W ,R3,R ); /* W=Ry(-xp)*Rx(-yp) */
     matmul("NN",3,3,3,N ,P ,NP);
-    matmul("NN",3,3,3,R ,NP,U_); /* U=W*Rz(gast)*N*P */
+    matmul("NN",3,3,3,R ,NP,U ); /* U=W*Rz(gast)*N*P */
     
-    for (i=0;i<9;i++) U[i]=U_[i];
     if (gmst) *gmst=gmst_;
 
     trace(5,"gmst=%.12f gast=%.12f\n",gmst_,gast);
@@ -2857,46 +3356,301 @@ extern int geterp(const erp_t *erp, gtime_t time, double *erpv)
     erpv[3]=(1.0-a)*erp->data[j].lod    +a*erp->data[j+1].lod;
     return 1;
 }
-/* compare ephemeris ---------------------------------------------------------*/
+/* hash key of navigation data -----------------------------------------------*/
+static uint32_t navkey(const nav_t *nav, int type, int index)
+{
+    uint64_t t;
+    uint32_t key;
+    int sat,iode,set=0;
+    
+    if (type==0) {
+        const eph_t *eph=nav->eph+index;
+        sat=eph->sat; iode=eph->iode; t=(uint64_t)eph->toe.time;
+        if (satsys(sat,NULL)==SYS_GAL) { /* F/NAV or I/NAV */
+            set=(eph->code&((1<<8)|(1<<1)))?1:0;
+        }
+    }
+    else if (type==1) {
+        const geph_t *geph=nav->geph+index;
+        sat=geph->sat; iode=geph->svh; t=(uint64_t)geph->toe.time;
+    }
+    else {
+        const seph_t *seph=nav->seph+index;
+        sat=seph->sat; iode=0; t=(uint64_t)seph->t0.time;
+    }
+    key=(uint32_t)sat*0x9E3779B1u^(uint32_t)iode*0x85EBCA77u^
+        (uint32_t)t*0xC2B2AE3Du^(uint32_t)(t>>32)^(uint32_t)set;
+    key^=key>>15; key*=0x2C1B3C6Du; key^=key>>12;
+    return key;
+}
+/* test duplicated navigation data -------------------------------------------*/
+static int navdup(const nav_t *nav, int type, int i, int j)
+{
+    if (type==0) {
+        const eph_t *e1=nav->eph+i,*e2=nav->eph+j;
+        if (e1->sat!=e2->sat||e1->iode!=e2->iode||
+            e1->toe.time!=e2->toe.time) return 0;
+        if (satsys(e1->sat,NULL)!=SYS_GAL) return 1;
+        return ((e1->code&((1<<8)|(1<<1)))?1:0)==
+               ((e2->code&((1<<8)|(1<<1)))?1:0);
+    }
+    else if (type==1) {
+        const geph_t *g1=nav->geph+i,*g2=nav->geph+j;
+        return g1->sat==g2->sat&&g1->svh==g2->svh&&g1->toe.time==g2->toe.time;
+    }
+    return nav->seph[i].sat==nav->seph[j].sat&&
+           nav->seph[i].t0.time==nav->seph[j].t0.time;
+}
+/* number of navigation data -------------------------------------------------*/
+static int navnum(const nav_t *nav, int type)
+{
+    return type==0?nav->n:(type==1?nav->ng:nav->ns);
+}
+/* insert index to hash table ------------------------------------------------*/
+static int hashins(navhash_t *hash, const nav_t *nav, int type, int index)
+{
+    uint32_t mask=(uint32_t)hash->size[type]-1,k;
+    int i;
+    
+    for (k=navkey(nav,type,index)&mask;(i=hash->idx[type][k])>=0;k=(k+1)&mask) {
+        
+        /* indexes not in data are left by removed data */
+        if (i<navnum(nav,type)&&i!=index&&navdup(nav,type,i,index)) return i;
+    }
+    hash->idx[type][k]=index;
+    hash->n[type]++;
+    return -1;
+}
+/* resize hash table ---------------------------------------------------------*/
+static int hashresize(navhash_t *hash, const nav_t *nav, int type, int n)
+{
+    int i,j,size,*idx=hash->idx[type],size0=hash->size[type];
+    
+    for (size=64;size<2*n;size*=2) ;
+    
+    if (!(hash->idx[type]=(int *)malloc(sizeof(int)*size))) {
+        hash->idx[type]=idx;
+        return 0;
+    }
+    for (i=0;i<size;i++) hash->idx[type][i]=-1;
+    hash->size[type]=size;
+    hash->n[type]=0;
+    
+    for (i=0;i<size0;i++) {
+        if ((j=idx[i])>=0&&j<navnum(nav,type)) hashins(hash,nav,type,j);
+    }
+    free(idx);
+    return 1;
+}
+/* initialize navigation data hash index ---------------------------------------
+* initialize hash index of ephemerides to check duplicated ephemerides
+* args   : navhash_t *hash O    hash index
+*          nav_t *nav    I      navigation data
+* return : status (1:ok,0:memory allocation error)
+* notes  : the ephemerides in nav are registered to the hash index.
+*          the key of an ephemeris is (sat,iode,toe,F/NAV or I/NAV) for
+*          GPS/GAL/QZS/BDS/IRN, (sat,svh,toe) for GLONASS and (sat,t0) for SBAS.
+*          the hash index should be freed by free_navhash()
+*-----------------------------------------------------------------------------*/
+extern int init_navhash(navhash_t *hash, const nav_t *nav)
+{
+    int i,j;
+    
+    trace(3,"init_navhash: n=%d ng=%d ns=%d\n",nav->n,nav->ng,nav->ns);
+    
+    for (i=0;i<3;i++) {
+        hash->idx[i]=NULL;
+        hash->size[i]=hash->n[i]=0;
+    }
+    for (i=0;i<3;i++) {
+        if (!hashresize(hash,nav,i,navnum(nav,i))) {
+            free_navhash(hash);
+            return 0;
+        }
+        for (j=0;j<navnum(nav,i);j++) hashins(hash,nav,i,j);
+    }
+    return 1;
+}
+/* free navigation data hash index ---------------------------------------------
+* free hash index of ephemerides
+* args   : navhash_t *hash IO   hash index
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void free_navhash(navhash_t *hash)
+{
+    int i;
+    
+    for (i=0;i<3;i++) {
+        free(hash->idx[i]);
+        hash->idx[i]=NULL;
+        hash->size[i]=hash->n[i]=0;
+    }
+}
+/* add ephemeris to navigation data hash index ---------------------------------
+* check duplication of new ephemeris and add it to hash index
+* args   : navhash_t *hash IO   hash index
+*          nav_t *nav    I      navigation data
+*          int   type    I      ephemeris type (0:eph,1:geph,2:seph)
+* return : status (1:added,0:duplicated,-1:memory allocation error)
+* notes  : the new ephemeris should be stored next to the last one in nav
+*          (nav->eph[nav->n], nav->geph[nav->ng] or nav->seph[nav->ns]).
+*          if added, increment the number of ephemerides in nav
+*-----------------------------------------------------------------------------*/
+extern int add_navhash(navhash_t *hash, const nav_t *nav, int type)
+{
+    int n=navnum(nav,type);
+    
+    if (2*(hash->n[type]+1)>hash->size[type]&&
+        !hashresize(hash,nav,type,hash->n[type]+1)) {
+        return -1;
+    }
+    return hashins(hash,nav,type,n)<0;
+}
+/* compare ephemeris -----------------------------------------------------------
+* order by satellite, toe, ttr and F/NAV or I/NAV for galileo. the order was
+* ttr, toe, satellite and F/NAV or I/NAV before 2026/10/19 (see sortnav())
+*-----------------------------------------------------------------------------*/
 static int cmpeph(const void *p1, const void *p2)
 {
-  eph_t *q1 = (eph_t *)p1, *q2 = (eph_t *)p2;
-  if (q1->ttr.time != q2->ttr.time) return (int)(q1->ttr.time - q2->ttr.time);
-  if (q1->toe.time != q2->toe.time) return (int)(q1->toe.time - q2->toe.time);
-  if (q1->sat != q2->sat) return q1->sat - q2->sat;
-  if (satsys(q1->sat, NULL) == SYS_GAL) {
-    int set1 = (q1->code & ((1 << 8) | (1 << 1))) ? 1 : 0;
-    int set2 = (q2->code & ((1 << 8) | (1 << 1))) ? 1 : 0;
-    return set1 - set2;
-  }
-  return 0;
+    const eph_t *q1=(const eph_t *)p1,*q2=(const eph_t *)p2;
+    int set1,set2;
+    
+    if (q1->sat!=q2->sat) return q1->sat-q2->sat;
+    if (q1->toe.time!=q2->toe.time) return q1->toe.time<q2->toe.time?-1:1;
+    if (q1->ttr.time!=q2->ttr.time) return q1->ttr.time<q2->ttr.time?-1:1;
+    if (satsys(q1->sat,NULL)!=SYS_GAL) return 0;
+    set1=(q1->code&((1<<8)|(1<<1)))?1:0;
+    set2=(q2->code&((1<<8)|(1<<1)))?1:0;
+    return set1-set2;
+}
+/* compare glonass ephemeris -------------------------------------------------*/
+static int cmpgeph(const void *p1, const void *p2)
+{
+    const geph_t *q1=(const geph_t *)p1,*q2=(const geph_t *)p2;
+    if (q1->sat!=q2->sat) return q1->sat-q2->sat;
+    if (q1->toe.time!=q2->toe.time) return q1->toe.time<q2->toe.time?-1:1;
+    if (q1->tof.time!=q2->tof.time) return q1->tof.time<q2->tof.time?-1:1;
+    return 0;
+}
+/* compare sbas ephemeris ----------------------------------------------------*/
+static int cmpseph(const void *p1, const void *p2)
+{
+    const seph_t *q1=(const seph_t *)p1,*q2=(const seph_t *)p2;
+    if (q1->sat!=q2->sat) return q1->sat-q2->sat;
+    if (q1->t0.time!=q2->t0.time) return q1->t0.time<q2->t0.time?-1:1;
+    if (q1->tof.time!=q2->tof.time) return q1->tof.time<q2->tof.time?-1:1;
+    return 0;
+}
+/* sort ephemerides by satellite and toe ---------------------------------------
+* stable bucket sort by satellite and insertion sort by toe in each satellite.
+* the cost is linear for ephemerides input in time order. if the input is not
+* nearly sorted (insertion moves more than NAVSORTMOV*n entries), fall back to
+* qsort.
+* the ephemerides are ordered per satellite so that the ephemerides of a
+* satellite are contiguous. they were ordered by ttr over all satellites
+* before 2026/10/19
+*-----------------------------------------------------------------------------*/
+#define NAVSORTMOV  8           /* max moves per entry for insertion sort */
+
+static void sortnav(void *data, int n, size_t size, size_t off,
+                    int (*cmp)(const void *, const void *))
+{
+    uint8_t *p=(uint8_t *)data,*buff,*tmp;
+    int i,j,sat,idx[MAXSAT+1]={0};
+    double nmov=0.0;
+    
+    if (!(buff=(uint8_t *)malloc(size*(n+1)))) {
+        qsort(data,n,size,cmp);
+        return;
+    }
+    tmp=buff+size*n;
+    
+    for (i=0;i<n;i++) {
+        memcpy(&sat,p+size*i+off,sizeof(int));
+        if (sat>=1&&sat<=MAXSAT) idx[sat]++; else idx[0]++;
+    }
+    for (i=0,j=0;i<=MAXSAT;i++) {
+        sat=idx[i]; idx[i]=j; j+=sat;
+    }
+    for (i=0;i<n;i++) {
+        memcpy(&sat,p+size*i+off,sizeof(int));
+        if (sat<1||sat>MAXSAT) sat=0;
+        memcpy(buff+size*idx[sat]++,p+size*i,size);
+    }
+    memcpy(p,buff,size*n);
+    
+    for (i=1;i<n;i++) {
+        if (cmp(p+size*(i-1),p+size*i)<=0) continue;
+        memcpy(tmp,p+size*i,size);
+        for (j=i;j>0&&cmp(p+size*(j-1),tmp)>0;j--) {
+            memcpy(p+size*j,p+size*(j-1),size);
+        }
+        memcpy(p+size*j,tmp,size);
+        
+        /* not nearly sorted input */
+        if ((nmov+=i-j)>(double)NAVSORTMOV*n) {
+            qsort(data,n,size,cmp);
+            break;
+        }
+    }
+    free(buff);
+}
+/* index ephemerides by satellite ----------------------------------------------
+* index of ephemerides sorted by satellite. the ephemerides of satellite sat
+* are data[idxsat[sat-1]] to data[idxsat[sat]-1]. the index is valid while the
+* array and the number of ephemerides are not changed (see satrange() in
+* ephemeris.c)
+*-----------------------------------------------------------------------------*/
+static void idxnav(nav_t *nav, int type, const void *data, int n, size_t size,
+                   size_t off)
+{
+    const uint8_t *p=(const uint8_t *)data;
+    int i,sat,s=0;
+    
+    nav->idxdata[type]=NULL;
+    nav->idxn[type]=0;
+    if (!data||n<=0) return;
+    
+    for (i=0;i<n;i++) {
+        memcpy(&sat,p+size*i+off,sizeof(int));
+        while (s<sat&&s<=MAXSAT) nav->idxsat[type][s++]=i;
+    }
+    while (s<=MAXSAT) nav->idxsat[type][s++]=n;
+    nav->idxdata[type]=data;
+    nav->idxn[type]=n;
+}
+/* delete duplicated ephemerides ---------------------------------------------*/
+static void delnavdup(nav_t *nav, int type, void *data, int *n, size_t size)
+{
+    navhash_t hash;
+    uint8_t *p=(uint8_t *)data;
+    int i,n0=*n;
+    
+    *n=0;
+    if (!init_navhash(&hash,nav)) {
+        *n=n0;
+        return;
+    }
+    for (i=0;i<n0;i++) {
+        if (i>*n) memcpy(p+size**n,p+size*i,size);
+        if (add_navhash(&hash,nav,type)) (*n)++;
+    }
+    free_navhash(&hash);
 }
 /* sort and unique ephemeris -------------------------------------------------*/
 static void uniqeph(nav_t *nav)
 {
+    eph_t *nav_eph;
+
     trace(3,"uniqeph: n=%d\n",nav->n);
 
-    if (nav->n<=0) return;
+    idxnav(nav,0,NULL,0,0,0);
 
-    qsort(nav->eph,nav->n,sizeof(eph_t),cmpeph);
+    if (nav->n<=0) return;
 
-    int j = 0;
-    for (int i=1;i<nav->n;i++) {
-        if (nav->eph[i].sat!=nav->eph[j].sat||
-            nav->eph[i].toe.time != nav->eph[j].toe.time ||
-            nav->eph[i].iode!=nav->eph[j].iode) {
-            nav->eph[++j]=nav->eph[i];
-            continue;
-        }
-        if (satsys(nav->eph[i].sat, NULL) == SYS_GAL) {
-          int setj = (nav->eph[j].code & ((1 << 8) | (1 << 1))) ? 1 : 0;
-          int seti = (nav->eph[i].code & ((1 << 8) | (1 << 1))) ? 1 : 0;
-          if (seti != setj) nav->eph[++j] = nav->eph[i];
-        }
-    }
-    nav->n=j+1;
+    delnavdup(nav,0,nav->eph,&nav->n,sizeof(eph_t));
+    sortnav(nav->eph,nav->n,sizeof(eph_t),offsetof(eph_t,sat),cmpeph);
 
-    eph_t *nav_eph;
     if (!(nav_eph=(eph_t *)realloc(nav->eph,sizeof(eph_t)*nav->n))) {
         trace(1,"uniqeph malloc error n=%d\n",nav->n);
         free(nav->eph); nav->eph=NULL; nav->n=nav->nmax=0;
@@ -2904,36 +3658,23 @@ static void uniqeph(nav_t *nav)
     }
     nav->eph=nav_eph;
     nav->nmax=nav->n;
+    idxnav(nav,0,nav->eph,nav->n,sizeof(eph_t),offsetof(eph_t,sat));
 
     trace(4,"uniqeph: n=%d\n",nav->n);
 }
-/* compare glonass ephemeris -------------------------------------------------*/
-static int cmpgeph(const void *p1, const void *p2) {
-  geph_t *q1 = (geph_t *)p1, *q2 = (geph_t *)p2;
-  if (q1->tof.time != q2->tof.time) return (int)(q1->tof.time - q2->tof.time);
-  if (q1->toe.time != q2->toe.time) return (int)(q1->toe.time - q2->toe.time);
-  return q1->sat - q2->sat;
-}
 /* sort and unique glonass ephemeris -----------------------------------------*/
 static void uniqgeph(nav_t *nav)
 {
     geph_t *nav_geph;
-    int i,j;
 
     trace(3,"uniqgeph: ng=%d\n",nav->ng);
 
-    if (nav->ng<=0) return;
+    idxnav(nav,1,NULL,0,0,0);
 
-    qsort(nav->geph,nav->ng,sizeof(geph_t),cmpgeph);
+    if (nav->ng<=0) return;
 
-    for (i=j=0;i<nav->ng;i++) {
-        if (nav->geph[i].sat!=nav->geph[j].sat||
-            nav->geph[i].toe.time!=nav->geph[j].toe.time||
-            nav->geph[i].svh!=nav->geph[j].svh) {
-            nav->geph[++j]=nav->geph[i];
-        }
-    }
-    nav->ng=j+1;
+    delnavdup(nav,1,nav->geph,&nav->ng,sizeof(geph_t));
+    sortnav(nav->geph,nav->ng,sizeof(geph_t),offsetof(geph_t,sat),cmpgeph);
 
     if (!(nav_geph=(geph_t *)realloc(nav->geph,sizeof(geph_t)*nav->ng))) {
         trace(1,"uniqgeph malloc error ng=%d\n",nav->ng);
@@ -2942,35 +3683,23 @@ static void uniqgeph(nav_t *nav)
     }
     nav->geph=nav_geph;
     nav->ngmax=nav->ng;
+    idxnav(nav,1,nav->geph,nav->ng,sizeof(geph_t),offsetof(geph_t,sat));
 
     trace(4,"uniqgeph: ng=%d\n",nav->ng);
 }
-/* compare sbas ephemeris ----------------------------------------------------*/
-static int cmpseph(const void *p1, const void *p2) {
-  seph_t *q1 = (seph_t *)p1, *q2 = (seph_t *)p2;
-  if (q1->tof.time != q2->tof.time) return (int)(q1->tof.time - q2->tof.time);
-  if (q1->t0.time != q2->t0.time) return (int)(q1->t0.time - q2->t0.time);
-  return q1->sat - q2->sat;
-}
 /* sort and unique sbas ephemeris --------------------------------------------*/
 static void uniqseph(nav_t *nav)
 {
     seph_t *nav_seph;
-    int i,j;
 
     trace(3,"uniqseph: ns=%d\n",nav->ns);
 
-    if (nav->ns<=0) return;
+    idxnav(nav,2,NULL,0,0,0);
 
-    qsort(nav->seph,nav->ns,sizeof(seph_t),cmpseph);
+    if (nav->ns<=0) return;
 
-    for (i=j=0;i<nav->ns;i++) {
-        if (nav->seph[i].sat!=nav->seph[j].sat||
-            nav->seph[i].t0.time!=nav->seph[j].t0.time) {
-            nav->seph[++j]=nav->seph[i];
-        }
-    }
-    nav->ns=j+1;
+    delnavdup(nav,2,nav->seph,&nav->ns,sizeof(seph_t));
+    sortnav(nav->seph,nav->ns,sizeof(seph_t),offsetof(seph_t,sat),cmpseph);
 
     if (!(nav_seph=(seph_t *)realloc(nav->seph,sizeof(seph_t)*nav->ns))) {
         trace(1,"uniqseph malloc error ns=%d\n",nav->ns);
@@ -2979,6 +3708,7 @@ static void uniqseph(nav_t *nav)
     }
     nav->seph=nav_seph;
     nav->nsmax=nav->ns;
+    idxnav(nav,2,nav->seph,nav->ns,sizeof(seph_t),offsetof(seph_t,sat));
 
     trace(4,"uniqseph: ns=%d\n",nav->ns);
 }
@@ -2986,6 +3716,9 @@ static void uniqseph(nav_t *nav)
 * unique ephemerides in navigation data and update carrier wave length
 * args   : nav_t *nav    IO     navigation data
 * return : number of epochs
+* notes  : duplicated ephemerides are deleted by hash index (see init_navhash())
+*          and the ephemerides are sorted by satellite and toe. the ephemerides
+*          are indexed by satellite for ephemeris selection (nav->idxsat)
 *-----------------------------------------------------------------------------*/
 extern void uniqnav(nav_t *nav)
 {
@@ -3197,7 +3930,8 @@ extern void freenav(nav_t *nav, int opt)
     if (opt&0x01) {free(nav->eph ); nav->eph =NULL; nav->n =nav->nmax =0;}
     if (opt&0x02) {free(nav->geph); nav->geph=NULL; nav->ng=nav->ngmax=0;}
     if (opt&0x04) {free(nav->seph); nav->seph=NULL; nav->ns=nav->nsmax=0;}
-    if (opt&0x08) {free(nav->peph); nav->peph=NULL; nav->ne=nav->nemax=0;}
+    if (opt&0x08) {free(nav->peph); nav->peph=NULL; nav->ne=nav->nemax=0;
+                   freepephs(nav);}
     if (opt&0x10) {free(nav->pclk); nav->pclk=NULL; nav->nc=nav->ncmax=0;}
     if (opt&0x20) {free(nav->alm ); nav->alm =NULL; nav->na=nav->namax=0;}
     if (opt&0x40) {free(nav->tec ); nav->tec =NULL; nav->nt=nav->ntmax=0;}
@@ -3559,7 +4293,7 @@ extern void dops(int ns, const double *azel, double elmin, double *dop)
     if (n<4) return;
     
     matmul("NT",4,4,n,H,H,Q);
-    if (!matinv(Q,4)) {
+    if (!matinv4(Q)) {
         dop[0]=SQRT(Q[0]+Q[5]+Q[10]+Q[15]); /* GDOP */
         dop[1]=SQRT(Q[0]+Q[5]+Q[10]);       /* PDOP */
         dop[2]=SQRT(Q[0]+Q[5]);             /* HDOP */
@@ -3669,6 +4403,23 @@ extern int seliflc(int optnf,int sys)
     /* use L1/L5 for Galileo if L5 is enabled */
     return((optnf==2||sys!=SYS_GAL)?1:2);
 }
+/* zenith delays by standard atmosphere and saastamoinen model --------------*/
+static void saascoef(const double *pos, double humi, double *zhd, double *zwd)
+{
+    const double temp0=15.0; /* temperature at sea level */
+    double hgt,pres,temp,e;
+
+    /* standard atmosphere */
+    hgt=pos[2]<0.0?0.0:pos[2];
+
+    pres=1013.25*pow(1.0-2.2557E-5*hgt,5.2568);
+    temp=temp0-6.5E-3*hgt+273.16;
+    e=6.108*humi*exp((17.15*temp-4684.0)/(temp-38.45));
+
+    /* saastamoinen model */
+    *zhd=0.0022768*pres/(1.0-0.00266*cos(2.0*pos[0])-0.00028*hgt/1E3);
+    *zwd=0.002277*(1255.0/temp+0.05)*e;
+}
 /* troposphere model -----------------------------------------------------------
 * compute tropospheric delay by standard atmosphere and saastamoinen model
 * args   : gtime_t time     I   time
@@ -3680,23 +4431,14 @@ extern int seliflc(int optnf,int sys)
 extern double tropmodel(gtime_t time, const double *pos, const double *azel,
                         double humi)
 {
-    const double temp0=15.0; /* temperature at sea level */
-    double hgt,pres,temp,e,z,trph,trpw;
+    double zhd,zwd,z;
 
     if (pos[2]<-100.0||1E4<pos[2]||azel[1]<=0) return 0.0;
 
-    /* standard atmosphere */
-    hgt=pos[2]<0.0?0.0:pos[2];
+    saascoef(pos,humi,&zhd,&zwd);
 
-    pres=1013.25*pow(1.0-2.2557E-5*hgt,5.2568);
-    temp=temp0-6.5E-3*hgt+273.16;
-    e=6.108*humi*exp((17.15*temp-4684.0)/(temp-38.45));
-
-    /* saastamoinen model */
     z=PI/2.0-azel[1];
-    trph=0.0022768*pres/(1.0-0.00266*cos(2.0*pos[0])-0.00028*hgt/1E3)/cos(z);
-    trpw=0.002277*(1255.0/temp+0.05)*e/cos(z);
-    return trph+trpw;
+    return zhd/cos(z)+zwd/cos(z);
 }
 #ifndef IERS_MODEL
 
@@ -3706,13 +4448,12 @@ static double interpc(const double coef[], double lat)
     if (i<1) return coef[0]; else if (i>4) return coef[4];
     return coef[i-1]*(1.0-lat/15.0+i)+coef[i]*(lat/15.0-i);
 }
-static double mapf(double el, double a, double b, double c)
+static double mapf(double sinel, double a, double b, double c)
 {
-    double sinel=sin(el);
     return (1.0+a/(1.0+b/(1.0+c)))/(sinel+(a/(sinel+b/(sinel+c))));
 }
-static double nmf(gtime_t time, const double pos[], const double azel[],
-                  double *mapfw)
+/* nmf coefficients at receiver position --------------------------------------*/
+static void nmfcoef(gtime_t time, const double pos[], double *ah, double *aw)
 {
     /* ref [5] table 3 */
     /* hydro-ave-a,b,c, hydro-amp-a,b,c, wet-a,b,c at latitude 15,30,45,60,75 */
@@ -3729,15 +4470,9 @@ static double nmf(gtime_t time, const double pos[], const double azel[],
         { 1.4275268E-3, 1.5138625E-3, 1.4572752E-3, 1.5007428E-3, 1.7599082E-3},
         { 4.3472961E-2, 4.6729510E-2, 4.3908931E-2, 4.4626982E-2, 5.4736038E-2}
     };
-    const double aht[]={ 2.53E-5, 5.49E-3, 1.14E-3}; /* height correction */
-
-    double y,cosy,ah[3],aw[3],dm,el=azel[1],lat=pos[0]*R2D,hgt=pos[2];
+    double y,cosy,lat=pos[0]*R2D;
     int i;
 
-    if (el<=0.0) {
-        if (mapfw) *mapfw=0.0;
-        return 0.0;
-    }
     /* year from doy 28, added half a year for southern latitudes */
     y=(time2doy(time)-28.0)/365.25+(lat<0.0?0.5:0.0);
 
@@ -3748,12 +4483,39 @@ static double nmf(gtime_t time, const double pos[], const double azel[],
         ah[i]=interpc(coef[i  ],lat)-interpc(coef[i+3],lat)*cosy;
         aw[i]=interpc(coef[i+6],lat);
     }
+}
+/* nmf with coefficients ------------------------------------------------------*/
+static double nmfel(double el, const double *ah, const double *aw, double hgt,
+                    double *mapfw)
+{
+    const double aht[]={ 2.53E-5, 5.49E-3, 1.14E-3}; /* height correction */
+    double sinel,dm;
+
+    if (el<=0.0) {
+        if (mapfw) *mapfw=0.0;
+        return 0.0;
+    }
+    sinel=sin(el);
+
     /* ellipsoidal height is used instead of height above sea level */
-    dm=(1.0/sin(el)-mapf(el,aht[0],aht[1],aht[2]))*hgt/1E3;
+    dm=(1.0/sinel-mapf(sinel,aht[0],aht[1],aht[2]))*hgt/1E3;
 
-    if (mapfw) *mapfw=mapf(el,aw[0],aw[1],aw[2]);
+    if (mapfw) *mapfw=mapf(sinel,aw[0],aw[1],aw[2]);
 
-    return mapf(el,ah[0],ah[1],ah[2])+dm;
+    return mapf(sinel,ah[0],ah[1],ah[2])+dm;
+}
+static double nmf(gtime_t time, const double pos[], const double azel[],
+                  double *mapfw)
+{
+    double ah[3],aw[3];
+
+    if (azel[1]<=0.0) {
+        if (mapfw) *mapfw=0.0;
+        return 0.0;
+    }
+    nmfcoef(time,pos,ah,aw);
+
+    return nmfel(azel[1],ah,aw,pos[2],mapfw);
 }
 #endif /* !IERS_MODEL */
 
@@ -3799,6 +4561,95 @@ extern double tropmapf(gtime_t time, const double pos[], const double azel[],
     return nmf(time,pos,azel,mapfw); /* NMF */
 #endif
 }
+/* set troposphere site terms --------------------------------------------------
+* set receiver site dependent terms of troposphere model and mapping function
+* args   : gtime_t time     I   time
+*          double *pos      I   receiver position {lat,lon,h} (rad,m)
+*          double humi      I   relative humidity
+*          tropsite_t *site IO  troposphere site terms
+* return : none
+* notes  : the site terms are kept as they are if time, position and humidity
+*          are same as the previous call. initialize site->stat to 0 before the
+*          first call.
+*-----------------------------------------------------------------------------*/
+extern void settropsite(gtime_t time, const double *pos, double humi,
+                        tropsite_t *site)
+{
+    if (site->stat&&timediff(time,site->time)==0.0&&site->pos[0]==pos[0]&&
+        site->pos[1]==pos[1]&&site->pos[2]==pos[2]&&site->humi==humi) {
+        return;
+    }
+    trace(4,"settropsite: pos=%10.6f %11.6f %6.1f humi=%.2f\n",pos[0]*R2D,
+          pos[1]*R2D,pos[2],humi);
+
+    site->time=time;
+    matcpy(site->pos,pos,3,1);
+    site->humi=humi;
+    site->zhd=site->zwd=0.0;
+    site->stat=1;
+
+    if (!(pos[2]<-100.0||1E4<pos[2])) {
+        saascoef(pos,humi,&site->zhd,&site->zwd);
+        site->stat|=2;
+    }
+    if (!(pos[2]<-1000.0||pos[2]>20000.0)) {
+#ifndef IERS_MODEL
+        nmfcoef(time,pos,site->ah,site->aw);
+#endif
+        site->stat|=4;
+    }
+}
+/* troposphere model for multiple satellites -----------------------------------
+* compute tropospheric delays by saastamoinen model with site terms
+* args   : tropsite_t *site I   troposphere site terms (settropsite())
+*          double *azel     I   azimuth/elevation angles {az,el,...} (rad)
+*          int    n         I   number of satellites
+*          double *trp      O   tropospheric delays (m) (n x 1)
+* return : none
+* notes  : same as tropmodel() for each satellite
+*-----------------------------------------------------------------------------*/
+extern void tropmodel_batch(const tropsite_t *site, const double *azel, int n,
+                            double *trp)
+{
+    double cosz;
+    int i;
+
+    for (i=0;i<n;i++) {
+        if (!(site->stat&2)||azel[1+i*2]<=0) {
+            trp[i]=0.0;
+            continue;
+        }
+        cosz=cos(PI/2.0-azel[1+i*2]);
+        trp[i]=site->zhd/cosz+site->zwd/cosz;
+    }
+}
+/* troposphere mapping function for multiple satellites ------------------------
+* compute tropospheric mapping functions with site terms
+* args   : tropsite_t *site I   troposphere site terms (settropsite())
+*          double *azel     I   azimuth/elevation angles {az,el,...} (rad)
+*          int    n         I   number of satellites
+*          double *mapfs    O   mapping functions {dry,wet,...} (n x 2)
+* return : none
+* notes  : same as tropmapf() for each satellite
+*-----------------------------------------------------------------------------*/
+extern void tropmapf_batch(const tropsite_t *site, const double *azel, int n,
+                           double *mapfs)
+{
+    int i;
+
+    for (i=0;i<n;i++) {
+        if (!(site->stat&4)) {
+            mapfs[i*2]=mapfs[1+i*2]=0.0;
+            continue;
+        }
+#ifdef IERS_MODEL
+        mapfs[i*2]=tropmapf(site->time,site->pos,azel+i*2,mapfs+1+i*2);
+#else
+        mapfs[i*2]=nmfel(azel[1+i*2],site->ah,site->aw,site->pos[2],
+                        mapfs+1+i*2);
+#endif
+    }
+}
 /* interpolate antenna phase center variation --------------------------------*/
 static double interpvar(double ang, const double *var)
 {
@@ -3932,6 +4783,39 @@ extern void sunmoonpos(gtime_t tutc, const double *erpv, double *rsun,
     if (rmoon) matmul("NN",3,1,3,U,rm,rmoon);
     if (gmst ) *gmst=gmst_;
 }
+/* set astronomical context ----------------------------------------------------
+* compute sun and moon position, gmst and eci to ecef transformation matrix
+* of an epoch
+* args   : gtime_t tutc     I   time in utc
+*          double *erpv     I   erp value {xp,yp,ut1_utc,lod} (rad,rad,s,s/d)
+*                               (NULL: no erp)
+*          astro_t *astro   O   astronomical context
+* return : none
+* notes  : the context is computed once per epoch by the caller and passed to
+*          satposs(), satantoff(), tidedisp(), ... it has no reference to other
+*          data, so it can be shared read-only by multiple threads
+*-----------------------------------------------------------------------------*/
+extern void setastro(gtime_t tutc, const double *erpv, astro_t *astro)
+{
+    double rs[3],rm[3];
+    int i;
+
+    char tstr[40];
+    trace(4,"setastro: tutc=%s\n",time2str(tutc,tstr,3));
+
+    astro->tutc=tutc;
+    for (i=0;i<5;i++) astro->erpv[i]=erpv?erpv[i]:0.0;
+
+    /* sun and moon position in eci */
+    sunmoonpos_eci(timeadd(tutc,astro->erpv[2]),rs,rm);
+
+    /* eci to ecef transformation matrix */
+    eci2ecef(tutc,astro->erpv,astro->U,&astro->gmst);
+
+    /* sun and moon position in ecef */
+    matmul("NN",3,1,3,astro->U,rs,astro->rsun );
+    matmul("NN",3,1,3,astro->U,rm,astro->rmoon);
+}
 /* uncompress file -------------------------------------------------------------
 * uncompress (uncompress/unzip/uncompact hatanaka-compression/tar) file
 * args   : char   *file     I   input file
@@ -261,11 +261,15 @@ extern "C" {
 #define INT_SWAP_STAT 86400.0           /* swap interval of solution status file (s) */
 
 #define MAXEXFILE   1024                /* max number of expanded files */
+#define NCHEB       12                  /* degree of chebyshev orbit segments */
 #define MAXSBSAGEF  30.0                /* max age of SBAS fast correction (s) */
 #define MAXSBSAGEL  1800.0              /* max age of SBAS long term corr (s) */
 #define MAXSBSURA   8                   /* max URA of SBAS satellite */
 #define MAXBAND     10                  /* max SBAS band of IGP */
 #define MAXNIGP     201                 /* max number of IGP in SBAS band */
+#define NIGPLAT     37                  /* number of IGP index latitudes (5 deg) */
+#define NIGPLON     72                  /* number of IGP index longitudes (5 deg) */
+#define MAXIGPIDX   4                   /* max number of IGP at index grid point */
 #define MAXNGEO     4                   /* max number of GEO satellites */
 #define MAXCOMMENT  100                 /* max number of RINEX comments */
 #define MAXSTRPATH  1024                /* max length of stream path */
@@ -280,11 +284,27 @@ extern "C" {
 #define MAXOBSBUF   128                 /* max number of observation data buffer */
 #define MAXNRPOS    16                  /* max number of reference positions */
 #define MAXLEAPS    64                  /* max number of leap seconds table */
+#define MAXCTXCLOSE 8                   /* max number of context close functions */
 #define MAXGISLAYER 32                  /* max number of GIS data layers */
 #define MAXRCVCMD   4096                /* max length of receiver commands */
 #define MAX_CODE_BIASES 3               /* max # of different code biases per freq */
 #define MAX_CODE_BIAS_FREQS 2           /* max # of freqs supported for code biases  */
 
+#define MET_DEC     0                   /* metrics span: decode input data */
+#define MET_SATPOS  1                   /* metrics span: satellite positions */
+#define MET_RES     2                   /* metrics span: residuals */
+#define MET_FILTER  3                   /* metrics span: filter update */
+#define MET_AR      4                   /* metrics span: ambiguity resolution */
+#define MET_OUT     5                   /* metrics span: solution output */
+#define MET_RTKPOS  6                   /* metrics span: positioning of epoch */
+#define MAXMETSPAN  7                   /* number of metrics spans */
+#define MET_NBIN    32                  /* number of bins of metrics histogram */
+
+#define DEGR_ARRERUN 0x01               /* degradation: skip AR reruns */
+#define DEGR_DOPSLIP 0x02               /* degradation: skip doppler slip detection */
+#define DEGR_ELMASK 0x04                /* degradation: drop low elevation satellites */
+#define DEGR_NFREQ  0x08                /* degradation: reduce number of frequencies */
+
 #define RNX2VER     2.10                /* RINEX ver.2 default output version */
 #define RNX3VER     3.00                /* RINEX ver.3 default output version */
 
@@ -549,6 +569,9 @@ extern "C" {
 #define rtklib_initlock(f) InitializeCriticalSection(f)
 #define rtklib_lock(f)     EnterCriticalSection(f)
 #define rtklib_unlock(f)   LeaveCriticalSection(f)
+#define rtklib_cond_t      CONDITION_VARIABLE
+#define rtklib_initcond(c) InitializeConditionVariable(c)
+#define rtklib_signal(c)   WakeAllConditionVariable(c)
 #define RTKLIB_FILEPATHSEP '\\'
 /* strtok_r not supported in Windows */
 #define strtok_r(str,delim,ptr) strtok(str,delim)
@@ -558,8 +581,16 @@ extern "C" {
 #define rtklib_initlock(f) pthread_mutex_init(f,NULL)
 #define rtklib_lock(f)     pthread_mutex_lock(f)
 #define rtklib_unlock(f)   pthread_mutex_unlock(f)
+#define rtklib_cond_t      pthread_cond_t
+#define rtklib_initcond(c) pthread_cond_init(c,NULL)
+#define rtklib_signal(c)   pthread_cond_broadcast(c)
 #define RTKLIB_FILEPATHSEP '/'
 #endif
+#ifdef _MSC_VER
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
 
 /* type definitions ----------------------------------------------------------*/
 
@@ -607,6 +638,24 @@ typedef struct {        /* earth rotation parameter type */
     erpd_t *data;       /* earth rotation parameter data */
 } erp_t;
 
+typedef struct {        /* astronomical context type */
+    gtime_t tutc;       /* time (utc) */
+    double erpv[5];     /* erp values {xp,yp,ut1_utc,lod} (rad,rad,s,s/d) */
+    double U[9];        /* eci to ecef transformation matrix */
+    double gmst;        /* greenwich mean sidereal time (rad) */
+    double rsun[3];     /* sun position in ecef (m) */
+    double rmoon[3];    /* moon position in ecef (m) */
+} astro_t;
+
+typedef struct {        /* troposphere site terms type */
+    gtime_t time;       /* time */
+    double pos[3];      /* receiver position {lat,lon,h} (rad,m) */
+    double humi;        /* relative humidity */
+    double zhd,zwd;     /* zenith hydrostatic/wet delay by saastamoinen (m) */
+    double ah[3],aw[3]; /* NMF hydrostatic/wet coefficients {a,b,c} */
+    int stat;           /* status (1:set,2:delay valid,4:mapping valid) */
+} tropsite_t;
+
 typedef struct {        /* antenna parameter type */
     int sat;            /* satellite number (0:receiver) */
     char type[MAXANT];  /* antenna type */
@@ -685,6 +734,18 @@ typedef struct {        /* precise ephemeris type */
     float  vco[MAXSAT][3]; /* satellite velocity covariance (m^2) */
 } peph_t;
 
+typedef struct {        /* per-satellite precise ephemeris type */
+    int n,nsat;         /* number of epochs and satellites */
+    gtime_t *time;      /* epoch times (GPST) [n] */
+    int idx[MAXSAT];    /* satellite index in store (-1: no data) */
+    double *pos;        /* satellite position/clock {x,y,z,clk} (ecef) (m|s)
+                           [nsat][n][4] */
+    float  *std;        /* satellite position/clock std (m|s) [nsat][n][4] */
+    double *cheb;       /* chebyshev coefficients of orbit segments (m)
+                           [nsat][n-1][3][NCHEB+1] (NULL: no segment) */
+    uint8_t *cval;      /* valid flags of orbit segments [nsat][n-1] */
+} pephs_t;
+
 typedef struct {        /* precise clock type */
     gtime_t time;       /* time (GPST) */
     int index;          /* clock index for multiple files */
@@ -747,11 +808,6 @@ typedef struct {        /* SBAS message type */
     uint8_t msg[29];    /* SBAS message (226bit) padded by 0 */
 } sbsmsg_t;
 
-typedef struct {        /* SBAS messages type */
-    int n,nmax;         /* number of SBAS messages/allocated */
-    sbsmsg_t *msgs;     /* SBAS messages */
-} sbs_t;
-
 typedef struct {        /* SBAS fast correction type */
     gtime_t t0;         /* time of applicability (TOF) */
     double prc;         /* pseudorange correction (PRC) (m) */
@@ -803,6 +859,29 @@ typedef struct {        /* SBAS ionospheric corrections type */
     sbsigp_t igp[MAXNIGP]; /* ionospheric correction */
 } sbsion_t;
 
+typedef struct {        /* SBAS IGP index type */
+    uint8_t n[NIGPLAT][NIGPLON]; /* number of IGPs at grid point */
+    int16_t igp[NIGPLAT][NIGPLON][MAXIGPIDX]; /* IGPs {band*MAXNIGP+index,...} */
+    int ovf;            /* index overflow (1:linear search) */
+} sbsigpidx_t;
+
+typedef struct {        /* SBAS correction state snapshot type */
+    gtime_t time;       /* snapshot time */
+    int index;          /* index of next message to apply */
+    sbssat_t sbssat;    /* SBAS satellite corrections */
+    sbsion_t sbsion[MAXBAND+1]; /* SBAS ionosphere corrections */
+} sbssnap_t;
+
+typedef struct {        /* SBAS messages type */
+    int n,nmax;         /* number of SBAS messages/allocated */
+    sbsmsg_t *msgs;     /* SBAS messages */
+    int nsnap;          /* number of correction state snapshots */
+    sbssnap_t *snap;    /* correction state snapshots */
+    double tint,tsub;   /* time interval of snapshots/fine snapshots (s) */
+    int isub,nsub;      /* snapshot index/number of fine snapshots */
+    sbssnap_t *sub;     /* fine snapshots between snap[isub] and snap[isub+1] */
+} sbs_t;
+
 typedef struct {        /* DGPS/GNSS correction type */
     gtime_t t0;         /* correction time */
     double prc;         /* pseudorange correction (PRC) (m) */
@@ -842,6 +921,7 @@ typedef struct {        /* navigation data type */
     geph_t *geph;       /* GLONASS ephemeris */
     seph_t *seph;       /* SBAS ephemeris */
     peph_t *peph;       /* precise ephemeris */
+    pephs_t *pephs;     /* per-satellite precise ephemeris (NULL: not set) */
     pclk_t *pclk;       /* precise clock */
     alm_t *alm;         /* almanac data */
     tec_t *tec;         /* tec grid data */
@@ -864,10 +944,20 @@ typedef struct {        /* navigation data type */
     pcv_t pcvs[MAXSAT]; /* satellite antenna pcv */
     sbssat_t sbssat;    /* SBAS satellite corrections */
     sbsion_t sbsion[MAXBAND+1]; /* SBAS ionosphere corrections */
+    sbsigpidx_t sbsidx; /* SBAS IGP index */
     dgps_t dgps[MAXSAT]; /* DGPS corrections */
     ssr_t ssr[MAXSAT];  /* SSR corrections */
+    const void *idxdata[3]; /* eph/geph/seph of satellite index (NULL: none) */
+    int idxn[3];        /* numbers of eph/geph/seph of satellite index */
+    int idxsat[3][MAXSAT+1]; /* satellite index (first eph/geph/seph of sat>i) */
 } nav_t;
 
+typedef struct {        /* navigation data hash index type */
+    int *idx[3];        /* hash tables of eph/geph/seph indexes (-1:empty) */
+    int size[3];        /* sizes of hash tables */
+    int n[3];           /* numbers of indexes in hash tables */
+} navhash_t;
+
 typedef struct {        /* station parameter type */
     char name   [MAXANT]; /* marker name */
     char markerno[MAXANT]; /* marker number */
@@ -908,6 +998,7 @@ typedef struct {        /* solution type */
     float prev_ratio2;  /* previous final AR ratio factor for validation */
     float thres;        /* AR ratio threshold for validation */
     int refstationid;   /* ref station ID */
+    uint8_t degrade;    /* degradations applied by deadline (DEGR_???) */
 } sol_t;
 
 typedef struct {        /* solution buffer type */
@@ -988,6 +1079,30 @@ typedef struct {        /* RINEX control struct type */
     char   opt[256];    /* rinex dependent options */
 } rnxctr_t;
 
+typedef struct {        /* RINEX observation stream type */
+    gtime_t ts,te;      /* time span (time==0: no limit) */
+    double tint;        /* time interval (s) (0:all) */
+    int    rcv;         /* receiver number */
+    char   opt[256];    /* rinex dependent options */
+    char   **files;     /* queued obs files */
+    int    nf,nfmax;    /* number of queued obs files and allocated */
+    int    ifile;       /* next obs file index */
+    FILE   *fp;         /* current obs file pointer */
+    int    cstat;       /* uncompress status of current obs file */
+    char   tmpfile[1024]; /* uncompressed temporary file */
+    double ver;         /* RINEX version */
+    int    tsys;        /* time system */
+    char   tobs[RNX_NUMSYS][MAXOBSTYPE][4]; /* rinex obs types */
+    sta_t  sta;         /* station info in obs body */
+    uint8_t slips[MAXSAT][NFREQ+NEXOBS]; /* cycle slips of skipped epochs */
+    gtime_t time1;      /* time of last read epoch */
+    double dtime1;      /* interval of last read epoch (s) */
+    int    n1;          /* number of obs data of last read epoch */
+    int    nobs;        /* number of obs data input */
+    obsd_t *data;       /* obs data of read epoch */
+    obs_t  obs;         /* obs data of pending epoch */
+} rnxobs_t;
+
 typedef struct {        /* download URL type */
     char type[32];      /* data type */
     char path[1024];    /* URL path */
@@ -1071,6 +1186,10 @@ typedef struct {        /* processing options type */
     double odisp[2][6*11]; /* ocean tide loading parameters {rov,base} */
     int  freqopt;       /* disable L2-AR */
     char pppopt[256];   /* ppp option */
+    int  streamobs;     /* stream obs data in forward processing (0:off,1:on) */
+    int  pephcheb;      /* precise orbit by chebyshev segments (0:off,1:on) */
+    double tideint;     /* tidal displacement cache interval (s) (0:off) */
+    int  budget;        /* processing time budget of epoch (ms) (0:no deadline) */
 } prcopt_t;
 
 typedef struct {        /* solution options type */
@@ -1108,6 +1227,7 @@ typedef struct {        /* file options type */
     char geexe  [MAXSTRPATH]; /* google earth exec file */
     char solstat[MAXSTRPATH]; /* solution statistics file */
     char trace  [MAXSTRPATH]; /* debug trace file */
+    char cache  [MAXSTRPATH]; /* binary obs/nav cache directory */
 } filopt_t;
 
 typedef struct {        /* RINEX options type */
@@ -1146,6 +1266,7 @@ typedef struct {        /* RINEX options type */
     int phshift;        /* phase shift correction */
     int halfcyc;        /* half cycle correction */
     int sortsats;       /* Sort by satellite index */
+    double tscan;       /* obs-type scan window (s) (0:scan all input) */
     int sep_nav;        /* separated nav files */
     gtime_t tstart;     /* first obs time */
     gtime_t tend;       /* last obs time */
@@ -1153,6 +1274,8 @@ typedef struct {        /* RINEX options type */
     char tobs[RNX_NUMSYS][MAXOBSTYPE][4]; /* obs types {GPS,GLO,GAL,QZS,SBS,CMP,IRN} */
     double shift[RNX_NUMSYS][MAXOBSTYPE]; /* phase shift (cyc) {GPS,GLO,GAL,QZS,SBS,CMP,IRN} */
     int nobs[RNX_NUMSYS]; /* number of obs types {GPS,GLO,GAL,QZS,SBS,CMP,IRN} */
+    uint32_t obsmap[RNX_NUMSYS][MAXOBSTYPE][(MAXCODE+32)/32]; /* obs code maps of obs types (see setrnxobsmap()) */
+    int obsmapset;      /* obs code maps set (0:no,1:yes) */
 } rnxopt_t;
 
 typedef struct {        /* satellite status type */
@@ -1189,6 +1312,33 @@ typedef struct {        /* ambiguity control type */
     char flags[MAXSAT]; /* fix flags */
 } ambc_t;
 
+typedef struct wsblk_tag { /* workspace memory block type */
+    size_t size;        /* size of block (doubles) */
+    double *data;       /* data of block */
+    struct wsblk_tag *next; /* next block */
+} wsblk_t;
+
+typedef struct {        /* workspace arena type */
+    wsblk_t *top;       /* first block */
+    wsblk_t *cur;       /* current block */
+    size_t used;        /* used size of current block (doubles) */
+    size_t size;        /* default block size (doubles) */
+    int nalloc;         /* number of heap allocations of blocks */
+} wspace_t;
+
+typedef struct {        /* base station residuals cache type */
+    int n;              /* number of base observations (0:invalid) */
+    int nf;             /* number of frequencies */
+    prcopt_t opt;       /* processing options */
+    double rb[3];       /* base position (ecef) (m) */
+    uint64_t navkey;    /* key of navigation data */
+    obsd_t obs[MAXOBS]; /* base observation data */
+    double rs[MAXOBS*6],dts[MAXOBS*2],var[MAXOBS]; /* satellite states */
+    int svh[MAXOBS];    /* satellite health flags */
+    double y[MAXOBS*NFREQ*2]; /* zero-difference residuals */
+    double e[MAXOBS*3],azel[MAXOBS*2],freq[MAXOBS*NFREQ]; /* los,azel,freq */
+} basec_t;
+
 typedef struct {        /* RTK control/result type */
     sol_t  sol;         /* RTK solution */
     double rb[6];       /* base position/velocity (ecef) (m|m/s) */
@@ -1202,11 +1352,20 @@ typedef struct {        /* RTK control/result type */
     char holdamb;       /* set if fix-and-hold has occurred at least once */
     ambc_t ambc[MAXSAT]; /* ambiguity control */
     ssat_t ssat[MAXSAT]; /* satellite status */
+    tropsite_t trps[2]; /* troposphere site terms {rover,base} */
     int neb;            /* bytes in error message buffer */
     char errbuf[MAXERRMSG]; /* error message buffer */
     prcopt_t opt;       /* processing options */
     int initial_mode;   /* initial positioning mode */
     int epoch;          /* epoch number */
+    int degr;           /* degradation level by deadline (0:none) */
+    uint64_t tepoch;    /* start time of epoch processing (ns) */
+    basec_t *bc;        /* base station residuals cache (NULL:no cache) */
+    void *tide;         /* tidal displacement cache (see tidedisp_cache()) */
+    wspace_t ws;        /* workspace of scratch matrices */
+    int nxs;            /* number of active states */
+    int *ixs;           /* active state indices (ascending order) */
+    int *pxs;           /* position of state in active indices (-1:inactive) */
 } rtk_t;
 
 typedef struct {        /* receiver raw data control type */
@@ -1225,6 +1384,7 @@ typedef struct {        /* receiver raw data control type */
     unsigned char lockflag[MAXSAT][NFREQ+NEXOBS]; /* used for carrying forward cycle slip */
     double icpp[MAXSAT],off[MAXSAT],icpc; /* carrier params for ss2 */
     double prCA[MAXSAT],dpCA[MAXSAT]; /* L1/CA pseudorange/doppler for javad */
+    double adrs[MAXSAT]; /* accumulated delta range for ublox TRK-MEAS/TRK-D5 */
     uint8_t halfc[MAXSAT][NFREQ+NEXOBS]; /* half-cycle resolved */
     char freqn[MAXOBS]; /* frequency number for javad */
     int nbyte;          /* number of bytes in message buffer */
@@ -1265,11 +1425,19 @@ typedef struct {        /* stream converter type */
     uint32_t tick[32];  /* cycle tick of output message */
     int ephsat[32];     /* satellites of output ephemeris */
     int stasel;         /* station info selection (0:remote,1:local) */
-    rtcm_t rtcm;        /* rtcm input data buffer */
-    raw_t raw;          /* raw  input data buffer */
+    char opt[256];      /* rtcm or receiver raw input options */
     rtcm_t out;         /* rtcm output data buffer */
+    uint8_t *obuf;      /* encoded frame buffer */
+    int nobuf,nobufmax; /* length/size of encoded frame buffer (bytes) */
 } strconv_t;
 
+typedef struct {        /* stream converter shared decoder type */
+    int itype;          /* input stream type */
+    char opt[256];      /* rtcm or receiver raw input options */
+    rtcm_t rtcm;        /* rtcm input data buffer */
+    raw_t raw;          /* raw  input data buffer */
+} strdec_t;
+
 typedef struct {        /* stream server type */
     int state;          /* server state (0:stop,1:running) */
     int cycle;          /* server cycle (ms) */
@@ -1286,10 +1454,96 @@ typedef struct {        /* stream server type */
     stream_t stream[16]; /* input/output streams */
     stream_t strlog[16]; /* return log streams */
     strconv_t *conv[16]; /* stream converter */
+    strdec_t *dec[16];  /* shared decoders of stream converters */
+    int convsrc[16];    /* converters of encoded frames for outputs */
     rtklib_thread_t thread; /* server thread */
     rtklib_lock_t lock; /* lock flag */
 } strsvr_t;
 
+typedef struct {        /* library context type */
+    double timeoffset;  /* time offset of timeget() (s) */
+    double leaps[MAXLEAPS+1][7]; /* leap seconds (y,m,d,h,m,s,utc-gpst) */
+    char codepris[7][MAXFREQ][16]; /* code priority for each freq-index */
+    int eph_sel[7];     /* ephemeris selections {GPS,GLO,GAL,QZS,BDS,IRN,SBS} */
+    int statlevel;      /* rtk status output level (0:off) */
+    FILE *fp_stat;      /* rtk status file pointer */
+    char file_stat[1024]; /* rtk status file original path */
+    gtime_t time_stat;  /* rtk status file time */
+    int model_geoid;    /* geoid model */
+    void *geoid;        /* geoid model data (NULL: embedded) */
+    void *datum;        /* datum trans parameter table */
+    int ndatum;         /* datum trans parameter table size */
+    void (*closefunc[MAXCTXCLOSE])(void); /* close functions of resources */
+    int nclose;         /* number of close functions */
+} rtkctx_t;
+
+typedef struct {        /* RTK server event type */
+    int n;              /* number of signals since last wait */
+    rtklib_lock_t lock; /* lock flag */
+    rtklib_cond_t cond; /* condition of signal */
+} rtksvrevt_t;
+
+typedef struct {        /* RTK server bounded queue type */
+    int n,size;         /* number of slots,slot size (bytes) */
+    int wp,rp;          /* write/read pointers */
+    int nmax;           /* max number of queued data */
+    int *len;           /* data lengths of slots (bytes) */
+    int *type;          /* data types of slots */
+    uint32_t *tick;     /* enqueue ticks of slots (ms) */
+    uint8_t *buff;      /* slot buffers (n*size bytes) */
+    rtksvrevt_t *evt;   /* event of consumer signaled by put (NULL: no) */
+    rtklib_lock_t lock; /* lock flag */
+    rtklib_cond_t cond; /* condition of free slot signaled by pop */
+} rtksvrq_t;
+
+typedef struct {        /* RTK server stage latency type */
+    uint32_t n;         /* number of processed data */
+    uint32_t ndrop;     /* number of data dropped by queue overflow */
+    double ave,max;     /* average/max latency (ms) */
+} rtksvrlat_t;
+
+typedef struct {        /* metrics span histogram type */
+    uint32_t n;         /* number of spans */
+    double sum,max;     /* total/max duration (us) */
+    uint32_t bin[MET_NBIN]; /* histogram of duration {<1,<2,<4,...} (us) */
+} metspan_t;
+
+typedef struct {        /* RTK server status snapshot type */
+    uint32_t seq;       /* sequence number of snapshot */
+    uint32_t tick;      /* tick of snapshot (ms) */
+    int state;          /* server state (0:stop,1:running) */
+    sol_t sol;          /* RTK solution */
+    double rb[6];       /* base position/velocity (ecef) (m|m/s) */
+    double x[6];        /* float position and std (ecef) {x,y,z,sx,sy,sz} (m) */
+    double xa[6];       /* fixed position and std (ecef) {x,y,z,sx,sy,sz} (m) */
+    int nx,na;          /* number of float/fixed states */
+    double tt;          /* time difference between current and previous (s) */
+    ssat_t ssat[MAXSAT]; /* satellite status */
+    int nobs[3];        /* number of observation data {rov,base,corr} */
+    obsd_t obs[3][MAXOBS]; /* latest observation data {rov,base,corr} */
+    uint32_t nmsg[3][10]; /* input message counts */
+    uint32_t nmsg2[3][100]; /* RTCM 2 message counts */
+    uint32_t nmsg3[3][400]; /* RTCM 3 message counts */
+    int rcvcount;       /* count of receiver event of rover */
+    int tmcount;        /* time mark count of rover */
+    int timevalid;      /* time mark valid of rover */
+    gtime_t eventime;   /* time mark of rover */
+    int nb[3];          /* bytes in input buffers {rov,base,corr} */
+    int sstat[MAXSTRRTK]; /* stream status */
+    char smsg[MAXSTRRTK][MAXSTRMSG]; /* stream status messages */
+    int cputime;        /* CPU time (ms) for a processing cycle */
+    int prcout;         /* missing observation data count */
+    int nave;           /* number of averaging base pos */
+    rtksvrlat_t lat[5]; /* stage latency {dec rov,dec base,dec corr,pos,out} */
+    int nq[6],nqmax[6]; /* current/max queue depths {obs rov,obs base,sol,log rov,log base,log corr} */
+    int inb[MAXSTRRTK],outb[MAXSTRRTK]; /* input/output bytes of streams */
+} rtksvrstat_t;
+
+typedef struct {        /* RTK server thread argument type */
+    void *svr;          /* RTK server */
+    int index;          /* input stream index */
+} rtksvrarg_t;
+
 typedef struct {        /* RTK server type */
     int state;          /* server state (0:stop,1:running) */
     int cycle;          /* processing cycle (ms) */
@@ -1311,17 +1565,42 @@ typedef struct {        /* RTK server type */
     uint8_t *pbuf[3];   /* peek buffers {rov,base,corr} */
     sol_t solbuf[MAXSOLBUF]; /* solution buffer */
     uint32_t nmsg[3][10]; /* input message counts */
+    uint32_t nmsg2[3][100]; /* RTCM 2 message counts (copied by decoders) */
+    uint32_t nmsg3[3][400]; /* RTCM 3 message counts (copied by decoders) */
+    int rcvcount,tmcount; /* receiver event/time mark count of rover */
+    int timevalid;      /* time mark valid of rover */
+    gtime_t eventime;   /* time mark of rover */
+    dgps_t dgps[3][MAXSAT]; /* DGPS corrections decoded {rov,base,corr} */
     raw_t  raw [3];     /* receiver raw control {rov,base,corr} */
     rtcm_t rtcm[3];     /* RTCM control {rov,base,corr} */
     gtime_t ftime[3];   /* download time {rov,base,corr} */
     char files[3][MAXSTRPATH]; /* download paths {rov,base,corr} */
     obs_t obs[3][MAXOBSBUF]; /* observation data {rov,base,corr} */
-    nav_t nav;          /* navigation data */
+    nav_t nav;          /* navigation data updated by decoders */
+    nav_t pnav;         /* navigation data copy of positioning thread */
+    uint32_t navver;    /* version of navigation data updated by decoders */
+    double rb[3];       /* base position by antenna position message (ecef) */
+    int basewait;       /* max wait of rover epoch for base epoch (ms) (0:no) */
     sbsmsg_t sbsmsg[MAXSBSMSG]; /* SBAS message buffer */
     stream_t stream[8]; /* streams {rov,base,corr,sol1,sol2,logr,logb,logc} */
     stream_t *moni;     /* monitor stream */
     uint32_t tick;      /* start tick */
-    rtklib_thread_t thread; /* server thread */
+    rtklib_thread_t thread; /* server thread (positioning) */
+    rtklib_thread_t dthread[3]; /* decoder threads {rov,base,corr} */
+    rtklib_thread_t othread; /* output thread */
+    rtksvrarg_t darg[3]; /* decoder thread arguments */
+    int ostate;         /* output thread state (0:stop,1:running) */
+    rtksvrq_t qobs[2];  /* observation epoch queues {rov,base} */
+    rtksvrq_t qsol;     /* solution output queue */
+    rtksvrq_t qlog[3];  /* log output queues {rov,base,corr} */
+    rtksvrevt_t evpos;  /* event of positioning thread */
+    rtksvrevt_t evout;  /* event of output thread */
+    rtksvrlat_t lat[5]; /* stage latency {dec rov,dec base,dec corr,pos,out} */
+    rtksvrstat_t *stat; /* status snapshots (triple buffer) */
+    int statidx;        /* index of latest status snapshot (-1:none) */
+    int statref[3];     /* reader counts of status snapshots */
+    uint32_t statseq;   /* sequence number of status snapshots */
+    rtklib_lock_t slock; /* lock of status snapshot index */
     int cputime;        /* CPU time (ms) for a processing cycle */
     int prcout;         /* missing observation data count */
     int nave;           /* number of averaging base pos */
@@ -1329,9 +1608,63 @@ typedef struct {        /* RTK server type */
     char cmds_periodic[3][MAXRCVCMD]; /* periodic commands */
     char cmd_reset[MAXRCVCMD]; /* reset command */
     double bl_reset;    /* baseline length to reset (km) */
+    rtkctx_t *ctx;      /* library context of server (NULL: default) */
     rtklib_lock_t lock; /* lock flag */
 } rtksvr_t;
 
+typedef struct {        /* multi-rover RTK server navigation snapshot type */
+    uint32_t ver;       /* version of snapshot */
+    int nref;           /* reference count */
+    nav_t nav;          /* navigation data (immutable after publish) */
+} rtkmsnap_t;
+
+typedef struct {        /* multi-rover RTK server rover type */
+    int strtype[2];     /* stream types {input,output} (STR_???) */
+    char path[2][MAXSTRPATH]; /* stream paths {input,output} */
+    int format;         /* input format (STRFMT_???) */
+    int budget;         /* processing time budget of an epoch (ms) (0:no limit) */
+    prcopt_t opt;       /* processing options */
+    solopt_t solopt;    /* solution options */
+    stream_t stream[2]; /* streams {input,output} */
+    raw_t *raw;         /* receiver raw control */
+    rtcm_t *rtcm;       /* RTCM control */
+    rtk_t rtk;          /* RTK control/result */
+    obsd_t *obs;        /* pending observation epoch */
+    int nobs;           /* number of pending observation data (0:none) */
+    uint32_t tick;      /* receiving tick of pending epoch (ms) */
+    int busy;           /* epoch in process by worker (0:no,1:yes) */
+    uint32_t nover;     /* number of epochs processed over budget */
+    rtksvrlat_t lat;    /* latency (n:processed,ndrop:skipped epochs) */
+    sol_t sol;          /* latest solution */
+} rtkmrov_t;
+
+typedef struct {        /* multi-rover RTK server type */
+    int state;          /* server state (0:stop,1:running) */
+    int cycle;          /* server cycle (ms) */
+    int nrov;           /* number of rovers */
+    int nworker;        /* number of worker threads */
+    int format[2];      /* input formats {base,corr} */
+    prcopt_t opt;       /* processing options for base/corr */
+    stream_t stream[2]; /* input streams {base,corr} */
+    raw_t *raw;         /* receiver raw controls {base,corr} */
+    rtcm_t *rtcm;       /* RTCM controls {base,corr} */
+    nav_t nav;          /* navigation data updated by decoder */
+    int dirty;          /* navigation data updated since last snapshot */
+    rtkmsnap_t *snap;   /* latest navigation snapshot */
+    uint32_t ver;       /* version of latest navigation snapshot */
+    obsd_t *base;       /* latest base observation epoch */
+    int nb;             /* number of base observation data */
+    double rb[6];       /* base position/velocity by station message (ecef) */
+    uint32_t nmsg[2][10]; /* input message counts {base,corr} */
+    rtkmrov_t *rov;     /* rovers */
+    int next;           /* next rover index scanned by workers */
+    rtklib_thread_t thread; /* server thread (decoder) */
+    rtklib_thread_t *wthread; /* worker threads */
+    int nwthread;       /* number of running worker threads */
+    rtkctx_t *ctx;      /* library context of server (NULL: default) */
+    rtklib_lock_t lock; /* lock flag */
+} rtkmsvr_t;
+
 typedef struct {        /* GIS data point type */
     double pos[3];      /* point data {lat,lon,height} (rad,m) */
 } gis_pnt_t;
@@ -1417,6 +1750,13 @@ EXPORT double *mat  (int n, int m);
 EXPORT int    *imat (int n, int m);
 EXPORT double *zeros(int n, int m);
 EXPORT double *eye  (int n);
+EXPORT int     wsinit (wspace_t *ws, size_t size);
+EXPORT void    wsfree (wspace_t *ws);
+EXPORT double *wsmat  (wspace_t *ws, int n, int m);
+EXPORT int    *wsimat (wspace_t *ws, int n, int m);
+EXPORT double *wszeros(wspace_t *ws, int n, int m);
+EXPORT size_t  wsmark (const wspace_t *ws);
+EXPORT void    wsrelease(wspace_t *ws, size_t mark);
 EXPORT double dot2(const double *a, const double *b);
 EXPORT double dot3(const double *a, const double *b);
 EXPORT double dot (const double *a, const double *b, int n);
@@ -1431,14 +1771,25 @@ EXPORT void matmulp(const char *tr, int n, int k, int m,
 EXPORT void matmulm(const char *tr, int n, int k, int m,
                     const double *A, const double *B, double *C);
 EXPORT int  matinv(double *A, int n);
+EXPORT int  matinv_ws(double *A, int n, wspace_t *ws);
 EXPORT int  solve (const char *tr, const double *A, const double *Y, int n,
                    int m, double *X);
+EXPORT int  solve_ws(const char *tr, const double *A, const double *Y, int n,
+                     int m, double *X, wspace_t *ws);
 EXPORT int  lsq   (const double *A, const double *y, int n, int m, double *x,
                    double *Q);
+EXPORT int  lsq_ws(const double *A, const double *y, int n, int m, double *x,
+                   double *Q, wspace_t *ws);
 EXPORT int  filter(double *x, double *P, const double *H, const double *v,
                    const double *R, int n, int m);
+EXPORT int  filter_ws(double *x, double *P, const double *H, const double *v,
+                      const double *R, int n, int m, const int *ixs, int nxs,
+                      wspace_t *ws);
 EXPORT int  smoother(const double *xf, const double *Qf, const double *xb,
                      const double *Qb, int n, double *xs, double *Qs);
+EXPORT void pvatrans(double *x, double *P, int n, const int *ix, int nix,
+                     double tt, double ta);
+EXPORT void rtkactstate(rtk_t *rtk, int i);
 EXPORT void matprint (const double *A, int n, int m, int p, int q);
 EXPORT void matfprint(const double *A, int n, int m, int p, int q, FILE *fp);
 
@@ -1471,6 +1822,12 @@ EXPORT double  time2doy (gtime_t t);
 EXPORT double  utc2gmst (gtime_t t, double ut1_utc);
 EXPORT int read_leaps(const char *file);
 
+EXPORT void init_rtkctx(rtkctx_t *ctx);
+EXPORT void free_rtkctx(rtkctx_t *ctx);
+EXPORT void add_ctxclose(void (*func)(void));
+EXPORT rtkctx_t *getrtkctx(void);
+EXPORT void setrtkctx(rtkctx_t *ctx);
+
 EXPORT int adjgpsweek(int week);
 EXPORT uint32_t tickget(void);
 EXPORT void sleepms(int ms);
@@ -1496,6 +1853,9 @@ EXPORT double dms2deg(const double *dms);
 EXPORT void readpos(const char *file, const char *rcv, double *pos);
 EXPORT int  sortobs(obs_t *obs);
 EXPORT void uniqnav(nav_t *nav);
+EXPORT int  init_navhash(navhash_t *hash, const nav_t *nav);
+EXPORT void free_navhash(navhash_t *hash);
+EXPORT int  add_navhash(navhash_t *hash, const nav_t *nav, int type);
 EXPORT int  screent(gtime_t time, gtime_t ts, gtime_t te, double tint);
 EXPORT int  readnav(const char *file, nav_t *nav);
 EXPORT int  savenav(const char *file, const nav_t *nav);
@@ -1574,8 +1934,17 @@ EXPORT double tropmodel(gtime_t time, const double *pos, const double *azel,
                         double humi);
 EXPORT double tropmapf(gtime_t time, const double *pos, const double *azel,
                        double *mapfw);
+EXPORT void settropsite(gtime_t time, const double *pos, double humi,
+                        tropsite_t *site);
+EXPORT void tropmodel_batch(const tropsite_t *site, const double *azel, int n,
+                            double *trp);
+EXPORT void tropmapf_batch(const tropsite_t *site, const double *azel, int n,
+                           double *mapfs);
 EXPORT int iontec(gtime_t time, const nav_t *nav, const double *pos,
                   const double *azel, int opt, double *delay, double *var);
+EXPORT int iontec_batch(gtime_t time, const nav_t *nav, const double *pos,
+                        const double *azel, int n, int opt, double *delay,
+                        double *var, int *stat);
 EXPORT void readtec(const char *file, nav_t *nav, int opt);
 EXPORT int ionocorr(gtime_t time, const nav_t *nav, int sat, const double *pos,
                     const double *azel, int ionoopt, double *ion, double *var);
@@ -1594,13 +1963,20 @@ EXPORT void antmodel_s(const pcv_t *pcv, double nadir, double *dant);
 /* earth tide models ---------------------------------------------------------*/
 EXPORT void sunmoonpos(gtime_t tutc, const double *erpv, double *rsun,
                        double *rmoon, double *gmst);
+EXPORT void setastro(gtime_t tutc, const double *erpv, astro_t *astro);
 EXPORT void tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
-                     const double *odisp, double *dr);
+                     const astro_t *astro, const double *odisp, double *dr);
+EXPORT void tidedisp_cache(void **cache, gtime_t tutc, const double *rr,
+                           int opt, const erp_t *erp, const double *odisp,
+                           double tint, double *dr);
+EXPORT void *reftidecache(void **cache);
+EXPORT void cleartidecache(void **cache);
 
 /* geoid models --------------------------------------------------------------*/
 EXPORT int opengeoid(int model, const char *file);
 EXPORT void closegeoid(void);
 EXPORT double geoidh(const double *pos);
+EXPORT void geoidh_batch(const double *pos, int n, double *h);
 
 /* datum transformation ------------------------------------------------------*/
 EXPORT int loaddatump(const char *file);
@@ -1617,6 +1993,7 @@ EXPORT int readrnxc(const char *file, nav_t *nav);
 EXPORT int outrnxobsh(FILE *fp, const rnxopt_t *opt, const nav_t *nav);
 EXPORT int outrnxobsb(FILE *fp, const rnxopt_t *opt, const obsd_t *obs, int n,
                       int epflag);
+EXPORT void setrnxobsmap(rnxopt_t *opt);
 EXPORT int outrnxnavh (FILE *fp, const rnxopt_t *opt, const nav_t *nav);
 EXPORT int outrnxgnavh(FILE *fp, const rnxopt_t *opt, const nav_t *nav);
 EXPORT int outrnxhnavh(FILE *fp, const rnxopt_t *opt, const nav_t *nav);
@@ -1630,10 +2007,29 @@ EXPORT int outrnxhnavb(FILE *fp, const rnxopt_t *opt, const seph_t *seph);
 EXPORT int rnxcomment(rnxopt_t *opt, const char *format, ...);
 EXPORT int rtk_uncompress(const char *file, char *uncfile);
 EXPORT int convrnx(int format, rnxopt_t *opt, const char *file, char **ofile);
+EXPORT int convrnx_batch(int format, rnxopt_t *opt, char **files,
+                         char **ofile, int n, int nthread);
 EXPORT int  init_rnxctr (rnxctr_t *rnx);
 EXPORT void free_rnxctr (rnxctr_t *rnx);
 EXPORT int  open_rnxctr (rnxctr_t *rnx, FILE *fp);
 EXPORT int  input_rnxctr(rnxctr_t *rnx, FILE *fp);
+EXPORT int  init_rnxobs (rnxobs_t *rnx, int rcv, gtime_t ts, gtime_t te,
+                         double tint, const char *opt);
+EXPORT void free_rnxobs (rnxobs_t *rnx);
+EXPORT int  add_rnxobs  (rnxobs_t *rnx, const char *file, nav_t *nav,
+                         sta_t *sta);
+EXPORT int  input_rnxobs(rnxobs_t *rnx, obsd_t *data, int nmax);
+
+/* binary data cache functions -----------------------------------------------*/
+EXPORT int cachepath(const char *dir, int type, const char **infile,
+                     const int *index, int n, gtime_t ts, gtime_t te,
+                     double ti, const char *opt, char *path);
+EXPORT int savecacheobs (const char *file, const obs_t *obs, const nav_t *nav,
+                         const sta_t *sta, int nsta, int nepoch);
+EXPORT int loadcacheobs (const char *file, obs_t *obs, nav_t *nav, sta_t *sta,
+                         int nsta);
+EXPORT int savecachepeph(const char *file, const nav_t *nav, const sbs_t *sbs);
+EXPORT int loadcachepeph(const char *file, nav_t *nav, sbs_t *sbs);
 
 /* ephemeris and clock functions ---------------------------------------------*/
 EXPORT double eph2clk (gtime_t time, const eph_t  *eph);
@@ -1646,17 +2042,20 @@ EXPORT void geph2pos(gtime_t time, const geph_t *geph, double *rs, double *dts,
 EXPORT void seph2pos(gtime_t time, const seph_t *seph, double *rs, double *dts,
                      double *var);
 EXPORT int  peph2pos(gtime_t time, int sat, const nav_t *nav, int opt,
-                     double *rs, double *dts, double *var);
+                     const astro_t *astro, double *rs, double *dts, double *var);
 EXPORT void satantoff(gtime_t time, const double *rs, int sat, const nav_t *nav,
-                      double *dant);
+                      const astro_t *astro, double *dant);
 EXPORT int  satpos(gtime_t time, gtime_t teph, int sat, int ephopt,
                    const nav_t *nav, double *rs, double *dts, double *var,
                    int *svh);
 EXPORT void satposs(gtime_t time, const obsd_t *obs, int n, const nav_t *nav,
-                    int sateph, double *rs, double *dts, double *var, int *svh);
+                    int sateph, const astro_t *astro, double *rs, double *dts,
+                    double *var, int *svh);
 EXPORT void setseleph(int sys, int sel);
 EXPORT int  getseleph(int sys);
 EXPORT void readsp3(const char *file, nav_t *nav, int opt);
+EXPORT int  setpephs(nav_t *nav, int opt);
+EXPORT void freepephs(nav_t *nav);
 EXPORT int  readsap(const char *file, gtime_t time, nav_t *nav);
 EXPORT int  readdcb(const char *file, nav_t *nav, const sta_t *sta);
 EXPORT int code2bias_ix(const int sys,const int code);
@@ -1795,6 +2194,10 @@ EXPORT void sbsoutmsg(FILE *fp, sbsmsg_t *sbsmsg);
 EXPORT int  sbsdecodemsg(gtime_t time, int prn, const uint32_t *words,
                          sbsmsg_t *sbsmsg);
 EXPORT int sbsupdatecorr(const sbsmsg_t *msg, nav_t *nav);
+EXPORT void sbsupdateigp(nav_t *nav, int band, int add);
+EXPORT int sbsmakesnap(sbs_t *sbs, double tint, double tsub);
+EXPORT void sbsfreesnap(sbs_t *sbs);
+EXPORT int sbsseekcorr(sbs_t *sbs, gtime_t time, int index, nav_t *nav);
 EXPORT int sbssatcorr(gtime_t time, int sat, const nav_t *nav, double *rs,
                       double *dts, double *var);
 EXPORT int sbsioncorr(gtime_t time, const nav_t *nav, const double *pos,
@@ -1824,6 +2227,7 @@ EXPORT int  stropen  (stream_t *stream, int type, int mode, const char *path);
 EXPORT void strclose (stream_t *stream);
 EXPORT int  strread  (stream_t *stream, uint8_t *buff, int n);
 EXPORT int  strwrite (stream_t *stream, uint8_t *buff, int n);
+EXPORT int  strreply (stream_t *stream, uint8_t *buff, int n);
 EXPORT void strsync  (stream_t *stream1, stream_t *stream2);
 EXPORT int  strstat  (stream_t *stream, char *msg);
 EXPORT int  strstatx (stream_t *stream, char *msg);
@@ -1839,6 +2243,8 @@ EXPORT void strsetproxy(const char *addr);
 /* integer ambiguity resolution ----------------------------------------------*/
 EXPORT int lambda(int n, int m, const double *a, const double *Q, double *F,
                   double *s);
+EXPORT int lambda_ws(int n, int m, const double *a, const double *Q, double *F,
+                     double *s, wspace_t *ws);
 EXPORT int lambda_reduction(int n, const double *Q, double *Z);
 EXPORT int lambda_search(int n, int m, const double *a, const double *Q,
                          double *F, double *s);
@@ -1847,6 +2253,9 @@ EXPORT int lambda_search(int n, int m, const double *a, const double *Q,
 EXPORT int pntpos(const obsd_t *obs, int n, const nav_t *nav,
                   const prcopt_t *opt, sol_t *sol, double *azel,
                   ssat_t *ssat, char *msg);
+EXPORT int pntpos_ws(const obsd_t *obs, int n, const nav_t *nav,
+                     const prcopt_t *opt, sol_t *sol, double *azel,
+                     ssat_t *ssat, char *msg, wspace_t *ws);
 
 /* precise positioning -------------------------------------------------------*/
 EXPORT void rtkinit(rtk_t *rtk, const prcopt_t *opt);
@@ -1855,6 +2264,7 @@ EXPORT int  rtkpos (rtk_t *rtk, const obsd_t *obs, int nobs, const nav_t *nav);
 EXPORT int  rtkopenstat(const char *file, int level);
 EXPORT void rtkclosestat(void);
 EXPORT int  rtkoutstat(rtk_t *rtk, int level, char *buff);
+EXPORT void rtkoutsolstat(rtk_t *rtk);
 
 /* precise point positioning -------------------------------------------------*/
 EXPORT void pppos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav);
@@ -1869,6 +2279,8 @@ EXPORT int postpos(gtime_t ts, gtime_t te, double ti, double tu,
                    const prcopt_t *popt, const solopt_t *sopt,
                    const filopt_t *fopt, const char **infile, int n, const char *outfile,
                    const char *rov, const char *base);
+EXPORT int postcache(gtime_t ts, gtime_t te, double ti, const prcopt_t *popt,
+                     const filopt_t *fopt, const char **infile, int n);
 
 /* stream server functions ---------------------------------------------------*/
 EXPORT void strsvrinit (strsvr_t *svr, int nout);
@@ -1899,8 +2311,34 @@ EXPORT void rtksvrunlock(rtksvr_t *svr);
 EXPORT int  rtksvrostat (rtksvr_t *svr, int type, gtime_t *time, int *sat,
                          double *az, double *el, int **snr, int *vsat);
 EXPORT void rtksvrsstat (rtksvr_t *svr, int *sstat, char *msg);
+EXPORT int  rtksvrgetstat(rtksvr_t *svr, rtksvrstat_t *stat);
 EXPORT int  rtksvrmark(rtksvr_t *svr, const char *name, const char *comment);
 
+/* metrics functions ---------------------------------------------------------*/
+EXPORT uint64_t metclock(void);
+EXPORT void metenable(int ena);
+EXPORT uint64_t metbegin(void);
+EXPORT void metend(int span, uint64_t t0);
+EXPORT int  metget(int span, metspan_t *s);
+EXPORT void metreset(void);
+EXPORT double metpct(const metspan_t *s, double p);
+EXPORT const char *metspanname(int span);
+EXPORT int  metout(char *buff, const char *prefix);
+
+/* multi-rover rtk server functions ------------------------------------------*/
+EXPORT int  rtkmsvrinit  (rtkmsvr_t *svr, int nrov);
+EXPORT void rtkmsvrfree  (rtkmsvr_t *svr);
+EXPORT int  rtkmsvrsetrov(rtkmsvr_t *svr, int index, const int *strs,
+                          const char **paths, int format, int budget,
+                          const prcopt_t *prcopt, const solopt_t *solopt);
+EXPORT int  rtkmsvrstart (rtkmsvr_t *svr, int cycle, int nworker,
+                          const int *strs, const char **paths,
+                          const int *formats, const prcopt_t *prcopt,
+                          char *errmsg);
+EXPORT void rtkmsvrstop  (rtkmsvr_t *svr);
+EXPORT int  rtkmsvrrstat (rtkmsvr_t *svr, int index, sol_t *sol,
+                          rtksvrlat_t *lat, uint32_t *nover);
+
 /* downloader functions ------------------------------------------------------*/
 EXPORT int dl_readurls(const char *file, const char **types, int ntype, url_t *urls,
                        int nmax);
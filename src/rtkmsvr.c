@@ -0,0 +1,812 @@
+/*------------------------------------------------------------------------------
+* rtkmsvr.c : multi-rover rtk server functions
+*
+* the multi-rover rtk server processes a number of rovers against one shared
+* base station and correction stream in a process.
+*
+* the server thread reads and decodes the base and correction streams once.
+* navigation data (ephemerides, ion/utc parameters, sbas and ssr corrections)
+* are published as immutable snapshots with a version number. a new snapshot
+* is made only if the navigation data are updated. workers hold a reference
+* of the snapshot while an epoch is processed, so that a snapshot is freed
+* after the last worker using it released it. the latest base epoch and base
+* position are copied by the workers under the server lock.
+*
+* the server thread also reads and decodes the rover input streams. the
+* latest epoch of each rover is kept as the pending epoch. a pool of worker
+* threads picks up the pending epochs in round-robin, runs rtkpos() by the
+* rtk control of the rover and writes the solution to the output stream of
+* the rover. an epoch not processed before the next epoch of the same rover
+* is received or within the processing time budget of the rover is skipped.
+*
+* each worker binds a copy of the server library context without the solution
+* status file, so that rtkpos() of workers do not share mutable context state.
+* the solution status of the rovers is written to the status file of the
+* server context under the server lock.
+*
+* options : -DWIN32    use WIN32 API
+*
+* version : $Revision:$ $Date:$
+* history : 2026/10/19 1.0 new
+*           2026/10/19 1.1 bind copy of server context to each worker and
+*                          write solution status under server lock
+*-----------------------------------------------------------------------------*/
+#include "rtklib.h"
+
+#define MAXWORKER       64      /* max number of worker threads */
+#define BUFFSIZE        32768   /* size of stream read buffer (bytes) */
+#define POLLCYCLE       1       /* polling cycle of idle workers (ms) */
+
+#ifdef WIN32
+typedef DWORD (WINAPI *threadfunc_t)(void *);
+#else
+typedef void *(*threadfunc_t)(void *);
+#endif
+
+/* create/join thread --------------------------------------------------------*/
+static int createthread(rtklib_thread_t *thread, threadfunc_t func, void *arg)
+{
+#ifdef WIN32
+    return (*thread=CreateThread(NULL,0,func,arg,0,NULL))!=NULL;
+#else
+    return !pthread_create(thread,NULL,func,arg);
+#endif
+}
+static void jointhread(rtklib_thread_t thread)
+{
+#ifdef WIN32
+    WaitForSingleObject(thread,INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread,NULL);
+#endif
+}
+/* update latency ------------------------------------------------------------*/
+static void updatelat(rtksvrlat_t *lat, uint32_t tick)
+{
+    double t=(double)(int)(tickget()-tick);
+    
+    lat->n++;
+    lat->ave+=(t-lat->ave)/lat->n;
+    if (t>lat->max) lat->max=t;
+}
+/* new/free navigation snapshot ----------------------------------------------*/
+static rtkmsnap_t *newsnap(const nav_t *nav, uint32_t ver)
+{
+    rtkmsnap_t *snap;
+    
+    if (!(snap=(rtkmsnap_t *)malloc(sizeof(rtkmsnap_t)))) return NULL;
+    snap->ver=ver;
+    snap->nref=1;
+    snap->nav=*nav;
+    snap->nav.peph=NULL; snap->nav.pephs=NULL; snap->nav.pclk=NULL;
+    snap->nav.alm=NULL; snap->nav.tec=NULL;
+    snap->nav.ne=snap->nav.nemax=snap->nav.nc=snap->nav.ncmax=0;
+    snap->nav.na=snap->nav.namax=snap->nav.nt=snap->nav.ntmax=0;
+    snap->nav.eph=NULL; snap->nav.geph=NULL; snap->nav.seph=NULL;
+    
+    if (!(snap->nav.eph =(eph_t  *)malloc(sizeof(eph_t )*nav->n ))||
+        !(snap->nav.geph=(geph_t *)malloc(sizeof(geph_t)*nav->ng))||
+        !(snap->nav.seph=(seph_t *)malloc(sizeof(seph_t)*nav->ns))) {
+        free(snap->nav.eph); free(snap->nav.geph); free(snap);
+        return NULL;
+    }
+    memcpy(snap->nav.eph ,nav->eph ,sizeof(eph_t )*nav->n );
+    memcpy(snap->nav.geph,nav->geph,sizeof(geph_t)*nav->ng);
+    memcpy(snap->nav.seph,nav->seph,sizeof(seph_t)*nav->ns);
+    return snap;
+}
+static void freesnap(rtkmsnap_t *snap)
+{
+    if (!snap) return;
+    free(snap->nav.eph); free(snap->nav.geph); free(snap->nav.seph);
+    free(snap);
+}
+/* acquire/release navigation snapshot (called with lock) --------------------*/
+static rtkmsnap_t *acqsnap(rtkmsvr_t *svr)
+{
+    if (svr->snap) svr->snap->nref++;
+    return svr->snap;
+}
+static void relsnap(rtkmsnap_t *snap)
+{
+    if (snap&&--snap->nref<=0) freesnap(snap);
+}
+/* publish navigation snapshot -----------------------------------------------*/
+static void publishsnap(rtkmsvr_t *svr)
+{
+    rtkmsnap_t *snap;
+    
+    if (!(snap=newsnap(&svr->nav,svr->ver+1))) {
+        tracet(1,"rtkmsvr: snapshot malloc error\n");
+        return;
+    }
+    rtklib_lock(&svr->lock);
+    relsnap(svr->snap);
+    svr->snap=snap;
+    svr->ver=snap->ver;
+    rtklib_unlock(&svr->lock);
+    
+    svr->dirty=0;
+    tracet(4,"rtkmsvr: publish snapshot ver=%u\n",snap->ver);
+}
+/* select observation data by processing options -----------------------------*/
+static int selobs(const obs_t *obs, const prcopt_t *opt, int rcv, obsd_t *data)
+{
+    obs_t sel={0};
+    int i,sat;
+    
+    sel.nmax=MAXOBS; sel.data=data;
+    for (i=0;i<obs->n&&sel.n<MAXOBS;i++) {
+        sat=obs->data[i].sat;
+        if (opt->exsats[sat-1]==1||!(satsys(sat,NULL)&opt->navsys)) continue;
+        data[sel.n]=obs->data[i];
+        data[sel.n++].rcv=rcv;
+    }
+    sortobs(&sel);
+    return sel.n;
+}
+/* update ephemeris ----------------------------------------------------------*/
+static void update_eph(rtkmsvr_t *svr, const nav_t *nav, int ephsat,
+                       int ephset)
+{
+    eph_t *eph1,*eph2,*eph3;
+    geph_t *geph1,*geph2,*geph3;
+    int prn;
+    
+    if (satsys(ephsat,&prn)!=SYS_GLO) {
+        /* svr->nav.eph={current_set1,current_set2,prev_set1,prev_set2} */
+        eph1=nav->eph+ephsat-1+MAXSAT*ephset;
+        eph2=svr->nav.eph+ephsat-1+MAXSAT*ephset;
+        eph3=svr->nav.eph+ephsat-1+MAXSAT*(2+ephset);
+        if (eph2->ttr.time==0||
+            (eph1->iode!=eph3->iode&&eph1->iode!=eph2->iode)||
+            (timediff(eph1->toe,eph3->toe)!=0.0&&
+             timediff(eph1->toe,eph2->toe)!=0.0)||
+            (timediff(eph1->toc,eph3->toc)!=0.0&&
+             timediff(eph1->toc,eph2->toc)!=0.0)) {
+            *eph3=*eph2;
+            *eph2=*eph1;
+            svr->dirty=1;
+        }
+    }
+    else {
+        geph1=nav->geph+prn-1;
+        geph2=svr->nav.geph+prn-1;
+        geph3=svr->nav.geph+prn-1+MAXPRNGLO;
+        if (geph2->tof.time==0||
+            (geph1->iode!=geph3->iode&&geph1->iode!=geph2->iode)) {
+            *geph3=*geph2;
+            *geph2=*geph1;
+            svr->dirty=1;
+        }
+    }
+}
+/* update ion/utc parameters -------------------------------------------------*/
+static void update_ionutc(rtkmsvr_t *svr, const nav_t *nav)
+{
+    matcpy(svr->nav.utc_gps,nav->utc_gps,8,1);
+    matcpy(svr->nav.utc_glo,nav->utc_glo,8,1);
+    matcpy(svr->nav.utc_gal,nav->utc_gal,8,1);
+    matcpy(svr->nav.utc_qzs,nav->utc_qzs,8,1);
+    matcpy(svr->nav.utc_cmp,nav->utc_cmp,8,1);
+    matcpy(svr->nav.utc_irn,nav->utc_irn,9,1);
+    matcpy(svr->nav.utc_sbs,nav->utc_sbs,4,1);
+    matcpy(svr->nav.ion_gps,nav->ion_gps,8,1);
+    matcpy(svr->nav.ion_gal,nav->ion_gal,4,1);
+    matcpy(svr->nav.ion_qzs,nav->ion_qzs,8,1);
+    matcpy(svr->nav.ion_cmp,nav->ion_cmp,8,1);
+    matcpy(svr->nav.ion_irn,nav->ion_irn,8,1);
+    svr->dirty=1;
+}
+/* update base station position ----------------------------------------------*/
+static void update_antpos(rtkmsvr_t *svr, const sta_t *sta)
+{
+    double rb[6]={0},pos[3],del[3]={0},dr[3];
+    int i;
+    
+    for (i=0;i<3;i++) rb[i]=sta->pos[i];
+    ecef2pos(rb,pos);
+    if (sta->deltype) { /* xyz */
+        del[2]=sta->hgt;
+        enu2ecef(pos,del,dr);
+        for (i=0;i<3;i++) rb[i]+=sta->del[i]+dr[i];
+    }
+    else { /* enu */
+        enu2ecef(pos,sta->del,dr);
+        for (i=0;i<3;i++) rb[i]+=dr[i];
+    }
+    rtklib_lock(&svr->lock);
+    for (i=0;i<6;i++) svr->rb[i]=rb[i];
+    rtklib_unlock(&svr->lock);
+}
+/* update ssr corrections ----------------------------------------------------*/
+static void update_ssr(rtkmsvr_t *svr, rtcm_t *rtcm)
+{
+    int i,sys,prn,iode;
+    
+    for (i=0;i<MAXSAT;i++) {
+        if (!rtcm->ssr[i].update) continue;
+    
+        /* check consistency between iods of orbit and clock */
+        if (rtcm->ssr[i].iod[0]!=rtcm->ssr[i].iod[1]) continue;
+        rtcm->ssr[i].update=0;
+    
+        /* check corresponding ephemeris exists */
+        iode=rtcm->ssr[i].iode;
+        sys=satsys(i+1,&prn);
+        if (sys==SYS_GPS||sys==SYS_GAL||sys==SYS_QZS) {
+            if (svr->nav.eph[i].iode!=iode&&
+                svr->nav.eph[i+MAXSAT].iode!=iode) continue;
+        }
+        else if (sys==SYS_GLO) {
+            if (svr->nav.geph[prn-1].iode!=iode&&
+                svr->nav.geph[prn-1+MAXPRNGLO].iode!=iode) continue;
+        }
+        svr->nav.ssr[i]=rtcm->ssr[i];
+        svr->dirty=1;
+    }
+}
+/* decode base/correction stream ---------------------------------------------*/
+static void decodebase(rtkmsvr_t *svr, int index, const uint8_t *buff, int n)
+{
+    raw_t *raw=svr->raw+index;
+    rtcm_t *rtcm=svr->rtcm+index;
+    obsd_t data[MAXOBS];
+    const obs_t *obs;
+    const nav_t *nav;
+    const sta_t *sta;
+    sbsmsg_t *sbsmsg=NULL;
+    int i,nb,ret,ephsat,ephset,fmt=svr->format[index];
+    
+    for (i=0;i<n;i++) {
+        if (fmt==STRFMT_RTCM2||fmt==STRFMT_RTCM3) {
+            ret=fmt==STRFMT_RTCM2?input_rtcm2(rtcm,buff[i]):
+                                  input_rtcm3(rtcm,buff[i]);
+            obs=&rtcm->obs; nav=&rtcm->nav; sta=&rtcm->sta;
+            ephsat=rtcm->ephsat; ephset=rtcm->ephset;
+        }
+        else {
+            ret=input_raw(raw,fmt,buff[i]);
+            obs=&raw->obs; nav=&raw->nav; sta=&raw->sta;
+            ephsat=raw->ephsat; ephset=raw->ephset;
+            sbsmsg=&raw->sbsmsg;
+        }
+        if (ret==1) { /* observation data */
+            svr->nmsg[index][0]++;
+            if (index!=0) continue;
+            nb=selobs(obs,&svr->opt,2,data);
+            rtklib_lock(&svr->lock);
+            memcpy(svr->base,data,sizeof(obsd_t)*nb);
+            svr->nb=nb;
+            rtklib_unlock(&svr->lock);
+        }
+        else if (ret==2) { /* ephemeris */
+            update_eph(svr,nav,ephsat,ephset);
+            svr->nmsg[index][satsys(ephsat,NULL)==SYS_GLO?6:1]++;
+        }
+        else if (ret==3) { /* sbas message */
+            if (sbsmsg&&(svr->opt.sbassatsel==sbsmsg->prn||
+                         svr->opt.sbassatsel==0)) {
+                sbsupdatecorr(sbsmsg,&svr->nav);
+                svr->dirty=1;
+            }
+            svr->nmsg[index][3]++;
+        }
+        else if (ret==5) { /* antenna position */
+            if (index==0&&svr->opt.refpos==POSOPT_RTCM) update_antpos(svr,sta);
+            svr->nmsg[index][4]++;
+        }
+        else if (ret==7) { /* dgps correction */
+            svr->nmsg[index][5]++;
+        }
+        else if (ret==9) { /* ion/utc parameters */
+            update_ionutc(svr,nav);
+            svr->nmsg[index][2]++;
+        }
+        else if (ret==10) { /* ssr message */
+            update_ssr(svr,rtcm);
+            svr->nmsg[index][7]++;
+        }
+        else if (ret==-1) { /* error */
+            svr->nmsg[index][9]++;
+        }
+    }
+}
+/* decode rover stream -------------------------------------------------------*/
+static void decoderov(rtkmsvr_t *svr, rtkmrov_t *rov, const uint8_t *buff,
+                      int n)
+{
+    obsd_t data[MAXOBS];
+    const obs_t *obs;
+    int i,nr,ret;
+    
+    for (i=0;i<n;i++) {
+        if (rov->format==STRFMT_RTCM2||rov->format==STRFMT_RTCM3) {
+            ret=rov->format==STRFMT_RTCM2?input_rtcm2(rov->rtcm,buff[i]):
+                                          input_rtcm3(rov->rtcm,buff[i]);
+            obs=&rov->rtcm->obs;
+        }
+        else {
+            ret=input_raw(rov->raw,rov->format,buff[i]);
+            obs=&rov->raw->obs;
+        }
+        /* navigation data of rovers are not used */
+        if (ret!=1||(nr=selobs(obs,&rov->opt,1,data))<=0) continue;
+    
+        /* pending epoch not processed yet is overwritten */
+        rtklib_lock(&svr->lock);
+        if (rov->nobs>0) rov->lat.ndrop++;
+        memcpy(rov->obs,data,sizeof(obsd_t)*nr);
+        rov->nobs=nr;
+        rov->tick=tickget();
+        rtklib_unlock(&svr->lock);
+    }
+}
+/* process rover epoch ---------------------------------------------------------
+* run rtkpos() for the rover epoch with the base epoch and navigation snapshot
+* and write the solution to the output stream of the rover
+*-----------------------------------------------------------------------------*/
+static void procrov(rtkmrov_t *rov, obsd_t *obs, int n, const double *rb,
+                    const nav_t *nav)
+{
+    uint8_t buff[2*MAXSOLMSG+1];
+    uint64_t t0;
+    int i,m;
+    
+    if (rov->opt.refpos==POSOPT_RTCM&&norm(rb,3)>0.0) {
+        for (i=0;i<6;i++) rov->rtk.rb[i]=rb[i];
+    }
+    t0=metbegin();
+    rtkpos(&rov->rtk,obs,n,nav);
+    metend(MET_RTKPOS,t0);
+    
+    if (rov->rtk.sol.stat==SOLQ_NONE) return;
+    
+    t0=metbegin();
+    m=outsols(buff,&rov->rtk.sol,rov->rtk.rb,&rov->solopt);
+    m+=outsolexs(buff+m,&rov->rtk.sol,rov->rtk.ssat,&rov->solopt);
+    if (m>0) strwrite(rov->stream+1,buff,m);
+    metend(MET_OUT,t0);
+}
+/* worker thread ---------------------------------------------------------------
+* pick up pending rover epochs in round-robin and process them
+*-----------------------------------------------------------------------------*/
+#ifdef WIN32
+static DWORD WINAPI workerthread(void *arg)
+#else
+static void *workerthread(void *arg)
+#endif
+{
+    rtkmsvr_t *svr=(rtkmsvr_t *)arg;
+    rtkmrov_t *rov;
+    rtkmsnap_t *snap;
+    rtkctx_t *ctx,wctx;
+    obsd_t *obs;
+    double rb[6];
+    uint32_t tick,tick0;
+    int i,j,k,n;
+    
+    tracet(3,"rtkmsvr workerthread:\n");
+    
+    /* context of worker without solution status file */
+    setrtkctx(svr->ctx);
+    ctx=getrtkctx();
+    wctx=*ctx;
+    wctx.fp_stat=NULL;
+    wctx.nclose=0;
+    setrtkctx(&wctx);
+    
+    if (!(obs=(obsd_t *)malloc(sizeof(obsd_t)*MAXOBS*2))) return 0;
+    
+    while (svr->state) {
+        rov=NULL; snap=NULL; n=0; tick0=0;
+    
+        rtklib_lock(&svr->lock);
+        for (i=0;i<svr->nrov;i++) {
+            k=(svr->next+i)%svr->nrov;
+            if (svr->rov[k].nobs<=0||svr->rov[k].busy) continue;
+            rov=svr->rov+k;
+            svr->next=(k+1)%svr->nrov;
+            break;
+        }
+        if (rov) {
+            tick0=rov->tick;
+    
+            /* skip epoch over processing time budget */
+            if (rov->budget>0&&(int)(tickget()-tick0)>rov->budget) {
+                rov->lat.ndrop++;
+                rov->nobs=0;
+                rov=NULL;
+            }
+        }
+        if (rov) {
+            memcpy(obs,rov->obs,sizeof(obsd_t)*rov->nobs);
+            n=rov->nobs;
+            for (j=0;j<svr->nb&&n<MAXOBS*2;j++) obs[n++]=svr->base[j];
+            for (j=0;j<6;j++) rb[j]=svr->rb[j];
+            rov->nobs=0;
+            rov->busy=1;
+            snap=acqsnap(svr);
+        }
+        rtklib_unlock(&svr->lock);
+    
+        if (!rov) {
+            sleepms(POLLCYCLE);
+            continue;
+        }
+        if (snap) {
+            tick=tickget();
+            procrov(rov,obs,n,rb,&snap->nav);
+            if (rov->budget>0&&(int)(tickget()-tick)>rov->budget) rov->nover++;
+        }
+        rtklib_lock(&svr->lock);
+        relsnap(snap);
+        if (snap) {
+            rov->sol=rov->rtk.sol;
+            updatelat(&rov->lat,tick0);
+    
+            /* output solution status to shared status file */
+            if (ctx->fp_stat) {
+                setrtkctx(ctx);
+                rtkoutsolstat(&rov->rtk);
+                setrtkctx(&wctx);
+            }
+        }
+        else {
+            rov->lat.ndrop++; /* no navigation data */
+        }
+        rov->busy=0;
+        rtklib_unlock(&svr->lock);
+    }
+    free(obs);
+    return 0;
+}
+/* multi-rover rtk server thread -----------------------------------------------
+* start worker threads and decode base, correction and rover streams
+*-----------------------------------------------------------------------------*/
+#ifdef WIN32
+static DWORD WINAPI rtkmsvrthread(void *arg)
+#else
+static void *rtkmsvrthread(void *arg)
+#endif
+{
+    rtkmsvr_t *svr=(rtkmsvr_t *)arg;
+    uint8_t *buff;
+    uint32_t tick;
+    int i,n,cputime;
+    
+    tracet(3,"rtkmsvrthread:\n");
+    
+    setrtkctx(svr->ctx);
+    
+    if (!(buff=(uint8_t *)malloc(BUFFSIZE))) {
+        tracet(1,"rtkmsvrthread: malloc error\n");
+        svr->state=0;
+    }
+    for (i=0;i<svr->nworker&&svr->state;i++) {
+        if (!createthread(svr->wthread+i,workerthread,svr)) {
+            tracet(1,"rtkmsvrthread: worker thread create error\n");
+            break;
+        }
+        svr->nwthread++;
+    }
+    if (svr->nwthread<=0) svr->state=0;
+    
+    while (svr->state) {
+        tick=tickget();
+    
+        /* decode base and correction streams */
+        for (i=0;i<2;i++) {
+            if ((n=strread(svr->stream+i,buff,BUFFSIZE))>0) {
+                decodebase(svr,i,buff,n);
+            }
+        }
+        /* publish navigation snapshot if updated */
+        if (svr->dirty) publishsnap(svr);
+    
+        /* decode rover streams */
+        for (i=0;i<svr->nrov;i++) {
+            if ((n=strread(svr->rov[i].stream,buff,BUFFSIZE))>0) {
+                decoderov(svr,svr->rov+i,buff,n);
+            }
+        }
+        cputime=(int)(tickget()-tick);
+        sleepms(svr->cycle-cputime);
+    }
+    for (i=0;i<svr->nwthread;i++) jointhread(svr->wthread[i]);
+    svr->nwthread=0;
+    free(buff);
+    
+    for (i=0;i<2;i++) strclose(svr->stream+i);
+    for (i=0;i<svr->nrov;i++) {
+        strclose(svr->rov[i].stream  );
+        strclose(svr->rov[i].stream+1);
+    }
+    return 0;
+}
+/* initialize multi-rover rtk server -------------------------------------------
+* initialize multi-rover rtk server
+* args   : rtkmsvr_t *svr   IO multi-rover rtk server
+*          int    nrov      I  number of rovers
+* return : status (0:error,1:ok)
+* notes  : svr->ctx is set to NULL (the server uses the default library
+*          context). the context is bound to the server thread and a copy
+*          of the context without the status file to each worker thread
+*-----------------------------------------------------------------------------*/
+extern int rtkmsvrinit(rtkmsvr_t *svr, int nrov)
+{
+    int i;
+    
+    tracet(3,"rtkmsvrinit: nrov=%d\n",nrov);
+    
+    memset(svr,0,sizeof(rtkmsvr_t));
+    svr->opt=prcopt_default;
+    
+    if (nrov<=0) return 0;
+    
+    if (!(svr->nav.eph =(eph_t  *)calloc(MAXSAT*4 ,sizeof(eph_t )))||
+        !(svr->nav.geph=(geph_t *)calloc(NSATGLO*2,sizeof(geph_t)))||
+        !(svr->nav.seph=(seph_t *)calloc(NSATSBS*2,sizeof(seph_t)))||
+        !(svr->raw =(raw_t  *)calloc(2,sizeof(raw_t )))||
+        !(svr->rtcm=(rtcm_t *)calloc(2,sizeof(rtcm_t)))||
+        !(svr->base=(obsd_t *)calloc(MAXOBS,sizeof(obsd_t)))||
+        !(svr->rov =(rtkmrov_t *)calloc(nrov,sizeof(rtkmrov_t)))||
+        !(svr->wthread=(rtklib_thread_t *)calloc(MAXWORKER,
+                                                 sizeof(rtklib_thread_t)))) {
+        tracet(1,"rtkmsvrinit: malloc error\n");
+        rtkmsvrfree(svr);
+        return 0;
+    }
+    svr->nav.n =svr->nav.nmax =MAXSAT*4;
+    svr->nav.ng=svr->nav.ngmax=NSATGLO*2;
+    svr->nav.ns=svr->nav.nsmax=NSATSBS*2;
+    for (i=0;i<MAXSAT*4;i++) {
+        svr->nav.eph[i].iode=-1; svr->nav.eph[i].iodc=-1;
+    }
+    for (i=0;i<NSATGLO*2;i++) svr->nav.geph[i].iode=-1;
+    svr->nrov=nrov;
+    
+    for (i=0;i<nrov;i++) {
+        svr->rov[i].opt=prcopt_default;
+        svr->rov[i].solopt=solopt_default;
+        if (!(svr->rov[i].obs=(obsd_t *)calloc(MAXOBS,sizeof(obsd_t)))) {
+            tracet(1,"rtkmsvrinit: malloc error\n");
+            rtkmsvrfree(svr);
+            return 0;
+        }
+        strinit(svr->rov[i].stream  );
+        strinit(svr->rov[i].stream+1);
+    }
+    for (i=0;i<2;i++) strinit(svr->stream+i);
+    rtklib_initlock(&svr->lock);
+    return 1;
+}
+/* free multi-rover rtk server -------------------------------------------------
+* free multi-rover rtk server
+* args   : rtkmsvr_t *svr   IO multi-rover rtk server
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void rtkmsvrfree(rtkmsvr_t *svr)
+{
+    int i;
+    
+    tracet(3,"rtkmsvrfree:\n");
+    
+    if (svr->rov) {
+        for (i=0;i<svr->nrov;i++) {
+            if (svr->rov[i].raw ) free_raw (svr->rov[i].raw );
+            if (svr->rov[i].rtcm) free_rtcm(svr->rov[i].rtcm);
+            free(svr->rov[i].raw);
+            free(svr->rov[i].rtcm);
+            free(svr->rov[i].obs);
+            rtkfree(&svr->rov[i].rtk);
+        }
+    }
+    if (svr->raw ) for (i=0;i<2;i++) free_raw (svr->raw +i);
+    if (svr->rtcm) for (i=0;i<2;i++) free_rtcm(svr->rtcm+i);
+    relsnap(svr->snap);
+    free(svr->nav.eph); free(svr->nav.geph); free(svr->nav.seph);
+    free(svr->raw); free(svr->rtcm); free(svr->base); free(svr->rov);
+    free(svr->wthread);
+    svr->snap=NULL; svr->nav.eph=NULL; svr->nav.geph=NULL; svr->nav.seph=NULL;
+    svr->raw=NULL; svr->rtcm=NULL; svr->base=NULL; svr->rov=NULL;
+    svr->wthread=NULL;
+    svr->nrov=0;
+}
+/* set rover of multi-rover rtk server -----------------------------------------
+* set streams and options of a rover before starting the server
+* args   : rtkmsvr_t *svr   IO multi-rover rtk server
+*          int    index     I  rover index (0 to svr->nrov-1)
+*          int    *strs     I  stream types {input,output} (STR_???)
+*          char   **paths   I  stream paths {input,output}
+*          int    format    I  input stream format (STRFMT_???)
+*          int    budget    I  processing time budget of an epoch (ms)
+*                              (0: no limit)
+*          prcopt_t *prcopt I  rtk processing options of the rover
+*          solopt_t *solopt I  solution options of the rover
+* return : status (0:error,1:ok)
+* notes  : an epoch waiting for a worker longer than the budget is skipped.
+*          navigation messages in the rover stream are not used
+*-----------------------------------------------------------------------------*/
+extern int rtkmsvrsetrov(rtkmsvr_t *svr, int index, const int *strs,
+                         const char **paths, int format, int budget,
+                         const prcopt_t *prcopt, const solopt_t *solopt)
+{
+    rtkmrov_t *rov;
+    int i;
+    
+    tracet(3,"rtkmsvrsetrov: index=%d format=%d budget=%d\n",index,format,
+           budget);
+    
+    if (svr->state||index<0||index>=svr->nrov) return 0;
+    
+    rov=svr->rov+index;
+    for (i=0;i<2;i++) {
+        rov->strtype[i]=strs[i];
+        strncpy(rov->path[i],paths[i],MAXSTRPATH-1);
+    }
+    rov->format=format;
+    rov->budget=budget>0?budget:0;
+    rov->opt=*prcopt;
+    rov->solopt=*solopt;
+    return 1;
+}
+/* start multi-rover rtk server ------------------------------------------------
+* open streams and start multi-rover rtk server thread
+* args   : rtkmsvr_t *svr   IO multi-rover rtk server
+*          int    cycle     I  server cycle (ms)
+*          int    nworker   I  number of worker threads
+*          int    *strs     I  input stream types {base,corr} (STR_???)
+*          char   **paths   I  input stream paths {base,corr}
+*          int    *formats  I  input stream formats {base,corr} (STRFMT_???)
+*          prcopt_t *prcopt I  processing options for base and corrections
+*                              (navsys,exsats,sbassatsel,refpos)
+*          char   *errmsg   O  error message
+* return : status (0:error,1:ok)
+* notes  : the rovers have to be set by rtkmsvrsetrov() before starting
+*-----------------------------------------------------------------------------*/
+extern int rtkmsvrstart(rtkmsvr_t *svr, int cycle, int nworker,
+                        const int *strs, const char **paths,
+                        const int *formats, const prcopt_t *prcopt,
+                        char *errmsg)
+{
+    rtkmrov_t *rov;
+    uint8_t buff[1024];
+    gtime_t time;
+    int i,j,n;
+    
+    tracet(3,"rtkmsvrstart: cycle=%d nworker=%d\n",cycle,nworker);
+    
+    if (svr->state) {
+        sprintf(errmsg,"server already started");
+        return 0;
+    }
+    strinitcom();
+    svr->cycle=cycle>1?cycle:1;
+    svr->nworker=nworker<1?1:(nworker>MAXWORKER?MAXWORKER:nworker);
+    svr->opt=*prcopt;
+    svr->nb=0;
+    svr->dirty=1;
+    for (i=0;i<6;i++) svr->rb[i]=0.0;
+    memset(svr->nmsg,0,sizeof(svr->nmsg));
+    
+    for (i=0;i<2;i++) {
+        svr->format[i]=formats[i];
+        free_raw (svr->raw +i);
+        free_rtcm(svr->rtcm+i);
+        if (!init_raw(svr->raw+i,formats[i])||!init_rtcm(svr->rtcm+i)) {
+            sprintf(errmsg,"rtk server malloc error");
+            return 0;
+        }
+        svr->rtcm[i].dgps=svr->nav.dgps;
+    }
+    for (i=0;i<svr->nrov;i++) {
+        rov=svr->rov+i;
+        if (!rov->raw ) rov->raw =(raw_t  *)calloc(1,sizeof(raw_t ));
+        if (!rov->rtcm) rov->rtcm=(rtcm_t *)calloc(1,sizeof(rtcm_t));
+        if (!rov->raw||!rov->rtcm) {
+            sprintf(errmsg,"rtk server malloc error");
+            return 0;
+        }
+        free_raw (rov->raw );
+        free_rtcm(rov->rtcm);
+        if (!init_raw(rov->raw,rov->format)||!init_rtcm(rov->rtcm)) {
+            sprintf(errmsg,"rtk server malloc error");
+            return 0;
+        }
+        rtkfree(&rov->rtk);
+        rtkinit(&rov->rtk,&rov->opt);
+        rov->nobs=rov->busy=0;
+        rov->nover=0;
+        memset(&rov->lat,0,sizeof(rtksvrlat_t));
+    }
+    /* open base/correction streams */
+    for (i=0;i<2;i++) {
+        if (!stropen(svr->stream+i,strs[i],STR_MODE_RW,paths[i])) {
+            sprintf(errmsg,"str%d open error path=%s",i+1,paths[i]);
+            for (i--;i>=0;i--) strclose(svr->stream+i);
+            return 0;
+        }
+        time=utc2gpst(timeget());
+        svr->raw [i].time=strs[i]==STR_FILE?strgettime(svr->stream+i):time;
+        svr->rtcm[i].time=strs[i]==STR_FILE?strgettime(svr->stream+i):time;
+    }
+    /* open rover streams */
+    for (i=0;i<svr->nrov;i++) {
+        rov=svr->rov+i;
+        for (j=0;j<2;j++) {
+            if (stropen(rov->stream+j,rov->strtype[j],
+                        j==0?STR_MODE_RW:STR_MODE_W,rov->path[j])) continue;
+            sprintf(errmsg,"rover %d str%d open error path=%s",i+1,j+1,
+                    rov->path[j]);
+            for (j--;j>=0;j--) strclose(rov->stream+j);
+            for (i--;i>=0;i--) {
+                strclose(svr->rov[i].stream  );
+                strclose(svr->rov[i].stream+1);
+            }
+            for (j=0;j<2;j++) strclose(svr->stream+j);
+            return 0;
+        }
+        time=utc2gpst(timeget());
+        rov->raw ->time=rov->strtype[0]==STR_FILE?strgettime(rov->stream):time;
+        rov->rtcm->time=rov->strtype[0]==STR_FILE?strgettime(rov->stream):time;
+    
+        /* write solution header */
+        n=outsolheads(buff,&rov->solopt);
+        strwrite(rov->stream+1,buff,n);
+    }
+    /* create multi-rover rtk server thread */
+    svr->state=1;
+    if (!createthread(&svr->thread,rtkmsvrthread,svr)) {
+        svr->state=0;
+        for (i=0;i<2;i++) strclose(svr->stream+i);
+        for (i=0;i<svr->nrov;i++) {
+            strclose(svr->rov[i].stream  );
+            strclose(svr->rov[i].stream+1);
+        }
+        sprintf(errmsg,"thread create error\n");
+        return 0;
+    }
+    return 1;
+}
+/* stop multi-rover rtk server -------------------------------------------------
+* stop multi-rover rtk server thread and worker threads
+* args   : rtkmsvr_t *svr   IO multi-rover rtk server
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void rtkmsvrstop(rtkmsvr_t *svr)
+{
+    tracet(3,"rtkmsvrstop:\n");
+    
+    if (!svr->state) return;
+    svr->state=0;
+    jointhread(svr->thread);
+}
+/* get rover status of multi-rover rtk server ----------------------------------
+* get the latest solution and processing counts of a rover
+* args   : rtkmsvr_t *svr   I  multi-rover rtk server
+*          int    index     I  rover index (0 to svr->nrov-1)
+*          sol_t  *sol      O  latest solution (NULL: not output)
+*          rtksvrlat_t *lat O  latency from receiving epoch to solution
+*                              (lat->n: processed, lat->ndrop: skipped epochs)
+*                              (NULL: not output)
+*          uint32_t *nover  O  number of epochs processed over budget
+*                              (NULL: not output)
+* return : version of latest navigation snapshot (0: no snapshot or error)
+*-----------------------------------------------------------------------------*/
+extern int rtkmsvrrstat(rtkmsvr_t *svr, int index, sol_t *sol,
+                        rtksvrlat_t *lat, uint32_t *nover)
+{
+    int ver;
+    
+    if (index<0||index>=svr->nrov) return 0;
+    
+    rtklib_lock(&svr->lock);
+    if (sol  ) *sol  =svr->rov[index].sol;
+    if (lat  ) *lat  =svr->rov[index].lat;
+    if (nover) *nover=svr->rov[index].nover;
+    ver=(int)svr->ver;
+    rtklib_unlock(&svr->lock);
+    return ver;
+}
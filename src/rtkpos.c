@@ -46,6 +46,33 @@
 *                           add detecting cycle slips by L1-Lx GF phase jump
 *                           delete GLONASS IFB correction in ddres()
 *                           use integer types in stdint.h
+*           2026/10/19 1.17 compute sun/moon position once per epoch for
+*                            satposs() and tidedisp() of rover and base
+*                           move solution status output to library context
+*                           compute troposphere site terms once per receiver
+*                            and mapping functions by tropmapf_batch()
+*                           add metrics spans of satellite positions,
+*                            residuals, filter and ambiguity resolution
+*                           add deadline mode shedding optional processing
+*                            by processing time budget of epoch
+*                           cache base station satellite states and residuals
+*                            per base epoch for high-rate rover
+*                           allocate scratch matrices in workspace of rtk
+*                            control struct
+*                           update only position/velocity/acceleration rows
+*                            and columns in udpos()
+*                           add active state index and copy covariance of
+*                            active states only in relpos()
+*                           hold tidal displacement cache in rtk control
+*                            struct
+*                           add api rtkoutsolstat()
+*                           key base station cache by all navigation data
+*                            and options used for base station
+*                           use pvatrans() for state transition in udpos()
+*                           move api rtkactstate() to rtkcmn.c
+*                           use filter_ws(),lambda_ws(),matinv_ws() and
+*                            pntpos_ws() with workspace of rtk control struct
+*                           pass active state index to filter_ws()
 *-----------------------------------------------------------------------------*/
 #include <stdarg.h>
 #include "rtklib.h"
@@ -62,6 +89,7 @@
 #define MIN(x,y)    ((x)<=(y)?(x):(y))
 #define MAX(x,y)    ((x)>=(y)?(x):(y))
 #define ROUND(x)    (int)floor((x)+0.5)
+#define HASHK(k,v)  (((k)^(uint64_t)(v))*FNV_PRIME)
 
 #define VAR_POS     SQR(30.0) /* initial variance of receiver pos (m^2) */
 #define VAR_POS_FIX SQR(1e-4) /* initial variance of fixed receiver pos (m^2) */
@@ -73,6 +101,10 @@
 #define GAP_RESION  120      /* gap to reset ionosphere parameters (epochs) */
 
 #define TTOL_MOVEB  (1.0+2*DTTOL)
+#define ELMIN_DEGR  (15.0*D2R) /* elevation mask in degraded mode (rad) */
+#define MAXDEGR     4        /* max degradation level of deadline mode */
+#define FNV_OFFSET  14695981039346656037ULL /* fnv-1a 64 offset basis */
+#define FNV_PRIME   1099511628211ULL    /* fnv-1a 64 prime */
                              /* time sync tolerance for moving-baseline (s) */
 
 /* number of parameters (pos,ionos,tropos,hw-bias,phase-bias,real,estimated) */
@@ -98,12 +130,6 @@ static double ar_poly_coeffs[3][5] = {
     {6.42237302e-01, -8.39813962e+00,  2.92107285e+01, -2.37577308e+01, -1.14307128e+00},
     {-2.22600390e-02,  3.23169103e-01, -1.39837429e+00, 2.19282996e+00, -5.34583971e-02}};
 
-/* global variables ----------------------------------------------------------*/
-static int statlevel=0;          /* rtk status output level (0:off) */
-static FILE *fp_stat=NULL;       /* rtk status file pointer */
-static char file_stat[1024]="";  /* rtk status file original path */
-static gtime_t time_stat={0};    /* rtk status file time */
-
 /* open solution status file ---------------------------------------------------
 * open solution status file and set output level
 * args   : char     *file   I   rtk status file
@@ -111,6 +137,7 @@ static gtime_t time_stat={0};    /* rtk status file time */
 * return : status (1:ok,0:error)
 * notes  : file can constain time keywords (%Y,%y,%m...) defined in reppath().
 *          The time to replace keywords is based on UTC of CPU time.
+*          The file is opened in the library context of the calling thread.
 * output : solution status file record format
 *
 *   $POS,week,tow,stat,posx,posy,posz,posxf,posyf,poszf
@@ -181,6 +208,7 @@ static gtime_t time_stat={0};    /* rtk status file time */
 *-----------------------------------------------------------------------------*/
 extern int rtkopenstat(const char *file, int level)
 {
+    rtkctx_t *ctx=getrtkctx();
     gtime_t time=utc2gpst(timeget());
     char path[1024];
 
@@ -190,13 +218,14 @@ extern int rtkopenstat(const char *file, int level)
 
     reppath(file,path,time,"","");
 
-    if (!(fp_stat=fopen(path,"w"))) {
+    if (!(ctx->fp_stat=fopen(path,"w"))) {
         trace(1,"rtkopenstat: file open error path=%s\n",path);
         return 0;
     }
-    strcpy(file_stat,file);
-    time_stat=time;
-    statlevel=level;
+    strcpy(ctx->file_stat,file);
+    ctx->time_stat=time;
+    ctx->statlevel=level;
+    add_ctxclose(rtkclosestat);
     return 1;
 }
 /* close solution status file --------------------------------------------------
@@ -206,12 +235,14 @@ extern int rtkopenstat(const char *file, int level)
 *-----------------------------------------------------------------------------*/
 extern void rtkclosestat(void)
 {
+    rtkctx_t *ctx=getrtkctx();
+
     trace(3,"rtkclosestat:\n");
 
-    if (fp_stat) fclose(fp_stat);
-    fp_stat=NULL;
-    file_stat[0]='\0';
-    statlevel=0;
+    if (ctx->fp_stat) fclose(ctx->fp_stat);
+    ctx->fp_stat=NULL;
+    ctx->file_stat[0]='\0';
+    ctx->statlevel=0;
 }
 /* Write solution status to buffer -------------------------------------------*/
 extern int rtkoutstat(rtk_t *rtk, int level, char *buff)
@@ -301,6 +332,11 @@ extern int rtkoutstat(rtk_t *rtk, int level, char *buff)
             }
         }
     }
+    /* Degradations by deadline */
+    if (rtk->sol.degrade) {
+        p+=sprintf(p,"$DEGR,%d,%.3f,%d,%d\n",week,tow,rtk->sol.stat,
+                   rtk->sol.degrade);
+    }
 
     if (level <= 1) return (int)(p-buff);
 
@@ -323,44 +359,53 @@ extern int rtkoutstat(rtk_t *rtk, int level, char *buff)
     return (int)(p-buff);
 }
 /* swap solution status file -------------------------------------------------*/
-static void swapsolstat(void)
+static void swapsolstat(rtkctx_t *ctx)
 {
     gtime_t time=utc2gpst(timeget());
     char path[1024];
 
-    if ((int)(time2gpst(time     ,NULL)/INT_SWAP_STAT)==
-        (int)(time2gpst(time_stat,NULL)/INT_SWAP_STAT)) {
+    if ((int)(time2gpst(time          ,NULL)/INT_SWAP_STAT)==
+        (int)(time2gpst(ctx->time_stat,NULL)/INT_SWAP_STAT)) {
         return;
     }
-    time_stat=time;
+    ctx->time_stat=time;
 
-    if (!reppath(file_stat,path,time,"","")) {
+    if (!reppath(ctx->file_stat,path,time,"","")) {
         return;
     }
-    if (fp_stat) fclose(fp_stat);
+    if (ctx->fp_stat) fclose(ctx->fp_stat);
 
-    if (!(fp_stat=fopen(path,"w"))) {
+    if (!(ctx->fp_stat=fopen(path,"w"))) {
         trace(2,"swapsolstat: file open error path=%s\n",path);
         return;
     }
     trace(3,"swapsolstat: path=%s\n",path);
 }
-/* output solution status ----------------------------------------------------*/
-static void outsolstat(rtk_t *rtk,const nav_t *nav)
+/* output solution status to file ----------------------------------------------
+* output solution status to solution status file of current library context
+* args   : rtk_t *rtk       I   rtk control/result struct
+* return : none
+* notes  : rtkpos() outputs the solution status by the function. threads
+*          sharing a status file run rtkpos() with contexts without the status
+*          file and call the function with the shared context under a lock
+*-----------------------------------------------------------------------------*/
+extern void rtkoutsolstat(rtk_t *rtk)
 {
-    if (statlevel<=0||!fp_stat||!rtk->sol.stat) return;
+    rtkctx_t *ctx=getrtkctx();
+
+    if (ctx->statlevel<=0||!ctx->fp_stat||!rtk->sol.stat) return;
 
-    trace(3,"outsolstat:\n");
+    trace(3,"rtkoutsolstat:\n");
 
     /* swap solution status file */
-    swapsolstat();
+    swapsolstat(ctx);
 
     /* write solution status */
     char buff[3*MAXSOLMSG+1];
-    int n=rtkoutstat(rtk,statlevel,buff);
+    int n=rtkoutstat(rtk,ctx->statlevel,buff);
     buff[n]='\0';
     
-    fputs(buff,fp_stat);
+    fputs(buff,ctx->fp_stat);
 }
 /* save error message --------------------------------------------------------*/
 static void errmsg(rtk_t *rtk, const char *format, ...)
@@ -459,6 +504,18 @@ static inline void initx(rtk_t *rtk, double xi, double var, int i)
     for (j=0;j<rtk->nx;j++) rtk->P[i+j*rtk->nx]=0.0;
     for (j=0;j<rtk->nx;j++) rtk->P[j+i*rtk->nx]=0.0;
     rtk->P[i+i*rtk->nx]=var;
+    rtkactstate(rtk,i);
+}
+/* copy covariance of active states ------------------------------------------*/
+static void cpyactP(const rtk_t *rtk, double *Pd, const double *Ps)
+{
+    int i,j,k,nx=rtk->nx;
+
+    for (i=0;i<nx;i++) Pd[i+i*nx]=Ps[i+i*nx];
+    for (j=0;j<rtk->nxs;j++) for (i=0;i<rtk->nxs;i++) {
+        k=rtk->ixs[i]+rtk->ixs[j]*nx;
+        Pd[k]=Ps[k];
+    }
 }
 /* select common satellites between rover and reference station --------------*/
 static int selsat(const obsd_t *obs, double *azel, int nu, int nr,
@@ -481,7 +538,8 @@ static int selsat(const obsd_t *obs, double *azel, int nu, int nr,
 /* temporal update of position/velocity/acceleration -------------------------*/
 static void udpos(rtk_t *rtk, double tt)
 {
-    double *F,*P,*FP,*x,*xp,pos[3],Q[9]={0},Qv[9],var=0.0;
+    double *P=rtk->P,pos[3],Q[9]={0},Qv[9],var=0.0,ta=0.0;
+    size_t mark;
     int i,j,*ix,nx;
 
     trace(3,"udpos   : tt=%.3f\n",tt);
@@ -521,41 +579,21 @@ static void udpos(rtk_t *rtk, double tt)
         return;
     }
     /* generate valid state index */
-    ix=imat(rtk->nx,1);
+    mark=wsmark(&rtk->ws);
+    ix=wsimat(&rtk->ws,rtk->nx,1);
     for (i=nx=0;i<rtk->nx;i++) {
          /*    TODO:  The b34 code causes issues so use b33 code for now */
         if (i<9||(rtk->x[i]!=0.0&&rtk->P[i+i*rtk->nx]>0.0)) ix[nx++]=i;
     }
-    /* state transition of position/velocity/acceleration */
-    F=eye(nx); P=mat(nx,nx); FP=mat(nx,nx); x=mat(nx,1); xp=mat(nx,1);
-
-    for (i=0;i<6;i++) {
-        F[i+(i+3)*nx]=tt;
-    }
     /* include accel terms if filter is converged */
     if (var<rtk->opt.thresar[1]) {
-        for (i=0;i<3;i++) {
-            F[i+(i+6)*nx]=(tt>=0?1:-1)*SQR(tt)/2.0;
-        }
+        ta=(tt>=0?1:-1)*SQR(tt)/2.0;
     }
     else trace(3,"pos var too high for accel term: %.4f\n", var);
-    for (i=0;i<nx;i++) {
-        x[i]=rtk->x[ix[i]];
-        for (j=0;j<nx;j++) {
-            P[i+j*nx]=rtk->P[ix[i]+ix[j]*rtk->nx];
-        }
-    }
-    /* x=F*x, P=F*P*F' */
-    matmul("NN",nx,1,nx,F,x,xp);
-    matmul("NN",nx,nx,nx,F,P,FP);
-    matmul("NT",nx,nx,nx,FP,F,P);
-    
-    for (i=0;i<nx;i++) {
-        rtk->x[ix[i]]=xp[i];
-        for (j=0;j<nx;j++) {
-            rtk->P[ix[i]+ix[j]*rtk->nx]=P[i+j*nx];
-        }
-    }
+
+    /* state transition of position/velocity/acceleration x=F*x, P=F*P*F' */
+    pvatrans(rtk->x,P,rtk->nx,ix,nx,tt,ta);
+    for (i=0;i<6;i++) rtkactstate(rtk,i);
     /* process noise added to only acceleration  P=P+Q */
     Q[0]=Q[4]=SQR(rtk->opt.prn[3])*fabs(tt);
     Q[8]=SQR(rtk->opt.prn[4])*fabs(tt);
@@ -564,7 +602,7 @@ static void udpos(rtk_t *rtk, double tt)
     for (i=0;i<3;i++) for (j=0;j<3;j++) {
         rtk->P[i+6+(j+6)*rtk->nx]+=Qv[i+j*3];
     }
-    free(ix); free(F); free(P); free(FP); free(x); free(xp);
+    wsrelease(&rtk->ws,mark);
 }
 /* temporal update of ionospheric parameters ---------------------------------*/
 static void udion(rtk_t *rtk, double tt, double bl, const int *sat, int ns)
@@ -578,8 +616,10 @@ static void udion(rtk_t *rtk, double tt, double bl, const int *sat, int ns)
     for (i=1;i<=MAXSAT;i++) {
         j=II(i,&rtk->opt);
         if (rtk->x[j]!=0.0&&
-            rtk->ssat[i-1].outc[0]>GAP_RESION&&rtk->ssat[i-1].outc[1]>GAP_RESION)
+            rtk->ssat[i-1].outc[0]>GAP_RESION&&rtk->ssat[i-1].outc[1]>GAP_RESION) {
             rtk->x[j]=0.0;
+            rtkactstate(rtk,j);
+        }
     }
     for (i=0;i<ns;i++) {
         j=II(sat[i],&rtk->opt);
@@ -801,6 +841,7 @@ static void udbias(rtk_t *rtk, double tt, const obsd_t *obs, const int *sat,
                    const int *iu, const int *ir, int ns, const nav_t *nav)
 {
     double cp,pr,cp1,cp2,pr1,pr2,*bias,offset,freqi,freq1,freq2,C1,C2;
+    size_t mark;
     int i,j,k,slip,rejc,reset,nf=NF(&rtk->opt),f2;
 
     trace(3,"udbias  : tt=%.3f ns=%d\n",tt,ns);
@@ -864,12 +905,14 @@ static void udbias(rtk_t *rtk, double tt, const obsd_t *obs, const int *sat,
             if (rtk->opt.modear==ARMODE_INST||(!(slip&LLI_SLIP)&&rejc<2)) continue;
             /* reset phase-bias state if detecting cycle slip or outlier */
             rtk->x[j]=0.0;
+            rtkactstate(rtk,j);
             rtk->ssat[sat[i]-1].rejc[k]=0;
             rtk->ssat[sat[i]-1].lock[k]=-rtk->opt.minlock;
             /* retain icbiases for GLONASS sats */
             if (rtk->ssat[sat[i]-1].sys!=SYS_GLO) rtk->ssat[sat[i]-1].icbias[k]=0;
         }
-        bias=zeros(ns,1);
+        mark=wsmark(&rtk->ws);
+        bias=wszeros(&rtk->ws,ns,1);
 
         /* estimate approximate phase-bias by delta phase - delta code */
         for (i=j=0,offset=0.0;i<ns;i++) {
@@ -918,7 +961,7 @@ static void udbias(rtk_t *rtk, double tt, const obsd_t *obs, const int *sat,
                 rtk->ssat[sat[i]-1].lock[k]=-rtk->opt.minlock;
             }
         }
-        free(bias);
+        wsrelease(&rtk->ws,mark);
     }
 }
 /* Temporal update of states --------------------------------------------------*/
@@ -1009,18 +1052,21 @@ static void zdres_sat(int base, double r, const obsd_t *obs, const nav_t *nav,
         I   var  = variance of ephemeris
         I   svh  = sat health flags
         I   nav  = sat nav data
+        I   astro= astronomical context of obs epoch (NULL: computed if needed)
         I   rr   = rcvr pos (x,y,z)
         I   opt  = options
         O   y[(0:1)+i*2] = zero diff residuals {phase,code} (m)
         O   e    = line of sight unit vectors to sats
         O   azel = [az, el] to sats                                           */
-static int zdres(int base, const obsd_t *obs, int n, const double *rs,
-                 const double *dts, const double *var, const int *svh,
-                 const nav_t *nav, const double *rr, const prcopt_t *opt,
-                 double *y, double *e, double *azel, double *freq)
+static int zdres(wspace_t *ws, void **tide, int base, const obsd_t *obs, int n,
+                 const double *rs, const double *dts, const double *var,
+                 const int *svh, const nav_t *nav, const astro_t *astro,
+                 const double *rr, const prcopt_t *opt, double *y, double *e,
+                 double *azel, double *freq)
 {
-    double r,rr_[3],pos[3],dant[NFREQ]={0},disp[3];
-    double mapfh,zhd,zazel[]={0.0,90.0*D2R};
+    tropsite_t site={{0}};
+    double *r,*mapfs,rr_[3],pos[3],dant[NFREQ]={0},disp[3];
+    size_t mark;
     int i,nf=NF(opt);
 
     trace(3,"zdres   : n=%d rr=%.2f %.2f %.2f\n",n,rr[0], rr[1], rr[2]);
@@ -1035,38 +1081,54 @@ static int zdres(int base, const obsd_t *obs, int n, const double *rs,
 
     /* adjust rcvr pos for earth tide correction */
     if (opt->tidecorr) {
-        tidedisp(gpst2utc(obs[0].time),rr_,opt->tidecorr,&nav->erp,
-                 opt->odisp[base],disp);
+        if (opt->tideint>0.0) {
+            tidedisp_cache(tide,gpst2utc(obs[0].time),rr_,opt->tidecorr,
+                           &nav->erp,opt->odisp[base],opt->tideint,disp);
+        }
+        else {
+            tidedisp(gpst2utc(obs[0].time),rr_,opt->tidecorr,&nav->erp,astro,
+                     opt->odisp[base],disp);
+        }
         for (i=0;i<3;i++) rr_[i]+=disp[i];
     }
     /* translate rcvr pos from ecef to geodetic */
     ecef2pos(rr_,pos);
 
+    mark=wsmark(ws);
+    r=wsmat(ws,n,1); mapfs=wsmat(ws,n,2);
+
+    /* compute geometric-range and azimuth/elevation angle */
+    for (i=0;i<n;i++) {
+        if ((r[i]=geodist(rs+i*6,rr_,e+i*3))<=0.0) continue;
+        satazel(pos,e+i*3,azel+i*2);
+    }
+    /* troposphere mapping functions of all satellites */
+    settropsite(obs[0].time,pos,0.0,&site);
+    tropmapf_batch(&site,azel,n,mapfs);
+
     /* loop through satellites */
     for (i=0;i<n;i++) {
-        /* compute geometric-range and azimuth/elevation angle */
-        if ((r=geodist(rs+i*6,rr_,e+i*3))<=0.0) continue;
-        if (satazel(pos,e+i*3,azel+i*2)<opt->elmin) continue;
+        if (r[i]<=0.0||azel[1+i*2]<opt->elmin) continue;
 
         /* excluded satellite? */
         if (satexclude(obs[i].sat,var[i],svh[i],opt)) continue;
 
         /* adjust range for satellite clock-bias */
-        r+=-CLIGHT*dts[i*2];
+        r[i]+=-CLIGHT*dts[i*2];
 
         /* adjust range for troposphere delay model (hydrostatic) */
-        zhd=tropmodel(obs[0].time,pos,zazel,0.0);
-        mapfh=tropmapf(obs[i].time,pos,azel+i*2,NULL);
-        r+=mapfh*zhd;
+        r[i]+=mapfs[i*2]*site.zhd;
 
         /* calc receiver antenna phase center correction */
         antmodel(opt->pcvr+base,opt->antdel[base],azel+i*2,opt->posopt[1],
                  dant);
 
         /* calc undifferenced phase/code residual for satellite */
-        trace(4,"sat=%d r=%.6f c*dts=%.6f zhd=%.6f map=%.6f\n",obs[i].sat,r,CLIGHT*dts[i*2],zhd,mapfh);
-        zdres_sat(base,r,obs+i,nav,azel+i*2,dant,opt,y+i*nf*2,freq+i*nf);
+        trace(4,"sat=%d r=%.6f c*dts=%.6f zhd=%.6f map=%.6f\n",obs[i].sat,r[i],CLIGHT*dts[i*2],site.zhd,mapfs[i*2]);
+        zdres_sat(base,r[i],obs+i,nav,azel+i*2,dant,opt,y+i*nf*2,freq+i*nf);
     }
+    wsrelease(ws,mark);
+
     trace(4,"rr_=%.3f %.3f %.3f\n",rr_[0],rr_[1],rr_[2]);
     trace(4,"pos=%.9f %.9f %.3f\n",pos[0]*R2D,pos[1]*R2D,pos[2]);
     for (i=0;i<n;i++) {
@@ -1150,16 +1212,12 @@ static int constbl(rtk_t *rtk, const double *x, const double *P, double *v,
     return 1;
 }
 /* precise tropospheric model -------------------------------------------------*/
-static double prectrop(gtime_t time, const double *pos, int r,
-                       const double *azel, const prcopt_t *opt, const double *x,
-                       double *dtdx)
+static double prectrop(double m_w, int r, const double *azel,
+                       const prcopt_t *opt, const double *x, double *dtdx)
 {
-    double m_w=0.0,cotz,grad_n,grad_e;
+    double cotz,grad_n,grad_e;
     int i=IT(r,opt);
 
-    /* wet mapping function */
-    tropmapf(time,pos,azel,&m_w);
-
     if (opt->tropopt>=TROPOPT_ESTG&&azel[1]>0.0) {
 
         /* m_w=m_0+m_0*cot(el)*(Gn*cos(az)+Ge*sin(az)): ref [6] */
@@ -1213,6 +1271,8 @@ static int ddres(rtk_t *rtk, const obsd_t *obs, double dt, const double *x,
     prcopt_t *opt=&rtk->opt;
     double bl,dr[3],posu[3],posr[3],didxi=0.0,didxj=0.0,*im;
     double *tropr,*tropu,*dtdxr,*dtdxu,*Ri,*Rj,freqi,freqj,*Hi=NULL,df;
+    double *azu,*azr,*mapfu,*mapfr;
+    size_t mark=wsmark(&rtk->ws);
     int i,j,k,m,f,nv=0,nb[NFREQ*NSYS*2+2]={0},b=0,sysi,sysj,nf=NF(opt);
     int frq,code;
 
@@ -1223,8 +1283,12 @@ static int ddres(rtk_t *rtk, const obsd_t *obs, double dt, const double *x,
     /* translate ecef pos to geodetic pos */
     ecef2pos(x,posu); ecef2pos(rtk->rb,posr);
 
-    Ri=mat(ns*nf*2+2,1); Rj=mat(ns*nf*2+2,1); im=mat(ns,1);
-    tropu=mat(ns,1); tropr=mat(ns,1); dtdxu=mat(ns,3); dtdxr=mat(ns,3);
+    Ri=wsmat(&rtk->ws,ns*nf*2+2,1); Rj=wsmat(&rtk->ws,ns*nf*2+2,1);
+    im=wsmat(&rtk->ws,ns,1);
+    tropu=wsmat(&rtk->ws,ns,1); tropr=wsmat(&rtk->ws,ns,1);
+    dtdxu=wsmat(&rtk->ws,ns,3); dtdxr=wsmat(&rtk->ws,ns,3);
+    azu=wsmat(&rtk->ws,2,ns); azr=wsmat(&rtk->ws,2,ns);
+    mapfu=wsmat(&rtk->ws,2,ns); mapfr=wsmat(&rtk->ws,2,ns);
 
     /* zero out residual phase and code biases for all satellites */
     for (i=0;i<MAXSAT;i++) for (j=0;j<NFREQ;j++) {
@@ -1233,13 +1297,24 @@ static int ddres(rtk_t *rtk, const obsd_t *obs, double dt, const double *x,
     /* compute factors of ionospheric and tropospheric delay
            - only used if kalman filter contains states for ION and TROP delays
            usually insignificant for short baselines (<10km)*/
+    if (opt->tropopt>=TROPOPT_EST) {
+        for (i=0;i<ns;i++) {
+            azu[i*2]=azel[iu[i]*2]; azu[1+i*2]=azel[1+iu[i]*2];
+            azr[i*2]=azel[ir[i]*2]; azr[1+i*2]=azel[1+ir[i]*2];
+        }
+        /* mapping functions by site terms kept over iterations of epoch */
+        settropsite(rtk->sol.time,posu,0.0,rtk->trps);
+        settropsite(rtk->sol.time,posr,0.0,rtk->trps+1);
+        tropmapf_batch(rtk->trps  ,azu,ns,mapfu);
+        tropmapf_batch(rtk->trps+1,azr,ns,mapfr);
+    }
     for (i=0;i<ns;i++) {
         if (opt->ionoopt==IONOOPT_EST) {
             im[i]=(ionmapf(posu,azel+iu[i]*2)+ionmapf(posr,azel+ir[i]*2))/2.0;
         }
         if (opt->tropopt>=TROPOPT_EST) {
-            tropu[i]=prectrop(rtk->sol.time,posu,0,azel+iu[i]*2,opt,x,dtdxu+i*3);
-            tropr[i]=prectrop(rtk->sol.time,posr,1,azel+ir[i]*2,opt,x,dtdxr+i*3);
+            tropu[i]=prectrop(mapfu[1+i*2],0,azu+i*2,opt,x,dtdxu+i*3);
+            tropr[i]=prectrop(mapfr[1+i*2],1,azr+i*2,opt,x,dtdxr+i*3);
         }
     }
     /* step through sat systems: m=0:gps/sbs,1:glo,2:gal,3:bds 4:qzs 5:irn*/
@@ -1432,8 +1507,7 @@ static int ddres(rtk_t *rtk, const obsd_t *obs, double dt, const double *x,
     /* double-differenced measurement error covariance */
     ddcov(nb,b,Ri,Rj,nv,R);
 
-    free(Ri); free(Rj); free(im);
-    free(tropu); free(tropr); free(dtdxu); free(dtdxr);
+    wsrelease(&rtk->ws,mark);
 
     return nv;
 }
@@ -1467,10 +1541,11 @@ static double intpres(gtime_t time, const obsd_t *obs, int n, const nav_t *nav,
     if (fabs(ttb)>opt->maxtdiff*2.0||ttb==tt) return tt;
 
     /* calculate sat positions for previous base obs */
-    satposs(time,obsb,nb,nav,opt->sateph,rs,dts,var,svh);
+    satposs(time,obsb,nb,nav,opt->sateph,NULL,rs,dts,var,svh);
 
     /* calculate [measured pseudorange - range] for previous base obs */
-    if (!zdres(1,obsb,nb,rs,dts,var,svh,nav,rtk->rb,opt,yb,e,azel,freq)) {
+    if (!zdres(&rtk->ws,&rtk->tide,1,obsb,nb,rs,dts,var,svh,nav,NULL,rtk->rb,
+               opt,yb,e,azel,freq)) {
         return tt;
     }
     /* interpolate previous and current base obs */
@@ -1592,12 +1667,13 @@ static void restamb(rtk_t *rtk, const double *bias, int nb, double *xa)
 static void holdamb(rtk_t *rtk, const double *xa)
 {
     double *v,*H,*R;
+    size_t mark=wsmark(&rtk->ws);
     int i,j,n,m,f,info,index[MAXSAT],nb=rtk->nx-rtk->na,nv=0,nf=NF(&rtk->opt);
     double dd;
     
     trace(3,"holdamb :\n");
 
-    v=mat(nb,1); H=zeros(nb,rtk->nx);
+    v=wsmat(&rtk->ws,nb,1); H=wszeros(&rtk->ws,nb,rtk->nx);
 
     for (m=0;m<6;m++) for (f=0;f<nf;f++) {
 
@@ -1624,19 +1700,20 @@ static void holdamb(rtk_t *rtk, const double *xa)
     /* return if less than min sats for hold (skip if fix&hold for GLONASS only) */
     if (rtk->opt.modear==ARMODE_FIXHOLD&&nv<rtk->opt.minholdsats) {
         trace(3,"holdamb: not enough sats to hold ambiguity\n");
-        free(v); free(H);
+        wsrelease(&rtk->ws,mark);
         return;
     }
 
     rtk->holdamb=1;  /* set flag to indicate hold has occurred */
-    R=zeros(nv,nv);
+    R=wszeros(&rtk->ws,nv,nv);
     for (i=0;i<nv;i++) R[i+i*nv]=rtk->opt.varholdamb;
 
     /* update states with constraints */
-    if ((info=filter(rtk->x,rtk->P,H,v,R,rtk->nx,nv))) {
+    if ((info=filter_ws(rtk->x,rtk->P,H,v,R,rtk->nx,nv,rtk->ixs,rtk->nxs,
+                        &rtk->ws))) {
         errmsg(rtk,"filter error (info=%d)\n",info);
     }
-    free(R);free(v); free(H);
+    wsrelease(&rtk->ws,mark);
 
     /* skip glonass/sbs icbias update if not enabled  */
     if (rtk->opt.glomodear!=GLO_ARMODE_FIXHOLD) return;
@@ -1691,6 +1768,7 @@ static int resamb_LAMBDA(rtk_t *rtk, double *bias, double *xa,int gps,int glo,in
     prcopt_t *opt=&rtk->opt;
     int i,j,nb,nb1,info,nx=rtk->nx,na=rtk->na;
     double *DP,*y,*b,*db,*Qb,*Qab,*QQ,s[2];
+    size_t mark=wsmark(&rtk->ws);
     int *ix;
     double coeff[3];
 
@@ -1700,16 +1778,17 @@ static int resamb_LAMBDA(rtk_t *rtk, double *bias, double *xa,int gps,int glo,in
     rtk->nb_ar=0;
     /* Create index of single to double-difference transformation matrix (D')
           used to translate phase biases to double difference */
-    ix=imat(nx,2);
+    ix=wsimat(&rtk->ws,nx,2);
     if ((nb=ddidx(rtk,ix,gps,glo,sbs))<(rtk->opt.minfixsats-1)) {  /* nb is sat pairs */
         errmsg(rtk,"not enough valid double-differences\n");
-        free(ix);
+        wsrelease(&rtk->ws,mark);
         return -1; /* flag abort */
     }
     rtk->nb_ar=nb;
     /* nx=# of float states, na=# of fixed states, nb=# of double-diff phase biases */
-    y=mat(nb,1); DP=mat(nb,nx-na); b=mat(nb,2); db=mat(nb,1); Qb=mat(nb,nb);
-    Qab=mat(na,nb); QQ=mat(na,nb);
+    y=wsmat(&rtk->ws,nb,1); DP=wsmat(&rtk->ws,nb,nx-na);
+    b=wsmat(&rtk->ws,nb,2); db=wsmat(&rtk->ws,nb,1); Qb=wsmat(&rtk->ws,nb,nb);
+    Qab=wsmat(&rtk->ws,na,nb); QQ=wsmat(&rtk->ws,na,nb);
 
     /* phase-bias covariance (Qb) and real-parameters to bias covariance (Qab) */
     /* y=D*xc, Qb=D*Qc*D', Qab=Qac*D' */
@@ -1736,7 +1815,7 @@ static int resamb_LAMBDA(rtk_t *rtk, double *bias, double *xa,int gps,int glo,in
     /* lambda/mlambda integer least-square estimation */
     /* return best integer solutions */
     /* b are best integer solutions, s are residuals */
-    if (!(info=lambda(nb,2,y,Qb,b,s))) {
+    if (!(info=lambda_ws(nb,2,y,Qb,b,s,&rtk->ws))) {
         trace(3,"N(1)=     "); tracemat(3,b   ,1,nb,7,2);
         trace(3,"N(2)=     "); tracemat(3,b+nb,1,nb,7,2);
 
@@ -1776,7 +1855,7 @@ static int resamb_LAMBDA(rtk_t *rtk, double *bias, double *xa,int gps,int glo,in
                 y[i]-=b[i];
             }
             /* adjust non phase-bias states and covariances using fixed solution values */
-            if (!matinv(Qb,nb)) {  /* returns 0 if inverse successful */
+            if (!matinv_ws(Qb,nb,&rtk->ws)) {  /* returns 0 if inverse successful */
                 /* rtk->xa = rtk->x-Qab*Qb^-1*(b0-b) */
                 matmul("NN",nb,1,nb,Qb ,y,db); /* db = Qb^-1*(b0-b) */
                 matmulm("NN",na,1,nb,Qab,db,rtk->xa); /* rtk->xa = rtk->x-Qab*db */
@@ -1805,8 +1884,7 @@ static int resamb_LAMBDA(rtk_t *rtk, double *bias, double *xa,int gps,int glo,in
         errmsg(rtk,"lambda error (info=%d)\n",info);
         nb=0;
     }
-    free(ix);
-    free(y); free(DP); free(b); free(db); free(Qb); free(Qab); free(QQ);
+    wsrelease(&rtk->ws,mark);
 
     return nb; /* number of ambiguities */
 }
@@ -1897,8 +1975,8 @@ static int manage_amb_LAMBDA(rtk_t *rtk, double *bias, double *xa, const int *sa
                 }
             }
         }
-        /* rerun if filter removed any sats */
-        if (rerun) {
+        /* rerun if filter removed any sats (skipped by deadline) */
+        if (rerun&&!(rtk->sol.degrade&DEGR_ARRERUN)) {
             trace(3,"rerun AR with new sats removed\n");
             /* try again with new sats removed */
             nb=resamb_LAMBDA(rtk,bias,xa,gps1,glo1,sbas1);
@@ -1914,7 +1992,7 @@ static int manage_amb_LAMBDA(rtk_t *rtk, double *bias, double *xa, const int *sa
         gps2=rtk->opt.gpsmodear==0&&rtk->sol.ratio>=rtk->sol.thres?0:1;
 
         /* if modes changed since initial AR run or haven't run yet,re-run with new modes */
-        if (glo1!=glo2||gps1!=gps2)
+        if ((glo1!=glo2||gps1!=gps2)&&!(rtk->sol.degrade&DEGR_ARRERUN))
             nb=resamb_LAMBDA(rtk,bias,xa,gps2,glo2,sbas2);
     }
     /* Restore excluded sat if still no fix or significant increase in ar ratio */
@@ -1953,6 +2031,198 @@ static int valpos(rtk_t *rtk, const double *v, const double *R, const int *vflg,
     }
     return stat;
 }
+/* elapsed time of epoch processing (ms) -------------------------------------*/
+static double epochtime(const rtk_t *rtk)
+{
+    return (double)(metclock()-rtk->tepoch)*1E-6;
+}
+/* shed optional processing by deadline ----------------------------------------
+* optional processing of relative positioning is shed progressively by the
+* degradation level: 1:skip AR reruns, 2:+skip doppler slip detection,
+* 3:+drop low elevation satellites, 4:+reduce number of frequencies.
+* the options changed are saved to opt0 and restored by restoredegr().
+* the phase-bias states of the dropped frequency are not updated by udbias()
+* (no outage count, slip check or time update), so they are reset as outage.
+*-----------------------------------------------------------------------------*/
+static void setdegr(rtk_t *rtk, prcopt_t *opt0)
+{
+    prcopt_t *opt=&rtk->opt;
+    int i;
+    
+    opt0->thresdop=opt->thresdop;
+    opt0->elmin=opt->elmin;
+    opt0->nf=opt->nf;
+    
+    if (rtk->degr>=1) {
+        rtk->sol.degrade|=DEGR_ARRERUN;
+    }
+    if (rtk->degr>=2&&opt->thresdop>0.0) {
+        opt->thresdop=0.0;
+        rtk->sol.degrade|=DEGR_DOPSLIP;
+    }
+    if (rtk->degr>=3&&opt->elmin<ELMIN_DEGR) {
+        opt->elmin=ELMIN_DEGR;
+        rtk->sol.degrade|=DEGR_ELMASK;
+    }
+    if (rtk->degr>=4&&opt->nf>1&&opt->ionoopt!=IONOOPT_IFLC) {
+        opt->nf--;
+        rtk->sol.degrade|=DEGR_NFREQ;
+        
+        for (i=1;i<=MAXSAT&&opt->mode>PMODE_DGPS;i++) {
+            if (rtk->x[IB(i,opt->nf,opt)]!=0.0) {
+                initx(rtk,0.0,0.0,IB(i,opt->nf,opt));
+            }
+            rtk->ssat[i-1].outc[opt->nf]=0;
+            rtk->ssat[i-1].lock[opt->nf]=-opt->minlock;
+        }
+    }
+}
+/* restore options and update degradation level --------------------------------
+* the level is raised if the epoch exceeded the processing time budget and
+* lowered if the epoch took less than half of the budget
+*-----------------------------------------------------------------------------*/
+static void restoredegr(rtk_t *rtk, const prcopt_t *opt0)
+{
+    double t=epochtime(rtk);
+    
+    rtk->opt.thresdop=opt0->thresdop;
+    rtk->opt.elmin=opt0->elmin;
+    rtk->opt.nf=opt0->nf;
+    
+    if (t>rtk->opt.budget) {
+        if (rtk->degr<MAXDEGR) rtk->degr++;
+    }
+    else if (t<rtk->opt.budget*0.5) {
+        if (rtk->degr>0) rtk->degr--;
+    }
+    trace(3,"restoredegr: t=%.1f budget=%d degrade=%02X level=%d\n",t,
+          rtk->opt.budget,rtk->sol.degrade,rtk->degr);
+}
+/* hash of double by bit pattern ---------------------------------------------*/
+static uint64_t hashd(uint64_t k, double v)
+{
+    uint64_t u;
+    
+    memcpy(&u,&v,sizeof(u));
+    return HASHK(k,u);
+}
+/* key of navigation data for base station cache -------------------------------
+* the key covers the inputs of satellite states and residuals of base station
+* in navigation data (ephemerides, precise ephemeris/clock stores, glonass fcn,
+* satellite antenna parameters, earth rotation parameters) and the ephemeris
+* selections of library context
+*-----------------------------------------------------------------------------*/
+static uint64_t navkey(const nav_t *nav, int sateph)
+{
+    const rtkctx_t *ctx=getrtkctx();
+    uint64_t k=FNV_OFFSET;
+    int i,j;
+    
+    for (i=0;i<nav->n;i++) {
+        k=HASHK(k,nav->eph[i].sat ); k=HASHK(k,nav->eph[i].iode);
+        k=HASHK(k,nav->eph[i].svh ); k=HASHK(k,nav->eph[i].toe.time);
+        k=HASHK(k,nav->eph[i].toc.time);
+    }
+    for (i=0;i<nav->ng;i++) {
+        k=HASHK(k,nav->geph[i].sat); k=HASHK(k,nav->geph[i].iode);
+        k=HASHK(k,nav->geph[i].svh); k=HASHK(k,nav->geph[i].toe.time);
+    }
+    for (i=0;i<nav->ns;i++) {
+        k=HASHK(k,nav->seph[i].sat); k=HASHK(k,nav->seph[i].t0.time);
+    }
+    for (i=0;i<32;i++) k=HASHK(k,nav->glo_fcn[i]);
+    for (i=0;i<7;i++) k=HASHK(k,ctx->eph_sel[i]);
+    
+    for (i=0;i<nav->erp.n;i++) {
+        k=hashd(k,nav->erp.data[i].mjd); k=hashd(k,nav->erp.data[i].ut1_utc);
+        k=hashd(k,nav->erp.data[i].xp ); k=hashd(k,nav->erp.data[i].yp );
+        k=hashd(k,nav->erp.data[i].xpr); k=hashd(k,nav->erp.data[i].ypr);
+        k=hashd(k,nav->erp.data[i].lod);
+    }
+    if (sateph==EPHOPT_PREC) {
+        k=HASHK(k,(uintptr_t)nav->peph); k=HASHK(k,nav->ne);
+        k=HASHK(k,(uintptr_t)nav->pclk); k=HASHK(k,nav->nc);
+        if (nav->ne>0) {
+            k=HASHK(k,nav->peph[0].time.time);
+            k=HASHK(k,nav->peph[nav->ne-1].time.time);
+        }
+        if (nav->nc>0) {
+            k=HASHK(k,nav->pclk[0].time.time);
+            k=HASHK(k,nav->pclk[nav->nc-1].time.time);
+        }
+        k=HASHK(k,(uintptr_t)nav->pephs);
+        if (nav->pephs&&nav->pephs->n>0) {
+            k=HASHK(k,nav->pephs->n); k=HASHK(k,nav->pephs->nsat);
+            k=HASHK(k,(uintptr_t)nav->pephs->cheb);
+            k=HASHK(k,nav->pephs->time[0].time);
+            k=HASHK(k,nav->pephs->time[nav->pephs->n-1].time);
+        }
+        for (i=0;i<MAXSAT;i++) {
+            k=HASHK(k,nav->pcvs[i].sat);
+            k=HASHK(k,nav->pcvs[i].ts.time); k=HASHK(k,nav->pcvs[i].te.time);
+            for (j=0;j<NFREQ;j++) {
+                k=hashd(k,nav->pcvs[i].off[j][0]);
+                k=hashd(k,nav->pcvs[i].off[j][1]);
+                k=hashd(k,nav->pcvs[i].off[j][2]);
+            }
+        }
+    }
+    return k;
+}
+/* get base station satellite states and residuals from cache -----------------
+* the cache is valid if the base observation data, the base position, the
+* key of navigation data, the processing options and the number of
+* frequencies are same as those of the cached epoch
+*-----------------------------------------------------------------------------*/
+static int getbasec(const rtk_t *rtk, const obsd_t *obs, int n, int nf,
+                    uint64_t key, double *rs, double *dts, double *var,
+                    int *svh, double *y, double *e, double *azel, double *freq)
+{
+    const basec_t *bc=rtk->bc;
+    
+    if (!bc||n<=0||bc->n!=n||bc->nf!=nf||bc->navkey!=key||
+        bc->rb[0]!=rtk->rb[0]||bc->rb[1]!=rtk->rb[1]||bc->rb[2]!=rtk->rb[2]||
+        memcmp(bc->obs,obs,sizeof(obsd_t)*n)||
+        memcmp(&bc->opt,&rtk->opt,sizeof(prcopt_t))) {
+        return 0;
+    }
+    memcpy(rs  ,bc->rs  ,sizeof(double)*n*6);
+    memcpy(dts ,bc->dts ,sizeof(double)*n*2);
+    memcpy(var ,bc->var ,sizeof(double)*n);
+    memcpy(svh ,bc->svh ,sizeof(int)*n);
+    memcpy(y   ,bc->y   ,sizeof(double)*n*nf*2);
+    memcpy(e   ,bc->e   ,sizeof(double)*n*3);
+    memcpy(azel,bc->azel,sizeof(double)*n*2);
+    memcpy(freq,bc->freq,sizeof(double)*n*nf);
+    return 1;
+}
+/* put base station satellite states and residuals to cache ------------------*/
+static void putbasec(rtk_t *rtk, const obsd_t *obs, int n, int nf,
+                     uint64_t key, const double *rs, const double *dts,
+                     const double *var, const int *svh, const double *y,
+                     const double *e, const double *azel, const double *freq)
+{
+    basec_t *bc=rtk->bc;
+    
+    if (!bc) return;
+    bc->n=0;
+    if (n<=0||n>MAXOBS) return;
+    
+    memcpy(bc->obs ,obs ,sizeof(obsd_t)*n);
+    memcpy(bc->rs  ,rs  ,sizeof(double)*n*6);
+    memcpy(bc->dts ,dts ,sizeof(double)*n*2);
+    memcpy(bc->var ,var ,sizeof(double)*n);
+    memcpy(bc->svh ,svh ,sizeof(int)*n);
+    memcpy(bc->y   ,y   ,sizeof(double)*n*nf*2);
+    memcpy(bc->e   ,e   ,sizeof(double)*n*3);
+    memcpy(bc->azel,azel,sizeof(double)*n*2);
+    memcpy(bc->freq,freq,sizeof(double)*n*nf);
+    matcpy(bc->rb,rtk->rb,3,1);
+    memcpy(&bc->opt,&rtk->opt,sizeof(prcopt_t));
+    bc->navkey=key;
+    bc->nf=nf;
+    bc->n=n;
+}
 /* relpos()relative positioning ------------------------------------------------------
  *  args:  rtk      IO      gps solution structure
            obs      I       satellite observations
@@ -1965,22 +2235,27 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
 {
     prcopt_t *opt=&rtk->opt;
     gtime_t time=obs[0].time;
+    astro_t astro[2],*astr=NULL,*astb=NULL;
     double *rs,*dts,*var,*y,*e,*azel,*freq,*v,*H,*R,*xp,*Pp,*xa,*bias,dt;
+    double erpv[5]={0};
+    uint64_t t0,key=0;
+    size_t mark;
     int i,j,f,n=nu+nr,ns,ny,nv,sat[MAXSAT],iu[MAXSAT],ir[MAXSAT];
-    int info,vflg[MAXOBS*NFREQ*2+1],svh[MAXOBS*2];
+    int info,nb,vflg[MAXOBS*NFREQ*2+1],svh[MAXOBS*2],usec,hit=0;
     int stat=rtk->opt.mode<=PMODE_DGPS?SOLQ_DGPS:SOLQ_FLOAT;
     int nf=opt->ionoopt==IONOOPT_IFLC?1:opt->nf;
 
     trace(3,"relpos  : nu=%d nr=%d\n",nu,nr);
 
     /* define local matrices, n=total observations, base + rover */
-    rs=mat(6,n);            /* range to satellites */
-    dts=mat(2,n);           /* satellite clock biases */
-    var=mat(1,n);
-    y=mat(nf*2,n);
-    e=mat(3,n);
-    azel=zeros(2,n);        /* [az, el] */
-    freq=zeros(nf,n);
+    mark=wsmark(&rtk->ws);
+    rs=wsmat(&rtk->ws,6,n);     /* range to satellites */
+    dts=wsmat(&rtk->ws,2,n);    /* satellite clock biases */
+    var=wsmat(&rtk->ws,1,n);
+    y=wsmat(&rtk->ws,nf*2,n);
+    e=wsmat(&rtk->ws,3,n);
+    azel=wszeros(&rtk->ws,2,n); /* [az, el] */
+    freq=wszeros(&rtk->ws,nf,n);
 
     /* init satellite status arrays */
     for (i=0;i<MAXSAT;i++) {
@@ -1991,19 +2266,54 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
                 rtk->ssat[i].snr_base[j] =0;
         }
     }
+    /* sun, moon and earth orientation at rover and base epochs */
+    if (opt->tidecorr||opt->sateph==EPHOPT_PREC||opt->sateph==EPHOPT_SSRCOM) {
+        geterp(&nav->erp,time,erpv);
+        setastro(gpst2utc(time),erpv,astr=astro);
+        if (nr<=0||fabs(timediff(obs[nu].time,time))<DTTOL) {
+            astb=astr;
+        }
+        else {
+            geterp(&nav->erp,obs[nu].time,erpv);
+            setastro(gpst2utc(obs[nu].time),erpv,astb=astro+1);
+        }
+    }
+    /* base station satellite states and residuals of same base epoch */
+    usec=opt->sateph==EPHOPT_BRDC||opt->sateph==EPHOPT_PREC;
+    if (usec) {
+        key=navkey(nav,opt->sateph);
+        hit=getbasec(rtk,obs+nu,nr,nf,key,rs+nu*6,dts+nu*2,var+nu,svh+nu,
+                     y+nu*nf*2,e+nu*3,azel+nu*2,freq+nu*nf);
+    }
     /* compute satellite positions, velocities and clocks for base and rover */
-    satposs(time,obs,n,nav,opt->sateph,rs,dts,var,svh);
+    t0=metbegin();
+    satposs(time,obs,hit?nu:n,nav,opt->sateph,astr,rs,dts,var,svh);
+    metend(MET_SATPOS,t0);
 
     /* calculate [range - measured pseudorange] for base station (phase and code)
          output is in y[nu:nu+nr], see call for rover below for more details                                                 */
-    trace(3,"base station:\n");
-    if (!zdres(1,obs+nu,nr,rs+nu*6,dts+nu*2,var+nu,svh+nu,nav,rtk->rb,opt,
-               y+nu*nf*2,e+nu*3,azel+nu*2,freq+nu*nf)) {
-        errmsg(rtk,"initial base station position error\n");
-
-        free(rs); free(dts); free(var); free(y); free(e); free(azel); free(freq);
-        return 0;
+    if (hit) {
+        trace(3,"base station: cached epoch\n");
+    }
+    else {
+        trace(3,"base station:\n");
+        t0=metbegin();
+        if (!zdres(&rtk->ws,&rtk->tide,1,obs+nu,nr,rs+nu*6,dts+nu*2,var+nu,
+                   svh+nu,nav,astb,rtk->rb,opt,y+nu*nf*2,e+nu*3,azel+nu*2,
+                   freq+nu*nf)) {
+            errmsg(rtk,"initial base station position error\n");
+
+            wsrelease(&rtk->ws,mark);
+            return 0;
+        }
+        metend(MET_RES,t0);
+        
+        if (usec) {
+            putbasec(rtk,obs+nu,nr,nf,key,rs+nu*6,dts+nu*2,var+nu,svh+nu,
+                     y+nu*nf*2,e+nu*3,azel+nu*2,freq+nu*nf);
+        }
     }
+    
     /* time diff between base and rover observations */
     if (opt->intpref) {
          /* time-interpolation of base residuals */
@@ -2016,7 +2326,7 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         rtk->sol.age=dt;
         if (fabs(rtk->sol.age)>opt->maxtdiff) {
             errmsg(rtk,"age of differential error (age=%.1f)\n",rtk->sol.age);
-            free(rs); free(dts); free(var); free(y); free(e); free(azel); free(freq);
+            wsrelease(&rtk->ws,mark);
             return 1;
         }
     }
@@ -2024,7 +2334,7 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
     if ((ns=selsat(obs,azel,nu,nr,opt,sat,iu,ir))<=0) {
         errmsg(rtk,"no common satellite\n");
 
-        free(rs); free(dts); free(var); free(y); free(e); free(azel); free(freq);
+        wsrelease(&rtk->ws,mark);
         return 0;
     }
     /* update kalman filter states (pos,vel,acc,ionosp, troposp, sat phase biases) */
@@ -2039,13 +2349,16 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         rtk->ssat[sat[i]-1].snr_base[j] =obs[ir[i]].SNR[j];
     }
 
-    /* initialize Pp,xa to zero, xp to rtk->x */
-    xp=mat(rtk->nx,1); Pp=zeros(rtk->nx,rtk->nx); xa=mat(rtk->nx,1);
+    /* initialize xp,Pp to rtk->x,rtk->P (covariance of active states only) */
+    xp=wsmat(&rtk->ws,rtk->nx,1); Pp=wsmat(&rtk->ws,rtk->nx,rtk->nx);
+    xa=wsmat(&rtk->ws,rtk->nx,1);
     matcpy(xp,rtk->x,rtk->nx,1);
-    matcpy(Pp,rtk->P,rtk->nx,rtk->nx);
+    cpyactP(rtk,Pp,rtk->P);
 
+    /* rows of H are cleared by ddres() */
     ny=ns*nf*2+2;
-    v=mat(ny,1); H=zeros(rtk->nx,ny); R=mat(ny,ny); bias=mat(rtk->nx,1);
+    v=wsmat(&rtk->ws,ny,1); H=wsmat(&rtk->ws,rtk->nx,ny);
+    R=wsmat(&rtk->ws,ny,ny); bias=wsmat(&rtk->ws,rtk->nx,1);
 
     trace(3,"rover:  dt=%.3f\n",dt);
     for (i=0;i<opt->niter;i++) {
@@ -2062,7 +2375,9 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
                 y    = zero diff residuals (code and phase)
                 e    = line of sight unit vectors to sats
                 azel = [az, el] to sats                                   */
-        if (!zdres(0,obs,nu,rs,dts,var,svh,nav,xp,opt,y,e,azel,freq)) {
+        t0=metbegin();
+        if (!zdres(&rtk->ws,&rtk->tide,0,obs,nu,rs,dts,var,svh,nav,astr,xp,opt,
+                   y,e,azel,freq)) {
             errmsg(rtk,"rover initial position error\n");
             stat=SOLQ_NONE;
             break;
@@ -2084,12 +2399,17 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
             stat=SOLQ_NONE;
             break;
         }
+        metend(MET_RES,t0);
+        
         /* kalman filter measurement update, updates x,y,z,sat phase biases, etc
                 K=P*H*(H'*P*H+R)^-1
                 xp=x+K*v
                 Pp=(I-K*H')*P                  */
         trace(3,"before filter x=");tracemat(3,rtk->x,1,9,13,6);
-        if ((info=filter(xp,Pp,H,v,R,rtk->nx,nv))) {
+        t0=metbegin();
+        info=filter_ws(xp,Pp,H,v,R,rtk->nx,nv,rtk->ixs,rtk->nxs,&rtk->ws);
+        metend(MET_FILTER,t0);
+        if (info) {
             errmsg(rtk,"filter error (info=%d)\n",info);
             stat=SOLQ_NONE;
             break;
@@ -2098,7 +2418,8 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         trace(4,"x(%d)=",i+1); tracemat(4,xp,1,NR(opt),13,4);
     }
     /* calc zero diff residuals again after kalman filter update */
-    if (stat!=SOLQ_NONE&&zdres(0,obs,nu,rs,dts,var,svh,nav,xp,opt,y,e,azel,freq)) {
+    if (stat!=SOLQ_NONE&&zdres(&rtk->ws,&rtk->tide,0,obs,nu,rs,dts,var,svh,nav,
+                               astr,xp,opt,y,e,azel,freq)) {
 
         /* calc double diff residuals again after kalman filter update for float solution */
         nv=ddres(rtk,obs,dt,xp,Pp,sat,y,e,azel,freq,iu,ir,ns,v,NULL,R,vflg);
@@ -2108,7 +2429,7 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
 
             /* copy states */
             matcpy(rtk->x,xp,rtk->nx,1);
-            matcpy(rtk->P,Pp,rtk->nx,rtk->nx);
+            cpyactP(rtk,rtk->P,Pp);
 
             /* update valid satellite status for ambiguity control */
             rtk->sol.ns=0;
@@ -2124,11 +2445,21 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
     }
     /* resolve integer ambiguity by LAMBDA */
     if (stat==SOLQ_FLOAT) {
+        
+        /* skip AR reruns if processing time budget exceeded */
+        if (opt->budget>0&&epochtime(rtk)>opt->budget) {
+            rtk->sol.degrade|=DEGR_ARRERUN;
+        }
+        t0=metbegin();
+        nb=manage_amb_LAMBDA(rtk,bias,xa,sat,nf,ns);
+        metend(MET_AR,t0);
+        
         /* if valid fixed solution, process it */
-        if (manage_amb_LAMBDA(rtk,bias,xa,sat,nf,ns)>1) {
+        if (nb>1) {
 
             /* find zero-diff residuals for fixed solution */
-            if (zdres(0,obs,nu,rs,dts,var,svh,nav,xa,opt,y,e,azel,freq)) {
+            if (zdres(&rtk->ws,&rtk->tide,0,obs,nu,rs,dts,var,svh,nav,astr,xa,
+                      opt,y,e,azel,freq)) {
 
                 /* post-fit residuals for fixed solution (xa includes fixed phase biases, rtk->xa does not) */
                 nv=ddres(rtk,obs,dt,xa,Pp,sat,y,e,azel,freq,iu,ir,ns,v,NULL,R,vflg);
@@ -2208,13 +2539,26 @@ static int relpos(rtk_t *rtk, const obsd_t *obs, int nu, int nr,
         if (rtk->ssat[i].lock[j]<0||(rtk->nfix>0&&rtk->ssat[i].fix[j]>=2))
             rtk->ssat[i].lock[j]++;
     }
-    free(rs); free(dts); free(var); free(y); free(e); free(azel); free(freq);
-    free(xp); free(Pp);  free(xa);  free(v); free(H); free(R); free(bias);
+    wsrelease(&rtk->ws,mark);
 
     if (stat!=SOLQ_NONE) rtk->sol.stat=stat;
 
     return stat!=SOLQ_NONE;
 }
+/* size of workspace ---------------------------------------------------------*/
+static size_t wssize(const prcopt_t *opt, int nx)
+{
+    int i,nf=NF(opt),ns=0,ny;
+    
+    if (opt->mode==PMODE_SINGLE) return MAXOBS*2;
+    
+    /* max number of satellites in an epoch */
+    for (i=1;i<=MAXSAT;i++) if (satsys(i,NULL)&opt->navsys) ns++;
+    ns=MIN(ns,MAXOBS);
+    
+    ny=opt->mode<=PMODE_FIXED?ns*nf*2+2:ns*opt->nf*2+MAXSAT+3;
+    return (size_t)MAXOBS*2*(14+nf*3)+(size_t)nx*(nx+ny+3)+(size_t)ny*(ny+1);
+}
 /* initialize RTK control ------------------------------------------------------
 * initialize RTK control struct
 * args   : rtk_t    *rtk    IO  TKk control/result struct
@@ -2226,6 +2570,7 @@ extern void rtkinit(rtk_t *rtk, const prcopt_t *opt)
     sol_t sol0={{0}};
     ambc_t ambc0={{{0}}};
     ssat_t ssat0={0};
+    tropsite_t trps0={{0}};
     int i;
 
     trace(3,"rtkinit :\n");
@@ -2240,14 +2585,27 @@ extern void rtkinit(rtk_t *rtk, const prcopt_t *opt)
     rtk->P=zeros(rtk->nx,rtk->nx);
     rtk->xa=zeros(rtk->na,1);
     rtk->Pa=zeros(rtk->na,rtk->na);
+    rtk->nxs=0;
+    rtk->ixs=imat(rtk->nx,1);
+    rtk->pxs=imat(rtk->nx,1);
+    for (i=0;i<rtk->nx;i++) rtk->pxs[i]=-1;
     rtk->nfix=rtk->neb=0;
     for (i=0;i<MAXSAT;i++) {
         rtk->ambc[i]=ambc0;
         rtk->ssat[i]=ssat0;
     }
+    rtk->trps[0]=rtk->trps[1]=trps0;
     rtk->holdamb=0;
     rtk->excsat=0;
     rtk->nb_ar=0;
+    rtk->degr=0;
+    rtk->tepoch=0;
+    wsinit(&rtk->ws,wssize(opt,rtk->nx));
+    rtk->bc=NULL;
+    rtk->tide=NULL;
+    if (opt->mode>=PMODE_DGPS&&opt->mode<=PMODE_FIXED) {
+        rtk->bc=(basec_t *)calloc(1,sizeof(basec_t));
+    }
     for (i=0;i<MAXERRMSG;i++) rtk->errbuf[i]=0;
     rtk->opt=*opt;
     rtk->initial_mode=rtk->opt.mode;
@@ -2267,6 +2625,12 @@ extern void rtkfree(rtk_t *rtk)
     free(rtk->P ); rtk->P =NULL;
     free(rtk->xa); rtk->xa=NULL;
     free(rtk->Pa); rtk->Pa=NULL;
+    free(rtk->bc); rtk->bc=NULL;
+    cleartidecache(&rtk->tide);
+    free(rtk->ixs); rtk->ixs=NULL;
+    free(rtk->pxs); rtk->pxs=NULL;
+    rtk->nxs=0;
+    wsfree(&rtk->ws);
 }
 /* precise positioning ---------------------------------------------------------
 * input observation data and navigation message, compute rover position by
@@ -2327,7 +2691,7 @@ extern void rtkfree(rtk_t *rtk)
 *-----------------------------------------------------------------------------*/
 extern int rtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
 {
-    prcopt_t *opt=&rtk->opt;
+    prcopt_t *opt=&rtk->opt,opt0;
     sol_t solb={{0}};
     gtime_t time;
     int i,nu,nr;
@@ -2335,6 +2699,9 @@ extern int rtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
 
     char tstr[40];
     trace(3,"rtkpos  : time=%s n=%d\n",time2str(obs[0].time,tstr,3),n);
+
+    if (opt->budget>0) rtk->tepoch=metclock();
+    rtk->sol.degrade=0;
     trace(4,"obs=\n"); traceobs(4,obs,n);
     /*trace(5,"nav=\n"); tracenav(5,nav);*/
 
@@ -2352,11 +2719,12 @@ extern int rtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
     /* rover position and time by single point positioning, skip if
      position variance smaller than threshold */
     if (rtk->P[0]==0||rtk->P[0]>STD_PREC_VAR_THRESH) {
-        if (!pntpos(obs,nu,nav,&rtk->opt,&rtk->sol,NULL,rtk->ssat,msg)) {
+        if (!pntpos_ws(obs,nu,nav,&rtk->opt,&rtk->sol,NULL,rtk->ssat,msg,
+                       &rtk->ws)) {
             errmsg(rtk,"point pos error (%s)\n",msg);
 
             if (!rtk->opt.dynamics) {
-                outsolstat(rtk,nav);
+                rtkoutsolstat(rtk);
                 return 0;
             }
         }
@@ -2376,7 +2744,7 @@ extern int rtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
 
     /* single point positioning */
     if (opt->mode==PMODE_SINGLE) {
-        outsolstat(rtk,nav);
+        rtkoutsolstat(rtk);
         return 1;
     }
     /* suppress output of single solution */
@@ -2386,20 +2754,21 @@ extern int rtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
     /* precise point positioning */
     if (opt->mode>=PMODE_PPP_KINEMA) {
         pppos(rtk,obs,nu,nav);
-        outsolstat(rtk,nav);
+        rtkoutsolstat(rtk);
         return 1;
     }
     /* check number of data of base station */
     if (nr==0) {
         errmsg(rtk,"no base station observation data for rtk\n");
-        outsolstat(rtk,nav);
+        rtkoutsolstat(rtk);
         return 1;
     }
     if (opt->mode==PMODE_MOVEB) { /*  moving baseline */
         /* estimate position/velocity of base station,
            skip if position variance below threshold*/
         if (rtk->P[0]==0||rtk->P[0]>STD_PREC_VAR_THRESH) {
-            if (!pntpos(obs+nu,nr,nav,&rtk->opt,&solb,NULL,NULL,msg)) {
+            if (!pntpos_ws(obs+nu,nr,nav,&rtk->opt,&solb,NULL,NULL,msg,
+                           &rtk->ws)) {
                 errmsg(rtk,"base station position error (%s)\n",msg);
                 return 0;
             }
@@ -2429,10 +2798,17 @@ extern int rtkpos(rtk_t *rtk, const obsd_t *obs, int n, const nav_t *nav)
     trace(3,"base pos: "); tracemat(3,rtk->rb,1,3,13,4);
     }
 
-    /* Relative positioning */
-    relpos(rtk,obs,nu,nr,nav);
+    /* Relative positioning, optional processing shed by deadline */
+    if (opt->budget>0) {
+        setdegr(rtk,&opt0);
+        relpos(rtk,obs,nu,nr,nav);
+        restoredegr(rtk,&opt0);
+    }
+    else {
+        relpos(rtk,obs,nu,nr,nav);
+    }
     rtk->epoch++;
-    outsolstat(rtk,nav);
+    rtkoutsolstat(rtk);
 
     return 1;
 }
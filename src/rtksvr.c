@@ -42,10 +42,313 @@
 *                            handle multiple ephemeris sets in updatesvr()
 *                            use API sat2freq() to get carrier frequency
 *                            use integer types in stdint.h
+*           2026/10/19  1.23 add library context svr->ctx bound to server thread
+*                            pipeline of decoder, positioning and output
+*                            threads connected by bounded queues
+*                            fine-grained server lock and status snapshots
+*                            metrics spans of decode, output and positioning
+*                            published for lock-free status readers
+*                            pair rover epoch with latest base epoch in queue
+*                            order (optional wait by svr->basewait)
+*                            positioning on navigation data copy without
+*                            server lock
+*                            blocking waits of threads by events
+*                            decode into private state of decoder threads
+*                            republish status snapshot on stop
 *-----------------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199506
 #include "rtklib.h"
 
 #define MIN_INT_RESET   30000   /* mininum interval of reset command (ms) */
+#define NQOBS           32      /* number of slots of epoch queues */
+#define NQSOL           32      /* number of slots of solution queue */
+#define NQLOG           16      /* number of slots of log queues */
+#define POLLCYCLE       1       /* polling cycle of status republish (ms) */
+#define NSTATBUF        3       /* number of status snapshot buffers */
+
+#define SQRT(x)     ((x)<=0.0||(x)!=(x)?0.0:sqrt(x))
+
+#ifdef WIN32
+typedef DWORD (WINAPI *threadfunc_t)(void *);
+#else
+typedef void *(*threadfunc_t)(void *);
+#endif
+
+/* wait condition with timeout (called with lock) ----------------------------*/
+static void condwait(rtklib_cond_t *cond, rtklib_lock_t *lock, int ms)
+{
+#ifdef WIN32
+    SleepConditionVariableCS(cond,lock,ms);
+#else
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_REALTIME,&ts);
+    ts.tv_sec+=ms/1000;
+    ts.tv_nsec+=(ms%1000)*1000000L;
+    if (ts.tv_nsec>=1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec-=1000000000L;
+    }
+    pthread_cond_timedwait(cond,lock,&ts);
+#endif
+}
+/* initialize/signal/wait event ------------------------------------------------
+* an event counts the signals, so a signal before the wait is not lost.
+* waitevt() returns at a signal after the last wait or by timeout (ms).
+*-----------------------------------------------------------------------------*/
+static void initevt(rtksvrevt_t *evt)
+{
+    evt->n=0;
+    rtklib_initlock(&evt->lock);
+    rtklib_initcond(&evt->cond);
+}
+static void setevt(rtksvrevt_t *evt)
+{
+    rtklib_lock(&evt->lock);
+    evt->n++;
+    rtklib_signal(&evt->cond);
+    rtklib_unlock(&evt->lock);
+}
+static void waitevt(rtksvrevt_t *evt, int ms)
+{
+    rtklib_lock(&evt->lock);
+    if (evt->n<=0&&ms>0) condwait(&evt->cond,&evt->lock,ms);
+    evt->n=0;
+    rtklib_unlock(&evt->lock);
+}
+
+/* free queue ----------------------------------------------------------------*/
+static void freeq(rtksvrq_t *q)
+{
+    free(q->len ); q->len =NULL;
+    free(q->type); q->type=NULL;
+    free(q->tick); q->tick=NULL;
+    free(q->buff); q->buff=NULL;
+    q->n=q->wp=q->rp=0;
+}
+/* initialize queue ----------------------------------------------------------*/
+static int initq(rtksvrq_t *q, int n, int size)
+{
+    q->n=n; q->size=size; q->wp=q->rp=q->nmax=0;
+    
+    if (!(q->len =(int *)malloc(sizeof(int)*n))||
+        !(q->type=(int *)malloc(sizeof(int)*n))||
+        !(q->tick=(uint32_t *)malloc(sizeof(uint32_t)*n))||
+        !(q->buff=(uint8_t *)malloc((size_t)size*n))) {
+        freeq(q);
+        return 0;
+    }
+    return 1;
+}
+/* put data to queue -----------------------------------------------------------
+* a queue has a single producer and a single consumer. the lock only guards
+* the read/write pointers, the slot data is copied outside of the lock. the
+* event of the consumer is signaled after the data is put.
+*-----------------------------------------------------------------------------*/
+static int putq(rtksvrq_t *q, const uint8_t *data, int len, int type,
+                uint32_t tick)
+{
+    int wp,rp,n;
+    
+    rtklib_lock(&q->lock);
+    wp=q->wp; rp=q->rp;
+    rtklib_unlock(&q->lock);
+    
+    if (!q->buff||(wp+1)%q->n==rp) return 0; /* queue full */
+    
+    len=len<q->size?len:q->size;
+    memcpy(q->buff+(size_t)q->size*wp,data,len);
+    q->len [wp]=len;
+    q->type[wp]=type;
+    q->tick[wp]=tick;
+    
+    rtklib_lock(&q->lock);
+    q->wp=(wp+1)%q->n;
+    if ((n=(q->wp-q->rp+q->n)%q->n)>q->nmax) q->nmax=n;
+    rtklib_unlock(&q->lock);
+    
+    if (q->evt) setevt(q->evt);
+    return 1;
+}
+/* put data to queue waiting for free slot ------------------------------------
+* wait for a free slot signaled by popq() while the queue is full and the
+* server is running. if the server lock is held by the caller (locked=1), it
+* is released while waiting.
+*-----------------------------------------------------------------------------*/
+static int waitputq(rtksvr_t *svr, rtksvrq_t *q, const uint8_t *data, int len,
+                    int type, int locked)
+{
+    uint32_t tick=tickget();
+    
+    while (!putq(q,data,len,type,tick)) {
+        if (!svr->state||!q->buff) return 0;
+        if (locked) rtksvrunlock(svr);
+        rtklib_lock(&q->lock);
+        if ((q->wp+1)%q->n==q->rp) condwait(&q->cond,&q->lock,svr->cycle);
+        rtklib_unlock(&q->lock);
+        if (locked) rtksvrlock(svr);
+    }
+    return 1;
+}
+/* peek data at head of queue (NULL: queue empty) ----------------------------*/
+static uint8_t *peekq(rtksvrq_t *q, int *len, int *type, uint32_t *tick)
+{
+    int wp,rp;
+    
+    rtklib_lock(&q->lock);
+    wp=q->wp; rp=q->rp;
+    rtklib_unlock(&q->lock);
+    
+    if (!q->buff||rp==wp) return NULL;
+    
+    if (len ) *len =q->len [rp];
+    if (type) *type=q->type[rp];
+    if (tick) *tick=q->tick[rp];
+    return q->buff+(size_t)q->size*rp;
+}
+/* remove data at head of queue ----------------------------------------------*/
+static void popq(rtksvrq_t *q)
+{
+    rtklib_lock(&q->lock);
+    if (q->rp!=q->wp) q->rp=(q->rp+1)%q->n;
+    rtklib_signal(&q->cond);
+    rtklib_unlock(&q->lock);
+}
+/* number of data in queue ---------------------------------------------------*/
+static int countq(rtksvrq_t *q)
+{
+    int n;
+    
+    rtklib_lock(&q->lock);
+    n=q->n>0?(q->wp-q->rp+q->n)%q->n:0;
+    rtklib_unlock(&q->lock);
+    return n;
+}
+/* update stage latency/drop count -------------------------------------------*/
+static void updatelat(rtksvr_t *svr, int i, uint32_t tick)
+{
+    rtksvrlat_t *lat=svr->lat+i;
+    double t=(int)(tickget()-tick);
+    
+    rtklib_lock(&svr->lock);
+    lat->n++;
+    lat->ave+=(t-lat->ave)/lat->n;
+    if (t>lat->max) lat->max=t;
+    rtklib_unlock(&svr->lock);
+}
+static void droplat(rtksvr_t *svr, int i)
+{
+    rtklib_lock(&svr->lock);
+    svr->lat[i].ndrop++;
+    rtklib_unlock(&svr->lock);
+}
+/* acquire/release latest status snapshot -----------------------------------*/
+static const rtksvrstat_t *acqstat(rtksvr_t *svr, int *k)
+{
+    rtklib_lock(&svr->slock);
+    if ((*k=svr->statidx)>=0) svr->statref[*k]++;
+    rtklib_unlock(&svr->slock);
+    return *k>=0?svr->stat+*k:NULL;
+}
+static void relstat(rtksvr_t *svr, int k)
+{
+    if (k<0) return;
+    rtklib_lock(&svr->slock);
+    svr->statref[k]--;
+    rtklib_unlock(&svr->slock);
+}
+/* publish status snapshot -----------------------------------------------------
+* the positioning thread fills a snapshot buffer which is neither the latest
+* one nor in use by readers and then publishes it as the latest. the snapshot
+* lock only guards the index and the reader counts, so readers never wait for
+* positioning and the positioning thread never waits for readers. if all
+* buffers are in use, the snapshot is skipped (return 0).
+*-----------------------------------------------------------------------------*/
+static int publishstat(rtksvr_t *svr)
+{
+    rtksvrstat_t *stat;
+    rtksvrq_t *q;
+    const rtk_t *rtk=&svr->rtk;
+    int i,j,k;
+    
+    if (!svr->stat) return 0;
+    
+    rtklib_lock(&svr->slock);
+    for (k=0;k<NSTATBUF;k++) {
+        if (k!=svr->statidx&&svr->statref[k]<=0) break;
+    }
+    rtklib_unlock(&svr->slock);
+    
+    if (k>=NSTATBUF) return 0;
+    stat=svr->stat+k;
+    
+    stat->tick=tickget();
+    stat->state=svr->state;
+    stat->sol=rtk->sol;
+    matcpy(stat->rb,rtk->rb,6,1);
+    for (i=0;i<3;i++) {
+        stat->x [i]=rtk->x &&rtk->nx>i?rtk->x [i]:0.0;
+        stat->x [i+3]=rtk->P &&rtk->nx>i?SQRT(rtk->P [i+i*rtk->nx]):0.0;
+        stat->xa[i]=rtk->xa&&rtk->na>i?rtk->xa[i]:0.0;
+        stat->xa[i+3]=rtk->Pa&&rtk->na>i?SQRT(rtk->Pa[i+i*rtk->na]):0.0;
+    }
+    stat->nx=rtk->nx;
+    stat->na=rtk->na;
+    stat->tt=rtk->tt;
+    memcpy(stat->ssat,rtk->ssat,sizeof(stat->ssat));
+    
+    rtksvrlock(svr);
+    for (i=0;i<3;i++) {
+        stat->nobs[i]=svr->obs[i][0].n;
+        memcpy(stat->obs[i],svr->obs[i][0].data,sizeof(obsd_t)*stat->nobs[i]);
+        for (j=0;j<10;j++) stat->nmsg[i][j]=svr->nmsg[i][j];
+        memcpy(stat->nmsg2[i],svr->nmsg2[i],sizeof(stat->nmsg2[i]));
+        memcpy(stat->nmsg3[i],svr->nmsg3[i],sizeof(stat->nmsg3[i]));
+        stat->nb[i]=svr->nb[i];
+    }
+    stat->rcvcount=svr->rcvcount;
+    stat->tmcount=svr->tmcount;
+    stat->timevalid=svr->timevalid;
+    stat->eventime=svr->eventime;
+    for (i=0;i<MAXSTRRTK;i++) {
+        stat->sstat[i]=strstat(svr->stream+i,stat->smsg[i]);
+        strsum(svr->stream+i,stat->inb+i,NULL,stat->outb+i,NULL);
+    }
+    for (i=0;i<6;i++) {
+        q=i<2?svr->qobs+i:(i==2?&svr->qsol:svr->qlog+i-3);
+        stat->nq[i]=countq(q);
+        stat->nqmax[i]=q->nmax;
+    }
+    stat->cputime=svr->cputime;
+    stat->prcout=svr->prcout;
+    stat->nave=svr->nave;
+    memcpy(stat->lat,svr->lat,sizeof(stat->lat));
+    rtksvrunlock(svr);
+    
+    rtklib_lock(&svr->slock);
+    stat->seq=++svr->statseq;
+    svr->statidx=k;
+    rtklib_unlock(&svr->slock);
+    return 1;
+}
+/* create/join thread --------------------------------------------------------*/
+static int createthread(rtklib_thread_t *thread, threadfunc_t func, void *arg)
+{
+#ifdef WIN32
+    return (*thread=CreateThread(NULL,0,func,arg,0,NULL))!=NULL;
+#else
+    return !pthread_create(thread,NULL,func,arg);
+#endif
+}
+static void jointhread(rtklib_thread_t thread)
+{
+#ifdef WIN32
+    WaitForSingleObject(thread,INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread,NULL);
+#endif
+}
 
 /* write solution header to output stream ------------------------------------*/
 static void writesolhead(stream_t *stream, const solopt_t *solopt)
@@ -67,7 +370,16 @@ static void saveoutbuf(rtksvr_t *svr, uint8_t *buff, int n, int index)
     
     rtksvrunlock(svr);
 }
-/* write solution to output stream -------------------------------------------*/
+/* queue solution message to output thread ----------------------------------*/
+static void queuesol(rtksvr_t *svr, const uint8_t *buff, int n, int type)
+{
+    if (n<=0) return;
+    if (!waitputq(svr,&svr->qsol,buff,n,type,0)) droplat(svr,4);
+}
+/* write solution to output stream ---------------------------------------------
+* solution messages are formatted by the positioning thread and written to the
+* output streams by the output thread (type 0:sol1,1:sol2,2:monitor)
+*-----------------------------------------------------------------------------*/
 static void writesol(rtksvr_t *svr, int index)
 {
     solopt_t solopt=solopt_default;
@@ -88,22 +400,16 @@ static void writesol(rtksvr_t *svr, int index)
             /* output solution */
             n=outsols(buff,&svr->rtk.sol,svr->rtk.rb,svr->solopt+i);
         }
-        strwrite(svr->stream+i+3,buff,n);
-        
-        /* save output buffer */
-        saveoutbuf(svr,buff,n,i);
+        queuesol(svr,buff,n,i);
         
         /* output extended solution */
         n=outsolexs(buff,&svr->rtk.sol,svr->rtk.ssat,svr->solopt+i);
-        strwrite(svr->stream+i+3,buff,n);
-        
-        /* save output buffer */
-        saveoutbuf(svr,buff,n,i);
+        queuesol(svr,buff,n,i);
     }
     /* output solution to monitor port */
     if (svr->moni) {
         n=outsols(buff,&svr->rtk.sol,svr->rtk.rb,&solopt);
-        strwrite(svr->moni,buff,n);
+        queuesol(svr,buff,n,2);
     }
     /* save solution buffer */
     if (svr->nsol<MAXSOLBUF) {
@@ -112,47 +418,56 @@ static void writesol(rtksvr_t *svr, int index)
         rtksvrunlock(svr);
     }
 }
-/* update glonass frequency channel number in raw data struct ----------------*/
-static void update_glofcn(rtksvr_t *svr)
+/* update glonass frequency channel number ------------------------------------
+* the fcn of received glonass ephemeris is kept in svr->nav.glo_fcn and set to
+* the raw data struct by the decoder thread owning it (see set_glofcn())
+*-----------------------------------------------------------------------------*/
+static void update_glofcn(rtksvr_t *svr, const geph_t *geph, int prn)
 {
-    int i,j,sat,frq;
+    if (geph->frq<-7||geph->frq>6) return;
+    svr->nav.glo_fcn[prn-1]=geph->frq+8;
+}
+/* set glonass frequency channel number in raw data struct -------------------*/
+static void set_glofcn(rtksvr_t *svr, int index)
+{
+    geph_t *geph;
+    int i,sat;
     
     for (i=0;i<MAXPRNGLO;i++) {
+        if (svr->nav.glo_fcn[i]<=0) continue;
         sat=satno(SYS_GLO,i+1);
-        
-        for (j=0,frq=-999;j<3;j++) {
-            if (svr->raw[j].nav.geph[i].sat!=sat) continue;
-            frq=svr->raw[j].nav.geph[i].frq;
-        }
-        if (frq<-7||frq>6) continue;
-        
-        for (j=0;j<3;j++) {
-            if (svr->raw[j].nav.geph[i].sat==sat) continue;
-            svr->raw[j].nav.geph[i].sat=sat;
-            svr->raw[j].nav.geph[i].frq=frq;
-        }
+        geph=svr->raw[index].nav.geph+i;
+        if (geph->sat==sat) continue;
+        geph->sat=sat;
+        geph->frq=svr->nav.glo_fcn[i]-8;
     }
 }
 /* update observation data ---------------------------------------------------*/
-static void update_obs(rtksvr_t *svr, obs_t *obs, int index, int iobs)
+static void update_obs(rtksvr_t *svr, obs_t *obs, int index)
 {
+    obs_t *p=&svr->obs[index][0];
     int i,n=0,sat,sys;
     
-        if (iobs<MAXOBSBUF) {
-            for (i=0;i<obs->n;i++) {
-            sat=obs->data[i].sat;
-            sys=satsys(sat,NULL);
-            if (svr->rtk.opt.exsats[sat-1]==1||!(sys&svr->rtk.opt.navsys)) {
-                continue;
-            }
-                svr->obs[index][iobs].data[n]=obs->data[i];
-                svr->obs[index][iobs].data[n++].rcv=index+1;
-            }
-            svr->obs[index][iobs].n=n;
-            sortobs(&svr->obs[index][iobs]);
+    for (i=0;i<obs->n;i++) {
+        sat=obs->data[i].sat;
+        sys=satsys(sat,NULL);
+        if (svr->rtk.opt.exsats[sat-1]==1||!(sys&svr->rtk.opt.navsys)) {
+            continue;
         }
-        svr->nmsg[index][0]++;
+        p->data[n]=obs->data[i];
+        p->data[n++].rcv=index+1;
     }
+    p->n=n;
+    sortobs(p);
+    
+    /* queue rover/base epoch to positioning thread (called with lock) */
+    if (index<2&&!waitputq(svr,svr->qobs+index,(uint8_t *)p->data,
+                           p->n*(int)sizeof(obsd_t),0,1)) {
+        svr->lat[index].ndrop++;
+        if (index==0) svr->prcout++;
+    }
+    svr->nmsg[index][0]++;
+}
 /* update ephemeris ----------------------------------------------------------*/
 static void update_eph(rtksvr_t *svr, nav_t *nav, int ephsat, int ephset,
                        int index)
@@ -175,6 +490,7 @@ static void update_eph(rtksvr_t *svr, nav_t *nav, int ephsat, int ephset,
                  timediff(eph1->toc,eph2->toc)!=0.0)) {
                 *eph3=*eph2; /* current ->previous */
                 *eph2=*eph1; /* received->current */
+                svr->navver++;
                 }
             }
             svr->nmsg[index][1]++;
@@ -188,7 +504,8 @@ static void update_eph(rtksvr_t *svr, nav_t *nav, int ephsat, int ephset,
                    (geph1->iode!=geph3->iode&&geph1->iode!=geph2->iode)) {
                    *geph3=*geph2;
                    *geph2=*geph1;
-                update_glofcn(svr);
+                update_glofcn(svr,geph1,prn);
+                svr->navver++;
                }
            }
            svr->nmsg[index][6]++;
@@ -209,6 +526,7 @@ static void update_sbs(rtksvr_t *svr, sbsmsg_t *sbsmsg, int index)
                 svr->sbsmsg[i]=*sbsmsg;
             }
             sbsupdatecorr(sbsmsg,&svr->nav);
+            svr->navver++;
         }
         svr->nmsg[index][3]++;
     }
@@ -228,10 +546,13 @@ static void update_ionutc(rtksvr_t *svr, nav_t *nav, int index)
         matcpy(svr->nav.ion_qzs,nav->ion_qzs,8,1);
         matcpy(svr->nav.ion_cmp,nav->ion_cmp,8,1);
         matcpy(svr->nav.ion_irn,nav->ion_irn,8,1);
+        svr->navver++;
         }
         svr->nmsg[index][2]++;
     }
-/* update antenna position ---------------------------------------------------*/
+/* update antenna position -----------------------------------------------------
+* the base position is set to the rtk control by the positioning thread
+*-----------------------------------------------------------------------------*/
 static void update_antpos(rtksvr_t *svr, int index)
 {
     sta_t *sta;
@@ -247,21 +568,21 @@ static void update_antpos(rtksvr_t *svr, int index)
         }
         /* update base station position */
             for (i=0;i<3;i++) {
-            svr->rtk.rb[i]=sta->pos[i];
+            svr->rb[i]=sta->pos[i];
             }
             /* antenna delta */
-            ecef2pos(svr->rtk.rb,pos);
+            ecef2pos(svr->rb,pos);
         if (sta->deltype) { /* xyz */
             del[2]=sta->hgt;
                 enu2ecef(pos,del,dr);
                 for (i=0;i<3;i++) {
-                svr->rtk.rb[i]+=sta->del[i]+dr[i];
+                svr->rb[i]+=sta->del[i]+dr[i];
                 }
             }
             else { /* enu */
             enu2ecef(pos,sta->del,dr);
                 for (i=0;i<3;i++) {
-                    svr->rtk.rb[i]+=dr[i];
+                    svr->rb[i]+=dr[i];
                 }
             }
         }
@@ -298,19 +619,31 @@ static void update_ssr(rtksvr_t *svr, int index)
                 }
             }
             svr->nav.ssr[i]=svr->rtcm[index].ssr[i];
+            svr->navver++;
         }
         svr->nmsg[index][7]++;
     }
+/* update dgps corrections ---------------------------------------------------*/
+static void update_dgps(rtksvr_t *svr, int index)
+{
+    int i;
+    
+    for (i=0;i<MAXSAT;i++) {
+        if (timediff(svr->dgps[index][i].t0,svr->nav.dgps[i].t0)<=0.0) continue;
+        svr->nav.dgps[i]=svr->dgps[index][i];
+        svr->navver++;
+    }
+    svr->nmsg[index][5]++;
+}
 /* update rtk server struct --------------------------------------------------*/
 static void update_svr(rtksvr_t *svr, int ret, obs_t *obs, nav_t *nav,
-                       int ephsat, int ephset, sbsmsg_t *sbsmsg, int index,
-                       int iobs)
+                       int ephsat, int ephset, sbsmsg_t *sbsmsg, int index)
 {
     tracet(4,"updatesvr: ret=%d ephsat=%d ephset=%d index=%d\n",ret,ephsat,
            ephset,index);
     
     if (ret==1) { /* observation data */
-        update_obs(svr,obs,index,iobs);
+        update_obs(svr,obs,index);
     }
     else if (ret==2) { /* ephemeris */
         update_eph(svr,nav,ephsat,ephset,index);
@@ -325,7 +658,7 @@ static void update_svr(rtksvr_t *svr, int ret, obs_t *obs, nav_t *nav,
         update_antpos(svr,index);
     }
     else if (ret==7) { /* dgps correction */
-        svr->nmsg[index][5]++;
+        update_dgps(svr,index);
     }
     else if (ret==10) { /* ssr message */
         update_ssr(svr,index);
@@ -344,8 +677,13 @@ static int decoderaw(rtksvr_t *svr, int index)
     
     tracet(4,"decoderaw: index=%d\n",index);
     
-    rtksvrlock(svr);
-    
+    /* raw/rtcm control is owned by the decoder thread. the server lock is
+       only taken to update the server by a decoded message */
+    if (svr->format[index]!=STRFMT_RTCM2&&svr->format[index]!=STRFMT_RTCM3) {
+        rtksvrlock(svr);
+        set_glofcn(svr,index);
+        rtksvrunlock(svr);
+    }
     for (i=0;i<svr->nb[index];i++) {
         
         /* input rtcm/receiver raw data from stream */
@@ -380,15 +718,26 @@ static int decoderaw(rtksvr_t *svr, int index)
 #endif
         /* update rtk server */
         if (ret>0) {
-            update_svr(svr,ret,obs,nav,ephsat,ephset,sbsmsg,index,fobs);
+            rtksvrlock(svr);
+            update_svr(svr,ret,obs,nav,ephsat,ephset,sbsmsg,index);
+            rtksvrunlock(svr);
         }
         /* observation data received */
-        if (ret==1) {
-            if (fobs<MAXOBSBUF) fobs++; else svr->prcout++;
-        }
+        if (ret==1) fobs++;
     }
+    /* copy decoder status for status snapshots */
+    rtksvrlock(svr);
     svr->nb[index]=0;
-    
+    memcpy(svr->nmsg2[index],svr->rtcm[index].nmsg2,sizeof(svr->nmsg2[index]));
+    memcpy(svr->nmsg3[index],svr->rtcm[index].nmsg3,sizeof(svr->nmsg3[index]));
+    if (index==0) {
+        svr->rcvcount=svr->raw[0].obs.rcvcount;
+        svr->tmcount=svr->raw[0].obs.tmcount;
+        if (svr->raw[0].obs.data) {
+            svr->timevalid=svr->raw[0].obs.data[0].timevalid;
+            svr->eventime=svr->raw[0].obs.data[0].eventime;
+        }
+    }
     rtksvrunlock(svr);
     
     return fobs;
@@ -423,12 +772,20 @@ static void decodefile(rtksvr_t *svr, int index)
             tracet(1,"sp3 file read error: %s\n",file);
             return;
         }
+        /* set per-satellite precise ephemeris */
+        setpephs(&nav,svr->rtk.opt.pephcheb?2:0);
+        
         /* update precise ephemeris */
         rtksvrlock(svr);
         
-        if (svr->nav.peph) free(svr->nav.peph);
+        if (svr->nav.peph!=svr->pnav.peph) { /* not taken by positioning */
+            free(svr->nav.peph);
+            freepephs(&svr->nav);
+        }
         svr->nav.ne=svr->nav.nemax=nav.ne;
         svr->nav.peph=nav.peph;
+        svr->nav.pephs=nav.pephs;
+        svr->navver++;
         svr->ftime[index]=utc2gpst(timeget());
         strcpy(svr->files[index],file);
         
@@ -444,15 +801,42 @@ static void decodefile(rtksvr_t *svr, int index)
         /* update precise clock */
         rtksvrlock(svr);
         
-        if (svr->nav.pclk) free(svr->nav.pclk);
+        if (svr->nav.pclk!=svr->pnav.pclk) free(svr->nav.pclk);
         svr->nav.nc=svr->nav.ncmax=nav.nc;
         svr->nav.pclk=nav.pclk;
+        svr->navver++;
         svr->ftime[index]=utc2gpst(timeget());
         strcpy(svr->files[index],file);
         
         rtksvrunlock(svr);
     }
 }
+/* update navigation data copy of positioning thread ---------------------------
+* copy the navigation data updated by decoders to the copy used by positioning
+* without the server lock (called with lock). precise ephemeris and clock are
+* handed over instead of copied and the replaced ones are freed.
+*-----------------------------------------------------------------------------*/
+static void syncnav(rtksvr_t *svr, uint32_t *ver)
+{
+    nav_t *nav=&svr->pnav;
+    eph_t *eph=nav->eph;
+    geph_t *geph=nav->geph;
+    seph_t *seph=nav->seph;
+    
+    if (*ver==svr->navver) return;
+    
+    if (nav->peph!=svr->nav.peph) {
+        free(nav->peph);
+        freepephs(nav);
+    }
+    if (nav->pclk!=svr->nav.pclk) free(nav->pclk);
+    *nav=svr->nav;
+    nav->eph=eph; nav->geph=geph; nav->seph=seph;
+    memcpy(eph ,svr->nav.eph ,sizeof(eph_t )*svr->nav.n );
+    memcpy(geph,svr->nav.geph,sizeof(geph_t)*svr->nav.ng);
+    memcpy(seph,svr->nav.seph,sizeof(seph_t)*svr->nav.ns);
+    *ver=svr->navver;
+}
 /* carrier-phase bias (fcb) correction ---------------------------------------*/
 static void corr_phase_bias(obsd_t *obs, int n, const nav_t *nav)
 {
@@ -558,142 +942,357 @@ static void send_nmea(rtksvr_t *svr, uint32_t *tickreset)
                sol_nmea.rr[2]);
     }
 }
-/* rtk server thread ---------------------------------------------------------*/
+/* decoder thread --------------------------------------------------------------
+* read an input stream, queue the data to the log stream and decode it. decoded
+* rover/base epochs are queued to the positioning thread
+*-----------------------------------------------------------------------------*/
 #ifdef WIN32
-static DWORD WINAPI rtksvrthread(void *arg)
+static DWORD WINAPI decthread(void *arg)
 #else
-static void *rtksvrthread(void *arg)
+static void *decthread(void *arg)
 #endif
 {
-    rtksvr_t *svr=(rtksvr_t *)arg;
-    obs_t obs;
-    obsd_t data[MAXOBS*2];
-    sol_t sol={{0}};
-    double tt;
-    uint32_t tick,ticknmea,tick1hz,tickreset;
+    rtksvr_t *svr=(rtksvr_t *)((rtksvrarg_t *)arg)->svr;
+    int i=((rtksvrarg_t *)arg)->index,n;
+    uint64_t t0;
+    uint32_t tick;
     uint8_t *p,*q;
-    char msg[128];
-    int i,j,n,cycle,cputime;
     
-    tracet(3,"rtksvrthread:\n");
+    tracet(3,"decthread: index=%d\n",i);
     
-    svr->state=1; obs.data=data;
-    svr->tick=tickget();
-    ticknmea=tick1hz=svr->tick-1000;
-    tickreset=svr->tick-MIN_INT_RESET;
+    /* bind library context of server to thread */
+    setrtkctx(svr->ctx);
     
-    for (cycle=0;svr->state;cycle++) {
+    while (svr->state) {
         tick=tickget();
-        for (i=0;i<3;i++) {
-            p=svr->buff[i]+svr->nb[i]; q=svr->buff[i]+svr->buffsize;
-            
-            /* read receiver raw/rtcm data from input stream */
-            if ((n=strread(svr->stream+i,p,q-p))<=0) {
-                continue;
+        p=svr->buff[i]+svr->nb[i]; q=svr->buff[i]+svr->buffsize;
+        
+        /* read receiver raw/rtcm data from input stream */
+        if ((n=strread(svr->stream+i,p,q-p))<=0) {
+            sleepms(svr->cycle);
+            continue;
+        }
+        /* queue receiver raw/rtcm data to log stream */
+        if (svr->stream[i+5].port&&!waitputq(svr,svr->qlog+i,p,n,i+5,0)) {
+            droplat(svr,i);
+        }
+        /* save peek buffer */
+        rtksvrlock(svr);
+        svr->nb[i]+=n;
+        n=n<svr->buffsize-svr->npb[i]?n:svr->buffsize-svr->npb[i];
+        memcpy(svr->pbuf[i]+svr->npb[i],p,n);
+        svr->npb[i]+=n;
+        rtksvrunlock(svr);
+        
+        t0=metbegin();
+        if (svr->format[i]==STRFMT_SP3||svr->format[i]==STRFMT_RNXCLK) {
+            /* decode download file */
+            decodefile(svr,i);
+        }
+        else {
+            /* decode receiver raw/rtcm data */
+            decoderaw(svr,i);
+        }
+        metend(MET_DEC,t0);
+        updatelat(svr,i,tick);
+    }
+    return 0;
+}
+/* output thread ---------------------------------------------------------------
+* write queued solutions and input logs to the output/log streams. after the
+* other threads stopped (svr->ostate=0), remaining data is flushed.
+*-----------------------------------------------------------------------------*/
+#ifdef WIN32
+static DWORD WINAPI outthread(void *arg)
+#else
+static void *outthread(void *arg)
+#endif
+{
+    rtksvr_t *svr=(rtksvr_t *)arg;
+    uint64_t t0;
+    uint32_t tick;
+    uint8_t *p;
+    int i,n,type,nw,stop;
+    
+    tracet(3,"outthread:\n");
+    
+    for (;;) {
+        stop=!svr->ostate;
+        
+        /* write solutions */
+        for (nw=0;(p=peekq(&svr->qsol,&n,&type,&tick));nw++) {
+            t0=metbegin();
+            if (type<2) {
+                strwrite(svr->stream+type+3,p,n);
+                saveoutbuf(svr,p,n,type);
             }
-            /* write receiver raw/rtcm data to log stream */
-            strwrite(svr->stream+i+5,p,n);
-            svr->nb[i]+=n;
-            
-            /* save peek buffer */
-            rtksvrlock(svr);
-            n=n<svr->buffsize-svr->npb[i]?n:svr->buffsize-svr->npb[i];
-            memcpy(svr->pbuf[i]+svr->npb[i],p,n);
-            svr->npb[i]+=n;
-            rtksvrunlock(svr);
+            else if (svr->moni) {
+                strwrite(svr->moni,p,n);
+            }
+            popq(&svr->qsol);
+            metend(MET_OUT,t0);
+            updatelat(svr,4,tick);
         }
-        int fobs[3]={0};
+        /* write logs of input streams */
         for (i=0;i<3;i++) {
-            if (svr->format[i]==STRFMT_SP3||svr->format[i]==STRFMT_RNXCLK) {
-                /* decode download file */
-                decodefile(svr,i);
-            }
-            else {
-                /* decode receiver raw/rtcm data */
-                fobs[i]=decoderaw(svr,i);
-                if (1==i&&svr->rtcm[1].staid>0) sol.refstationid=svr->rtcm[1].staid; 
+            for (;(p=peekq(svr->qlog+i,&n,&type,NULL));nw++) {
+                strwrite(svr->stream+type,p,n);
+                popq(svr->qlog+i);
             }
         }
+        if (stop) break;
+        if (nw<=0) waitevt(&svr->evout,svr->cycle);
+    }
+    return 0;
+}
+/* update base epoch aligned to rover epoch ------------------------------------
+* take base epochs from queue up to the rover time, so a rover epoch is paired
+* with the latest base epoch not newer than the rover in the queue order. base
+* epochs newer than the rover are held in the queue. if the queue is full
+* without rover epochs (drop=1), the oldest base epochs are dropped.
+*-----------------------------------------------------------------------------*/
+static int alignbase(rtksvr_t *svr, gtime_t time, obsd_t *base, int nb,
+                     sol_t *sol, int drop)
+{
+    uint8_t *p;
+    char msg[128];
+    int i,n,stat;
+    
+    while ((p=peekq(svr->qobs+1,&n,NULL,NULL))) {
+        if (n>0&&timediff(((obsd_t *)p)->time,time)>DTTOL) {
+            if (!drop||countq(svr->qobs+1)<NQOBS-1) break;
+            popq(svr->qobs+1);
+            droplat(svr,1);
+            continue;
+        }
+        nb=n/(int)sizeof(obsd_t);
+        memcpy(base,p,n);
+        popq(svr->qobs+1);
+        
+        if (svr->rtcm[1].staid>0) sol->refstationid=svr->rtcm[1].staid;
+        
         /* averaging single base pos */
-        if (fobs[1]>0&&svr->rtk.opt.refpos==POSOPT_SINGLE) {
-            if ((svr->rtk.opt.maxaveep<=0||svr->nave<svr->rtk.opt.maxaveep)&&
-                pntpos(svr->obs[1][0].data,svr->obs[1][0].n,&svr->nav,
-                       &svr->rtk.opt,&sol,NULL,NULL,msg)) {
+        if (svr->rtk.opt.refpos==POSOPT_SINGLE) {
+            stat=(svr->rtk.opt.maxaveep<=0||svr->nave<svr->rtk.opt.maxaveep)&&
+                 pntpos(base,nb,&svr->pnav,&svr->rtk.opt,sol,NULL,NULL,msg);
+            rtksvrlock(svr);
+            if (stat) {
                 svr->nave++;
                 for (i=0;i<3;i++) {
-                    svr->rb_ave[i]+=(sol.rr[i]-svr->rb_ave[i])/svr->nave;
+                    svr->rb_ave[i]+=(sol->rr[i]-svr->rb_ave[i])/svr->nave;
                 }
             }
             for (i=0;i<3;i++) svr->rtk.opt.rb[i]=svr->rb_ave[i];
+            rtksvrunlock(svr);
+        }
+    }
+    return nb;
+}
+/* test base stream synchronized to rover epoch --------------------------------
+* by default (svr->basewait=0), a rover epoch is processed at once with the
+* latest base epoch. with svr->basewait>0, a rover epoch is held until the base
+* stream reached the rover time (a base epoch at or after the rover time is
+* received) or for svr->basewait (ms), so the pairing of rover and base epochs
+* does not depend on the timing of the decoder threads.
+*-----------------------------------------------------------------------------*/
+static int basesync(rtksvr_t *svr, gtime_t time, const obsd_t *base, int nb,
+                    uint32_t tick)
+{
+    int mode=svr->rtk.opt.mode;
+    
+    if (svr->basewait<=0||mode==PMODE_SINGLE||mode>=PMODE_PPP_KINEMA||
+        !svr->stream[1].port) {
+        return 1;
+    }
+    if (nb>0&&timediff(base[0].time,time)>=-DTTOL) return 1;
+    if (peekq(svr->qobs+1,NULL,NULL,NULL)) return 1;
+    
+    return (int)(tickget()-tick)>=svr->basewait;
+}
+/* rtk server thread -----------------------------------------------------------
+* start decoder and output threads and run positioning for rover epochs in the
+* order of the epoch queue. positioning runs without the server lock on the
+* navigation data copy, so decoders are not blocked by positioning.
+*-----------------------------------------------------------------------------*/
+#ifdef WIN32
+static DWORD WINAPI rtksvrthread(void *arg)
+#else
+static void *rtksvrthread(void *arg)
+#endif
+{
+    rtksvr_t *svr=(rtksvr_t *)arg;
+    obs_t obs;
+    obsd_t data[MAXOBS*2],base[MAXOBS];
+    sol_t sol={{0}};
+    gtime_t time={0};
+    double tt;
+    uint64_t t0;
+    uint32_t tick,tick0,tickcyc,ticknmea,tick1hz,tickreset,tickrov,ver=0;
+    uint8_t *p;
+    int i,n,nr,nb=0,np,cycle=0,cputime,ndec=0,ms;
+    
+    tracet(3,"rtksvrthread:\n");
+    
+    /* bind library context of server to thread */
+    setrtkctx(svr->ctx);
+    
+    svr->state=1; obs.data=data;
+    svr->tick=tickget();
+    tickcyc=svr->tick;
+    ticknmea=tick1hz=svr->tick-1000;
+    tickreset=svr->tick-MIN_INT_RESET;
+    tickrov=svr->tick;
+    
+    /* navigation data copy for positioning */
+    rtksvrlock(svr);
+    syncnav(svr,&ver);
+    rtksvrunlock(svr);
+    
+    /* start decoder and output threads */
+    svr->ostate=1;
+    if (!createthread(&svr->othread,outthread,svr)) {
+        tracet(1,"rtksvrthread: output thread create error\n");
+        svr->ostate=svr->state=0;
+    }
+    for (i=0;i<3&&svr->state;i++) {
+        svr->darg[i].svr=svr;
+        svr->darg[i].index=i;
+        if (!createthread(svr->dthread+i,decthread,svr->darg+i)) {
+            tracet(1,"rtksvrthread: decoder thread create error\n");
+            svr->state=0;
+            break;
         }
-        for (i=0;i<fobs[0];i++) { /* for each rover observation data */
+        ndec++;
+    }
+    while (svr->state) {
+        tick=tickget();
+        
+        /* for each rover observation data */
+        for (np=0;(p=peekq(svr->qobs,&n,NULL,&tick0));np++) {
+            nr=n/(int)sizeof(obsd_t);
+            if (nr>0) time=((obsd_t *)p)->time;
+            
+            /* update base observation data aligned to rover */
+            nb=alignbase(svr,time,base,nb,&sol,0);
+            
+            /* wait for base epoch at rover time */
+            if (!basesync(svr,time,base,nb,tick0)) break;
+            tickrov=tickget();
+            
             obs.n=0;
-            for (j=0;j<svr->obs[0][i].n&&obs.n<MAXOBS*2;j++) {
-                obs.data[obs.n++]=svr->obs[0][i].data[j];
+            for (i=0;i<nr&&obs.n<MAXOBS*2;i++) {
+                obs.data[obs.n++]=((obsd_t *)p)[i];
             }
-            for (j=0;j<svr->obs[1][0].n&&obs.n<MAXOBS*2;j++) {
-                obs.data[obs.n++]=svr->obs[1][0].data[j];
+            for (i=0;i<nb&&obs.n<MAXOBS*2;i++) {
+                obs.data[obs.n++]=base[i];
             }
+            popq(svr->qobs);
+            
+            /* update navigation data copy and base position */
+            rtksvrlock(svr);
+            syncnav(svr,&ver);
+            if (svr->rtk.opt.refpos==POSOPT_RTCM&&norm(svr->rb,3)>0.0) {
+                matcpy(svr->rtk.rb,svr->rb,3,1);
+            }
+            rtksvrunlock(svr);
+            
             /* carrier phase bias correction */
             if (!strstr(svr->rtk.opt.pppopt,"-DIS_FCB")) {
-                corr_phase_bias(obs.data,obs.n,&svr->nav);
+                corr_phase_bias(obs.data,obs.n,&svr->pnav);
             }
             /* rtk positioning */
-            rtksvrlock(svr);
-            rtkpos(&svr->rtk,obs.data,obs.n,&svr->nav);
-            rtksvrunlock(svr);
+            t0=metbegin();
+            rtkpos(&svr->rtk,obs.data,obs.n,&svr->pnav);
+            metend(MET_RTKPOS,t0);
             
             if (svr->rtk.sol.stat!=SOLQ_NONE) {
                 
                 /* adjust current time */
-                tt=(int)(tickget()-tick)/1000.0+DTTOL;
+                tt=(int)(tickget()-tick0)/1000.0+DTTOL;
                 timeset(gpst2utc(timeadd(svr->rtk.sol.time,tt)));
                 
                 /* write solution */
-                writesol(svr,i);
-            }
-            /* if cpu overload, increment obs outage counter and break */
-            if ((int)(tickget()-tick)>=svr->cycle) {
-                svr->prcout+=fobs[0]-i-1;
+                writesol(svr,np);
             }
+            updatelat(svr,3,tick0);
+            
+            /* publish status snapshot */
+            publishstat(svr);
         }
-        /* send null solution if no solution (1hz) */
-        if (svr->rtk.sol.stat==SOLQ_NONE&&(int)(tick-tick1hz)>=1000) {
-            writesol(svr,0);
-            tick1hz=tick;
+        /* update base observation data without rover */
+        if (np<=0) {
+            nb=alignbase(svr,time,base,nb,&sol,!peekq(svr->qobs,NULL,NULL,NULL)&&
+                         (int)(tick-tickrov)>=svr->basewait);
         }
-        /* write periodic command to input stream */
-        for (i=0;i<3;i++) {
-            periodic_cmd(cycle*svr->cycle,svr->cmds_periodic[i],svr->stream+i);
+        
+        if (np>0&&(cputime=(int)(tickget()-tick))>0) svr->cputime=cputime;
+        
+        if ((int)(tick-tickcyc)>=svr->cycle) {
+            
+            /* send null solution if no solution (1hz) */
+            if (svr->rtk.sol.stat==SOLQ_NONE&&(int)(tick-tick1hz)>=1000) {
+                writesol(svr,0);
+                tick1hz=tick;
+            }
+            /* write periodic command to input stream */
+            for (i=0;i<3;i++) {
+                periodic_cmd(cycle*svr->cycle,svr->cmds_periodic[i],svr->stream+i);
+            }
+            /* send nmea request to base/nrtk input stream */
+            if (svr->nmeacycle>0&&(int)(tick-ticknmea)>=svr->nmeacycle) {
+                send_nmea(svr,&tickreset);
+                ticknmea=tick;
+            }
+            /* publish status snapshot */
+            if (np<=0) publishstat(svr);
+            
+            tickcyc=tick;
+            cycle++;
         }
-        /* send nmea request to base/nrtk input stream */
-        if (svr->nmeacycle>0&&(int)(tick-ticknmea)>=svr->nmeacycle) {
-            send_nmea(svr,&tickreset);
-            ticknmea=tick;
+        /* wait for observation data until next cycle */
+        if (np<=0&&(ms=svr->cycle-(int)(tickget()-tickcyc))>0) {
+            waitevt(&svr->evpos,ms);
         }
-        if ((cputime=(int)(tickget()-tick))>0) svr->cputime=cputime;
-        
-        /* sleep until next cycle */
-        sleepms(svr->cycle-cputime);
+    }
+    /* stop decoder and output threads */
+    for (i=0;i<ndec;i++) jointhread(svr->dthread[i]);
+    if (svr->ostate) {
+        svr->ostate=0;
+        setevt(&svr->evout);
+        jointhread(svr->othread);
     }
     for (i=0;i<MAXSTRRTK;i++) strclose(svr->stream+i);
+    
+    /* republish status snapshot of closed streams */
+    for (i=0;i<100&&!publishstat(svr);i++) sleepms(POLLCYCLE);
     for (i=0;i<3;i++) {
         svr->nb[i]=svr->npb[i]=0;
         free(svr->buff[i]); svr->buff[i]=NULL;
         free(svr->pbuf[i]); svr->pbuf[i]=NULL;
         free_raw (svr->raw +i);
         free_rtcm(svr->rtcm+i);
+        freeq(svr->qlog+i);
     }
     for (i=0;i<2;i++) {
         svr->nsb[i]=0;
         free(svr->sbuf[i]); svr->sbuf[i]=NULL;
+        freeq(svr->qobs+i);
     }
+    freeq(&svr->qsol);
     return 0;
 }
 /* initialize rtk server -------------------------------------------------------
 * initialize rtk server
 * args   : rtksvr_t *svr    IO rtk server
 * return : status (0:error,1:ok)
+* notes  : svr->ctx is set to NULL (the server uses the default library
+*          context). to run several servers with different options in a
+*          process, set a context initialized by init_rtkctx() to svr->ctx
+*          before calling rtksvrstart()
+*          svr->basewait is set to 0 (a rover epoch is processed with the
+*          latest base epoch at once). to hold a rover epoch until the base
+*          epoch at the rover time is received, set the max wait (ms) to
+*          svr->basewait before calling rtksvrstart()
 *-----------------------------------------------------------------------------*/
 extern int rtksvrinit(rtksvr_t *svr)
 {
@@ -721,25 +1320,53 @@ extern int rtksvrinit(rtksvr_t *svr)
     for (i=0;i<3;i++) svr->pbuf[i]=NULL;
     for (i=0;i<MAXSOLBUF;i++) svr->solbuf[i]=sol0;
     for (i=0;i<3;i++) for (j=0;j<10;j++) svr->nmsg[i][j]=0;
+    memset(svr->nmsg2,0,sizeof(svr->nmsg2));
+    memset(svr->nmsg3,0,sizeof(svr->nmsg3));
+    svr->rcvcount=svr->tmcount=svr->timevalid=0;
+    svr->eventime=time0;
+    memset(svr->dgps,0,sizeof(svr->dgps));
     for (i=0;i<3;i++) svr->ftime[i]=time0;
     for (i=0;i<3;i++) svr->files[i][0]='\0';
     svr->moni=NULL;
     svr->tick=0;
-    svr->thread=0;
+    svr->thread=svr->othread=0;
+    for (i=0;i<3;i++) svr->dthread[i]=0;
+    svr->ostate=0;
+    memset(svr->qobs,0,sizeof(svr->qobs));
+    memset(&svr->qsol,0,sizeof(svr->qsol));
+    memset(svr->qlog,0,sizeof(svr->qlog));
+    memset(svr->lat,0,sizeof(svr->lat));
+    svr->stat=NULL;
+    svr->statidx=-1;
+    for (i=0;i<3;i++) svr->statref[i]=0;
+    svr->statseq=0;
     svr->cputime=svr->prcout=svr->nave=0;
     for (i=0;i<3;i++) svr->rb_ave[i]=0.0;
+    svr->ctx=NULL;
     
     memset(&svr->nav,0,sizeof(nav_t));
+    memset(&svr->pnav,0,sizeof(nav_t));
     memset(&svr->obs,0,sizeof(svr->obs));
+    svr->navver=0;
+    for (i=0;i<3;i++) svr->rb[i]=0.0;
+    svr->basewait=0;
     if (!(svr->nav.eph =(eph_t  *)malloc(sizeof(eph_t )*MAXSAT*4 ))||
         !(svr->nav.geph=(geph_t *)malloc(sizeof(geph_t)*NSATGLO*2))||
-        !(svr->nav.seph=(seph_t *)malloc(sizeof(seph_t)*NSATSBS*2))) {
+        !(svr->nav.seph=(seph_t *)malloc(sizeof(seph_t)*NSATSBS*2))||
+        !(svr->pnav.eph =(eph_t  *)malloc(sizeof(eph_t )*MAXSAT*4 ))||
+        !(svr->pnav.geph=(geph_t *)malloc(sizeof(geph_t)*NSATGLO*2))||
+        !(svr->pnav.seph=(seph_t *)malloc(sizeof(seph_t)*NSATSBS*2))) {
         tracet(1,"rtksvrinit: malloc error\n");
         rtksvrfree(svr);
         return 0;
     }
     for (i=0;i<MAXSAT*4 ;i++) svr->nav.eph [i]=eph0;
     for (i=0;i<NSATGLO*2;i++) svr->nav.geph[i]=geph0;
+    if (!(svr->stat=(rtksvrstat_t *)calloc(NSTATBUF,sizeof(rtksvrstat_t)))) {
+        tracet(1,"rtksvrinit: malloc error\n");
+        rtksvrfree(svr);
+        return 0;
+    }
     for (i=0;i<NSATSBS*2;i++) svr->nav.seph[i]=seph0;
     svr->nav.n =svr->nav.nmax =MAXSAT *4;
     svr->nav.ng=svr->nav.ngmax=NSATGLO*2;
@@ -762,6 +1389,22 @@ extern int rtksvrinit(rtksvr_t *svr)
     *svr->cmd_reset='\0';
     svr->bl_reset=10.0;
     rtklib_initlock(&svr->lock);
+    initevt(&svr->evpos);
+    initevt(&svr->evout);
+    for (i=0;i<2;i++) {
+        rtklib_initlock(&svr->qobs[i].lock);
+        rtklib_initcond(&svr->qobs[i].cond);
+        svr->qobs[i].evt=&svr->evpos;
+    }
+    for (i=0;i<3;i++) {
+        rtklib_initlock(&svr->qlog[i].lock);
+        rtklib_initcond(&svr->qlog[i].cond);
+        svr->qlog[i].evt=&svr->evout;
+    }
+    rtklib_initlock(&svr->qsol.lock);
+    rtklib_initcond(&svr->qsol.cond);
+    svr->qsol.evt=&svr->evout;
+    rtklib_initlock(&svr->slock);
     
     return 1;
 }
@@ -777,6 +1420,15 @@ extern void rtksvrfree(rtksvr_t *svr)
     free(svr->nav.eph );
     free(svr->nav.geph);
     free(svr->nav.seph);
+    free(svr->pnav.eph );
+    free(svr->pnav.geph);
+    free(svr->pnav.seph);
+    if (svr->pnav.peph!=svr->nav.peph) {
+        free(svr->pnav.peph);
+        freepephs(&svr->pnav);
+    }
+    if (svr->pnav.pclk!=svr->nav.pclk) free(svr->pnav.pclk);
+    free(svr->stat); svr->stat=NULL;
     for (i=0;i<3;i++) for (j=0;j<MAXOBSBUF;j++) {
         free(svr->obs[i][j].data);
     }
@@ -889,9 +1541,27 @@ extern int rtksvrstart(rtksvr_t *svr, int cycle, int buffsize, int *strs,
         strcpy(svr->raw [i].opt,rcvopts[i]);
         strcpy(svr->rtcm[i].opt,rcvopts[i]);
         
-        /* connect dgps corrections */
-        svr->rtcm[i].dgps=svr->nav.dgps;
+        /* connect private dgps corrections of decoder */
+        memset(svr->dgps[i],0,sizeof(svr->dgps[i]));
+        svr->rtcm[i].dgps=svr->dgps[i];
+        memset(svr->nmsg2[i],0,sizeof(svr->nmsg2[i]));
+        memset(svr->nmsg3[i],0,sizeof(svr->nmsg3[i]));
+    }
+    for (i=0;i<3;i++) { /* epoch and log queues */
+        if ((i<2&&!initq(svr->qobs+i,NQOBS,(int)sizeof(obsd_t)*MAXOBS))||
+            !initq(svr->qlog+i,NQLOG,svr->buffsize)) {
+            tracet(1,"rtksvrstart: malloc error\n");
+            sprintf(errmsg,"rtk server malloc error");
+            return 0;
+        }
     }
+    if (!initq(&svr->qsol,NQSOL,3*MAXSOLMSG+1)) { /* solution queue */
+        tracet(1,"rtksvrstart: malloc error\n");
+        sprintf(errmsg,"rtk server malloc error");
+        return 0;
+    }
+    memset(svr->lat,0,sizeof(svr->lat));
+    
     for (i=0;i<2;i++) { /* output peek buffer */
         if (!(svr->sbuf[i]=(uint8_t *)malloc(buffsize))) {
             tracet(1,"rtksvrstart: malloc error\n");
@@ -913,6 +1583,8 @@ extern int rtksvrstart(rtksvr_t *svr, int cycle, int buffsize, int *strs,
     for (i=0;i<MAXSAT*4 ;i++) svr->nav.eph [i].ttr=time0;
     for (i=0;i<NSATGLO*2;i++) svr->nav.geph[i].tof=time0;
     for (i=0;i<NSATSBS*2;i++) svr->nav.seph[i].tof=time0;
+    for (i=0;i<3;i++) svr->rb[i]=0.0;
+    svr->navver++;
     
     /* set monitor stream */
     svr->moni=moni;
@@ -984,6 +1656,7 @@ extern void rtksvrstop(rtksvr_t *svr, const char **cmds)
     
     /* stop rtk server */
     svr->state=0;
+    setevt(&svr->evpos);
     
     /* free rtk server thread */
 #ifdef WIN32
@@ -1067,31 +1740,32 @@ extern void rtksvrclosestr(rtksvr_t *svr, int index)
 extern int rtksvrostat(rtksvr_t *svr, int rcv, gtime_t *time, int *sat,
                        double *az, double *el, int **snr, int *vsat)
 {
-    int i,j,ns;
+    const rtksvrstat_t *stat;
+    int i,j,k,ns;
     
     tracet(4,"rtksvrostat: rcv=%d\n",rcv);
     
-    if (!svr->state) return 0;
-    rtksvrlock(svr);
-    ns=svr->obs[rcv][0].n;
+    if (!svr->state||!(stat=acqstat(svr,&k))) return 0;
+    
+    ns=stat->nobs[rcv];
     if (ns>0) {
-        *time=svr->obs[rcv][0].data[0].time;
+        *time=stat->obs[rcv][0].time;
     }
     for (i=0;i<ns;i++) {
-        sat [i]=svr->obs[rcv][0].data[i].sat;
-        az  [i]=svr->rtk.ssat[sat[i]-1].azel[0];
-        el  [i]=svr->rtk.ssat[sat[i]-1].azel[1];
+        sat [i]=stat->obs[rcv][i].sat;
+        az  [i]=stat->ssat[sat[i]-1].azel[0];
+        el  [i]=stat->ssat[sat[i]-1].azel[1];
         for (j=0;j<NFREQ;j++) {
-            snr[i][j]=(int)(svr->obs[rcv][0].data[i].SNR[j]*SNR_UNIT+0.5);
+            snr[i][j]=(int)(stat->obs[rcv][i].SNR[j]*SNR_UNIT+0.5);
         }
-        if (svr->rtk.sol.stat==SOLQ_NONE||svr->rtk.sol.stat==SOLQ_SINGLE) {
-            vsat[i]=svr->rtk.ssat[sat[i]-1].vs;
+        if (stat->sol.stat==SOLQ_NONE||stat->sol.stat==SOLQ_SINGLE) {
+            vsat[i]=stat->ssat[sat[i]-1].vs;
         }
         else {
-            vsat[i]=svr->rtk.ssat[sat[i]-1].vsat[0];
+            vsat[i]=stat->ssat[sat[i]-1].vsat[0];
         }
     }
-    rtksvrunlock(svr);
+    relstat(svr,k);
     return ns;
 }
 /* get stream status -----------------------------------------------------------
@@ -1103,17 +1777,42 @@ extern int rtksvrostat(rtksvr_t *svr, int rcv, gtime_t *time, int *sat,
 *-----------------------------------------------------------------------------*/
 extern void rtksvrsstat(rtksvr_t *svr, int *sstat, char *msg)
 {
-    int i;
-    char s[MAXSTRMSG],*p=msg;
+    const rtksvrstat_t *stat;
+    int i,k;
+    char *p=msg;
     
     tracet(4,"rtksvrsstat:\n");
     
-    rtksvrlock(svr);
+    *p='\0';
+    if (!(stat=acqstat(svr,&k))) {
+        for (i=0;i<MAXSTRRTK;i++) sstat[i]=0;
+        return;
+    }
     for (i=0;i<MAXSTRRTK;i++) {
-        sstat[i]=strstat(svr->stream+i,s);
-        if (*s) p+=sprintf(p,"(%d) %s ",i+1,s);
+        sstat[i]=stat->sstat[i];
+        if (*stat->smsg[i]) p+=sprintf(p,"(%d) %s ",i+1,stat->smsg[i]);
     }
-    rtksvrunlock(svr);
+    relstat(svr,k);
+}
+/* get server status snapshot --------------------------------------------------
+* get the latest status snapshot of rtk server without the server lock
+* args   : rtksvr_t *svr    I  rtk server
+*          rtksvrstat_t *stat O status snapshot
+* return : sequence number of snapshot (0: no snapshot)
+* notes  : the snapshot is published by the positioning thread for each epoch
+*          and for each processing cycle without observation data
+*-----------------------------------------------------------------------------*/
+extern int rtksvrgetstat(rtksvr_t *svr, rtksvrstat_t *stat)
+{
+    const rtksvrstat_t *p;
+    int k;
+    
+    tracet(4,"rtksvrgetstat:\n");
+    
+    if (!(p=acqstat(svr,&k))) return 0;
+    *stat=*p;
+    relstat(svr,k);
+    return (int)stat->seq;
 }
 /* mark current position -------------------------------------------------------
 * open output/log stream
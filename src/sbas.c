@@ -36,6 +36,12 @@
 *                           add prn mask of qzss for qzss L1SAIF
 *           2016/07/29 1.9  crc24q() -> rtk_crc24q()
 *           2020/11/30 1.10 use integer types in stdint.h
+*           2026/10/19 1.11 search igps by index of grid points updated by
+*                            ionospheric grid point masks
+*                           add api sbsmakesnap(),sbsfreesnap(),sbsseekcorr()
+*                           add api sbsupdateigp()
+*                           make fine snapshots and seek incrementally in
+*                            sbsseekcorr()
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -266,10 +272,53 @@ static int decode_sbstype9(const sbsmsg_t *msg, nav_t *nav)
     trace(5,"decode_sbstype9: prn=%d\n",msg->prn);
     return 1;
 }
+/* index grid point of igp --------------------------------------------------*/
+static int igpkey(int lat, int lon, int *i, int *j)
+{
+    if (lat%5||lon%5||lat<-90||lat>90||lon<-180||lon>=180) return 0;
+    *i=(lat+90)/5;
+    *j=(lon+180)/5;
+    return 1;
+}
+/* update igp index by igps of band (add=0:remove,1:add) ---------------------*/
+static void updateigpidx(sbsigpidx_t *idx, const sbsion_t *sbsion, int band,
+                         int add)
+{
+    int i,j,k,m,code;
+    
+    for (k=0;k<sbsion[band].nigp;k++) {
+        code=band*MAXNIGP+k;
+        if (!igpkey(sbsion[band].igp[k].lat,sbsion[band].igp[k].lon,&i,&j)) {
+            if (add) idx->ovf=1;
+            continue;
+        }
+        if (add) {
+            if (idx->n[i][j]>=MAXIGPIDX) {
+                idx->ovf=1;
+                continue;
+            }
+            /* keep igps in order of band and index */
+            for (m=idx->n[i][j];m>0&&idx->igp[i][j][m-1]>code;m--) {
+                idx->igp[i][j][m]=idx->igp[i][j][m-1];
+            }
+            idx->igp[i][j][m]=(int16_t)code;
+            idx->n[i][j]++;
+        }
+        else {
+            for (m=0;m<idx->n[i][j];m++) {
+                if (idx->igp[i][j][m]==code) break;
+            }
+            if (m>=idx->n[i][j]) continue;
+            for (;m<idx->n[i][j]-1;m++) idx->igp[i][j][m]=idx->igp[i][j][m+1];
+            idx->n[i][j]--;
+        }
+    }
+}
 /* decode type 18: ionospheric grid point masks ------------------------------*/
-static int decode_sbstype18(const sbsmsg_t *msg, sbsion_t *sbsion)
+static int decode_sbstype18(const sbsmsg_t *msg, nav_t *nav)
 {
     const sbsigpband_t *p;
+    sbsion_t *sbsion=nav->sbsion;
     int i,j,n,m,band=getbitu(msg->msg,18,4);
     
     trace(4,"decode_sbstype18:\n");
@@ -278,6 +327,9 @@ static int decode_sbstype18(const sbsmsg_t *msg, sbsion_t *sbsion)
     else if (9<=band&&band<=10) {p=igpband2[band-9]; m=5;}
     else return 0;
     
+    /* remove igps of previous mask from index */
+    updateigpidx(&nav->sbsidx,sbsion,band,0);
+    
     sbsion[band].iodi=(int16_t)getbitu(msg->msg,22,2);
     
     for (i=1,n=0;i<=201;i++) {
@@ -291,6 +343,9 @@ static int decode_sbstype18(const sbsmsg_t *msg, sbsion_t *sbsion)
     }
     sbsion[band].nigp=n;
     
+    /* add igps of new mask to index */
+    updateigpidx(&nav->sbsidx,sbsion,band,1);
+    
     trace(5,"decode_sbstype18: band=%d nigp=%d\n",band,n);
     return 1;
 }
@@ -414,6 +469,23 @@ static int decode_sbstype26(const sbsmsg_t *msg, sbsion_t *sbsion)
     trace(5,"decode_sbstype26: band=%d block=%d\n",band,block);
     return 1;
 }
+/* update sbas igp index ---------------------------------------------------------
+* remove or add igps of a band in navigation data to the igp index
+* args   : nav_t    *nav    IO  navigation data
+*          int      band    I   igp band (0-MAXBAND)
+*          int      add     I   0:remove igps of nav->sbsion[band],1:add them
+* return : none
+* notes  : call with add=0 before the igp mask of nav->sbsion[band] is
+*          changed and with add=1 after the change, if the mask is decoded
+*          without sbsupdatecorr() (e.g. by receiver dependent messages)
+*-----------------------------------------------------------------------------*/
+extern void sbsupdateigp(nav_t *nav, int band, int add)
+{
+    trace(4,"sbsupdateigp: band=%d add=%d\n",band,add);
+    
+    if (band<0||band>MAXBAND) return;
+    updateigpidx(&nav->sbsidx,nav->sbsion,band,add);
+}
 /* update sbas corrections -----------------------------------------------------
 * update sbas correction parameters in navigation data with a sbas message
 * args   : sbsmg_t  *msg    I   sbas message
@@ -441,7 +513,7 @@ extern int sbsupdatecorr(const sbsmsg_t *msg, nav_t *nav)
         case  6: stat=decode_sbstype6 (msg,&nav->sbssat); break;
         case  7: stat=decode_sbstype7 (msg,&nav->sbssat); break;
         case  9: stat=decode_sbstype9 (msg,nav);          break;
-        case 18: stat=decode_sbstype18(msg,nav ->sbsion); break;
+        case 18: stat=decode_sbstype18(msg,nav);          break;
         case 24: stat=decode_sbstype24(msg,&nav->sbssat); break;
         case 25: stat=decode_sbstype25(msg,&nav->sbssat); break;
         case 26: stat=decode_sbstype26(msg,nav ->sbsion); break;
@@ -451,6 +523,192 @@ extern int sbsupdatecorr(const sbsmsg_t *msg, nav_t *nav)
     }
     return stat?type:-1;
 }
+/* restore correction state from snapshot -----------------------------------*/
+static void restoresnap(const sbssnap_t *snap, nav_t *nav)
+{
+    int i;
+    
+    if (snap) {
+        nav->sbssat=snap->sbssat;
+        memcpy(nav->sbsion,snap->sbsion,sizeof(nav->sbsion));
+    }
+    else {
+        memset(&nav->sbssat,0,sizeof(sbssat_t));
+        memset(nav->sbsion,0,sizeof(nav->sbsion));
+    }
+    /* rebuild igp index */
+    memset(&nav->sbsidx,0,sizeof(sbsigpidx_t));
+    for (i=0;i<=MAXBAND;i++) updateigpidx(&nav->sbsidx,nav->sbsion,i,1);
+}
+/* replay messages and save snapshots ----------------------------------------*/
+static int replaysnap(const sbs_t *sbs, const sbssnap_t *snap0, gtime_t ts,
+                      gtime_t te, double tint, sbssnap_t *snap, int nmax)
+{
+    nav_t *nav;
+    gtime_t time,tnext=timeadd(ts,tint);
+    int i,n=0;
+    
+    if (!(nav=(nav_t *)calloc(1,sizeof(nav_t)))) return -1;
+    
+    restoresnap(snap0,nav);
+    
+    for (i=snap0?snap0->index:0;i<sbs->n&&n<nmax;i++) {
+        time=gpst2time(sbs->msgs[i].week,sbs->msgs[i].tow);
+        
+        if (te.time&&timediff(time,te)>0.0) break;
+        
+        for (;timediff(time,tnext)>0.0&&n<nmax;tnext=timeadd(tnext,tint)) {
+            snap[n].time=tnext;
+            snap[n].index=i;
+            snap[n].sbssat=nav->sbssat;
+            memcpy(snap[n++].sbsion,nav->sbsion,sizeof(nav->sbsion));
+        }
+        if (getbitu(sbs->msgs[i].msg,8,6)!=9) { /* except for geo nav */
+            sbsupdatecorr(sbs->msgs+i,nav);
+        }
+    }
+    free(nav);
+    return n;
+}
+/* make sbas correction state snapshots ----------------------------------------
+* replay sbas messages from the beginning and save the correction state
+* (fast, long-term and ionospheric corrections) every time interval
+* args   : sbs_t    *sbs    IO  sbas messages (sorted by time)
+*          double   tint    I   time interval of snapshots (s)
+*          double   tsub    I   time interval of fine snapshots (s) (0:none)
+* return : number of snapshots (-1: error)
+* notes  : snapshot k holds the state after all messages with reception time
+*          <= snap[k].time are applied. previous snapshots are freed.
+*          geo navigation messages (type 9) are not applied.
+*          fine snapshots are made by sbsseekcorr() within the interval of a
+*          snapshot when seeking backward.
+*-----------------------------------------------------------------------------*/
+extern int sbsmakesnap(sbs_t *sbs, double tint, double tsub)
+{
+    gtime_t ts,te,t0={0};
+    int n,nmax;
+    
+    trace(3,"sbsmakesnap: n=%d tint=%.0f tsub=%.0f\n",sbs->n,tint,tsub);
+    
+    sbsfreesnap(sbs);
+    
+    if (sbs->n<=0||tint<=0.0) return 0;
+    
+    ts=gpst2time(sbs->msgs[0].week,sbs->msgs[0].tow);
+    te=gpst2time(sbs->msgs[sbs->n-1].week,sbs->msgs[sbs->n-1].tow);
+    nmax=(int)(timediff(te,ts)/tint)+2;
+    
+    if (!(sbs->snap=(sbssnap_t *)malloc(sizeof(sbssnap_t)*nmax))||
+        (n=replaysnap(sbs,NULL,ts,t0,tint,sbs->snap,nmax))<0) {
+        trace(1,"sbsmakesnap: malloc error nmax=%d\n",nmax);
+        sbsfreesnap(sbs);
+        return -1;
+    }
+    sbs->nsnap=n;
+    sbs->tint=tint;
+    sbs->tsub=tsub>0.0&&tsub<tint?tsub:0.0;
+    return n;
+}
+/* free sbas correction state snapshots ----------------------------------------
+* args   : sbs_t    *sbs    IO  sbas messages
+* return : none
+*-----------------------------------------------------------------------------*/
+extern void sbsfreesnap(sbs_t *sbs)
+{
+    trace(3,"sbsfreesnap: nsnap=%d nsub=%d\n",sbs->nsnap,sbs->nsub);
+    
+    free(sbs->snap); sbs->snap=NULL; sbs->nsnap=0;
+    free(sbs->sub ); sbs->sub =NULL; sbs->nsub =0;
+    sbs->tint=sbs->tsub=0.0;
+}
+/* make fine snapshots between snap[j] and snap[j+1] -------------------------*/
+static int makesubsnap(sbs_t *sbs, int j)
+{
+    const sbssnap_t *snap0=j>=0?sbs->snap+j:NULL;
+    gtime_t ts,te={0};
+    int n,nmax=(int)(sbs->tint/sbs->tsub)+1;
+    
+    trace(4,"makesubsnap: j=%d\n",j);
+    
+    if (!sbs->sub&&
+        !(sbs->sub=(sbssnap_t *)malloc(sizeof(sbssnap_t)*nmax))) {
+        return 0;
+    }
+    ts=snap0?snap0->time:gpst2time(sbs->msgs[0].week,sbs->msgs[0].tow);
+    if (j+1<sbs->nsnap) te=sbs->snap[j+1].time;
+    
+    if ((n=replaysnap(sbs,snap0,ts,te,sbs->tsub,sbs->sub,nmax))<0) return 0;
+    sbs->isub=j;
+    sbs->nsub=n;
+    return 1;
+}
+/* search latest snapshot before time ----------------------------------------*/
+static int searchsnap(const sbssnap_t *snap, int n, gtime_t time)
+{
+    int i,j,k;
+    
+    for (i=0,j=n-1;i<=j;) {
+        k=(i+j)/2;
+        if (timediff(snap[k].time,time)>0.0) j=k-1; else i=k+1;
+    }
+    return j;
+}
+/* seek sbas corrections -------------------------------------------------------
+* set sbas correction state at a time by applying the messages after the
+* current state or by restoring the latest snapshot before the time and
+* applying the messages after the snapshot
+* args   : sbs_t    *sbs    IO  sbas messages with snapshots
+*          gtime_t  time    I   time (gpst)
+*          int      index   I   index of next message to apply of the current
+*                               correction state in nav (-1: unknown)
+*          nav_t    *nav    IO  navigation data (sbssat,sbsion,sbsidx)
+* return : index of next message to apply
+* notes  : messages with reception time <= time are applied (except for geo
+*          navigation messages). without snapshots, all messages are replayed
+*          from the beginning.
+*          the current state is kept if no message is between the current
+*          state and the time. if seeking backward with fine snapshots, the
+*          fine snapshots within the snapshot interval are made on demand and
+*          the messages after the latest fine snapshot are applied.
+*-----------------------------------------------------------------------------*/
+extern int sbsseekcorr(sbs_t *sbs, gtime_t time, int index, nav_t *nav)
+{
+    const sbssnap_t *snap=NULL;
+    char tstr[40];
+    int i,j,k;
+    
+    trace(4,"sbsseekcorr: time=%s index=%d\n",time2str(time,tstr,0),index);
+    
+    /* index of next message after time */
+    for (i=0,j=sbs->n-1;i<=j;) {
+        k=(i+j)/2;
+        if (timediff(gpst2time(sbs->msgs[k].week,sbs->msgs[k].tow),time)>0.0) {
+            j=k-1;
+        }
+        else i=k+1;
+    }
+    /* restore snapshot if the current state is after time */
+    if (index<0||index>i) {
+        j=searchsnap(sbs->snap,sbs->nsnap,time);
+        if (j>=0) snap=sbs->snap+j;
+        
+        if (sbs->tsub>0.0&&(sbs->nsub<=0||sbs->isub!=j)) {
+            makesubsnap(sbs,j);
+        }
+        if (sbs->nsub>0&&sbs->isub==j&&
+            (k=searchsnap(sbs->sub,sbs->nsub,time))>=0) {
+            snap=sbs->sub+k;
+        }
+        restoresnap(snap,nav);
+        index=snap?snap->index:0;
+    }
+    for (;index<i;index++) {
+        if (getbitu(sbs->msgs[index].msg,8,6)!=9) { /* except for geo nav */
+            sbsupdatecorr(sbs->msgs+index,nav);
+        }
+    }
+    return i;
+}
 /* read sbas log file --------------------------------------------------------*/
 static void readmsgs(const char *file, int sel, gtime_t ts, gtime_t te,
                      sbs_t *sbs)
@@ -601,9 +859,10 @@ extern void sbsoutmsg(FILE *fp, sbsmsg_t *sbsmsg)
 }
 /* search igps ---------------------------------------------------------------*/
 static void searchigp(gtime_t time, const double *pos, const sbsion_t *ion,
-                      const sbsigp_t **igp, double *x, double *y)
+                      const sbsigpidx_t *idx, const sbsigp_t **igp, double *x,
+                      double *y)
 {
-    int i,latp[2],lonp[4];
+    int i,j,k,m,n,nc=0,code,cand[4*MAXIGPIDX],latp[2],lonp[4];
     double lat=pos[0]*R2D,lon=pos[1]*R2D;
     const sbsigp_t *p;
     
@@ -641,6 +900,32 @@ static void searchigp(gtime_t time, const double *pos, const sbsion_t *ion,
         }
     }
     for (i=0;i<4;i++) if (lonp[i]==180) lonp[i]=-180;
+    
+    if (!idx->ovf) {
+        
+        /* igps at grid points around ipp in order of band and index */
+        for (k=0;k<4;k++) {
+            if (!igpkey(latp[k%2],lonp[k],&i,&j)) continue;
+            for (m=0;m<idx->n[i][j];m++) {
+                code=idx->igp[i][j][m];
+                for (n=0;n<nc;n++) if (cand[n]>=code) break;
+                if (n<nc&&cand[n]==code) continue;
+                memmove(cand+n+1,cand+n,sizeof(int)*(nc-n));
+                cand[n]=code;
+                nc++;
+            }
+        }
+        for (n=0;n<nc;n++) {
+            p=ion[cand[n]/MAXNIGP].igp+cand[n]%MAXNIGP;
+            if (p->t0.time==0) continue;
+            if      (p->lat==latp[0]&&p->lon==lonp[0]&&p->give>0) igp[0]=p;
+            else if (p->lat==latp[1]&&p->lon==lonp[1]&&p->give>0) igp[1]=p;
+            else if (p->lat==latp[0]&&p->lon==lonp[2]&&p->give>0) igp[2]=p;
+            else if (p->lat==latp[1]&&p->lon==lonp[3]&&p->give>0) igp[3]=p;
+            if (igp[0]&&igp[1]&&igp[2]&&igp[3]) return;
+        }
+        return;
+    }
     for (i=0;i<=MAXBAND;i++) {
         for (p=ion[i].igp;p<ion[i].igp+ion[i].nigp;p++) {
             if (p->t0.time==0) continue;
@@ -683,7 +968,7 @@ extern int sbsioncorr(gtime_t time, const nav_t *nav, const double *pos,
     fp=ionppp(pos,azel,re,hion,posp);
     
     /* search igps around ipp */
-    searchigp(time,posp,nav->sbsion,igp,&x,&y);
+    searchigp(time,posp,nav->sbsion,&nav->sbsidx,igp,&x,&y);
     
     /* weight of igps */
     if (igp[0]&&igp[1]&&igp[2]&&igp[3]) {
@@ -37,6 +37,7 @@ DESTDIR = $${ROOT_DIRECTORY}/lib
 
 SOURCES += rtkcmn.c \
     trace.c \
+    bincache.c \
     convkml.c \
     convrnx.c \
     convgpx.c \
@@ -47,6 +48,7 @@ SOURCES += rtkcmn.c \
     gis.c \
     ionex.c \
     lambda.c \
+    metrics.c \
     options.c \
     pntpos.c \
     postpos.c \
@@ -59,6 +61,7 @@ SOURCES += rtkcmn.c \
     rtcm2.c \
     rtcm3.c \
     rtcm3e.c \
+    rtkmsvr.c \
     rtkpos.c \
     rtksvr.c \
     sbas.c \
@@ -74,6 +74,7 @@
 *                           accept HTTP/1.1 as protocol for NTRIP caster
 *                           suppress warning for buffer overflow by sprintf()
 *                           use integer types in stdint.h
+*           2026/10/19 1.30 add API strreply()
 *-----------------------------------------------------------------------------*/
 #define _POSIX_C_SOURCE 199506
 #include <ctype.h>
@@ -180,6 +181,7 @@ typedef struct {            /* tcp control type */
 typedef struct tcpsvr_tag { /* tcp server type */
     tcp_t svr;              /* tcp server control */
     tcp_t cli[MAXCLI];      /* tcp client controls */
+    int rcli;               /* client index of last read data (-1:none) */
 } tcpsvr_t;
 
 typedef struct {            /* tcp cilent type */
@@ -1187,6 +1189,7 @@ static tcpsvr_t *opentcpsvr(const char *path, char *msg)
     
     if (!(tcpsvr=(tcpsvr_t *)malloc(sizeof(tcpsvr_t)))) return NULL;
     *tcpsvr=tcpsvr0;
+    tcpsvr->rcli=-1;
     decodetcppath(path,tcpsvr->svr.saddr,port,NULL,NULL,NULL,NULL);
     if (sscanf(port,"%d",&tcpsvr->svr.port)<1) {
         sprintf(msg,"port error: %s",port);
@@ -1309,11 +1312,33 @@ static int readtcpsvr(tcpsvr_t *tcpsvr, uint8_t *buff, int n, char *msg)
         }
         if (nr>0) {
             tcpsvr->cli[i].tact=tickget();
+            tcpsvr->rcli=i;
             return nr;
         }
     }
     return 0;
 }
+/* reply to client of last read data of tcp server ---------------------------*/
+static int replytcpsvr(tcpsvr_t *tcpsvr, uint8_t *buff, int n, char *msg)
+{
+    tcp_t *cli;
+    int ns;
+    
+    if (tcpsvr->rcli<0) return 0;
+    cli=tcpsvr->cli+tcpsvr->rcli;
+    tcpsvr->rcli=-1;
+    
+    tracet(3,"replytcpsvr: sock=%d n=%d\n",cli->sock,n);
+    
+    if (cli->state!=2) return 0;
+    
+    if ((ns=send_nb(cli->sock,buff,n))<0) ns=0;
+    
+    /* disconnect client after reply */
+    discontcp(cli,ticonnect);
+    updatetcpsvr(tcpsvr,msg);
+    return ns;
+}
 /* write tcp server ----------------------------------------------------------*/
 static int writetcpsvr(tcpsvr_t *tcpsvr, uint8_t *buff, int n, char *msg)
 {
@@ -2941,6 +2966,35 @@ extern int strwrite(stream_t *stream, uint8_t *buff, int n)
     strunlock(stream);
     return ns;
 }
+/* reply to stream -------------------------------------------------------------
+* reply data to the client which sent the last data read by strread()
+* args   : stream_t *stream I   stream
+*          uint8_t *buff    I   data buffer
+*          int    n         I   data length
+* return : status (0:error,>0:ok)
+* notes  : for tcp server, the data is sent only to the client of the last read
+*          data and the client is disconnected after the reply, so that the
+*          other clients of the stream do not receive the reply. for the other
+*          stream types, the data is written by strwrite().
+*-----------------------------------------------------------------------------*/
+extern int strreply(stream_t *stream, uint8_t *buff, int n)
+{
+    int ns;
+    
+    tracet(4,"strreply: n=%d\n",n);
+    
+    if (stream->type!=STR_TCPSVR) return strwrite(stream,buff,n);
+    
+    if (!(stream->mode&STR_MODE_W)||!stream->port) return 0;
+    
+    strlock(stream);
+    if ((ns=replytcpsvr((tcpsvr_t *)stream->port,buff,n,stream->msg))>0) {
+        stream->outb+=ns;
+        stream->tact=tickget();
+    }
+    strunlock(stream);
+    return ns;
+}
 /* get stream status -----------------------------------------------------------
 * get stream status
 * args   : stream_t *stream I   stream
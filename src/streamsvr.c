@@ -31,6 +31,8 @@
 *                           support multiple ephemeris sets (e.g. I/NAV-F/NAV)
 *                           delete API strsvrsetsrctbl()
 *                           use integer types in stdint.h
+*           2026/10/19 1.16 decode input stream once for all converters
+*                           share encoded frames of identical converters
 *-----------------------------------------------------------------------------*/
 #define _POSIX_C_SOURCE 199506
 #include "rtklib.h"
@@ -100,19 +102,14 @@ extern strconv_t *strconvnew(int itype, int otype, const char *msgs, int staid,
     conv->itype=itype;
     conv->otype=otype;
     conv->stasel=stasel;
-    if (!init_rtcm(&conv->rtcm)||!init_rtcm(&conv->out)) {
-        free(conv);
-        return NULL;
-    }
-    if (!init_raw(&conv->raw,itype)) {
-        free_rtcm(&conv->rtcm);
-        free_rtcm(&conv->out);
+    conv->obuf=NULL;
+    conv->nobuf=conv->nobufmax=0;
+    if (!init_rtcm(&conv->out)) {
         free(conv);
         return NULL;
     }
     if (stasel) conv->out.staid=staid;
-    sprintf(conv->rtcm.opt,"-EPHALL %s",opt);
-    sprintf(conv->raw.opt ,"-EPHALL %s",opt);
+    sprintf(conv->opt,"-EPHALL %.240s",opt);
     return conv;
 }
 /* free stream converter -------------------------------------------------------
@@ -123,11 +120,94 @@ extern strconv_t *strconvnew(int itype, int otype, const char *msgs, int staid,
 extern void strconvfree(strconv_t *conv)
 {
     if (!conv) return;
-    free_rtcm(&conv->rtcm);
     free_rtcm(&conv->out);
-    free_raw(&conv->raw);
+    free(conv->obuf);
     free(conv);
 }
+/* new shared decoder of stream converters -----------------------------------*/
+static strdec_t *newdec(int itype, const char *opt)
+{
+    strdec_t *dec;
+    
+    if (!(dec=(strdec_t *)malloc(sizeof(strdec_t)))) return NULL;
+    
+    dec->itype=itype;
+    strcpy(dec->opt,opt);
+    if (!init_rtcm(&dec->rtcm)) {
+        free(dec);
+        return NULL;
+    }
+    if (!init_raw(&dec->raw,itype)) {
+        free_rtcm(&dec->rtcm);
+        free(dec);
+        return NULL;
+    }
+    strcpy(dec->rtcm.opt,opt);
+    strcpy(dec->raw.opt ,opt);
+    return dec;
+}
+/* free shared decoder of stream converters ----------------------------------*/
+static void freedec(strdec_t *dec)
+{
+    if (!dec) return;
+    free_rtcm(&dec->rtcm);
+    free_raw(&dec->raw);
+    free(dec);
+}
+/* compare output station info of converters ---------------------------------*/
+static int samesta(const sta_t *sta1, const sta_t *sta2)
+{
+    return !strcmp(sta1->name   ,sta2->name   )&&
+           !strcmp(sta1->antdes ,sta2->antdes )&&
+           !strcmp(sta1->antsno ,sta2->antsno )&&
+           !strcmp(sta1->rectype,sta2->rectype)&&
+           !strcmp(sta1->recver ,sta2->recver )&&
+           !strcmp(sta1->recsno ,sta2->recsno )&&
+           sta1->antsetup==sta2->antsetup&&sta1->itrf==sta2->itrf&&
+           sta1->deltype==sta2->deltype&&sta1->hgt==sta2->hgt&&
+           !memcmp(sta1->pos,sta2->pos,sizeof(sta1->pos))&&
+           !memcmp(sta1->del,sta2->del,sizeof(sta1->del));
+}
+/* test converters generating identical frames -------------------------------*/
+static int sameconv(const strconv_t *conv1, const strconv_t *conv2)
+{
+    int i;
+    
+    if (conv1->itype!=conv2->itype||conv1->otype!=conv2->otype||
+        conv1->nmsg!=conv2->nmsg||conv1->stasel!=conv2->stasel||
+        strcmp(conv1->opt,conv2->opt)) return 0;
+    
+    for (i=0;i<conv1->nmsg;i++) {
+        if (conv1->msgs[i]!=conv2->msgs[i]||conv1->tint[i]!=conv2->tint[i]) {
+            return 0;
+        }
+    }
+    if (conv1->stasel&&(conv1->out.staid!=conv2->out.staid||
+                        !samesta(&conv1->out.sta,&conv2->out.sta))) return 0;
+    return 1;
+}
+/* output encoded frame to converter buffer ----------------------------------*/
+static void outframe(strconv_t *conv, const uint8_t *buff, int n)
+{
+    uint8_t *p;
+    int nmax;
+    
+    if (n<=0) return;
+    
+    if (conv->nobuf+n>conv->nobufmax) {
+        for (nmax=conv->nobufmax>0?conv->nobufmax:4096;nmax<conv->nobuf+n;) {
+            nmax*=2;
+        }
+        if (!(p=(uint8_t *)realloc(conv->obuf,nmax))) {
+            trace(1,"outframe: realloc error n=%d\n",nmax);
+            return;
+        }
+        conv->obuf=p;
+        conv->nobufmax=nmax;
+    }
+    memcpy(conv->obuf+conv->nobuf,buff,n);
+    conv->nobuf+=n;
+}
 /* copy received data from receiver raw to rtcm ------------------------------*/
 static void raw2rtcm(rtcm_t *out, const raw_t *raw, int ret)
 {
@@ -222,8 +302,9 @@ static void rtcm2rtcm(rtcm_t *out, const rtcm_t *rtcm, int ret, int stasel)
     }
 }
 /* write rtcm3 msm to stream -------------------------------------------------*/
-static void write_rtcm3_msm(stream_t *str, rtcm_t *out, int msg, int sync)
+static void write_rtcm3_msm(strconv_t *conv, int msg, int sync)
 {
+    rtcm_t *out=&conv->out;
     obsd_t *data,buff[MAXOBS];
     int i,j,n,ns,sys,nobs,code,nsat=0,nsig=0,nmsg,mask[MAXCODE]={0};
     
@@ -270,14 +351,14 @@ static void write_rtcm3_msm(stream_t *str, rtcm_t *out, int msg, int sync)
         out->obs.n=n;
         
         if (gen_rtcm3(out,msg,0,i<nmsg-1?1:sync)) {
-            strwrite(str,out->buff,out->nbyte);
+            outframe(conv,out->buff,out->nbyte);
         }
     }
     out->obs.data=data;
     out->obs.n=nobs;
 }
 /* write obs data messages ---------------------------------------------------*/
-static void write_obs(gtime_t time, stream_t *str, strconv_t *conv)
+static void write_obs(gtime_t time, strconv_t *conv)
 {
     int i,j=0;
     
@@ -293,22 +374,22 @@ static void write_obs(gtime_t time, stream_t *str, strconv_t *conv)
         if (conv->otype==STRFMT_RTCM2) {
             if (!gen_rtcm2(&conv->out,conv->msgs[i],i!=j)) continue;
             
-            /* write messages to stream */
-            strwrite(str,conv->out.buff,conv->out.nbyte);
+            /* output messages */
+            outframe(conv,conv->out.buff,conv->out.nbyte);
         }
         else if (conv->otype==STRFMT_RTCM3) {
             if (conv->msgs[i]<=1012) {
                 if (!gen_rtcm3(&conv->out,conv->msgs[i],0,i!=j)) continue;
-                strwrite(str,conv->out.buff,conv->out.nbyte);
+                outframe(conv,conv->out.buff,conv->out.nbyte);
             }
-            else { /* write rtcm3 msm to stream */
-                write_rtcm3_msm(str,&conv->out,conv->msgs[i],i!=j);
+            else { /* output rtcm3 msm */
+                write_rtcm3_msm(conv,conv->msgs[i],i!=j);
             }
         }
     }
 }
 /* write nav data messages ---------------------------------------------------*/
-static void write_nav(gtime_t time, stream_t *str, strconv_t *conv)
+static void write_nav(gtime_t time, strconv_t *conv)
 {
     int i;
     
@@ -324,8 +405,8 @@ static void write_nav(gtime_t time, stream_t *str, strconv_t *conv)
         }
         else continue;
         
-        /* write messages to stream */
-        strwrite(str,conv->out.buff,conv->out.nbyte);
+        /* output messages */
+        outframe(conv,conv->out.buff,conv->out.nbyte);
     }
 }
 /* next ephemeris satellite --------------------------------------------------*/
@@ -361,7 +442,7 @@ static int nextsat(nav_t *nav, int sat, int msg)
     return 0;
 }
 /* write cyclic nav data messages --------------------------------------------*/
-static void write_nav_cycle(stream_t *str, strconv_t *conv)
+static void write_nav_cycle(strconv_t *conv)
 {
     uint32_t tick=tickget();
     int i,sat,tint;
@@ -389,12 +470,12 @@ static void write_nav_cycle(stream_t *str, strconv_t *conv)
         }
         else continue;
         
-        /* write messages to stream */
-        strwrite(str,conv->out.buff,conv->out.nbyte);
+        /* output messages */
+        outframe(conv,conv->out.buff,conv->out.nbyte);
     }
 }
 /* write cyclic station info messages ----------------------------------------*/
-static void write_sta_cycle(stream_t *str, strconv_t *conv)
+static void write_sta_cycle(strconv_t *conv)
 {
     uint32_t tick=tickget();
     int i,tint;
@@ -416,41 +497,94 @@ static void write_sta_cycle(stream_t *str, strconv_t *conv)
         }
         else continue;
         
-        /* write messages to stream */
-        strwrite(str,conv->out.buff,conv->out.nbyte);
+        /* output messages */
+        outframe(conv,conv->out.buff,conv->out.nbyte);
     }
 }
-/* convert stearm ------------------------------------------------------------*/
-static void strconv(stream_t *str, strconv_t *conv, uint8_t *buff, int n)
+/* convert stearm ----------------------------------------------------------------
+* decode input stream once by shared decoder and generate output messages by
+* converters using the decoder. encoded frames are buffered in converters
+*-----------------------------------------------------------------------------*/
+static void strconv(strsvr_t *svr, strdec_t *dec, uint8_t *buff, int n)
 {
-    int i,ret;
+    strconv_t *conv;
+    int i,j,ret;
     
     for (i=0;i<n;i++) {
         
-        /* input rtcm 2 messages */
-        if (conv->itype==STRFMT_RTCM2) {
-            ret=input_rtcm2(&conv->rtcm,buff[i]);
-            rtcm2rtcm(&conv->out,&conv->rtcm,ret,conv->stasel);
+        /* input rtcm 2/3 or receiver raw messages */
+        if (dec->itype==STRFMT_RTCM2) {
+            ret=input_rtcm2(&dec->rtcm,buff[i]);
         }
-        /* input rtcm 3 messages */
-        else if (conv->itype==STRFMT_RTCM3) {
-            ret=input_rtcm3(&conv->rtcm,buff[i]);
-            rtcm2rtcm(&conv->out,&conv->rtcm,ret,conv->stasel);
+        else if (dec->itype==STRFMT_RTCM3) {
+            ret=input_rtcm3(&dec->rtcm,buff[i]);
         }
-        /* input receiver raw messages */
         else {
-            ret=input_raw(&conv->raw,conv->itype,buff[i]);
-            raw2rtcm(&conv->out,&conv->raw,ret);
+            ret=input_raw(&dec->raw,dec->itype,buff[i]);
+        }
+        for (j=0;j<svr->nstr-1;j++) {
+            if (svr->dec[j]!=dec||svr->convsrc[j]!=j) continue;
+            conv=svr->conv[j];
+            
+            if (dec->itype==STRFMT_RTCM2||dec->itype==STRFMT_RTCM3) {
+                rtcm2rtcm(&conv->out,&dec->rtcm,ret,conv->stasel);
+            }
+            else {
+                raw2rtcm(&conv->out,&dec->raw,ret);
+            }
+            /* output obs and nav data messages */
+            switch (ret) {
+                case 1: write_obs(conv->out.time,conv); break;
+                case 2: write_nav(conv->out.time,conv); break;
+            }
+        }
+    }
+}
+/* set shared decoders and sources of encoded frames of converters -----------*/
+static int setdecs(strsvr_t *svr)
+{
+    strconv_t *conv;
+    int i,j;
+    
+    for (i=0;i<svr->nstr-1;i++) {
+        svr->dec[i]=NULL;
+        svr->convsrc[i]=i;
+        if (!(conv=svr->conv[i])) continue;
+        
+        /* share decoder with same input type and options */
+        for (j=0;j<i;j++) {
+            if (!svr->dec[j]||svr->dec[j]->itype!=conv->itype||
+                strcmp(svr->dec[j]->opt,conv->opt)) continue;
+            svr->dec[i]=svr->dec[j];
+            break;
+        }
+        if (!svr->dec[i]&&!(svr->dec[i]=newdec(conv->itype,conv->opt))) {
+            return 0;
         }
-        /* write obs and nav data messages to stream */
-        switch (ret) {
-            case 1: write_obs(conv->out.time,str,conv); break;
-            case 2: write_nav(conv->out.time,str,conv); break;
+        /* share encoded frames with identical converter */
+        for (j=0;j<i;j++) {
+            if (!svr->conv[j]||svr->convsrc[j]!=j||
+                !sameconv(svr->conv[j],conv)) continue;
+            svr->convsrc[i]=j;
+            break;
         }
+        tracet(3,"setdecs: out=%d src=%d\n",i+1,svr->convsrc[i]+1);
+    }
+    return 1;
+}
+/* free shared decoders of converters ----------------------------------------*/
+static void freedecs(strsvr_t *svr)
+{
+    int i,j;
+    
+    for (i=0;i<16;i++) {
+        for (j=0;j<i&&svr->dec[j]!=svr->dec[i];j++) ;
+        if (j>=i) freedec(svr->dec[i]);
+    }
+    for (i=0;i<16;i++) {
+        svr->dec[i]=NULL;
+        svr->convsrc[i]=i;
     }
-    /* write cyclic nav data and station info messages to stream */
-    write_nav_cycle(str,conv);
-    write_sta_cycle(str,conv);
 }
 /* periodic command ----------------------------------------------------------*/
 static void periodic_cmd(int cycle, const char *cmd, stream_t *stream)
@@ -489,10 +623,11 @@ static void *strsvrthread(void *arg)
 #endif
 {
     strsvr_t *svr=(strsvr_t *)arg;
+    strconv_t *conv;
     sol_t sol_nmea={{0}};
     uint32_t tick,tick_nmea;
     uint8_t buff[1024];
-    int i,n,cyc;
+    int i,j,n,cyc;
     
     tracet(3,"strsvrthread:\n");
     
@@ -505,15 +640,31 @@ static void *strsvrthread(void *arg)
         /* read data from input stream */
         while ((n=strread(svr->stream,svr->buff,svr->buffsize))>0&&svr->state) {
             
+            /* convert data by shared decoders */
+            for (i=0;i<svr->nstr-1;i++) {
+                for (j=0;j<i&&svr->dec[j]!=svr->dec[i];j++) ;
+                if (svr->dec[i]&&j>=i) strconv(svr,svr->dec[i],svr->buff,n);
+            }
             /* write data to output streams */
             for (i=1;i<svr->nstr;i++) {
                 if (svr->conv[i-1]) {
-                    strconv(svr->stream+i,svr->conv[i-1],svr->buff,n);
+                    conv=svr->conv[i-1];
+                    
+                    /* cyclic nav data and station info messages */
+                    if (svr->convsrc[i-1]==i-1) {
+                        write_nav_cycle(conv);
+                        write_sta_cycle(conv);
+                    }
+                    conv=svr->conv[svr->convsrc[i-1]];
+                    strwrite(svr->stream+i,conv->obuf,conv->nobuf);
                 }
                 else {
                     strwrite(svr->stream+i,svr->buff,n);
                 }
             }
+            for (i=0;i<svr->nstr-1;i++) {
+                if (svr->conv[i]) svr->conv[i]->nobuf=0;
+            }
             /* write data to log stream */
             strwrite(svr->strlog,svr->buff,n);
             
@@ -553,6 +704,7 @@ static void *strsvrthread(void *arg)
     }
     for (i=0;i<svr->nstr;i++) strclose(svr->stream+i);
     for (i=0;i<svr->nstr;i++) strclose(svr->strlog+i);
+    freedecs(svr);
     svr->npb=0;
     free(svr->buff); svr->buff=NULL;
     free(svr->pbuf); svr->pbuf=NULL;
@@ -584,7 +736,11 @@ extern void strsvrinit(strsvr_t *svr, int nout)
     for (i=0;i<nout+1&&i<16;i++) strinit(svr->stream+i);
     for (i=0;i<nout+1&&i<16;i++) strinit(svr->strlog+i);
     svr->nstr=i;
-    for (i=0;i<16;i++) svr->conv[i]=NULL;
+    for (i=0;i<16;i++) {
+        svr->conv[i]=NULL;
+        svr->dec[i]=NULL;
+        svr->convsrc[i]=i;
+    }
     svr->thread=0;
     rtklib_initlock(&svr->lock);
 }
@@ -670,6 +826,13 @@ extern int strsvrstart(strsvr_t *svr, int *opts, int *strs, const char **paths,
         svr->buff = svr->pbuf = NULL;
         return 0;
     }
+    /* set shared decoders of converters */
+    if (!setdecs(svr)) {
+        freedecs(svr);
+        free(svr->buff); free(svr->pbuf);
+        svr->buff = svr->pbuf = NULL;
+        return 0;
+    }
     /* open streams */
     for (i=0;i<svr->nstr;i++) {
         strcpy(file1,paths[0]); if ((p=strstr(file1,"::"))) *p='\0';
@@ -677,6 +840,7 @@ extern int strsvrstart(strsvr_t *svr, int *opts, int *strs, const char **paths,
         if (i>0&&*file1&&!strcmp(file1,file2)) {
             sprintf(svr->stream[i].msg,"output path error: %-512.512s",file2);
             for (i--;i>=0;i--) strclose(svr->stream+i);
+            freedecs(svr);
             free(svr->buff); free(svr->pbuf);
             svr->buff = svr->pbuf = NULL;
             return 0;
@@ -689,6 +853,7 @@ extern int strsvrstart(strsvr_t *svr, int *opts, int *strs, const char **paths,
         }
         if (stropen(svr->stream+i,strs[i],rw,paths[i])) continue;
         for (i--;i>=0;i--) strclose(svr->stream+i);
+        freedecs(svr);
         free(svr->buff); free(svr->pbuf);
         svr->buff = svr->pbuf = NULL;
         return 0;
@@ -715,6 +880,7 @@ extern int strsvrstart(strsvr_t *svr, int *opts, int *strs, const char **paths,
 #endif
         for (i=0;i<svr->nstr;i++) strclose(svr->stream+i);
         svr->state=0;
+        freedecs(svr);
         free(svr->buff); free(svr->pbuf);
         svr->buff = svr->pbuf = NULL;
         return 0;
@@ -20,6 +20,14 @@
 * history : 2015/05/10 1.0  separated from ppp.c
 *           2015/06/11 1.1  fix bug on computing days in tide_oload() (#128)
 *           2017/04/11 1.2  fix bug on calling geterp() in timdedisp()
+*           2026/10/19 1.3  add astronomical context to api tidedisp()
+*                           add api tidedisp_cache(),cleartidecache()
+*                           hold tide cache by caller instead of library
+*                            context for multi-thread use
+*                           add api reftidecache() to share tide cache
+*                            by sessions with lock
+*                           compute tide cache nodes at station position
+*                            rounded to grid
 *-----------------------------------------------------------------------------*/
 #include "rtklib.h"
 
@@ -30,6 +38,34 @@
 #define GMS         1.327124E+20    /* sun gravitational constant */
 #define GMM         4.902801E+12    /* moon gravitational constant */
 
+#define TIDE_MAXSTA 16              /* max number of stations in tide cache */
+#define TIDE_MAXNODE 86400          /* max number of nodes for a station */
+#define TIDE_POSGRID 100.0          /* station position grid (m) */
+
+typedef struct {                    /* tidal displacement node type */
+    int64_t k;                      /* node index (utc time/interval) */
+    double dr[3];                   /* displacement (ecef) (m) */
+} tidenode_t;
+
+typedef struct {                    /* tidal displacement cache of station */
+    double rr[3];                   /* station position on grid (ecef) (m) */
+    int opt;                        /* tide options */
+    double tint;                    /* node interval (s) */
+    int oload;                      /* ocean loading parameters (0:none) */
+    double odisp[6*11];             /* ocean loading parameters */
+    uint32_t used;                  /* last used count */
+    int n,nmax;                     /* number of nodes and allocated */
+    tidenode_t *node;               /* nodes sorted by index */
+} tidesta_t;
+
+typedef struct {                    /* tidal displacement cache type */
+    int nsta;                       /* number of stations */
+    uint32_t count;                 /* use count */
+    int nref;                       /* number of references */
+    rtklib_lock_t lock;             /* lock flag */
+    tidesta_t sta[TIDE_MAXSTA];     /* station caches */
+} tidecache_t;
+
 /* function prototypes -------------------------------------------------------*/
 #ifdef IERS_MODEL
 extern int dehanttideinel_(double *xsta, int *year, int *mon, int *day,
@@ -217,6 +253,8 @@ static void tide_pole(gtime_t tut, const double *pos, const double *erpv,
 *                                 4: pole tide
 *                                 8: elimate permanent deformation
 *          double *erp      I   earth rotation parameters (NULL: not used)
+*          astro_t *astro   I   astronomical context of the epoch
+*                               (NULL: computed from tutc and erp)
 *          double *odisp    I   ocean loading parameters  (NULL: not used)
 *                                 odisp[0+i*6]: consituent i amplitude radial(m)
 *                                 odisp[1+i*6]: consituent i amplitude west  (m)
@@ -233,7 +271,7 @@ static void tide_pole(gtime_t tut, const double *pos, const double *erpv,
 *          ver.2.4.0 does not use ocean loading and pole tide corrections
 *-----------------------------------------------------------------------------*/
 extern void tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
-                     const double *odisp, double *dr)
+                     const astro_t *astro, const double *odisp, double *dr)
 {
     gtime_t tut;
     double pos[2],E[9],drt[3],denu[3],rs[3],rm[3],gmst,erpv[5]={0};
@@ -246,7 +284,10 @@ extern void tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
     char tstr[40];
     trace(3,"tidedisp: tutc=%s\n",time2str(tutc,tstr,0));
     
-    if (erp) {
+    if (astro) {
+        for (i=0;i<5;i++) erpv[i]=astro->erpv[i];
+    }
+    else if (erp) {
         geterp(erp,utc2gpst(tutc),erpv);
     }
     tut=timeadd(tutc,erpv[2]);
@@ -262,7 +303,16 @@ extern void tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
     if (opt&1) { /* solid earth tides */
         
         /* sun and moon position in ecef */
-        sunmoonpos(tutc,erpv,rs,rm,&gmst);
+        if (astro) {
+            for (i=0;i<3;i++) {
+                rs[i]=astro->rsun[i];
+                rm[i]=astro->rmoon[i];
+            }
+            gmst=astro->gmst;
+        }
+        else {
+            sunmoonpos(tutc,erpv,rs,rm,&gmst);
+        }
         
 #ifdef IERS_MODEL
         time2epoch(tutc,ep);
@@ -290,3 +340,223 @@ extern void tidedisp(gtime_t tutc, const double *rr, int opt, const erp_t *erp,
     }
     trace(5,"tidedisp: dr=%.3f %.3f %.3f\n",dr[0],dr[1],dr[2]);
 }
+/* search station in tide cache ----------------------------------------------*/
+static tidesta_t *tidesta(tidecache_t *cache, const double *rr, int opt,
+                          const double *odisp, double tint)
+{
+    tidesta_t *sta=NULL;
+    double rg[3];
+    int i,j;
+
+    /* station position on grid independent of order of calls */
+    for (i=0;i<3;i++) rg[i]=floor(rr[i]/TIDE_POSGRID+0.5)*TIDE_POSGRID;
+
+    for (i=0;i<cache->nsta;i++) {
+        sta=cache->sta+i;
+        if (sta->opt!=opt||sta->tint!=tint||sta->oload!=(odisp!=NULL)) continue;
+        if (odisp&&memcmp(sta->odisp,odisp,sizeof(sta->odisp))) continue;
+        if (sta->rr[0]==rg[0]&&sta->rr[1]==rg[1]&&sta->rr[2]==rg[2]) break;
+    }
+    if (i>=cache->nsta) {
+
+        /* new station or replace least recently used one */
+        if (cache->nsta<TIDE_MAXSTA) {
+            sta=cache->sta+cache->nsta++;
+            sta->nmax=0; sta->node=NULL;
+        }
+        else {
+            for (i=j=0;i<TIDE_MAXSTA;i++) {
+                if (cache->sta[i].used<cache->sta[j].used) j=i;
+            }
+            sta=cache->sta+j;
+        }
+        trace(3,"tidesta: new station rr=%.3f %.3f %.3f opt=%d tint=%.1f\n",
+              rg[0],rg[1],rg[2],opt,tint);
+
+        matcpy(sta->rr,rg,3,1);
+        sta->opt=opt;
+        sta->tint=tint;
+        sta->oload=odisp!=NULL;
+        if (odisp) memcpy(sta->odisp,odisp,sizeof(sta->odisp));
+        sta->n=0;
+    }
+    sta->used=++cache->count;
+    return sta;
+}
+/* get displacement at node -------------------------------------------------*/
+static int tidenode(tidesta_t *sta, int64_t k, const erp_t *erp, double *dr)
+{
+    tidenode_t *node;
+    gtime_t time;
+    double t;
+    int i=0,j=sta->n-1,m;
+
+    /* search node by index */
+    if (sta->n>0&&k>sta->node[j].k) i=sta->n;
+    else {
+        while (i<=j) {
+            m=(i+j)/2;
+            if (sta->node[m].k==k) {
+                matcpy(dr,sta->node[m].dr,3,1);
+                return 1;
+            }
+            if (sta->node[m].k<k) i=m+1; else j=m-1;
+        }
+    }
+    /* add new node by the full tide model */
+    if (sta->n>=TIDE_MAXNODE) {
+        trace(3,"tidenode: node overflow n=%d\n",sta->n);
+        sta->n=i=0;
+    }
+    if (sta->n>=sta->nmax) {
+        sta->nmax=sta->nmax<=0?64:sta->nmax*2;
+        if (!(node=(tidenode_t *)realloc(sta->node,sizeof(tidenode_t)*sta->nmax))) {
+            trace(1,"tidenode: memory allocation error\n");
+            free(sta->node); sta->node=NULL; sta->n=sta->nmax=0;
+            return 0;
+        }
+        sta->node=node;
+    }
+    t=(double)k*sta->tint;
+    time.time=(time_t)floor(t);
+    time.sec=t-floor(t);
+    tidedisp(time,sta->rr,sta->opt,erp,NULL,sta->oload?sta->odisp:NULL,dr);
+
+    memmove(sta->node+i+1,sta->node+i,sizeof(tidenode_t)*(sta->n-i));
+    sta->node[i].k=k;
+    matcpy(sta->node[i].dr,dr,3,1);
+    sta->n++;
+    return 1;
+}
+/* new tidal displacement cache ---------------------------------------------*/
+static tidecache_t *newtidecache(void)
+{
+    tidecache_t *c;
+
+    if (!(c=(tidecache_t *)calloc(1,sizeof(tidecache_t)))) return NULL;
+    c->nref=1;
+    rtklib_initlock(&c->lock);
+    return c;
+}
+/* tidal displacement by cache -------------------------------------------------
+* displacements by earth tides interpolated between cached node displacements
+* args   : void   **cache   IO  tidal displacement cache (NULL: no cache)
+*                               (*cache=NULL before the first call)
+*          gtime_t tutc     I   time in utc
+*          double *rr       I   site position (ecef) (m)
+*          int    opt       I   options (see tidedisp())
+*          erp_t  *erp      I   earth rotation parameters (NULL: not used)
+*          double *odisp    I   ocean loading parameters (see tidedisp())
+*          double tint      I   node interval (s) (0: no cache)
+*          double *dr       O   displacement by earth tides (ecef) (m)
+* return : none
+* notes  : the full tide model by tidedisp() is evaluated at node times of
+*          multiples of tint in utc and the displacement is linearly
+*          interpolated between the nodes. the interpolation error is less
+*          than tint^2/8*|d2r/dt2|, where |d2r/dt2|<1.1E-8 m/s^2 for the
+*          sum of tides (<0.5m at semi-diurnal frequencies). the error is
+*          <0.002 mm for tint=30s and <0.5 mm for tint=600s.
+*          the nodes are computed at the site position rounded to a grid of
+*          TIDE_POSGRID (100m, error <0.02 mm) and shared by calls in the same
+*          grid cell with the same options, so the displacements do not depend
+*          on the order of calls. the cache is allocated at the first call and should
+*          be freed by cleartidecache(). the cache is locked while nodes are
+*          searched or added, so sessions and threads processing the same
+*          stations can share it by reftidecache() (e.g. forward and backward
+*          passes of postpos()). the cache assumes the same erp data for all
+*          calls.
+*-----------------------------------------------------------------------------*/
+extern void tidedisp_cache(void **cache, gtime_t tutc, const double *rr,
+                           int opt, const erp_t *erp, const double *odisp,
+                           double tint, double *dr)
+{
+    tidecache_t *c;
+    tidesta_t *sta;
+    double t,a,dr0[3],dr1[3];
+    int64_t k;
+    int i,stat;
+
+    trace(4,"tidedisp_cache: tint=%.1f opt=%d\n",tint,opt);
+
+    dr[0]=dr[1]=dr[2]=0.0;
+
+    if (!cache||tint<=0.0) {
+        tidedisp(tutc,rr,opt,erp,NULL,odisp,dr);
+        return;
+    }
+    if (norm(rr,3)<=0.0) return;
+
+    if (!*cache&&!(*cache=newtidecache())) {
+        tidedisp(tutc,rr,opt,erp,NULL,odisp,dr);
+        return;
+    }
+    c=(tidecache_t *)*cache;
+
+    t=((double)tutc.time+tutc.sec)/tint;
+    k=(int64_t)floor(t);
+    a=t-floor(t);
+
+    rtklib_lock(&c->lock);
+    sta=tidesta(c,rr,opt,odisp,tint);
+    stat=tidenode(sta,k,erp,dr0)&&(a<=0.0||tidenode(sta,k+1,erp,dr1));
+    rtklib_unlock(&c->lock);
+
+    if (!stat) {
+        tidedisp(tutc,rr,opt,erp,NULL,odisp,dr);
+        return;
+    }
+    if (a<=0.0) {
+        matcpy(dr,dr0,3,1);
+        return;
+    }
+    for (i=0;i<3;i++) dr[i]=(1.0-a)*dr0[i]+a*dr1[i];
+
+    trace(5,"tidedisp_cache: dr=%.3f %.3f %.3f\n",dr[0],dr[1],dr[2]);
+}
+/* reference tidal displacement cache ------------------------------------------
+* add reference to tidal displacement cache to share it
+* args   : void   **cache   IO  tidal displacement cache (see tidedisp_cache())
+*                               (allocated if *cache=NULL)
+* return : shared tidal displacement cache (NULL: memory allocation error)
+* notes  : the returned cache is passed to tidedisp_cache() as the cache of
+*          another session and released by cleartidecache() as well as *cache
+*-----------------------------------------------------------------------------*/
+extern void *reftidecache(void **cache)
+{
+    tidecache_t *c;
+
+    trace(3,"reftidecache:\n");
+
+    if (!cache) return NULL;
+    if (!*cache&&!(*cache=newtidecache())) return NULL;
+
+    c=(tidecache_t *)*cache;
+    rtklib_lock(&c->lock);
+    c->nref++;
+    rtklib_unlock(&c->lock);
+    return c;
+}
+/* clear tidal displacement cache ----------------------------------------------
+* release reference to tidal displacement cache and free memory
+* args   : void   **cache   IO  tidal displacement cache (see tidedisp_cache())
+* return : none
+* notes  : the memory is freed when the last reference is released
+*-----------------------------------------------------------------------------*/
+extern void cleartidecache(void **cache)
+{
+    tidecache_t *c;
+    int i,nref;
+
+    trace(3,"cleartidecache:\n");
+
+    if (!cache||!(c=(tidecache_t *)*cache)) return;
+    *cache=NULL;
+
+    rtklib_lock(&c->lock);
+    nref=--c->nref;
+    rtklib_unlock(&c->lock);
+    if (nref>0) return;
+
+    for (i=0;i<c->nsta;i++) free(c->sta[i].node);
+    free(c);
+}
@@ -140,11 +140,60 @@ void utest4(void)
     
     printf("%s utest4 : OK\n",__FILE__);
 }
+/* tropmodel_batch(), tropmapf_batch() */
+void utest5(void)
+{
+    double e1[]={2007,1,16,6,0,0},e2[]={2030,12,31,23,59,59};
+    double pos[][3]={
+        { 35*D2R, 140*D2R, 100.0},{-80*D2R,-170*D2R,1000.0},
+        { 10*D2R,  30*D2R,   0.0},{ 45*D2R,  10*D2R,-500.0},
+        { 45*D2R,  10*D2R,15000.0},{ 45*D2R, 10*D2R,30000.0}
+    };
+    double humi[]={0.0,0.7},azel[192*2],trp[192],mapfs[192*2];
+    double trp0,mapfd,mapfw;
+    gtime_t time[2];
+    tropsite_t site={{0}};
+    int i,j,k,m,n;
+
+    time[0]=epoch2time(e1);
+    time[1]=epoch2time(e2);
+
+    for (n=0,i=-5;i<=90;i++) { /* el=-5-90 deg, az=0-330 deg */
+        azel[n*2  ]=(i*30%360)*D2R;
+        azel[n*2+1]=i*D2R;
+        n++;
+        azel[n*2  ]=((i*30+180)%360)*D2R;
+        azel[n*2+1]=(i+0.5)*D2R;
+        n++;
+    }
+    for (i=0;i<2;i++) for (j=0;j<6;j++) for (k=0;k<2;k++) {
+        settropsite(time[i],pos[j],humi[k],&site);
+        tropmodel_batch(&site,azel,n,trp);
+        tropmapf_batch(&site,azel,n,mapfs);
+
+        for (m=0;m<n;m++) {
+            trp0=tropmodel(time[i],pos[j],azel+m*2,humi[k]);
+                assert(fabs(trp[m]-trp0)<=1E-12*fabs(trp0));
+            mapfd=tropmapf(time[i],pos[j],azel+m*2,&mapfw);
+                assert(mapfs[m*2]==mapfd&&mapfs[m*2+1]==mapfw);
+        }
+    }
+    /* same site terms */
+    settropsite(time[0],pos[0],humi[1],&site);
+    site.zhd=-1.0;
+    settropsite(time[0],pos[0],humi[1],&site);
+        assert(site.zhd==-1.0);
+    settropsite(time[1],pos[0],humi[1],&site);
+        assert(site.zhd>0.0);
+
+    printf("%s utest5 : OK\n",__FILE__);
+}
 int main(void)
 {
     utest1();
     utest2();
     utest3();
     utest4();
+    utest5();
     return 0;
 }
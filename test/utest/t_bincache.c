@@ -0,0 +1,133 @@
+/*------------------------------------------------------------------------------
+* rtklib unit test driver : binary data cache functions
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <assert.h>
+#include "../../src/rtklib.h"
+
+/* copy file -----------------------------------------------------------------*/
+static int copyfile(const char *src, const char *dst)
+{
+    FILE *fp1,*fp2;
+    char buff[4096];
+    size_t n;
+
+    if (!(fp1=fopen(src,"rb"))) return 0;
+    if (!(fp2=fopen(dst,"wb"))) {
+        fclose(fp1);
+        return 0;
+    }
+    while ((n=fread(buff,1,sizeof(buff),fp1))>0) fwrite(buff,1,n,fp2);
+    fclose(fp1);
+    fclose(fp2);
+    return 1;
+}
+/* savecacheobs(), loadcacheobs() */
+void utest1(void)
+{
+    char file1[]="../data/rinex/07590920.05o";
+    char file2[]="../data/rinex/07590920.05n";
+    char file3[]="./t_bincache1.rtkc";
+    obs_t obs1={0},obs2={0};
+    nav_t nav1={0},nav2={0};
+    sta_t sta1={""},sta2={""};
+    int stat;
+
+    stat=readrnx(file1,1,"",&obs1,&nav1,&sta1);
+        assert(stat==1);
+    stat=readrnx(file2,1,"",NULL,&nav1,NULL);
+        assert(stat==1);
+    sortobs(&obs1);
+    uniqnav(&nav1);
+        assert(obs1.n>0&&nav1.n>0);
+
+    stat=savecacheobs(file3,&obs1,&nav1,&sta1,1,120);
+        assert(stat==1);
+    stat=loadcacheobs(file3,&obs2,&nav2,&sta2,1);
+        assert(stat==120);
+        assert(obs2.n==obs1.n&&nav2.n==nav1.n&&nav2.ng==nav1.ng);
+        assert(!memcmp(obs2.data,obs1.data,sizeof(obsd_t)*obs1.n));
+        assert(!memcmp(nav2.eph,nav1.eph,sizeof(eph_t)*nav1.n));
+        assert(!memcmp(nav2.ion_gps,nav1.ion_gps,sizeof(nav1.ion_gps)));
+        assert(!memcmp(nav2.utc_gps,nav1.utc_gps,sizeof(nav1.utc_gps)));
+        assert(!strcmp(sta2.name,sta1.name));
+        assert(sta2.pos[0]==sta1.pos[0]&&sta2.del[2]==sta1.del[2]);
+
+    /* invalid cache */
+    stat=loadcacheobs("./t_bincache0.rtkc",&obs2,&nav2,NULL,0);
+        assert(stat==0);
+
+    remove(file3);
+    free(obs1.data); free(obs2.data);
+    freenav(&nav1,0xFF); freenav(&nav2,0xFF);
+
+    printf("%s utest1 : OK\n",__FILE__);
+}
+/* savecachepeph(), loadcachepeph() */
+void utest2(void)
+{
+    char file1[]="../data/sp3/igs15904.sp3";
+    char file2[]="../data/sp3/igs15904.clk";
+    char file3[]="./t_bincache2.rtkc";
+    nav_t nav1={0},nav2={0};
+    sbs_t sbs1={0},sbs2={0};
+    int stat;
+
+    readsp3(file1,&nav1,0);
+    readrnxc(file2,&nav1);
+        assert(nav1.ne>0&&nav1.nc>0);
+
+    stat=savecachepeph(file3,&nav1,&sbs1);
+        assert(stat==1);
+    stat=loadcachepeph(file3,&nav2,&sbs2);
+        assert(stat==1);
+        assert(nav2.ne==nav1.ne&&nav2.nc==nav1.nc&&sbs2.n==0);
+        assert(!memcmp(nav2.peph,nav1.peph,sizeof(peph_t)*nav1.ne));
+        assert(!memcmp(nav2.pclk,nav1.pclk,sizeof(pclk_t)*nav1.nc));
+
+    remove(file3);
+    freenav(&nav1,0xFF); freenav(&nav2,0xFF);
+
+    printf("%s utest2 : OK\n",__FILE__);
+}
+/* cachepath() : stale cache of modified input file */
+void utest3(void)
+{
+    const char *infile[]={"./t_bincache3.obs","../data/rinex/07590920.05n"};
+    char path1[1024],path2[1024],path3[1024],path4[1024];
+    gtime_t ts={0},te={0};
+    FILE *fp;
+    int stat;
+
+    stat=copyfile("../data/rinex/07590920.05o",infile[0]);
+        assert(stat==1);
+
+    stat=cachepath("",0,infile,NULL,2,ts,te,0.0,"",path1);
+        assert(stat==0);
+    cachepath(".",0,infile,NULL,2,ts,te,0.0,"",path1);
+    cachepath(".",0,infile,NULL,2,ts,te,0.0,"",path2);
+        assert(!strcmp(path1,path2));
+    cachepath(".",0,infile,NULL,2,ts,te,30.0,"",path3);
+        assert(strcmp(path1,path3));
+    cachepath(".",1,infile,NULL,2,ts,te,0.0,"",path3);
+        assert(strcmp(path1,path3));
+
+    /* modify input file */
+    fp=fopen(infile[0],"ab");
+        assert(fp);
+    fputs("\n",fp);
+    fclose(fp);
+    cachepath(".",0,infile,NULL,2,ts,te,0.0,"",path4);
+        assert(strcmp(path1,path4));
+
+    remove(infile[0]);
+
+    printf("%s utest3 : OK\n",__FILE__);
+}
+int main(void)
+{
+    utest1();
+    utest2();
+    utest3();
+    return 0;
+}
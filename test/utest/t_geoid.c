@@ -2,6 +2,7 @@
 * rtklib unit test driver : geoid functions
 *-----------------------------------------------------------------------------*/
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <assert.h>
 #include "../../src/rtklib.h"
@@ -163,10 +164,161 @@ void utest3(void)
     printf("\n");
     printf("%s utset3 : OK\n",__FILE__);
 }
+/* synthetic geoid grid value (m) */
+static double gridval(int model, int i, int j)
+{
+    switch (model) {
+        case GEOID_EGM96_M150 : return ((i*37+j*91)%20001-10000)*0.01;
+        case GEOID_EGM2008_M25: return (float)(sin(i*0.01)*50.0+cos(j*0.013)*30.0);
+    }
+    return 30.0+(i%97)*0.0173-(j%89)*0.1021; /* GEOID_GSI2000_M15 */
+}
+/* generate synthetic geoid grid file */
+static int gengrid(int model, const char *file)
+{
+    FILE *fp;
+    int16_t v2;
+    float v4=0.0f;
+    int i,j,k;
+
+    if (!(fp=fopen(file,"wb"))) return 0;
+    if (model==GEOID_EGM96_M150) { /* big-endian 2 byte (cm) 1440 x 721 */
+        for (j=0;j<721;j++) for (i=0;i<1440;i++) {
+            v2=(int16_t)floor(gridval(model,i,j)*100.0+0.5);
+            fputc((v2>>8)&0xFF,fp); fputc(v2&0xFF,fp);
+        }
+    }
+    else if (model==GEOID_EGM2008_M25) { /* 4 byte float 8640 x 4321 */
+        for (j=0;j<241;j++) { /* lat 80-90 deg only */
+            fwrite(&v4,4,1,fp);
+            for (i=0;i<8640;i++) {
+                v4=(float)gridval(model,i,j);
+                fwrite(&v4,4,1,fp);
+            }
+            v4=0.0f;
+            fwrite(&v4,4,1,fp);
+        }
+    }
+    else { /* ascii 1201 x 1801, 28 fields per line */
+        fprintf(fp,"%-252s\r\n","synthetic gsi geoid");
+        for (j=0;j<1801;j++) {
+            for (i=k=0;i<1201;i++) {
+                fprintf(fp,"%9.4f",gridval(model,i,j));
+                if (++k==28||i==1200) {
+                    fprintf(fp,"%*s\r\n",(28-k)*9,"");
+                    k=0;
+                }
+            }
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+/* reference geoid height by synthetic grid */
+static double refgeoidh(int model, const double *pos)
+{
+    double lat=pos[0]*R2D,lon=pos[1]*R2D,a,b,y[4];
+    double lon0=0.0,lat0=90.0,dlon,dlat;
+    int i1,i2,j1,j2,nlon,nlat;
+    char buff[16];
+
+    if (lon<0.0) lon+=360.0;
+    if (model==GEOID_EGM96_M150) {
+        dlon=15.0/60.0; dlat=-15.0/60.0; nlon=1440; nlat=721;
+    }
+    else if (model==GEOID_EGM2008_M25) {
+        dlon=2.5/60.0; dlat=-2.5/60.0; nlon=8640; nlat=4321;
+    }
+    else {
+        if (lon<120.0||150.0<lon||lat<20.0||50.0<lat) return 0.0;
+        lon0=120.0; lat0=20.0; dlon=1.5/60.0; dlat=1.0/60.0; nlon=1201; nlat=1801;
+    }
+    a=(lon-lon0)/dlon; i1=(int)a; a-=i1;
+    b=(lat-lat0)/dlat; j1=(int)b; b-=j1;
+    i2=i1<nlon-1?i1+1:(model==GEOID_GSI2000_M15?i1:0);
+    j2=j1<nlat-1?j1+1:j1;
+    if (model==GEOID_EGM96_M150) {
+        y[0]=floor(gridval(model,i1,j1)*100.0+0.5)*0.01;
+        y[1]=floor(gridval(model,i2,j1)*100.0+0.5)*0.01;
+        y[2]=floor(gridval(model,i1,j2)*100.0+0.5)*0.01;
+        y[3]=floor(gridval(model,i2,j2)*100.0+0.5)*0.01;
+    }
+    else if (model==GEOID_EGM2008_M25) {
+        y[0]=gridval(model,i1,j1); y[1]=gridval(model,i2,j1);
+        y[2]=gridval(model,i1,j2); y[3]=gridval(model,i2,j2);
+    }
+    else {
+        sprintf(buff,"%9.4f",gridval(model,i1,j1)); y[0]=atof(buff);
+        sprintf(buff,"%9.4f",gridval(model,i2,j1)); y[1]=atof(buff);
+        sprintf(buff,"%9.4f",gridval(model,i1,j2)); y[2]=atof(buff);
+        sprintf(buff,"%9.4f",gridval(model,i2,j2)); y[3]=atof(buff);
+    }
+    return y[0]*(1.0-a)*(1.0-b)+y[1]*a*(1.0-b)+y[2]*(1.0-a)*b+y[3]*a*b;
+}
+/* opengeoid(), geoidh(), geoidh_batch() with synthetic grid files */
+void utest4(void)
+{
+    const int model[]={GEOID_EGM96_M150,GEOID_EGM2008_M25,GEOID_GSI2000_M15};
+    const double range[][4]={ /* lat/lon range (deg) */
+        {-90.0,90.0,-180.0,360.0},{80.0,90.0,-180.0,360.0},{20.0,50.0,120.0,150.0}
+    };
+    char file[]="./t_geoid4.grd";
+    double pos[1000*3],h[1000],dhmax;
+    int i,j,ret,n=1000;
+
+    srand(1234);
+
+    for (i=0;i<3;i++) {
+        ret=gengrid(model[i],file);
+            assert(ret);
+        ret=opengeoid(model[i],file);
+            assert(ret==1);
+        for (j=0;j<n;j++) {
+            pos[j*3  ]=(range[i][0]+(range[i][1]-range[i][0])*rand()/RAND_MAX)*D2R;
+            pos[j*3+1]=(range[i][2]+(range[i][3]-range[i][2])*rand()/RAND_MAX)*D2R;
+            pos[j*3+2]=0.0;
+        }
+        geoidh_batch(pos,n,h);
+        for (j=0,dhmax=0.0;j<n;j++) {
+                assert(h[j]==geoidh(pos+j*3));
+            if (fabs(h[j]-refgeoidh(model[i],pos+j*3))>dhmax) {
+                dhmax=fabs(h[j]-refgeoidh(model[i],pos+j*3));
+            }
+        }
+        printf("model=%d max difference=%.3E\n",model[i],dhmax);
+            assert(dhmax<1E-6);
+
+        /* out of grid file */
+        if (model[i]==GEOID_EGM2008_M25) {
+            pos[0]=45.0*D2R;
+                assert(geoidh(pos)==0.0);
+        }
+        closegeoid();
+    }
+    remove(file);
+
+    printf("%s utest4 : OK\n",__FILE__);
+}
+/* check existence of data file */
+static int chkfile(const char *file)
+{
+    FILE *fp;
+
+    if (!(fp=fopen(file,"r"))) {
+        printf("%s : no data file %s\n",__FILE__,file);
+        return 0;
+    }
+    fclose(fp);
+    return 1;
+}
 int main(void)
 {
-    utest1();
-    utest2();
-    utest3();
+    /* utest1-3 skipped without geoid data files */
+    if (chkfile(file1)&&chkfile(file2)&&chkfile(file3)&&chkfile(file4)) {
+        utest1();
+        utest2();
+        utest3();
+    }
+    utest4();
     return 0;
 }
@@ -223,11 +223,67 @@ void utest4(void)
     
     printf("%s utest4 : OK\n",__FILE__);
 }
+/* iontec_batch() vs iontec() */
+void utest5(void)
+{
+    char *file3="../data/sp3/igrg33*0.10i";
+    nav_t nav={0};
+    gtime_t time1,time;
+    double ep1[]={2010,12, 3, 0, 0, 0};
+    double pos[][3]={
+        { 25*D2R, 135*D2R,  0.0},{-60*D2R,-170*D2R,1000.0},
+        { 89*D2R,  10*D2R, 50.0},{ 35*D2R,  140*D2R,-2000.0}
+    };
+    double azel[64*2],delay[64],var[64],delay0,var0;
+    int i,j,k,m,n,opt,stat[64],stat0,nok,nt,ntec=0;
+
+    time1=epoch2time(ep1);
+    readtec(file3,&nav,0);
+        assert(nav.nt>2);
+    nt=nav.nt;
+
+    for (n=0;n<64;n++) {
+        azel[n*2  ]=(n*47%360)*D2R;
+        azel[n*2+1]=(n*1.5-5.0)*D2R; /* el=-5-89.5 deg */
+    }
+    for (m=0;m<2;m++) {
+        if (m==1) { /* irregular map intervals */
+            for (i=j=0;i<nav.nt;i++) {
+                if (i%3==1&&i<nav.nt-1) continue;
+                nav.tec[j++]=nav.tec[i];
+            }
+            nav.nt=j;
+        }
+        for (i=-3600;i<=86400*3+3600;i+=(m==0?917:1811)) {
+            time=timeadd(time1,i+0.25*(i%4));
+            for (j=0;j<4;j++) for (opt=0;opt<4;opt++) {
+                nok=iontec_batch(time,&nav,pos[j],azel,n,opt,delay,var,stat);
+                for (k=0;k<n;k++) {
+                    delay0=var0=0.0;
+                    stat0=iontec(time,&nav,pos[j],azel+k*2,opt,&delay0,&var0);
+                        assert(stat[k]==stat0);
+                    if (!stat0) continue;
+                    if (delay0>0.0) ntec++;
+                        assert(fabs(delay[k]-delay0)<=1E-12*fabs(delay0)+1E-15);
+                        assert(fabs(var[k]-var0)<=1E-12*fabs(var0)+1E-15);
+                    nok--;
+                }
+                    assert(nok==0);
+            }
+        }
+    }
+        assert(ntec>0);
+    nav.nt=nt;
+    free(nav.tec);
+
+    printf("%s utest5 : OK\n",__FILE__);
+}
 int main(int argc, char **argv)
 {
     utest1();
     utest2();
     utest3();
     utest4();
+    utest5();
     return 0;
 }
@@ -179,6 +179,46 @@ void utest6(void)
     }
     free(a); free(b);
 }
+/* matinv_ws(), lsq_ws(), filter_ws() */
+void utest7(void)
+{
+    wspace_t ws;
+    double A[4],x[3],Q[9],x1[4]={1.0,0.0,2.0,3.0},x2[4],P1[16]={0},P2[16];
+    double Hf[8]={1.0,0.0,0.5,0.0, 0.0,0.0,1.0,1.0},v[2]={0.1,-0.2};
+    double R[4]={0.01,0.0,0.0,0.02},x3[4],P3[16];
+    int i,info1,info2,ix[3]={0,2,3};
+    size_t mark;
+
+    wsinit(&ws,16);
+    mark=wsmark(&ws);
+    memcpy(A,invB,sizeof(double)*4);
+    matinv_ws(A,2,&ws);
+    for (i=0;i<4;i++) assert(fabs(A[i]-B[i])<1E-9);
+    lsq_ws(H,y,3,4,x,Q,&ws);
+    for (i=0;i<3;i++) assert(fabs(x[i]-xs[i])<1E-9);
+    for (i=0;i<9;i++) assert(fabs(Q[i]-Qs[i])<1E-9);
+    for (i=0;i<4;i++) P1[i+i*4]=1.0+i;
+    P1[2]=P1[8]=0.5;
+    memcpy(x2,x1,sizeof(x1)); memcpy(P2,P1,sizeof(P1));
+    memcpy(x3,x1,sizeof(x1)); memcpy(P3,P1,sizeof(P1));
+    info1=filter(x1,P1,Hf,v,R,4,2);
+    info2=filter_ws(x2,P2,Hf,v,R,4,2,NULL,0,&ws);
+        assert(info1==0&&info2==0);
+    for (i=0;i<4;i++) assert(x1[i]==x2[i]);
+    for (i=0;i<16;i++) assert(P1[i]==P2[i]);
+        assert(x2[1]==0.0&&P2[1+1*4]==2.0); /* zero state not updated */
+    memcpy(x2,x3,sizeof(x3)); memcpy(P2,P3,sizeof(P3));
+    info2=filter_ws(x2,P2,Hf,v,R,4,2,ix,3,&ws); /* active state index */
+        assert(info2==0);
+    for (i=0;i<4;i++) assert(x1[i]==x2[i]);
+    for (i=0;i<16;i++) assert(P1[i]==P2[i]);
+    info2=filter_ws(x3,P3,Hf,v,R,4,2,ix,2,&ws); /* state 3 not listed */
+        assert(info2==0&&x3[3]==3.0&&P3[3+3*4]==4.0);
+        assert(wsmark(&ws)==mark);
+    wsfree(&ws);
+
+    printf("%s utest7 : OK\n",__FILE__);
+}
 int main(void)
 {
     utest1();
@@ -187,5 +227,6 @@ int main(void)
     utest4();
     utest5();
     utest6();
+    utest7();
     return 0;
 }
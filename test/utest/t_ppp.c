@@ -60,7 +60,7 @@ void utest3(void)
     double dr[3]={0};
     int i;
     
-    tidedisp(epoch2time(ep1),rr,1,NULL,NULL,dr);
+    tidedisp(epoch2time(ep1),rr,1,NULL,NULL,NULL,dr);
     
     printf("X_disp=%8.5f %8.5f %8.5f\n",dr[0],dp[0],dr[0]-dp[0]);
     printf("Y_disp=%8.5f %8.5f %8.5f\n",dr[1],dp[1],dr[1]-dp[1]);
@@ -71,10 +71,52 @@ void utest3(void)
     }
     printf("%s utset3 : OK\n",__FILE__);
 }
+/* tidedisp_cache(), reftidecache(), cleartidecache() */
+void utest4(void)
+{
+    double ep1[]={2010,6,7,1,2,3};
+    double rr[]={-3957198.431,3310198.621,3737713.474}; /* TSKB */
+    double dr0[3],dr1[3],dr2[3];
+    void *cache=NULL,*tidec=NULL,*ses1,*ses2;
+    gtime_t time;
+    int i,j;
+    
+    ses1=reftidecache(&tidec); /* forward pass */
+    ses2=reftidecache(&tidec); /* backward pass */
+        assert(tidec&&ses1==tidec&&ses2==tidec);
+    
+    for (i=0;i<3600;i+=7) {
+        time=timeadd(epoch2time(ep1),i);
+        tidedisp(time,rr,7,NULL,NULL,NULL,dr0);
+        tidedisp_cache(&cache,time,rr,7,NULL,NULL,30.0,dr1);
+        tidedisp_cache(&ses1,time,rr,7,NULL,NULL,30.0,dr2);
+        for (j=0;j<3;j++) {
+            assert(fabs(dr1[j]-dr0[j])<1E-5&&dr2[j]==dr1[j]);
+        }
+    }
+    cleartidecache(&ses1);
+        assert(ses1==NULL);
+    
+    for (i=3600-7;i>=0;i-=7) {
+        time=timeadd(epoch2time(ep1),i);
+        tidedisp_cache(&cache,time,rr,7,NULL,NULL,30.0,dr1);
+        tidedisp_cache(&ses2,time,rr,7,NULL,NULL,30.0,dr2);
+        for (j=0;j<3;j++) {
+            assert(dr2[j]==dr1[j]);
+        }
+    }
+    cleartidecache(&ses2);
+    cleartidecache(&tidec);
+    cleartidecache(&cache);
+        assert(!ses2&&!tidec&&!cache);
+    
+    printf("%s utest4 : OK\n",__FILE__);
+}
 int main(void)
 {
     utest1();
     utest2();
     utest3();
+    utest4();
     return 0;
 }
@@ -5,6 +5,8 @@
 #include <assert.h>
 #include "../../src/rtklib.h"
 
+static char *atxfile="../../data/ant/igs14.atx"; /* antenna file (not in test data) */
+
 static void dumpeph(peph_t *peph, int n)
 {
     char s[40];
@@ -62,7 +64,7 @@ void utest2(void)
     double ep1[]={2008,3,1,0,0,0};
     double ep2[]={2006,11,4,23,59,59};
     char *file1="../data/sp3/igs06.atx";
-    char *file2="../../data/ant/igs14.atx";
+    char *file2=atxfile;
     pcvs_t pcvs={0};
     pcv_t *pcv;
     gtime_t time;
@@ -132,9 +134,9 @@ void utest4(void)
         assert(nav.ne>0);
     readrnxc(file2,&nav);
         assert(nav.nc>0);
-    stat=peph2pos(time,0,&nav,0,rs,dts,&var);
+    stat=peph2pos(time,0,&nav,0,NULL,rs,dts,&var);
         assert(!stat);
-    stat=peph2pos(time,160,&nav,0,rs,dts,&var);
+    stat=peph2pos(time,160,&nav,0,NULL,rs,dts,&var);
         assert(!stat);
 
     fp=fopen("testpeph1.out","w");
@@ -145,7 +147,7 @@ void utest4(void)
         t=timeadd(time,(double)i);
         for (j=0;j<6;j++) rs [j]=0.0;
         for (j=0;j<2;j++) dts[j]=0.0;
-        peph2pos(t,sat,&nav,0,rs,dts,&var);
+        peph2pos(t,sat,&nav,0,NULL,rs,dts,&var);
         fprintf(fp,"%02d %6d %14.3f %14.3f %14.3f %14.3f %10.3f %10.3f %10.3f %10.3f\n",
                 sat,i,rs[0],rs[1],rs[2],dts[0]*1E9,rs[3],rs[4],rs[5],dts[1]*1E9);
     }
@@ -158,7 +160,7 @@ void utest5(void)
     FILE *fp;
     char *file1="../data/sp3/igs1590*.sp3"; /* 2010/7/1 */
     char *file2="../data/sp3/igs1590*.clk"; /* 2010/7/1 */
-    char *file3="../../data/ant/igs14.atx";
+    char *file3=atxfile;
     char *file4="../data/rinex/brdc*.10n";
     pcvs_t pcvs={0};
     pcv_t *pcv;
@@ -198,12 +200,82 @@ void utest5(void)
     fclose(fp);
     printf("%s utest5 : OK\n",__FILE__);
 }
+/* setpephs() : per-satellite store and chebyshev orbit segments */
+void utest6(void)
+{
+    char *file1="../data/sp3/igs1590*.sp3"; /* 2010/7/1 */
+    char *file2="../data/sp3/igs1590*.clk"; /* 2010/7/1 */
+    nav_t nav1={0},nav2={0},nav3={0};
+    double ep[]={2010,7,1,0,0,0};
+    double rs1[6],dts1[2],rs2[6],dts2[2],rs3[6],dts3[2],var1,var2,var3;
+    double dp2=0.0,dv2=0.0,dp3=0.0,dv3=0.0;
+    int i,j,n=0,sat,stat1,stat2,stat3;
+    gtime_t t,time;
+
+    time=epoch2time(ep);
+
+    readsp3(file1,&nav1,0); readrnxc(file2,&nav1);
+    readsp3(file1,&nav2,0); readrnxc(file2,&nav2);
+    readsp3(file1,&nav3,0); readrnxc(file2,&nav3);
+        assert(nav1.ne>0&&nav1.nc>0);
+    stat1=setpephs(&nav2,0);
+    stat2=setpephs(&nav3,2);
+        assert(stat1&&stat2&&nav2.pephs&&nav3.pephs);
+
+    /* polynomial interpolation vs store and chebyshev segments */
+    for (i=-600;i<86400*2+600;i+=37) {
+        t=timeadd(time,(double)i);
+        for (sat=1;sat<=MAXSAT;sat++) {
+            stat1=peph2pos(t,sat,&nav1,1,NULL,rs1,dts1,&var1);
+            stat2=peph2pos(t,sat,&nav2,1,NULL,rs2,dts2,&var2);
+            stat3=peph2pos(t,sat,&nav3,1,NULL,rs3,dts3,&var3);
+                assert(stat1==stat2&&stat1==stat3);
+            if (!stat1) continue;
+                assert(dts1[0]==dts2[0]); /* relativity by chebyshev orbit */
+                assert(fabs(dts1[0]-dts3[0])<1E-12);
+                assert(var1==var2&&var1==var3);
+            for (j=0;j<3;j++) {
+                if (fabs(rs2[j  ]-rs1[j  ])>dp2) dp2=fabs(rs2[j  ]-rs1[j  ]);
+                if (fabs(rs2[j+3]-rs1[j+3])>dv2) dv2=fabs(rs2[j+3]-rs1[j+3]);
+                if (fabs(rs3[j  ]-rs1[j  ])>dp3) dp3=fabs(rs3[j  ]-rs1[j  ]);
+                if (fabs(rs3[j+3]-rs1[j+3])>dv3) dv3=fabs(rs3[j+3]-rs1[j+3]);
+            }
+            n++;
+        }
+    }
+    printf("n=%d store: dpos=%.3E dvel=%.3E cheb: dpos=%.3E dvel=%.3E\n",n,
+           dp2,dv2,dp3,dv3);
+        assert(n>0);
+        assert(dp2==0.0&&dv2==0.0);
+        assert(dp3<=1E-4&&dv3<1E-3); /* MAXERR_CHEB */
+
+    freepephs(&nav3);
+        assert(!nav3.pephs);
+    freenav(&nav1,0xFF); freenav(&nav2,0xFF); freenav(&nav3,0xFF);
+
+    printf("%s utest6 : OK\n",__FILE__);
+}
+/* check existence of data file */
+static int chkfile(const char *file)
+{
+    FILE *fp;
+
+    if (!(fp=fopen(file,"r"))) {
+        printf("%s : no data file %s\n",__FILE__,file);
+        return 0;
+    }
+    fclose(fp);
+    return 1;
+}
 int main(int argc, char **argv)
 {
+    int atx=chkfile(atxfile);
+
     utest1();
-    utest2();
+    if (atx) utest2(); /* skipped without antenna file */
     utest3();
     utest4();
-    utest5();
+    if (atx) utest5();
+    utest6();
     return 0;
 }
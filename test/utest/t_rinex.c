@@ -43,7 +43,7 @@ static void dumpnav(nav_t *nav)
 static void dumpsta(sta_t *sta)
 {
     printf("name    = %s\n",sta->name);
-    printf("marker  = %s\n",sta->marker);
+    printf("markerno= %s\n",sta->markerno);
     printf("antdes  = %s\n",sta->antdes);
     printf("antsno  = %s\n",sta->antsno);
     printf("rectype = %s\n",sta->rectype);
@@ -85,7 +85,7 @@ void utest1(void)
     n=sortobs(&obs);
         assert(n==120/*171*/);
     uniqnav(&nav);
-        assert(nav.n==167);
+        assert(nav.n==164); /* 167 before removing non-adjacent duplicates */
     dumpobs(&obs); dumpnav(&nav); dumpsta(&sta);
         assert(obs.data&&obs.n>0&&nav.eph&&nav.n>0);
     free(obs.data);
@@ -208,6 +208,275 @@ void utest6(void)
     }
     printf("%s utest6 : OK\n",__FILE__);
 }
+/* uniqnav() : duplicated and unsorted ephemerides */
+void utest7(void)
+{
+    char file1[]="../data/rinex/07590920.05n";
+    char file2[]="../data/rinex/30400920.05n";
+    nav_t nav1={0},nav2={0};
+    eph_t eph;
+    int i,n,stat;
+
+    stat=readrnx(file1,1,"",NULL,&nav1,NULL);
+        assert(stat==1);
+    stat=readrnx(file2,1,"",NULL,&nav1,NULL);
+        assert(stat==1);
+    uniqnav(&nav1);
+        assert(nav1.n==164);
+    for (i=1;i<nav1.n;i++) { /* sorted by sat, toe and ttr without duplicates */
+        assert(nav1.eph[i-1].sat<nav1.eph[i].sat||
+               (nav1.eph[i-1].sat==nav1.eph[i].sat&&
+                (timediff(nav1.eph[i-1].toe,nav1.eph[i].toe)<0.0||
+                 (timediff(nav1.eph[i-1].toe,nav1.eph[i].toe)==0.0&&
+                  (timediff(nav1.eph[i-1].ttr,nav1.eph[i].ttr)<0.0||
+                   nav1.eph[i-1].iode!=nav1.eph[i].iode)))));
+    }
+    /* reversed and duplicated input */
+    n=nav1.n;
+    nav2.eph=(eph_t *)malloc(sizeof(eph_t)*n*2);
+        assert(nav2.eph);
+    for (i=0;i<n;i++) {
+        nav2.eph[i]=nav2.eph[2*n-1-i]=nav1.eph[n-1-i];
+    }
+    nav2.n=nav2.nmax=2*n;
+    uniqnav(&nav2);
+        assert(nav2.n==n);
+        assert(!memcmp(nav2.eph,nav1.eph,sizeof(eph_t)*n));
+    freenav(&nav2,0xFF);
+
+    /* one satellite in reversed order (fall back to qsort) */
+    nav2.eph=(eph_t *)malloc(sizeof(eph_t)*200);
+        assert(nav2.eph);
+    for (i=0;i<200;i++) {
+        eph=nav1.eph[0];
+        eph.iode=i%100;
+        eph.toe=eph.ttr=timeadd(nav1.eph[0].toe,7200.0*(99-i%100));
+        nav2.eph[i]=eph;
+    }
+    nav2.n=nav2.nmax=200;
+    uniqnav(&nav2);
+        assert(nav2.n==100);
+    for (i=0;i<100;i++) {
+        assert(nav2.eph[i].iode==99-i);
+    }
+    freenav(&nav1,0xFF); freenav(&nav2,0xFF);
+
+    printf("%s utest7 : OK\n",__FILE__);
+}
+/* compare obs data of an epoch */
+static int cmpobs(const obsd_t *a, const obsd_t *b, int n)
+{
+    int i,j;
+    for (i=0;i<n;i++) {
+        if (timediff(a[i].time,b[i].time)!=0.0||a[i].sat!=b[i].sat||
+            a[i].rcv!=b[i].rcv) return 0;
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            if (a[i].P[j]!=b[i].P[j]||a[i].L[j]!=b[i].L[j]||
+                a[i].D[j]!=b[i].D[j]||a[i].SNR[j]!=b[i].SNR[j]||
+                a[i].LLI[j]!=b[i].LLI[j]||a[i].code[j]!=b[i].code[j]) return 0;
+        }
+    }
+    return 1;
+}
+/* init_rnxobs(), add_rnxobs(), input_rnxobs(), free_rnxobs() */
+void utest8(void)
+{
+    gtime_t t0={0},ts,te;
+    double ep1[]={2005,4,2,0,10,0},ep2[]={2005,4,2,0,40,0};
+    double tint[]={0.0,0.0,90.0};
+    char file1[]="../data/rinex/07590920.05o";
+    char file2[]="../data/rinex/07590920.05n";
+    obsd_t data[MAXOBS];
+    obs_t obs={0};
+    nav_t nav={0};
+    sta_t sta1={""},sta2={""};
+    rnxobs_t rnx;
+    int i,j,k,n,ne,stat;
+
+    for (k=0;k<3;k++) {
+        ts=k==0?t0:epoch2time(ep1);
+        te=k==0?t0:epoch2time(ep2);
+
+        /* whole file */
+        stat=readrnxt(file1,1,ts,te,tint[k],"",&obs,NULL,&sta1);
+            assert(stat==1);
+        ne=sortobs(&obs);
+            assert(ne>0);
+
+        /* stream */
+        stat=init_rnxobs(&rnx,1,ts,te,tint[k],"");
+            assert(stat==1);
+        n=add_rnxobs(&rnx,file1,NULL,&sta2);
+            assert(n==1);
+        n=add_rnxobs(NULL,file2,&nav,NULL);
+            assert(n==0&&nav.n>0);
+            assert(!strcmp(sta1.name,sta2.name)&&sta1.pos[0]==sta2.pos[0]);
+
+        for (i=j=0;(n=input_rnxobs(&rnx,data,MAXOBS))>0;i+=n,j++) {
+                assert(i+n<=obs.n);
+                assert(cmpobs(data,obs.data+i,n));
+                assert(i+n==obs.n||timediff(obs.data[i+n].time,data[0].time)>DTTOL);
+        }
+            assert(i==obs.n&&j==ne);
+        free_rnxobs(&rnx);
+
+        free(obs.data); obs.data=NULL; obs.n=obs.nmax=0;
+        freenav(&nav,0xFF);
+    }
+    printf("%s utest8 : OK\n",__FILE__);
+}
+/* reference of obs data field formatter before buffered output */
+static void refobsf(char *p, double obs, int lli, int std)
+{
+    if (obs==0.0) p+=sprintf(p,"              ");
+    else p+=sprintf(p,"%14.3f",fmod(obs,1e9));
+    if (lli<0||!(lli&(LLI_SLIP|LLI_HALFC|LLI_BOCTRK))) p+=sprintf(p," ");
+    else p+=sprintf(p,"%1.1d",lli&(LLI_SLIP|LLI_HALFC|LLI_BOCTRK));
+    if (std<=0) sprintf(p," "); else sprintf(p,"%1.1x",std>9?9:std);
+}
+/* check obs data field output by outrnxobsb() */
+static int chkobsf(rnxopt_t *opt, double val, int lli, int std)
+{
+    obsd_t data={{0}};
+    double ep[]={2020,1,1,0,0,0};
+    char buff[256],ref[32];
+    FILE *fp;
+    int stat;
+
+    data.time=epoch2time(ep);
+    data.sat=satno(SYS_GPS,1);
+    data.code[0]=CODE_L1C;
+    data.L[0]=val;
+    data.LLI[0]=(uint8_t)(lli<0?0:lli);
+    data.Lstd[0]=(uint8_t)std;
+
+    if (!(fp=tmpfile())) return 0;
+    outrnxobsb(fp,opt,&data,1,0);
+    rewind(fp);
+    stat=fgets(buff,sizeof(buff),fp)&&fgets(buff,sizeof(buff),fp);
+    fclose(fp);
+    refobsf(ref,val,lli,std);
+    strcat(ref,"\n");
+    if (!stat||strncmp(buff,"G01",3)||strcmp(buff+3,ref)) {
+        printf("val=%.6f lli=%d std=%d out=%s ref=%s",val,lli,std,buff+3,ref);
+        return 0;
+    }
+    return 1;
+}
+/* compare files */
+static int cmpfile(FILE *fp1, FILE *fp2)
+{
+    int c1,c2;
+
+    rewind(fp1); rewind(fp2);
+    do {
+        c1=fgetc(fp1); c2=fgetc(fp2);
+    } while (c1==c2&&c1!=EOF);
+    return c1==c2;
+}
+/* outrnxobsb() : fast formatter and obs code maps vs previous output */
+void utest9(void)
+{
+    const char *tobs3[]={"C1C","L1C","D1C","S1C","C1P","L1P","C2P","L2P","S2P"};
+    const char *tobs2[]={"C1","L1","P1","P2","L2","D1","S1","S2"};
+    double val[]={
+        1.0,-1.0,0.0004,0.0005,0.0015,-0.0004,-0.0005,-0.0006,0.4995,
+        123.4565,20000000.0005,-20000000.0005,999999999.999,999999999.9996,
+        1e9,1e9+0.0004,-1e9+0.0004,2e9+123.456,123456789012.345,-5e10
+    };
+    obs_t obs={0};
+    rnxopt_t opt1={{0}},opt2;
+    FILE *fp1,*fp2;
+    int i,j,k,n,ver,stat;
+
+    opt1.navsys=SYS_GPS;
+    memset(opt1.mask,'1',sizeof(opt1.mask));
+
+    /* boundary values */
+    opt1.rnxver=304;
+    opt1.nobs[RNX_SYS_GPS]=1;
+    strcpy(opt1.tobs[RNX_SYS_GPS][0],"L1C");
+    for (i=0;i<(int)(sizeof(val)/sizeof(double));i++) {
+        assert(chkobsf(&opt1,val[i],0,0));
+        assert(chkobsf(&opt1,val[i],LLI_SLIP|LLI_HALFC,5));
+        assert(chkobsf(&opt1,val[i],LLI_BOCTRK,12));
+    }
+    /* all obs data in test data */
+    stat=readrnx("../data/rinex/07590920.05o",1,"",&obs,NULL,NULL);
+        assert(stat==1&&obs.n>0);
+    for (i=0;i<obs.n;i++) for (j=0;j<NFREQ;j++) {
+        assert(chkobsf(&opt1,obs.data[i].P[j],-1,0));
+        assert(chkobsf(&opt1,obs.data[i].L[j],obs.data[i].LLI[j],0));
+        assert(chkobsf(&opt1,obs.data[i].D[j],-1,0));
+        assert(chkobsf(&opt1,obs.data[i].SNR[j]*SNR_UNIT,-1,0));
+    }
+    /* obs type search vs obs code maps */
+    n=sortobs(&obs);
+    for (ver=0;ver<2;ver++) {
+        opt1.rnxver=ver?211:304;
+        opt1.nobs[RNX_SYS_GPS]=ver?8:9;
+        for (i=0;i<opt1.nobs[RNX_SYS_GPS];i++) {
+            strcpy(opt1.tobs[RNX_SYS_GPS][i],ver?tobs2[i]:tobs3[i]);
+        }
+        opt2=opt1;
+        setrnxobsmap(&opt2);
+            assert(opt2.obsmapset);
+        fp1=tmpfile(); fp2=tmpfile();
+            assert(fp1&&fp2);
+        for (i=j=0;i<n;i++,j+=k) {
+            for (k=1;j+k<obs.n&&timediff(obs.data[j+k].time,obs.data[j].time)==0.0;k++) ;
+            stat=outrnxobsb(fp1,&opt1,obs.data+j,k,0);
+                assert(stat==1);
+            stat=outrnxobsb(fp2,&opt2,obs.data+j,k,0);
+                assert(stat==1);
+        }
+            assert(ftell(fp1)>0&&cmpfile(fp1,fp2));
+        fclose(fp1); fclose(fp2);
+    }
+    free(obs.data);
+
+    printf("%s utest9 : OK\n",__FILE__);
+}
+/* uniqnav(), satpos() : satellite index of ephemerides */
+void utest10(void)
+{
+    char file1[]="../data/rinex/07590920.05n";
+    char file2[]="../data/rinex/30400920.05n";
+    nav_t nav={0};
+    gtime_t time;
+    double rs1[6],dts1[2],rs2[6],dts2[2],var1,var2;
+    int i,sat,svh1,svh2,stat1,stat2,n=0;
+
+    readrnx(file1,1,"",NULL,&nav,NULL);
+    readrnx(file2,1,"",NULL,&nav,NULL);
+        assert(nav.idxdata[0]==NULL);
+    uniqnav(&nav);
+        assert(nav.idxdata[0]==nav.eph&&nav.idxn[0]==nav.n);
+    for (sat=1;sat<=MAXSAT;sat++) {
+        for (i=0;i<nav.n;i++) {
+            assert((nav.eph[i].sat==sat)==
+                   (i>=nav.idxsat[0][sat-1]&&i<nav.idxsat[0][sat]));
+        }
+    }
+    /* selection with index vs without index */
+    for (i=0;i<96;i++) {
+        time=timeadd(nav.eph[0].toe,900.0*i-43200.0);
+        for (sat=1;sat<=MAXSAT;sat++) {
+            stat1=satpos(time,time,sat,EPHOPT_BRDC,&nav,rs1,dts1,&var1,&svh1);
+            nav.idxdata[0]=NULL;
+            stat2=satpos(time,time,sat,EPHOPT_BRDC,&nav,rs2,dts2,&var2,&svh2);
+            nav.idxdata[0]=nav.eph;
+                assert(stat1==stat2);
+            if (!stat1) continue;
+                assert(!memcmp(rs1,rs2,sizeof(rs1))&&!memcmp(dts1,dts2,sizeof(dts1)));
+            n++;
+        }
+    }
+        assert(n>900);
+    freenav(&nav,0xFF);
+
+    printf("%s utest10 : OK\n",__FILE__);
+}
 int main(int argc, char **argv)
 {
     utest1();
@@ -216,5 +485,9 @@ int main(int argc, char **argv)
     utest4();
     utest5();
     utest6();
+    utest7();
+    utest8();
+    utest9();
+    utest10();
     return 0;
 }
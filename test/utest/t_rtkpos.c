@@ -0,0 +1,219 @@
+/*------------------------------------------------------------------------------
+* rtklib unit test driver : rtk positioning functions
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "../../src/rtklib.h"
+
+/* heap allocation counter (linked with -Wl,--wrap=malloc,...) */
+static int nheap=0;
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+void *__wrap_malloc(size_t size)
+{
+    nheap++; return __real_malloc(size);
+}
+void *__wrap_calloc(size_t n, size_t size)
+{
+    nheap++; return __real_calloc(n,size);
+}
+void *__wrap_realloc(void *p, size_t size)
+{
+    nheap++; return __real_realloc(p,size);
+}
+
+/* wsinit(), wsmat(), wsimat(), wszeros(), wsmark(), wsrelease(), wsfree() */
+void utest1(void)
+{
+    wspace_t ws;
+    double *a,*b,*c,*d;
+    int *ia,i,stat;
+    size_t mark;
+
+    stat=wsinit(&ws,100);
+        assert(stat==1&&ws.nalloc==1);
+    mark=wsmark(&ws);
+        assert(mark==0);
+    a=wsmat(&ws,10,5);
+    ia=wsimat(&ws,3,3);
+    c=wszeros(&ws,4,4);
+        assert(a&&ia&&c);
+        assert((double *)ia>=a+50&&c>=(double *)ia);
+    for (i=0;i<16;i++) assert(c[i]==0.0);
+        assert(ws.nalloc==1);
+    d=wsmat(&ws,50,1); /* exceed first block */
+        assert(d&&ws.nalloc==2);
+        assert(wsmat(&ws,0,1)==NULL&&wsimat(&ws,1,0)==NULL);
+    wsrelease(&ws,mark);
+        assert(wsmark(&ws)==0);
+    b=wsmat(&ws,10,5);
+        assert(b==a);
+    wsimat(&ws,3,3);
+    wszeros(&ws,4,4);
+        assert(wsmat(&ws,50,1)==d);
+        assert(ws.nalloc==2);
+    wsrelease(&ws,mark);
+    b=wsmat(&ws,200,1); /* larger than default block size */
+        assert(b&&ws.nalloc==3);
+    wsrelease(&ws,mark);
+    wsmat(&ws,10,5);
+        assert(wsmat(&ws,200,1)==b);
+        assert(ws.nalloc==3);
+    wsfree(&ws);
+        assert(ws.top==NULL&&ws.cur==NULL);
+
+    printf("%s utest1 : OK\n",__FILE__);
+}
+/* check active state index */
+static int chkact(const rtk_t *rtk)
+{
+    int i;
+    for (i=0;i<rtk->nxs;i++) {
+        if (rtk->pxs[rtk->ixs[i]]!=i) return 0;
+        if (i>0&&rtk->ixs[i]<=rtk->ixs[i-1]) return 0;
+    }
+    for (i=0;i<rtk->nx;i++) {
+        if (rtk->x[i]!=0.0&&rtk->pxs[i]<0) return 0;
+    }
+    return 1;
+}
+/* rtkinit(), rtkpos(), rtkfree() : no heap allocation in steady state */
+void utest2(void)
+{
+    char file1[]="../data/rinex/07590920.05o";
+    char file2[]="../data/rinex/30400920.05o";
+    char file3[]="../data/rinex/07590920.05n";
+    obs_t obs={0};
+    nav_t nav={0};
+    sta_t sta={""};
+    obsd_t data[MAXOBS*2];
+    prcopt_t opt=prcopt_default;
+    rtk_t rtk;
+    int i,j,k,n,nu,ne=0,nalloc=0,nfix=0,nh,nheap0=0,stat;
+
+    stat=readrnx(file1,1,"",&obs,&nav,NULL);
+        assert(stat==1);
+    stat=readrnx(file2,2,"",&obs,&nav,&sta);
+        assert(stat==1);
+    stat=readrnx(file3,1,"",NULL,&nav,NULL);
+        assert(stat==1);
+    sortobs(&obs);
+    uniqnav(&nav);
+
+    opt.mode=PMODE_KINEMA;
+    opt.nf=2;
+    opt.modear=ARMODE_FIXHOLD;
+    opt.dynamics=1;
+    for (i=0;i<3;i++) opt.rb[i]=sta.pos[i];
+    rtkinit(&rtk,&opt);
+        assert(rtk.ws.nalloc==1);
+
+    for (i=0;i<obs.n;i=j) {
+        for (j=i+1;j<obs.n;j++) {
+            if (timediff(obs.data[j].time,obs.data[i].time)>DTTOL) break;
+        }
+        /* rover observations followed by base observations */
+        for (k=i,n=0;k<j;k++) if (obs.data[k].rcv==1) data[n++]=obs.data[k];
+        for (k=i,nu=n;k<j;k++) if (obs.data[k].rcv==2) data[n++]=obs.data[k];
+        if (nu<=0||n<=nu) continue;
+
+        nh=nheap;
+        rtkpos(&rtk,data,n,&nav);
+        if (ne>=10) nheap0+=nheap-nh; /* heap allocations after warm-up */
+            assert(chkact(&rtk));
+        if (rtk.sol.stat==SOLQ_FIX) nfix++;
+        if (++ne==10) nalloc=rtk.ws.nalloc;
+    }
+        assert(ne==120&&nfix>0);
+        assert(rtk.ws.nalloc==nalloc);
+        assert(rtk.ws.nalloc==1);
+        assert(nheap0==0);
+
+    rtkfree(&rtk);
+        assert(rtk.ws.top==NULL&&rtk.ixs==NULL);
+    free(obs.data);
+    freenav(&nav,0xFF);
+
+    printf("%s utest2 : OK\n",__FILE__);
+}
+/* rtkactstate() */
+void utest3(void)
+{
+    prcopt_t opt=prcopt_default;
+    rtk_t rtk;
+    int i;
+
+    opt.mode=PMODE_KINEMA;
+    rtkinit(&rtk,&opt);
+        assert(rtk.nxs==0&&chkact(&rtk));
+    rtk.x[10]=1.0; rtkactstate(&rtk,10);
+    rtk.x[5]=1.0; rtkactstate(&rtk,5);
+    rtk.x[20]=1.0; rtkactstate(&rtk,20);
+    rtk.x[5]=2.0; rtkactstate(&rtk,5);
+        assert(rtk.nxs==3&&chkact(&rtk));
+        assert(rtk.ixs[0]==5&&rtk.ixs[1]==10&&rtk.ixs[2]==20);
+    rtk.x[10]=0.0; rtkactstate(&rtk,10);
+        assert(rtk.nxs==2&&rtk.pxs[10]==-1&&rtk.pxs[20]==1&&chkact(&rtk));
+    rtkactstate(&rtk,-1);
+    rtkactstate(&rtk,rtk.nx);
+        assert(rtk.nxs==2);
+    for (i=0;i<rtk.nx;i++) {
+        rtk.x[i]=0.0; rtkactstate(&rtk,i);
+    }
+        assert(rtk.nxs==0&&chkact(&rtk));
+    rtkfree(&rtk);
+
+    printf("%s utest3 : OK\n",__FILE__);
+}
+/* pvatrans() : in place state transition vs dense F*x, F*P*F' */
+void utest4(void)
+{
+    const int n=15,ix[]={0,1,2,3,4,5,6,7,8,10,11,14};
+    const double tt[]={1.0,-0.5,30.0},ta[]={0.5,-0.125,0.0};
+    double x[15],P[15*15],F[15*15],xr[15],FP[15*15],Pr[15*15],A[15*15];
+    int i,j,k,nix=(int)(sizeof(ix)/sizeof(int)),act[15]={0};
+
+    for (k=0;k<nix;k++) act[ix[k]]=1;
+
+    for (k=0;k<3;k++) {
+        /* random states and covariance P=A*A' of active states */
+        for (i=0;i<n*n;i++) A[i]=(double)(rand()%2000-1000)/100.0;
+        matmul("NT",n,n,n,A,A,P);
+        for (i=0;i<n;i++) {
+            x[i]=act[i]?(double)(rand()%2000-1000)/10.0:0.0;
+            for (j=0;j<n;j++) if (!act[i]||!act[j]) P[i+j*n]=0.0;
+        }
+        /* dense reference */
+        for (i=0;i<n*n;i++) F[i]=0.0;
+        for (i=0;i<n;i++) F[i+i*n]=1.0;
+        for (i=0;i<6;i++) F[i+(i+3)*n]=tt[k];
+        for (i=0;i<3;i++) F[i+(i+6)*n]=ta[k];
+        matmul("NN",n,1,n,F,x,xr);
+        matmul("NN",n,n,n,F,P,FP);
+        matmul("NT",n,n,n,FP,F,Pr);
+
+        pvatrans(x,P,n,ix,nix,tt[k],ta[k]);
+
+        for (i=0;i<n;i++) {
+            assert(fabs(x[i]-xr[i])<=1E-9*(1.0+fabs(xr[i])));
+        }
+        for (i=0;i<n*n;i++) {
+            assert(fabs(P[i]-Pr[i])<=1E-9*(1.0+fabs(Pr[i])));
+        }
+        for (i=0;i<n;i++) for (j=0;j<n;j++) {
+            assert(fabs(P[i+j*n]-P[j+i*n])<=1E-9*(1.0+fabs(P[i+j*n])));
+        }
+    }
+    printf("%s utest4 : OK\n",__FILE__);
+}
+int main(void)
+{
+    utest1();
+    utest2();
+    utest3();
+    utest4();
+    return 0;
+}
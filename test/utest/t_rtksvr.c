@@ -0,0 +1,491 @@
+/*------------------------------------------------------------------------------
+* rtklib unit test driver : rtk server functions
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../../src/rtklib.h"
+
+#define MAXLINE     1000        /* max number of solution lines */
+
+static const char *file1="../data/rinex/07590920.05o"; /* rover */
+static const char *file2="../data/rinex/30400920.05o"; /* base */
+static const char *file3="../data/rinex/07590920.05n"; /* navigation */
+static const char *file4="./t_rtksvr1.rtcm3";
+static const char *file5="./t_rtksvr2.rtcm3";
+
+static obs_t obsr,obsb;
+static nav_t navr;
+static sta_t stab;
+static rtksvr_t svr;
+static rtkmsvr_t msvr;
+static rtk_t rtk;
+
+/* duplicate string */
+static char *dupstr(const char *str)
+{
+    char *p=(char *)malloc(strlen(str)+1);
+        assert(p);
+    return strcpy(p,str);
+}
+/* output rtcm3 message to file or stream */
+static void putmsg(rtcm_t *rtcm, int type, FILE *fp, stream_t *str)
+{
+    if (!gen_rtcm3(rtcm,type,0,0)) return;
+    if (fp) fwrite(rtcm->buff,rtcm->nbyte,1,fp);
+    if (str) strwrite(str,rtcm->buff,rtcm->nbyte);
+}
+/* output rtcm3 ephemerides nearest to time */
+static void puteph(rtcm_t *rtcm, const nav_t *nav, gtime_t time, FILE *fp,
+                   stream_t *str)
+{
+    double dt,dtmin;
+    int i,k,sat;
+
+    for (sat=1;sat<=MAXSAT;sat++) {
+        for (i=0,k=-1,dtmin=1E9;i<nav->n;i++) {
+            if (nav->eph[i].sat!=sat) continue;
+            if ((dt=fabs(timediff(nav->eph[i].toe,time)))>=dtmin) continue;
+            k=i; dtmin=dt;
+        }
+        if (k<0) continue;
+        rtcm->nav.eph[sat-1]=nav->eph[k];
+        rtcm->ephsat=sat;
+        putmsg(rtcm,1019,fp,str);
+    }
+}
+/* output rtcm3 observation epoch starting at index i (return next index) */
+static int putobs(rtcm_t *rtcm, const obs_t *obs, int i, FILE *fp,
+                  stream_t *str)
+{
+    obsd_t *data=rtcm->obs.data;
+    int j;
+
+    for (j=i+1;j<obs->n;j++) {
+        if (timediff(obs->data[j].time,obs->data[i].time)>DTTOL) break;
+    }
+    rtcm->time=obs->data[i].time;
+    rtcm->obs.data=obs->data+i;
+    rtcm->obs.n=j-i;
+    putmsg(rtcm,1004,fp,str);
+    rtcm->obs.data=data;
+    rtcm->obs.n=0;
+    return j;
+}
+/* generate rtcm3 file of observation data and ephemerides */
+static void genrtcm(const char *file, const obs_t *obs, const nav_t *nav,
+                    const sta_t *sta, int staid)
+{
+    rtcm_t rtcm;
+    FILE *fp;
+    int i;
+
+    init_rtcm(&rtcm);
+    rtcm.staid=staid;
+    fp=fopen(file,"wb");
+        assert(fp);
+
+    /* ephemerides nearest to the middle of data */
+    if (nav) puteph(&rtcm,nav,obs->data[obs->n/2].time,fp,NULL);
+
+    /* station position */
+    if (sta) {
+        rtcm.sta=*sta;
+        putmsg(&rtcm,1005,fp,NULL);
+    }
+    /* observation data */
+    for (i=0;i<obs->n;) i=putobs(&rtcm,obs,i,fp,NULL);
+    fclose(fp);
+    free_rtcm(&rtcm);
+}
+/* decode rtcm3 file to epochs of observation data as rtk server */
+static int decrtcm(const char *file, gtime_t time, const prcopt_t *opt,
+                   int rcv, obs_t *obs, nav_t *nav)
+{
+    rtcm_t rtcm;
+    FILE *fp;
+    int i,ret,nep=0,sat;
+
+    init_rtcm(&rtcm);
+    rtcm.time=time;
+    fp=fopen(file,"rb");
+        assert(fp);
+
+    while ((ret=input_rtcm3f(&rtcm,fp))>=-1) {
+        if (ret==2&&nav) {
+            sat=rtcm.ephsat;
+            nav->eph[sat-1+MAXSAT*rtcm.ephset]=rtcm.nav.eph[sat-1+MAXSAT*rtcm.ephset];
+        }
+        if (ret!=1) continue;
+
+        for (i=0;i<rtcm.obs.n;i++) {
+            sat=rtcm.obs.data[i].sat;
+            if (opt->exsats[sat-1]==1||!(satsys(sat,NULL)&opt->navsys)) continue;
+            if (obs->n>=obs->nmax) {
+                obs->nmax=obs->nmax<=0?1024:obs->nmax*2;
+                obs->data=(obsd_t *)realloc(obs->data,sizeof(obsd_t)*obs->nmax);
+                    assert(obs->data);
+            }
+            obs->data[obs->n]=rtcm.obs.data[i];
+            obs->data[obs->n++].rcv=rcv;
+        }
+        nep++;
+    }
+    fclose(fp);
+    free_rtcm(&rtcm);
+    sortobs(obs);
+    return nep;
+}
+/* solutions of sequential decoding and positioning */
+static int refsols(const prcopt_t *opt, const solopt_t *sopt, gtime_t time,
+                   char **lines)
+{
+    obs_t obs1={0},obs2={0};
+    obsd_t data[MAXOBS*2];
+    nav_t nav={0};
+    eph_t eph0={0,-1,-1};
+    uint8_t buff[MAXSOLMSG+1];
+    int i,j,k,ke,m,n,nl=0;
+
+    nav.eph=(eph_t *)malloc(sizeof(eph_t)*MAXSAT*4);
+    for (i=0;i<MAXSAT*4;i++) nav.eph[i]=eph0;
+    nav.n=nav.nmax=MAXSAT*4;
+
+    decrtcm(file4,time,opt,1,&obs1,&nav);
+    decrtcm(file5,time,opt,2,&obs2,NULL);
+
+    rtkinit(&rtk,opt);
+
+    for (i=m=k=ke=0;i<obs1.n;i=j) {
+        for (j=i+1;j<obs1.n;j++) {
+            if (timediff(obs1.data[j].time,obs1.data[i].time)>DTTOL) break;
+        }
+        /* latest base epoch not newer than rover */
+        while (m<obs2.n&&timediff(obs2.data[m].time,obs1.data[i].time)<=DTTOL) {
+            for (k=ke=m;ke<obs2.n;ke++) {
+                if (timediff(obs2.data[ke].time,obs2.data[k].time)>DTTOL) break;
+            }
+            m=ke;
+        }
+        for (n=0;i+n<j;n++) data[n]=obs1.data[i+n];
+        for (m=k;m<ke&&n<MAXOBS*2;m++) data[n++]=obs2.data[m];
+
+        rtkpos(&rtk,data,n,&nav);
+
+        if (rtk.sol.stat==SOLQ_NONE) continue;
+        n=outsols(buff,&rtk.sol,rtk.rb,sopt);
+        buff[n]='\0';
+            assert(nl<MAXLINE);
+        lines[nl++]=dupstr((char *)buff);
+    }
+    rtkfree(&rtk);
+    free(obs1.data); free(obs2.data); free(nav.eph);
+    return nl;
+}
+/* read solution lines */
+static int readsols(const char *file, char **lines)
+{
+    FILE *fp;
+    char buff[1024];
+    int n=0;
+
+    if (!(fp=fopen(file,"r"))) return 0;
+    while (fgets(buff,sizeof(buff),fp)&&n<MAXLINE) {
+        if (buff[0]=='%') continue;
+        lines[n++]=dupstr(buff);
+    }
+    fclose(fp);
+    return n;
+}
+/* read solution status lines */
+static int readstat(const char *file, char **lines)
+{
+    FILE *fp;
+    char buff[1024];
+    int n=0;
+
+    if (!(fp=fopen(file,"r"))) return 0;
+    while (fgets(buff,sizeof(buff),fp)&&n<MAXLINE*64) {
+        lines[n++]=dupstr(buff);
+    }
+    fclose(fp);
+    return n;
+}
+/* free solution lines */
+static void freesols(char **lines, int n)
+{
+    int i;
+    for (i=0;i<n;i++) free(lines[i]);
+}
+/* compare lines */
+static int cmplines(const void *p1, const void *p2)
+{
+    return strcmp(*(char **)p1,*(char **)p2);
+}
+/* run rtk server with file streams to end of rover epochs */
+static int runsvr(const prcopt_t *opt, solopt_t *sopt, gtime_t tend,
+                  const char *outfile)
+{
+    prcopt_t popt=*opt;
+    rtksvrstat_t *stat;
+    int strs[MAXSTRRTK]={STR_FILE,STR_FILE,0,STR_FILE};
+    int fmts[3]={STRFMT_RTCM3,STRFMT_RTCM3,STRFMT_RTCM3},i,j,stat1;
+    int sstat[MAXSTRRTK];
+    const char *paths[MAXSTRRTK]={"","","","","","","",""};
+    const char *cmds[3]={NULL,NULL,NULL},*opts[3]={"","",""};
+    double nmeapos[3]={0};
+    char errmsg[1024];
+
+    paths[0]=file4;
+    paths[1]=file5;
+    paths[3]=outfile;
+
+    stat1=rtksvrinit(&svr);
+        assert(stat1&&svr.basewait==0);
+    svr.basewait=1000; /* pair epochs independent of decoder timing */
+    stat1=rtksvrstart(&svr,10,32768,strs,paths,fmts,0,cmds,cmds,opts,0,0,
+                      nmeapos,&popt,sopt,NULL,errmsg);
+        assert(stat1);
+
+    stat=(rtksvrstat_t *)malloc(sizeof(rtksvrstat_t));
+        assert(stat);
+
+    /* wait for solution of last rover epoch */
+    for (i=0;i<3000;i++) {
+        sleepms(10);
+        if (rtksvrgetstat(&svr,stat)&&stat->sol.time.time&&
+            timediff(stat->sol.time,tend)>=-DTTOL) break;
+    }
+    rtksvrstop(&svr,cmds);
+
+    /* status after stop */
+    rtksvrsstat(&svr,sstat,errmsg);
+    for (j=0;j<MAXSTRRTK;j++) assert(sstat[j]==0);
+    stat1=rtksvrgetstat(&svr,stat);
+        assert(stat1&&stat->state==0);
+        assert(stat->nmsg3[0][4]>0&&stat->nmsg3[0][19]>0); /* 1004,1019 */
+        assert(stat->nmsg3[1][4]>0&&stat->nmsg3[1][5]>0);  /* 1004,1005 */
+    for (j=0;j<MAXSTRRTK;j++) assert(stat->sstat[j]==0);
+    free(stat);
+    rtksvrfree(&svr);
+    return i<3000;
+}
+/* wait for data written to base stream read by multi-rover rtk server */
+static int waitbase(void)
+{
+    int i,inb,outb;
+
+    for (i=0;i<5000;i++) {
+        strsum(msvr.stream,&inb,NULL,&outb,NULL);
+        if (inb>=outb) return 1;
+        sleepms(1);
+    }
+    return 0;
+}
+/* wait for rover epochs processed by multi-rover rtk server */
+static int waitrov(int nep)
+{
+    rtksvrlat_t lat;
+    int i,k;
+
+    for (i=0;i<5000;i++) {
+        for (k=0;k<msvr.nrov;k++) {
+            rtkmsvrrstat(&msvr,k,NULL,&lat,NULL);
+            if (lat.n+lat.ndrop<nep) break;
+        }
+        if (k>=msvr.nrov) return 1;
+        sleepms(1);
+    }
+    return 0;
+}
+/* run multi-rover rtk server with rovers paced epoch by epoch */
+static void runmsvr(const prcopt_t *opt, const prcopt_t *ropt,
+                    const solopt_t *sopt, const char **outfile, int nrov,
+                    int nworker, const char *statfile)
+{
+    rtkctx_t ctx;
+    rtcm_t rtcm;
+    rtksvrlat_t lat;
+    int strs[2]={STR_MEMBUF,STR_NONE},rstrs[2]={STR_MEMBUF,STR_FILE};
+    int fmts[2]={STRFMT_RTCM3,STRFMT_RTCM3},i,j,k,m,nep,stat;
+    const char *paths[2]={"",""},*rpaths[2];
+    char errmsg[1024];
+
+    init_rtkctx(&ctx);
+    setrtkctx(&ctx);
+    timeset(gpst2utc(obsr.data[0].time));
+    stat=rtkopenstat(statfile,1);
+        assert(stat);
+
+    stat=rtkmsvrinit(&msvr,nrov);
+        assert(stat);
+    msvr.ctx=&ctx;
+    for (k=0;k<nrov;k++) {
+        rpaths[0]="";
+        rpaths[1]=outfile[k];
+        stat=rtkmsvrsetrov(&msvr,k,rstrs,rpaths,STRFMT_RTCM3,0,ropt+k,sopt);
+            assert(stat);
+    }
+    stat=rtkmsvrstart(&msvr,1,nworker,strs,paths,fmts,opt,errmsg);
+        assert(stat);
+
+    /* ephemerides */
+    init_rtcm(&rtcm);
+    puteph(&rtcm,&navr,obsr.data[obsr.n/2].time,NULL,msvr.stream);
+    for (i=0;i<5000&&!rtkmsvrrstat(&msvr,0,NULL,NULL,NULL);i++) sleepms(1);
+        assert(i<5000);
+
+    /* base epochs not newer than rover epoch and rover epochs */
+    for (i=j=nep=0;i<obsr.n;nep++) {
+        while (j<obsb.n&&timediff(obsb.data[j].time,obsr.data[i].time)<=DTTOL) {
+            j=putobs(&rtcm,&obsb,j,NULL,msvr.stream);
+        }
+        stat=waitbase();
+            assert(stat);
+        for (k=0;k<nrov;k++) m=putobs(&rtcm,&obsr,i,NULL,msvr.rov[k].stream);
+        i=m;
+        stat=waitrov(nep+1);
+            assert(stat);
+    }
+    for (k=0;k<nrov;k++) {
+        rtkmsvrrstat(&msvr,k,NULL,&lat,NULL);
+            assert(lat.n==nep&&lat.ndrop==0);
+    }
+    rtkmsvrstop(&msvr);
+    rtkmsvrfree(&msvr);
+    free_rtcm(&rtcm);
+    setrtkctx(NULL);
+    free_rtkctx(&ctx);
+}
+/* rtksvrstart() : rover/base epochs of file streams vs sequential decoding,
+                  status after rtksvrstop() */
+void utest1(void)
+{
+    gtime_t time,tend;
+    prcopt_t opt=prcopt_default;
+    solopt_t sopt[2];
+    char *lines1[MAXLINE],*lines2[MAXLINE];
+    int i,j,n1,n2,stat;
+
+    memset(&obsr,0,sizeof(obs_t));
+    memset(&obsb,0,sizeof(obs_t));
+    memset(&navr,0,sizeof(nav_t));
+    stat=readrnx(file1,1,"",&obsr,&navr,NULL);
+        assert(stat==1);
+    stat=readrnx(file2,2,"",&obsb,NULL,&stab);
+        assert(stat==1);
+    stat=readrnx(file3,0,"",NULL,&navr,NULL);
+        assert(stat==1);
+    sortobs(&obsr);
+    sortobs(&obsb);
+
+    genrtcm(file4,&obsr,&navr,NULL,1);
+    genrtcm(file5,&obsb,NULL,&stab,2);
+    time=obsr.data[0].time;
+    tend=obsr.data[obsr.n-1].time;
+
+    opt.mode=PMODE_KINEMA;
+    opt.navsys=SYS_GPS;
+    opt.refpos=POSOPT_POS_XYZ;
+    matcpy(opt.rb,stab.pos,3,1);
+    sopt[0]=sopt[1]=solopt_default;
+    sopt[0].posf=SOLF_XYZ;
+    sopt[0].timef=0;
+
+    /* cpu time for week number of rtcm3 ephemerides */
+    timeset(gpst2utc(time));
+
+    n1=refsols(&opt,sopt,time,lines1);
+        assert(n1>100);
+
+    for (i=0;i<3;i++) {
+        timeset(gpst2utc(time)); /* reset by closing file stream */
+        stat=runsvr(&opt,sopt,tend,"./t_rtksvr1.pos");
+            assert(stat);
+        n2=readsols("./t_rtksvr1.pos",lines2);
+            assert(n2==n1);
+        for (j=0;j<n1;j++) {
+            assert(!strcmp(lines1[j],lines2[j]));
+        }
+        freesols(lines2,n2);
+    }
+    timereset();
+    freesols(lines1,n1);
+    remove("./t_rtksvr1.pos");
+
+    printf("%s utest1 : OK\n",__FILE__);
+}
+/* rtkmsvrstart() : two rovers by worker threads vs single-rover servers */
+void utest2(void)
+{
+    const char *outfile1[]={"./t_rtksvr2.pos"},*outfile2[]={"./t_rtksvr3.pos"};
+    const char *outfile3[]={"./t_rtksvr4.pos","./t_rtksvr5.pos"};
+    const char *statfile[]={"./t_rtksvr1.stat","./t_rtksvr2.stat",
+                            "./t_rtksvr3.stat"};
+    prcopt_t opt=prcopt_default,ropt[2];
+    solopt_t sopt=solopt_default;
+    char *lines1[MAXLINE],*lines2[MAXLINE],*lines3[MAXLINE*2];
+    static char *stat1[MAXLINE*64],*stat2[MAXLINE*64];
+    int i,j,n1,n2,n3,ns1,ns2;
+
+    opt.navsys=SYS_GPS;
+    opt.refpos=POSOPT_POS_XYZ;
+    matcpy(opt.rb,stab.pos,3,1);
+    opt.tidecorr=1;
+    ropt[0]=ropt[1]=opt;
+    ropt[0].mode=PMODE_KINEMA;
+    ropt[1].mode=PMODE_STATIC;
+    sopt.posf=SOLF_XYZ;
+    sopt.timef=0;
+
+    /* single-rover servers */
+    runmsvr(&opt,ropt  ,&sopt,outfile1,1,1,statfile[0]);
+    runmsvr(&opt,ropt+1,&sopt,outfile2,1,1,statfile[1]);
+    n1=readsols(outfile1[0],lines1);
+    n2=readsols(outfile2[0],lines2);
+        assert(n1>100&&n2>100);
+    ns1=readstat(statfile[0],stat1);
+    ns1+=readstat(statfile[1],stat1+ns1);
+        assert(ns1>n1+n2);
+
+    /* two rovers by two workers */
+    for (i=0;i<3;i++) {
+        runmsvr(&opt,ropt,&sopt,outfile3,2,2,statfile[2]);
+        n3=readsols(outfile3[0],lines3);
+            assert(n3==n1);
+        for (j=0;j<n1;j++) assert(!strcmp(lines1[j],lines3[j]));
+        freesols(lines3,n3);
+        n3=readsols(outfile3[1],lines3);
+            assert(n3==n2);
+        for (j=0;j<n2;j++) assert(!strcmp(lines2[j],lines3[j]));
+        freesols(lines3,n3);
+
+        /* solution status of both rovers */
+        ns2=readstat(statfile[2],stat2);
+            assert(ns2==ns1);
+        qsort(stat1,ns1,sizeof(char *),cmplines);
+        qsort(stat2,ns2,sizeof(char *),cmplines);
+        for (j=0;j<ns1;j++) assert(!strcmp(stat1[j],stat2[j]));
+        freesols(stat2,ns2);
+    }
+    timereset();
+    freesols(lines1,n1);
+    freesols(lines2,n2);
+    freesols(stat1,ns1);
+    remove(outfile1[0]); remove(outfile2[0]);
+    remove(outfile3[0]); remove(outfile3[1]);
+    for (i=0;i<3;i++) remove(statfile[i]);
+
+    printf("%s utest2 : OK\n",__FILE__);
+}
+int main(void)
+{
+    utest1();
+    utest2();
+    remove(file4);
+    remove(file5);
+    free(obsr.data); free(obsb.data);
+    freenav(&navr,0xFF);
+    return 0;
+}
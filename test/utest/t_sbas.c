@@ -0,0 +1,285 @@
+/*------------------------------------------------------------------------------
+* rtklib unit test driver : sbas functions
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../../src/rtklib.h"
+
+static nav_t nav1,nav2;
+static sbs_t sbs;
+
+/* generate type 18 ionospheric grid point mask message */
+static void gentype18(sbsmsg_t *msg, int band, int iodi, int pat)
+{
+    int i;
+
+    memset(msg->msg,0,sizeof(msg->msg));
+    setbitu(msg->msg,8,6,18);
+    setbitu(msg->msg,18,4,band);
+    setbitu(msg->msg,22,2,iodi);
+    for (i=1;i<=201;i++) {
+        setbitu(msg->msg,23+i,1,(i*7+band)%pat?1:0);
+    }
+}
+/* generate type 26 ionospheric delay message */
+static void gentype26(sbsmsg_t *msg, int band, int block, int iodi)
+{
+    int i,j;
+
+    memset(msg->msg,0,sizeof(msg->msg));
+    setbitu(msg->msg,8,6,26);
+    setbitu(msg->msg,14,4,band);
+    setbitu(msg->msg,18,4,block);
+    for (i=0;i<15;i++) {
+        j=block*15+i+band*3;
+        setbitu(msg->msg,22+i*13,9,j%13==0?0x1FF:20+j%300); /* delay */
+        setbitu(msg->msg,22+i*13+9,4,j%11==0?15:j%14);      /* give */
+    }
+    setbitu(msg->msg,217,2,iodi);
+}
+/* compare igp indices */
+static int cmpigpidx(const sbsigpidx_t *idx1, const sbsigpidx_t *idx2)
+{
+    int i,j;
+
+    if (idx1->ovf!=idx2->ovf) return 0;
+    for (i=0;i<NIGPLAT;i++) for (j=0;j<NIGPLON;j++) {
+        if (idx1->n[i][j]!=idx2->n[i][j]) return 0;
+        if (memcmp(idx1->igp[i][j],idx2->igp[i][j],
+                   sizeof(int16_t)*idx1->n[i][j])) return 0;
+    }
+    return 1;
+}
+/* generate type 1 prn mask message */
+static void gentype1(sbsmsg_t *msg, int iodp)
+{
+    int i;
+
+    memset(msg->msg,0,sizeof(msg->msg));
+    setbitu(msg->msg,8,6,1);
+    for (i=1;i<=32;i++) {
+        setbitu(msg->msg,13+i,1,(i+iodp)%5?1:0);
+    }
+    setbitu(msg->msg,224,2,iodp);
+}
+/* generate type 2-3 fast correction message */
+static void gentype2(sbsmsg_t *msg, int type, int iodp, int t)
+{
+    int i;
+
+    memset(msg->msg,0,sizeof(msg->msg));
+    setbitu(msg->msg,8,6,type);
+    setbitu(msg->msg,14,2,t%4);
+    setbitu(msg->msg,16,2,iodp);
+    for (i=0;i<13;i++) {
+        setbits(msg->msg,18+i*12,12,(t*7+i*31)%2001-1000);
+        setbitu(msg->msg,174+4*i,4,(t+i)%14);
+    }
+}
+/* add sbas message */
+static void addmsg(sbs_t *sbs, const sbsmsg_t *msg)
+{
+    assert(sbs->n<sbs->nmax);
+    sbs->msgs[sbs->n++]=*msg;
+}
+/* generate sbas messages of two geos */
+static void genmsgs(sbs_t *sbs, gtime_t ts, int nt)
+{
+    sbsmsg_t msg={0};
+    int t,k,band,iodp,iodi;
+
+    sbs->nmax=nt*2;
+    sbs->msgs=(sbsmsg_t *)malloc(sizeof(sbsmsg_t)*sbs->nmax);
+        assert(sbs->msgs);
+
+    for (t=0;t<nt;t++) {
+        msg.tow=(int)time2gpst(timeadd(ts,t),&msg.week);
+        iodp=(t/400)%4;
+        iodi=(t/500)%4;
+        band=(t/20)%3;
+        k=t%20;
+
+        /* geo 1: masks and ionospheric corrections */
+        msg.prn=129;
+        if      (k== 0) gentype1(&msg,iodp);
+        else if (k== 1) gentype18(&msg,band,iodi,3+(t/500)%3);
+        else if (k<=15) gentype26(&msg,band,k-2,iodi);
+        else {
+            memset(msg.msg,0,sizeof(msg.msg));
+            setbitu(msg.msg,8,6,k==16?9:63);
+        }
+        addmsg(sbs,&msg);
+
+        /* geo 2: fast corrections */
+        msg.prn=131;
+        gentype2(&msg,2+t%2,iodp,t);
+        addmsg(sbs,&msg);
+    }
+}
+/* replay sbas messages to time */
+static void replaymsgs(const sbs_t *sbs, gtime_t time, nav_t *nav)
+{
+    int i;
+
+    memset(&nav->sbssat,0,sizeof(sbssat_t));
+    memset(nav->sbsion,0,sizeof(nav->sbsion));
+    memset(&nav->sbsidx,0,sizeof(sbsigpidx_t));
+
+    for (i=0;i<sbs->n;i++) {
+        if (timediff(gpst2time(sbs->msgs[i].week,sbs->msgs[i].tow),time)>0.0) {
+            break;
+        }
+        if (getbitu(sbs->msgs[i].msg,8,6)!=9) sbsupdatecorr(sbs->msgs+i,nav);
+    }
+}
+/* compare sbas correction states */
+static int cmpstate(const nav_t *nav1, const nav_t *nav2)
+{
+    return !memcmp(&nav1->sbssat,&nav2->sbssat,sizeof(sbssat_t))&&
+           !memcmp(nav1->sbsion,nav2->sbsion,sizeof(nav1->sbsion))&&
+           cmpigpidx(&nav1->sbsidx,&nav2->sbsidx);
+}
+/* update ionospheric corrections of all bands */
+static void updateion(nav_t *nav, gtime_t time, int iodi, int pat)
+{
+    sbsmsg_t msg={0};
+    int band,block;
+
+    time2gpst(time,&msg.week);
+    msg.tow=(int)time2gpst(time,NULL);
+    msg.prn=129;
+
+    for (band=0;band<=MAXBAND;band++) {
+        gentype18(&msg,band,iodi,pat);
+            assert(sbsupdatecorr(&msg,nav)==18);
+        for (block=0;block<14;block++) {
+            gentype26(&msg,band,block,iodi);
+            sbsupdatecorr(&msg,nav);
+        }
+    }
+}
+/* compare ionospheric corrections with igp index and linear search */
+static int cmpioncorr(gtime_t time, nav_t *nav)
+{
+    double pos[3]={0},azel[2],delay1,var1,delay2,var2;
+    int i,j,k,stat1,stat2,nok=0;
+
+    nav2=*nav;
+    nav2.sbsidx.ovf=1; /* linear search */
+
+    for (i=-89;i<=89;i+=2) for (j=-180;j<180;j+=7) for (k=0;k<4;k++) {
+        pos[0]=(i+0.3)*D2R;
+        pos[1]=(j+0.6)*D2R;
+        azel[0]=k*90.0*D2R;
+        azel[1]=(15.0+k*20.0)*D2R;
+        stat1=sbsioncorr(time,nav  ,pos,azel,&delay1,&var1);
+        stat2=sbsioncorr(time,&nav2,pos,azel,&delay2,&var2);
+        if (stat1!=stat2||delay1!=delay2||var1!=var2) return -1;
+        if (stat1&&delay1!=0.0) nok++;
+    }
+    return nok;
+}
+/* sbsupdatecorr(), sbsioncorr() : igp index vs linear search */
+void utest1(void)
+{
+    double ep[]={2020,1,1,0,0,0};
+    gtime_t time=epoch2time(ep);
+    int n;
+
+    memset(&nav1,0,sizeof(nav_t));
+
+    updateion(&nav1,time,1,5);
+        assert(!nav1.sbsidx.ovf);
+    n=cmpioncorr(time,&nav1);
+        assert(n>0);
+
+    /* update masks with fewer igps and new iodi */
+    updateion(&nav1,time,2,3);
+        assert(!nav1.sbsidx.ovf);
+    n=cmpioncorr(time,&nav1);
+        assert(n>0);
+
+    printf("%s utest1 : OK\n",__FILE__);
+}
+/* sbsupdateigp() : incremental index vs rebuilt index */
+void utest2(void)
+{
+    double ep[]={2020,1,1,0,0,0};
+    gtime_t time=epoch2time(ep);
+    int i,band;
+
+    memset(&nav1,0,sizeof(nav_t));
+    updateion(&nav1,time,1,4);
+
+    /* change mask of band 3 without sbsupdatecorr() */
+    sbsupdateigp(&nav1,3,0);
+    for (i=0;i<nav1.sbsion[3].nigp;i+=2) {
+        nav1.sbsion[3].igp[i/2]=nav1.sbsion[3].igp[i];
+    }
+    nav1.sbsion[3].nigp=(nav1.sbsion[3].nigp+1)/2;
+    sbsupdateigp(&nav1,3,1);
+
+    /* rebuild index */
+    nav2=nav1;
+    memset(&nav2.sbsidx,0,sizeof(sbsigpidx_t));
+    for (band=0;band<=MAXBAND;band++) sbsupdateigp(&nav2,band,1);
+        assert(cmpigpidx(&nav1.sbsidx,&nav2.sbsidx));
+        assert(cmpioncorr(time,&nav1)>0);
+
+    /* remove all igps */
+    for (band=0;band<=MAXBAND;band++) sbsupdateigp(&nav1,band,0);
+    memset(&nav2.sbsidx,0,sizeof(sbsigpidx_t));
+        assert(cmpigpidx(&nav1.sbsidx,&nav2.sbsidx));
+
+    printf("%s utest2 : OK\n",__FILE__);
+}
+/* sbsmakesnap(), sbsseekcorr() : seek vs replay from the beginning */
+void utest3(void)
+{
+    double ep[]={2020,1,1,0,0,0},tsub[]={0.0,10.0,7.0};
+    gtime_t ts=epoch2time(ep),time;
+    int i,j,t,n,index,nt=1300;
+
+    genmsgs(&sbs,ts,nt);
+
+    for (i=0;i<3;i++) {
+        n=sbsmakesnap(&sbs,300.0,tsub[i]);
+            assert(n==(nt-1)/300);
+
+        /* backward as postpos */
+        memset(&nav1,0,sizeof(nav_t));
+        for (t=nt+1,index=-1;t>=-1;t--) {
+            time=timeadd(ts,t-1.0+DTTOL);
+            index=sbsseekcorr(&sbs,time,index,&nav1);
+            replaymsgs(&sbs,time,&nav2);
+                assert(cmpstate(&nav1,&nav2));
+                assert(index==(t<=0?0:(t>=nt?sbs.n:t*2)));
+        }
+        /* forward and random jumps */
+        for (j=0,t=0,index=-1;j<200;j++) {
+            t=j<100?t+(j%7):(t*37+j*101)%(nt+10);
+            time=timeadd(ts,t+0.5);
+            index=sbsseekcorr(&sbs,time,j%3?index:-1,&nav1);
+            replaymsgs(&sbs,time,&nav2);
+                assert(cmpstate(&nav1,&nav2));
+        }
+        /* without snapshots */
+        sbsfreesnap(&sbs);
+        time=timeadd(ts,nt/2+0.5);
+        sbsseekcorr(&sbs,time,-1,&nav1);
+        replaymsgs(&sbs,time,&nav2);
+            assert(cmpstate(&nav1,&nav2));
+    }
+    free(sbs.msgs);
+
+    printf("%s utest3 : OK\n",__FILE__);
+}
+int main(void)
+{
+    utest1();
+    utest2();
+    utest3();
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*------------------------------------------------------------------------------
+* rtklib unit test driver : stream server functions
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../../src/rtklib.h"
+
+#define MAXOUT      5           /* max number of output streams */
+
+static const char *file1="../data/rcvraw/ubx_20080526.ubx";
+
+static strsvr_t svr;
+
+/* read file */
+static int readfile(const char *file, uint8_t **buff)
+{
+    FILE *fp;
+    long n;
+
+    if (!(fp=fopen(file,"rb"))) return -1;
+    fseek(fp,0,SEEK_END);
+    n=ftell(fp);
+    fseek(fp,0,SEEK_SET);
+    *buff=(uint8_t *)malloc(n>0?n:1);
+        assert(*buff);
+    n=(long)fread(*buff,1,n,fp);
+    fclose(fp);
+    return (int)n;
+}
+/* compare files */
+static int cmpfile(const char *file1, const char *file2)
+{
+    uint8_t *buff1,*buff2;
+    int n1,n2,stat;
+
+    n1=readfile(file1,&buff1);
+    n2=readfile(file2,&buff2);
+    if (n1<0||n2<0) return 0;
+    stat=n1==n2&&!memcmp(buff1,buff2,n1);
+    free(buff1); free(buff2);
+    return stat;
+}
+/* new converter of ubx input */
+static strconv_t *newconv(const char *msgs, const char *opt)
+{
+    strconv_t *conv=strconvnew(STRFMT_UBX,STRFMT_RTCM3,msgs,0,0,opt);
+        assert(conv);
+    return conv;
+}
+/* run stream server from input file to output files */
+static void runsvr(strconv_t **conv, const char **outfile, int nout,
+                   int (*check)(void))
+{
+    int opts[]={10000,10000,2000,32768,10,0,30,0};
+    int strs[MAXOUT+1]={STR_FILE},stat[MAXOUT+1],log_stat[MAXOUT+1];
+    int byte[MAXOUT+1],bps[MAXOUT+1],i,size;
+    const char *paths[MAXOUT+1],*logs[MAXOUT+1],*cmds[MAXOUT+1];
+    char msg[MAXSTRMSG*(MAXOUT+1)];
+    uint8_t *buff;
+
+    size=readfile(file1,&buff);
+        assert(size>0);
+    free(buff);
+
+    paths[0]=file1;
+    logs[0]="";
+    cmds[0]=NULL;
+    for (i=0;i<nout;i++) {
+        strs[i+1]=STR_FILE;
+        paths[i+1]=outfile[i];
+        logs[i+1]="";
+        cmds[i+1]=NULL;
+    }
+    strsvrinit(&svr,nout);
+    i=strsvrstart(&svr,opts,strs,paths,logs,conv,cmds,cmds,NULL);
+        assert(i);
+    if (check) assert(check());
+
+    /* wait for end of input */
+    for (i=0;i<5000;i++) {
+        strsvrstat(&svr,stat,log_stat,byte,bps,msg);
+        if (byte[0]>=size) break;
+        sleepms(1);
+    }
+        assert(i<5000);
+    strsvrstop(&svr,cmds);
+}
+/* check shared decoders and sources of encoded frames */
+static int checkdecs(void)
+{
+    return svr.dec[0]&&svr.dec[1]==svr.dec[0]&&svr.dec[2]==svr.dec[0]&&
+           !svr.dec[3]&&svr.dec[4]&&svr.dec[4]!=svr.dec[0]&&
+           svr.convsrc[0]==0&&svr.convsrc[1]==0&&svr.convsrc[2]==2&&
+           svr.convsrc[4]==4;
+}
+/* strsvrstart() : outputs of shared decoder vs stream servers of a converter */
+void utest1(void)
+{
+    const char *msgs[]={"1004,1019","1004,1019","1074,1019","","1004,1019"};
+    const char *opts[]={"","","","","-INVCP"};
+    const char *reffile[]={"./t_strsvr1.rtcm3","","./t_strsvr2.rtcm3","",
+                           "./t_strsvr3.rtcm3"};
+    const char *outfile[]={"./t_strsvr4.rtcm3","./t_strsvr5.rtcm3",
+                           "./t_strsvr6.rtcm3","./t_strsvr7.ubx",
+                           "./t_strsvr8.rtcm3"};
+    strconv_t *conv[MAXOUT]={0};
+    uint8_t *buff;
+    int i;
+
+    /* reference of each converter decoding input */
+    for (i=0;i<MAXOUT;i++) {
+        if (!*reffile[i]) continue;
+        conv[0]=newconv(msgs[i],opts[i]);
+        runsvr(conv,reffile+i,1,NULL);
+        strconvfree(conv[0]);
+    }
+    /* converters sharing decoders and encoded frames and raw output */
+    for (i=0;i<MAXOUT;i++) conv[i]=*msgs[i]?newconv(msgs[i],opts[i]):NULL;
+    runsvr(conv,outfile,MAXOUT,checkdecs);
+    for (i=0;i<MAXOUT;i++) strconvfree(conv[i]);
+
+        assert(readfile(reffile[0],&buff)>1000);
+    free(buff);
+        assert(cmpfile(reffile[0],outfile[0]));
+        assert(cmpfile(reffile[0],outfile[1]));
+        assert(cmpfile(reffile[2],outfile[2]));
+        assert(cmpfile(file1     ,outfile[3]));
+        assert(cmpfile(reffile[4],outfile[4]));
+        assert(!cmpfile(reffile[0],reffile[2]));
+        assert(!cmpfile(reffile[0],reffile[4]));
+
+    for (i=0;i<MAXOUT;i++) {
+        if (*reffile[i]) remove(reffile[i]);
+        remove(outfile[i]);
+    }
+    printf("%s utest1 : OK\n",__FILE__);
+}
+int main(void)
+{
+    utest1();
+    return 0;
+}
@@ -202,7 +202,7 @@ static int simobs(simopt_t simopt, rnxopt_t rnxopt, nav_t *nav, obs_t *obs) {
     /* earth tides correction */
     if (simopt.tidecorr>0) {
       dr[0]=dr[1]=dr[2]=0.0;
-      tidedisp(gpst2utc(time),simopt.rr,simopt.tidecorr,&nav->erp,
+      tidedisp(gpst2utc(time),simopt.rr,simopt.tidecorr,&nav->erp,NULL,
                simopt.odisp,dr);
       for (k=0;k<3;k++) rr[k] += dr[k];
     };